@@ -9,6 +9,7 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <algorithm>
 #include <errno.h>
 #include <fcntl.h>
 #include <fstream>
@@ -36,6 +37,7 @@
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonValue>
+#include <QtCore/QRunnable>
 #include <QtCore/QThread>
 #include <QtNetwork/QNetworkRequest>
 #include <QtNetwork/QNetworkReply>
@@ -50,6 +52,7 @@
 #include <StDev.h>
 #include <UUID.h>
 
+#include "AudioMixKernels.h"
 #include "AudioRingBuffer.h"
 #include "AudioMixerClientData.h"
 #include "AudioMixerDatagramProcessor.h"
@@ -77,6 +80,39 @@ bool AudioMixer::_printStreamStats = false;
 
 bool AudioMixer::_enableFilter = true;
 
+AudioMixerWorkerState::AudioMixerWorkerState() :
+    candidateStreams(),
+    sumMixes(0),
+    sumCandidateStreams(0),
+    listenersMixed(0),
+    mixTimeStats(0, READ_DATAGRAMS_STATS_WINDOW_SECONDS)
+{
+    memset(preMixSamples, 0, sizeof(preMixSamples));
+    memset(mixSamples, 0, sizeof(mixSamples));
+    memset(streamSamples, 0, sizeof(streamSamples));
+}
+
+/// runs on a thread of the mixing thread pool, claiming and mixing listeners until none are left for the frame
+class AudioMixerWorker : public QRunnable {
+public:
+    AudioMixerWorker(AudioMixer* mixer, AudioMixerWorkerState* state) :
+        _mixer(mixer),
+        _state(state)
+    {
+        // the same worker is handed to the pool every frame
+        setAutoDelete(false);
+    }
+    
+    void run() {
+        _mixer->mixClaimedListeners(*_state);
+        _mixer->_workersDoneSemaphore.release();
+    }
+    
+private:
+    AudioMixer* _mixer;
+    AudioMixerWorkerState* _state;
+};
+
 bool AudioMixer::shouldMute(float quietestFrame) {
     return (quietestFrame > _noiseMutingThreshold);
 }
@@ -91,21 +127,62 @@ AudioMixer::AudioMixer(const QByteArray& packet) :
     _numStatFrames(0),
     _sumListeners(0),
     _sumMixes(0),
+    _sumCandidateStreams(0),
     _lastPerSecondCallbackTime(usecTimestampNow()),
     _sendAudioStreamStats(false),
     _datagramsReadPerCallStats(0, READ_DATAGRAMS_STATS_WINDOW_SECONDS),
     _timeSpentPerCallStats(0, READ_DATAGRAMS_STATS_WINDOW_SECONDS),
     _timeSpentPerHashMatchCallStats(0, READ_DATAGRAMS_STATS_WINDOW_SECONDS),
-    _readPendingCallsPerSecondStats(1, READ_DATAGRAMS_STATS_WINDOW_SECONDS)
+    _readPendingCallsPerSecondStats(1, READ_DATAGRAMS_STATS_WINDOW_SECONDS),
+    _packetRing(NUM_PACKET_RING_SLOTS),
+    _packetRingDepthStats(0, READ_DATAGRAMS_STATS_WINDOW_SECONDS),
+    _packetRingDropsPerSecondStats(1, READ_DATAGRAMS_STATS_WINDOW_SECONDS),
+    _packetRingDropsAtLastSecond(0)
 {
     // constant defined in AudioMixer.h.  However, we don't want to include this here
     // we will soon find a better common home for these audio-related constants
+    
+    setupMixingThreads(DEFAULT_NUM_MIXING_THREADS);
+}
+
+AudioMixer::~AudioMixer() {
+    _mixingThreadPool.waitForDone();
+    
+    qDeleteAll(_workers);
+    qDeleteAll(_workerStates);
+}
+
+void AudioMixer::setupMixingThreads(int numMixingThreads) {
+    numMixingThreads = glm::clamp(numMixingThreads, 1, MAX_NUM_MIXING_THREADS);
+    
+    _mixingThreadPool.waitForDone();
+    
+    qDeleteAll(_workers);
+    _workers.clear();
+    qDeleteAll(_workerStates);
+    _workerStates.clear();
+    
+    for (int i = 0; i < numMixingThreads; i++) {
+        _workerStates.append(new AudioMixerWorkerState());
+        
+        // the mixer thread mixes alongside the pool, so it needs no runnable of its own
+        if (i > 0) {
+            _workers.append(new AudioMixerWorker(this, _workerStates[i]));
+        }
+    }
+    
+    _mixingThreadPool.setMaxThreadCount(glm::max(numMixingThreads - 1, 1));
+    
+    // keep the pool threads around between frames, we need them again in 10ms
+    const int MIXING_THREAD_EXPIRY_MSECS = 10 * 1000;
+    _mixingThreadPool.setExpiryTimeout(MIXING_THREAD_EXPIRY_MSECS);
 }
 
 const float ATTENUATION_BEGINS_AT_DISTANCE = 1.0f;
 const float RADIUS_OF_HEAD = 0.076f;
 
-int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* listenerNodeData,
+int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerWorkerState& worker,
+                                                         AudioMixerClientData* listenerNodeData,
                                                          const QUuid& streamUUID,
                                                          PositionalAudioStream* streamToAdd,
                                                          AvatarAudioStream* listeningNodeStream) {
@@ -162,7 +239,7 @@ int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* l
         return 0;
     }
     
-    ++_sumMixes;
+    ++worker.sumMixes;
     
     if (streamToAdd->getType() == PositionalAudioStream::Injector) {
         attenuationCoefficient *= reinterpret_cast<InjectedAudioStream*>(streamToAdd)->getAttenuationRatio();
@@ -321,41 +398,33 @@ int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* l
             for (int i = 0; i < numSamplesDelay; i++) {
                 int16_t originalHistoricalSample = *delayStreamSourceSamples;
 
-                _preMixSamples[delayedChannelHistoricalAudioOutputIndex] += originalHistoricalSample 
-                                                                                 * attenuationAndWeakChannelRatioAndFade;
+                worker.preMixSamples[delayedChannelHistoricalAudioOutputIndex] += originalHistoricalSample 
+                                                                                  * attenuationAndWeakChannelRatioAndFade;
                 ++delayStreamSourceSamples; // move our input pointer
                 delayedChannelHistoricalAudioOutputIndex += OUTPUT_SAMPLES_PER_INPUT_SAMPLE; // move our output sample
             }
         }
 
         // Here's where we copy the MONO input to the STEREO output, and account for delay and weak side attenuation
-        for (int inputSample = 0; inputSample < inputSampleCount; inputSample++) {
-            int16_t originalSample = streamPopOutput[inputSample];
-            int16_t leftSideSample = originalSample * leftSideAttenuation;
-            int16_t rightSideSample = originalSample * rightSideAttenuation;
-
-            // since we might be delayed, don't write beyond our maxOutputIndex
-            if (leftDestinationIndex <= maxOutputIndex) {
-                _preMixSamples[leftDestinationIndex] += leftSideSample;
-            }
-            if (rightDestinationIndex <= maxOutputIndex) {
-                _preMixSamples[rightDestinationIndex] += rightSideSample;
-            }
-
-            leftDestinationIndex += OUTPUT_SAMPLES_PER_INPUT_SAMPLE;
-            rightDestinationIndex += OUTPUT_SAMPLES_PER_INPUT_SAMPLE;
-        }
+        streamPopOutput.readSamples(worker.streamSamples, inputSampleCount);
+        
+        // since we might be delayed, don't write beyond our maxOutputIndex
+        int leftSampleCount = std::min(inputSampleCount,
+                                       (maxOutputIndex - leftDestinationIndex) / OUTPUT_SAMPLES_PER_INPUT_SAMPLE + 1);
+        int rightSampleCount = std::min(inputSampleCount,
+                                        (maxOutputIndex - rightDestinationIndex) / OUTPUT_SAMPLES_PER_INPUT_SAMPLE + 1);
+        
+        AudioMixKernels::mixScaledIntoInterleavedChannel(worker.preMixSamples + leftDestinationIndex,
+                                                         worker.streamSamples, leftSampleCount, leftSideAttenuation);
+        AudioMixKernels::mixScaledIntoInterleavedChannel(worker.preMixSamples + rightDestinationIndex,
+                                                         worker.streamSamples, rightSampleCount, rightSideAttenuation);
         
     } else {
-        int stereoDivider = streamToAdd->isStereo() ? 1 : 2;
-
-       float attenuationAndFade = attenuationCoefficient * repeatedFrameFadeFactor;
+        float attenuationAndFade = attenuationCoefficient * repeatedFrameFadeFactor;
 
-        for (int s = 0; s < AudioConstants::NETWORK_FRAME_SAMPLES_STEREO; s++) {
-            _preMixSamples[s] = glm::clamp(_preMixSamples[s] + (int)(streamPopOutput[s / stereoDivider] * attenuationAndFade),
-                                            AudioConstants::MIN_SAMPLE_VALUE,
-                                           AudioConstants::MAX_SAMPLE_VALUE);
-        }
+        streamPopOutput.readSamples(worker.streamSamples, AudioConstants::NETWORK_FRAME_SAMPLES_STEREO);
+        AudioMixKernels::mixScaledSaturated(worker.preMixSamples, worker.streamSamples,
+                                            AudioConstants::NETWORK_FRAME_SAMPLES_STEREO, attenuationAndFade);
     }
 
     if (!sourceIsSelf && _enableFilter && !streamToAdd->ignorePenumbraFilter()) {
@@ -418,54 +487,106 @@ int AudioMixer::addStreamToMixForListeningNodeWithStream(AudioMixerClientData* l
         // set the gain on both filter channels
         penumbraFilter.setParameters(0, 0, AudioConstants::SAMPLE_RATE, penumbraFilterFrequency, penumbraFilterGainL, penumbraFilterSlope);
         penumbraFilter.setParameters(0, 1, AudioConstants::SAMPLE_RATE, penumbraFilterFrequency, penumbraFilterGainR, penumbraFilterSlope);
-        penumbraFilter.render(_preMixSamples, _preMixSamples, AudioConstants::NETWORK_FRAME_SAMPLES_STEREO / 2);
+        penumbraFilter.render(worker.preMixSamples, worker.preMixSamples, AudioConstants::NETWORK_FRAME_SAMPLES_STEREO / 2);
     }
     
-    // Actually mix the _preMixSamples into the _mixSamples here.
-    for (int s = 0; s < AudioConstants::NETWORK_FRAME_SAMPLES_STEREO; s++) {
-        _mixSamples[s] = glm::clamp(_mixSamples[s] + _preMixSamples[s], AudioConstants::MIN_SAMPLE_VALUE,
-                                    AudioConstants::MAX_SAMPLE_VALUE);
-    }
+    // Actually mix the worker's preMixSamples into its mixSamples here.
+    AudioMixKernels::mixSaturated(worker.mixSamples, worker.preMixSamples, AudioConstants::NETWORK_FRAME_SAMPLES_STEREO);
 
     return 1;
 }
 
-int AudioMixer::prepareMixForListeningNode(Node* node) {
+int AudioMixer::prepareMixForListeningNode(AudioMixerWorkerState& worker, Node* node) {
     AvatarAudioStream* nodeAudioStream = static_cast<AudioMixerClientData*>(node->getLinkedData())->getAvatarAudioStream();
     AudioMixerClientData* listenerNodeData = static_cast<AudioMixerClientData*>(node->getLinkedData());
     
     // zero out the client mix for this node
-    memset(_preMixSamples, 0, sizeof(_preMixSamples));
-    memset(_mixSamples, 0, sizeof(_mixSamples));
+    memset(worker.preMixSamples, 0, sizeof(worker.preMixSamples));
+    memset(worker.mixSamples, 0, sizeof(worker.mixSamples));
 
     // loop through all other nodes that have sufficient audio to mix
     int streamsMixed = 0;
     
-    DependencyManager::get<NodeList>()->eachNode([&](const SharedNodePointer& otherNode){
-        if (otherNode->getLinkedData()) {
-            AudioMixerClientData* otherNodeClientData = (AudioMixerClientData*) otherNode->getLinkedData();
-            
-            // enumerate the ARBs attached to the otherNode and add all that should be added to mix
+    // only visit the streams that are loud enough and close enough to possibly clear the audibility threshold
+    _frameStreamIndex.findCandidates(nodeAudioStream->getPosition(), worker.candidateStreams);
+    worker.sumCandidateStreams += (int)worker.candidateStreams.size();
+    
+    for (size_t i = 0; i < worker.candidateStreams.size(); i++) {
+        const IndexedAudioStream& otherStream = _frameStreamIndex.getStream(worker.candidateStreams[i]);
+        
+        if (*otherStream.node != *node || otherStream.stream->shouldLoopbackForNode()) {
+            streamsMixed += addStreamToMixForListeningNodeWithStream(worker, listenerNodeData, otherStream.streamUUID,
+                                                                     otherStream.stream, nodeAudioStream);
+        }
+    }
+    
+    listenerNodeData->setMixForFrame(worker.mixSamples, streamsMixed);
+    
+    return streamsMixed;
+}
+
+void AudioMixer::buildFrameStreamIndex() {
+    _frameStreamIndex.clear();
+    
+    // walk the frame's node snapshot instead of the NodeList, the index holds raw pointers to these nodes
+    foreach (const SharedNodePointer& otherNode, _frameNodes) {
+        AudioMixerClientData* otherNodeClientData = (AudioMixerClientData*) otherNode->getLinkedData();
+        
+        // enumerate the ARBs attached to the otherNode and add all that could be added to a mix
+        
+        const QHash<QUuid, PositionalAudioStream*>& otherNodeAudioStreams = otherNodeClientData->getAudioStreams();
+        QHash<QUuid, PositionalAudioStream*>::ConstIterator i;
+        for (i = otherNodeAudioStreams.constBegin(); i != otherNodeAudioStreams.constEnd(); i++) {
+            PositionalAudioStream* otherNodeStream = i.value();
+            QUuid streamUUID = i.key();
             
-            const QHash<QUuid, PositionalAudioStream*>& otherNodeAudioStreams = otherNodeClientData->getAudioStreams();
-            QHash<QUuid, PositionalAudioStream*>::ConstIterator i;
-            for (i = otherNodeAudioStreams.constBegin(); i != otherNodeAudioStreams.constEnd(); i++) {
-                PositionalAudioStream* otherNodeStream = i.value();
-                QUuid streamUUID = i.key();
-                
-                if (otherNodeStream->getType() == PositionalAudioStream::Microphone) {
-                    streamUUID = otherNode->getUUID();
-                }
-                
-                if (*otherNode != *node || otherNodeStream->shouldLoopbackForNode()) {
-                    streamsMixed += addStreamToMixForListeningNodeWithStream(listenerNodeData, streamUUID,
-                                                                             otherNodeStream, nodeAudioStream);
-                }
+            if (otherNodeStream->getType() == PositionalAudioStream::Microphone) {
+                streamUUID = otherNode->getUUID();
             }
+            
+            _frameStreamIndex.addStream(otherNode.data(), streamUUID, otherNodeStream, _minAudibilityThreshold);
         }
-    });
+    }
     
-    return streamsMixed;
+    _frameStreamIndex.finalize();
+}
+
+void AudioMixer::mixClaimedListeners(AudioMixerWorkerState& worker) {
+    quint64 mixStart = usecTimestampNow();
+    
+    int listenerIndex;
+    while ((listenerIndex = _nextListenerIndex.fetchAndAddRelaxed(1)) < _frameListeners.size()) {
+        prepareMixForListeningNode(worker, _frameListeners[listenerIndex].data());
+        ++worker.listenersMixed;
+    }
+    
+    worker.mixTimeStats.update(usecTimestampNow() - mixStart);
+}
+
+void AudioMixer::mixFrameForListeners() {
+    _nextListenerIndex.store(0);
+    
+    // only wake up as many pool threads as there are listeners beyond the one the mixer thread takes
+    int numPoolWorkers = glm::min(_workers.size(), _frameListeners.size() - 1);
+    
+    for (int i = 0; i < numPoolWorkers; i++) {
+        _mixingThreadPool.start(_workers[i]);
+    }
+    
+    // the mixer thread does its share of the frame instead of sitting idle
+    mixClaimedListeners(*_workerStates[0]);
+    
+    if (numPoolWorkers > 0) {
+        // every pool worker releases once when it runs out of listeners to claim
+        _workersDoneSemaphore.acquire(numPoolWorkers);
+    }
+    
+    foreach (AudioMixerWorkerState* workerState, _workerStates) {
+        _sumMixes += workerState->sumMixes;
+        workerState->sumMixes = 0;
+        _sumCandidateStreams += workerState->sumCandidateStreams;
+        workerState->sumCandidateStreams = 0;
+    }
 }
 
 void AudioMixer::sendAudioEnvironmentPacket(SharedNodePointer node) {
@@ -531,14 +652,36 @@ void AudioMixer::sendAudioEnvironmentPacket(SharedNodePointer node) {
             memcpy(envDataAt, &wetLevel, sizeof(float));
             envDataAt += sizeof(float);
         }
-        DependencyManager::get<NodeList>()->writeDatagram(clientEnvBuffer, envDataAt - clientEnvBuffer, node);
+        DependencyManager::get<NodeList>()->writeDatagramInPlace(clientEnvBuffer, envDataAt - clientEnvBuffer, node);
     }
 }
 
+void AudioMixer::processQueuedPackets() {
+    quint64 processStart = usecTimestampNow();
+    
+    // only take what is already queued, so that packets arriving meanwhile wait for the next frame
+    // instead of holding this one up
+    int numQueuedPackets = _packetRing.getDepth();
+    _packetRingDepthStats.update(numQueuedPackets);
+    
+    for (int i = 0; i < numQueuedPackets; i++) {
+        PacketRing::Slot* slot = _packetRing.beginRead();
+        readPendingDatagram(slot->packet, slot->senderSockAddr);
+        _packetRing.endRead();
+    }
+    
+    _datagramsReadPerCallStats.update(numQueuedPackets);
+    _timeSpentPerCallStats.update(usecTimestampNow() - processStart);
+}
+
 void AudioMixer::readPendingDatagram(const QByteArray& receivedPacket, const HifiSockAddr& senderSockAddr) {
     auto nodeList = DependencyManager::get<NodeList>();
     
-    if (nodeList->packetVersionAndHashMatch(receivedPacket)) {
+    quint64 hashMatchStart = usecTimestampNow();
+    bool isVersionAndHashMatch = nodeList->packetVersionAndHashMatch(receivedPacket);
+    _timeSpentPerHashMatchCallStats.update(usecTimestampNow() - hashMatchStart);
+    
+    if (isVersionAndHashMatch) {
         // pull any new audio data from nodes off of the network stack
         PacketType mixerPacketType = packetTypeForPacket(receivedPacket);
         if (mixerPacketType == PacketTypeMicrophoneAudioNoEcho
@@ -557,7 +700,7 @@ void AudioMixer::readPendingDatagram(const QByteArray& receivedPacket, const Hif
                 nodeList->eachNode([&](const SharedNodePointer& node){
                     if (node->getType() == NodeType::Agent && node->getActiveSocket() &&
                         node->getLinkedData() && node != sendingNode) {
-                        nodeList->writeDatagram(packet, packet.size(), node);
+                        nodeList->writeDatagramInPlace(packet, node);
                     }
                 });
             }
@@ -576,16 +719,20 @@ void AudioMixer::sendStatsPacket() {
     statsObject["performance_throttling_ratio"] = _performanceThrottlingRatio;
 
     statsObject["average_listeners_per_frame"] = (float) _sumListeners / (float) _numStatFrames;
+    statsObject["mixing_threads"] = _workerStates.size();
     
     if (_sumListeners > 0) {
         statsObject["average_mixes_per_listener"] = (float) _sumMixes / (float) _sumListeners;
+        statsObject["average_candidate_streams_per_listener"] = (float) _sumCandidateStreams / (float) _sumListeners;
     } else {
         statsObject["average_mixes_per_listener"] = 0.0;
+        statsObject["average_candidate_streams_per_listener"] = 0.0;
     }
 
     ThreadedAssignment::addPacketStatsAndSendStatsPacket(statsObject);
     _sumListeners = 0;
     _sumMixes = 0;
+    _sumCandidateStreams = 0;
     _numStatFrames = 0;
 
 
@@ -621,6 +768,18 @@ void AudioMixer::sendStatsPacket() {
     somethingToSend = true;
     sizeOfStats += property.size() + value.size();
     
+    property = "packet_ring_stats";
+    value = getPacketRingStatsString();
+    statsObject2[qPrintable(property)] = value;
+    somethingToSend = true;
+    sizeOfStats += property.size() + value.size();
+    
+    property = "mix_time_per_worker_stats";
+    value = getMixingWorkerTimeStatsString();
+    statsObject2[qPrintable(property)] = value;
+    somethingToSend = true;
+    sizeOfStats += property.size() + value.size();
+    
     auto nodeList = DependencyManager::get<NodeList>();
     int clientNumber = 0;
     
@@ -664,7 +823,8 @@ void AudioMixer::run() {
     _datagramProcessingThread->setObjectName("Datagram Processor Thread");
     
     // create an AudioMixerDatagramProcessor and move it to that thread
-    AudioMixerDatagramProcessor* datagramProcessor = new AudioMixerDatagramProcessor(nodeList->getNodeSocket(), thread());
+    AudioMixerDatagramProcessor* datagramProcessor = new AudioMixerDatagramProcessor(nodeList->getNodeSocket(), thread(),
+                                                                                     _packetRing);
     datagramProcessor->moveToThread(_datagramProcessingThread);
     
     // remove the NodeList as the parent of the node socket
@@ -675,9 +835,6 @@ void AudioMixer::run() {
     connect(&nodeList->getNodeSocket(), &QUdpSocket::readyRead,
             datagramProcessor, &AudioMixerDatagramProcessor::readPendingDatagrams);
     
-    // connect to the datagram processing thread signal that tells us we have to handle a packet
-    connect(datagramProcessor, &AudioMixerDatagramProcessor::packetRequiresProcessing, this, &AudioMixer::readPendingDatagram);
-    
     // delete the datagram processor and the associated thread when the QThread quits
     connect(_datagramProcessingThread, &QThread::finished, datagramProcessor, &QObject::deleteLater);
     connect(datagramProcessor, &QObject::destroyed, _datagramProcessingThread, &QThread::deleteLater);
@@ -782,6 +939,15 @@ void AudioMixer::run() {
             _lastPerSecondCallbackTime = now;
         }
         
+        // everything that arrived since the last frame goes into the streams before we pop from them
+        processQueuedPackets();
+        
+        _frameNodes.resize(0);
+        _frameListeners.resize(0);
+        
+        // everything this frame sends goes out in as few system calls as we can manage once the frame is done
+        nodeList->beginBatchedSends();
+        
         nodeList->eachNode([&](const SharedNodePointer& node) {
             
             if (node->getLinkedData()) {
@@ -796,62 +962,80 @@ void AudioMixer::run() {
                 if (nodeData->getAvatarAudioStream()
                     && shouldMute(nodeData->getAvatarAudioStream()->getQuietestFrameLoudness())) {
                     QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeNoisyMute);
-                    nodeList->writeDatagram(packet, node);
+                    nodeList->writeDatagramInPlace(packet, node);
                 }
                 
+                _frameNodes.append(node);
+                
                 if (node->getType() == NodeType::Agent && node->getActiveSocket()
                     && nodeData->getAvatarAudioStream()) {
-
-                    int streamsMixed = prepareMixForListeningNode(node.data());
-
-                    char* mixDataAt;
-                    if (streamsMixed > 0) {
-                        // pack header
-                        int numBytesMixPacketHeader = populatePacketHeader(clientMixBuffer, PacketTypeMixedAudio);
-                        mixDataAt = clientMixBuffer + numBytesMixPacketHeader;
-
-                        // pack sequence number
-                        quint16 sequence = nodeData->getOutgoingSequenceNumber();
-                        memcpy(mixDataAt, &sequence, sizeof(quint16));
-                        mixDataAt  += sizeof(quint16);
-                        
-                        // pack mixed audio samples
-                        memcpy(mixDataAt, _mixSamples, AudioConstants::NETWORK_FRAME_BYTES_STEREO);
-                        mixDataAt += AudioConstants::NETWORK_FRAME_BYTES_STEREO;
-                    } else {
-                        // pack header
-                        int numBytesPacketHeader = populatePacketHeader(clientMixBuffer, PacketTypeSilentAudioFrame);
-                        mixDataAt = clientMixBuffer + numBytesPacketHeader;
-
-                        // pack sequence number
-                        quint16 sequence = nodeData->getOutgoingSequenceNumber();
-                        memcpy(mixDataAt, &sequence, sizeof(quint16));
-                        mixDataAt += sizeof(quint16);
-
-                        // pack number of silent audio samples
-                        quint16 numSilentSamples = AudioConstants::NETWORK_FRAME_SAMPLES_STEREO;
-                        memcpy(mixDataAt, &numSilentSamples, sizeof(quint16));
-                        mixDataAt += sizeof(quint16);
-                    }
-                    
-                    // Send audio environment
-                    sendAudioEnvironmentPacket(node);
-
-                    // send mixed audio packet
-                    nodeList->writeDatagram(clientMixBuffer, mixDataAt - clientMixBuffer, node);
-                    nodeData->incrementOutgoingMixedAudioSequenceNumber();
-
-                    // send an audio stream stats packet if it's time
-                    if (_sendAudioStreamStats) {
-                        nodeData->sendAudioStreamStatsPackets(node);
-                        _sendAudioStreamStats = false;
-                    }
-
-                    ++_sumListeners;
+                    _frameListeners.append(node);
                 }
             }
         });
         
+        // every stream has popped its frame, index them by position and audible range
+        buildFrameStreamIndex();
+        
+        // now mix for all listeners (in parallel if we have mixing threads)
+        mixFrameForListeners();
+        
+        foreach (const SharedNodePointer& node, _frameListeners) {
+            AudioMixerClientData* nodeData = (AudioMixerClientData*)node->getLinkedData();
+            
+            char* mixDataAt;
+            if (nodeData->getStreamsMixedForFrame() > 0) {
+                // pack header
+                int numBytesMixPacketHeader = populatePacketHeader(clientMixBuffer, PacketTypeMixedAudio);
+                mixDataAt = clientMixBuffer + numBytesMixPacketHeader;
+
+                // pack sequence number
+                quint16 sequence = nodeData->getOutgoingSequenceNumber();
+                memcpy(mixDataAt, &sequence, sizeof(quint16));
+                mixDataAt  += sizeof(quint16);
+                
+                // pack mixed audio samples
+                memcpy(mixDataAt, nodeData->getMixSamples(), AudioConstants::NETWORK_FRAME_BYTES_STEREO);
+                mixDataAt += AudioConstants::NETWORK_FRAME_BYTES_STEREO;
+            } else {
+                // pack header
+                int numBytesPacketHeader = populatePacketHeader(clientMixBuffer, PacketTypeSilentAudioFrame);
+                mixDataAt = clientMixBuffer + numBytesPacketHeader;
+
+                // pack sequence number
+                quint16 sequence = nodeData->getOutgoingSequenceNumber();
+                memcpy(mixDataAt, &sequence, sizeof(quint16));
+                mixDataAt += sizeof(quint16);
+
+                // pack number of silent audio samples
+                quint16 numSilentSamples = AudioConstants::NETWORK_FRAME_SAMPLES_STEREO;
+                memcpy(mixDataAt, &numSilentSamples, sizeof(quint16));
+                mixDataAt += sizeof(quint16);
+            }
+            
+            // Send audio environment
+            sendAudioEnvironmentPacket(node);
+
+            // send mixed audio packet
+            nodeList->writeDatagramInPlace(clientMixBuffer, mixDataAt - clientMixBuffer, node);
+            nodeData->incrementOutgoingMixedAudioSequenceNumber();
+
+            // send an audio stream stats packet if it's time
+            if (_sendAudioStreamStats) {
+                nodeData->sendAudioStreamStatsPackets(node);
+                _sendAudioStreamStats = false;
+            }
+
+            ++_sumListeners;
+        }
+        
+        nodeList->flushBatchedSends();
+        
+        // don't hold on to nodes that may be killed before the next frame
+        _frameStreamIndex.clear();
+        _frameNodes.resize(0);
+        _frameListeners.resize(0);
+        
         ++_numStatFrames;
         
         QCoreApplication::processEvents();
@@ -874,6 +1058,10 @@ void AudioMixer::perSecondActions() {
     int callsLastSecond = _datagramsReadPerCallStats.getCurrentIntervalSamples();
     _readPendingCallsPerSecondStats.update(callsLastSecond);
 
+    int packetRingDrops = _packetRing.getNumDropped();
+    _packetRingDropsPerSecondStats.update(packetRingDrops - _packetRingDropsAtLastSecond);
+    _packetRingDropsAtLastSecond = packetRingDrops;
+
     if (_printStreamStats) {
 
         printf("\n================================================================================\n\n");
@@ -908,6 +1096,15 @@ void AudioMixer::perSecondActions() {
             _timeSpentPerHashMatchCallStats.getWindowSum() / WINDOW_LENGTH_USECS * 100.0,
             _timeSpentPerHashMatchCallStats.getCurrentIntervalSum() / USECS_PER_SECOND * 100.0);
 
+        printf("            Packets queued at the start of a frame | avg: %.2f, avg_30s: %.2f, max_30s: %d\n",
+            _packetRingDepthStats.getAverage(),
+            _packetRingDepthStats.getWindowAverage(),
+            _packetRingDepthStats.getWindowMax());
+
+        printf("     Packets dropped with the packet ring full | total: %d, last_second: %.0f\n",
+            packetRingDrops,
+            _packetRingDropsPerSecondStats.getLastCompleteIntervalStats().getSum());
+
         DependencyManager::get<NodeList>()->eachNode([](const SharedNodePointer& node) {
             if (node->getLinkedData()) {
                 AudioMixerClientData* nodeData = (AudioMixerClientData*)node->getLinkedData();
@@ -924,6 +1121,11 @@ void AudioMixer::perSecondActions() {
     _datagramsReadPerCallStats.currentIntervalComplete();
     _timeSpentPerCallStats.currentIntervalComplete();
     _timeSpentPerHashMatchCallStats.currentIntervalComplete();
+    _packetRingDepthStats.currentIntervalComplete();
+    
+    foreach (AudioMixerWorkerState* workerState, _workerStates) {
+        workerState->mixTimeStats.currentIntervalComplete();
+    }
 }
 
 QString AudioMixer::getReadPendingDatagramsCallsPerSecondsStatsString() const {
@@ -954,6 +1156,27 @@ QString AudioMixer::getReadPendingDatagramsHashMatchTimeStatsString() const {
     return result;
 }
 
+QString AudioMixer::getPacketRingStatsString() const {
+    QString result = "queued_per_frame_avg_30s: " + QString::number(_packetRingDepthStats.getWindowAverage(), 'f', 2)
+        + " queued_per_frame_max_30s: " + QString::number(_packetRingDepthStats.getWindowMax())
+        + " slots: " + QString::number(_packetRing.getNumSlots())
+        + " dropped_last_sec: " + QString::number(_packetRingDropsPerSecondStats.getLastCompleteIntervalStats().getSum())
+        + " dropped_total: " + QString::number(_packetRing.getNumDropped());
+    return result;
+}
+
+QString AudioMixer::getMixingWorkerTimeStatsString() const {
+    QString result;
+    for (int i = 0; i < _workerStates.size(); i++) {
+        const AudioMixerWorkerState* workerState = _workerStates[i];
+        result += "worker_" + QString::number(i) + ":"
+            + " usecs_per_frame_avg_30s: " + QString::number(workerState->mixTimeStats.getWindowAverage(), 'f', 2)
+            + " usecs_per_frame_max_30s: " + QString::number(workerState->mixTimeStats.getWindowMax())
+            + " listeners_mixed_total: " + QString::number(workerState->listenersMixed) + " ";
+    }
+    return result;
+}
+
 void AudioMixer::parseSettingsObject(const QJsonObject &settingsObject) {
     if (settingsObject.contains(AUDIO_BUFFER_GROUP_KEY)) {
         QJsonObject audioBufferGroupObject = settingsObject[AUDIO_BUFFER_GROUP_KEY].toObject();
@@ -1049,6 +1272,20 @@ void AudioMixer::parseSettingsObject(const QJsonObject &settingsObject) {
             }
         }
 
+        const QString NUM_MIXING_THREADS = "mixing_threads";
+        if (audioEnvGroupObject[NUM_MIXING_THREADS].isString()) {
+            bool ok = false;
+            int numMixingThreads = audioEnvGroupObject[NUM_MIXING_THREADS].toString().toInt(&ok);
+            if (ok) {
+                if (numMixingThreads <= 0) {
+                    // 0 means use one mixing thread per core
+                    numMixingThreads = QThread::idealThreadCount();
+                }
+                setupMixingThreads(numMixingThreads);
+                qDebug() << "Mixing listeners on" << _workerStates.size() << "threads";
+            }
+        }
+
         const QString FILTER_KEY = "enable_filter";
         if (audioEnvGroupObject[FILTER_KEY].isBool()) {
             _enableFilter = audioEnvGroupObject[FILTER_KEY].toBool();
@@ -12,23 +12,65 @@
 #ifndef hifi_AudioMixer_h
 #define hifi_AudioMixer_h
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
+
+#include <vector>
+
 #include <AABox.h>
 #include <AudioRingBuffer.h>
+#include <MovingMinMaxAvg.h>
+#include <PacketRing.h>
 #include <ThreadedAssignment.h>
 
+#include "AudioStreamSpatialIndex.h"
+
 class PositionalAudioStream;
 class AvatarAudioStream;
 class AudioMixerClientData;
+class AudioMixerWorker;
 
 const int SAMPLE_PHASE_DELAY_AT_90 = 20;
 
 const int READ_DATAGRAMS_STATS_WINDOW_SECONDS = 30;
 
+// packets queued between the datagram processor and the mixer, about a second of a 100 client mixer's input
+const int NUM_PACKET_RING_SLOTS = 1024;
+
+const int DEFAULT_NUM_MIXING_THREADS = 1;
+const int MAX_NUM_MIXING_THREADS = 32;
+
+/// scratch buffers and stats for one thread that mixes a subset of the listeners each frame
+struct AudioMixerWorkerState {
+    AudioMixerWorkerState();
+    
+    // used on a per stream basis to run the filter on before mixing, large enough to handle the historical
+    // data from a phase delay as well as an entire network buffer
+    int16_t preMixSamples[AudioConstants::NETWORK_FRAME_SAMPLES_STEREO + (SAMPLE_PHASE_DELAY_AT_90 * 2)];
+    
+    // client samples capacity is larger than what will be sent to optimize mixing
+    // we are MMX adding 4 samples at a time so we need client samples to have an extra 4
+    int16_t mixSamples[AudioConstants::NETWORK_FRAME_SAMPLES_STEREO + (SAMPLE_PHASE_DELAY_AT_90 * 2)];
+    
+    // the frame of the stream being mixed, copied out of its ring buffer so the mix kernels see contiguous samples
+    int16_t streamSamples[AudioConstants::NETWORK_FRAME_SAMPLES_STEREO];
+    
+    // indices into the frame's AudioStreamSpatialIndex of the streams the current listener might hear
+    std::vector<int> candidateStreams;
+    
+    int sumMixes;
+    int sumCandidateStreams;
+    int listenersMixed;
+    MovingMinMaxAvg<quint64> mixTimeStats; // update with usecs this worker spent mixing in each frame
+};
+
 /// Handles assignments of type AudioMixer - mixing streams of audio and re-distributing to various clients.
 class AudioMixer : public ThreadedAssignment {
     Q_OBJECT
 public:
     AudioMixer(const QByteArray& packet);
+    ~AudioMixer();
 public slots:
     /// threaded run of assignment
     void run();
@@ -41,25 +83,49 @@ public slots:
     static const InboundAudioStream::Settings& getStreamSettings() { return _streamSettings; }
     
 private:
+    friend class AudioMixerWorker;
+    
     /// adds one stream to the mix for a listening node
-    int addStreamToMixForListeningNodeWithStream(AudioMixerClientData* listenerNodeData,
-                                                    const QUuid& streamUUID,
-                                                    PositionalAudioStream* streamToAdd,
-                                                    AvatarAudioStream* listeningNodeStream);
+    int addStreamToMixForListeningNodeWithStream(AudioMixerWorkerState& worker,
+                                                 AudioMixerClientData* listenerNodeData,
+                                                 const QUuid& streamUUID,
+                                                 PositionalAudioStream* streamToAdd,
+                                                 AvatarAudioStream* listeningNodeStream);
+    
+    /// prepares a mix for one Node in the worker's buffers and hands it to the node's AudioMixerClientData
+    int prepareMixForListeningNode(AudioMixerWorkerState& worker, Node* node);
     
-    /// prepares and sends a mix to one Node
-    int prepareMixForListeningNode(Node* node);
+    /// mixes listeners from _frameListeners until every listener for this frame has been claimed
+    void mixClaimedListeners(AudioMixerWorkerState& worker);
+    
+    /// mixes every listener in _frameListeners, spreading the work across the mixing threads
+    void mixFrameForListeners();
+    
+    void setupMixingThreads(int numMixingThreads);
     
     /// Send Audio Environment packet for a single node
     void sendAudioEnvironmentPacket(SharedNodePointer node);
 
-    // used on a per stream basis to run the filter on before mixing, large enough to handle the historical
-    // data from a phase delay as well as an entire network buffer
-    int16_t _preMixSamples[AudioConstants::NETWORK_FRAME_SAMPLES_STEREO + (SAMPLE_PHASE_DELAY_AT_90 * 2)];
+    // state for each of the threads mixing in a frame, index 0 is always used by the mixer thread itself
+    QVector<AudioMixerWorkerState*> _workerStates;
+    QVector<AudioMixerWorker*> _workers;
+    QThreadPool _mixingThreadPool;
+    QSemaphore _workersDoneSemaphore;
     
-    // client samples capacity is larger than what will be sent to optimize mixing
-    // we are MMX adding 4 samples at a time so we need client samples to have an extra 4
-    int16_t _mixSamples[AudioConstants::NETWORK_FRAME_SAMPLES_STEREO + (SAMPLE_PHASE_DELAY_AT_90 * 2)];
+    // the nodes with audio data this frame, the listeners among them,
+    // and the index of the next listener that has not been claimed by a worker
+    QVector<SharedNodePointer> _frameNodes;
+    QVector<SharedNodePointer> _frameListeners;
+    QAtomicInt _nextListenerIndex;
+    
+    // every stream with something to mix this frame, bucketed by how far away it can be heard
+    AudioStreamSpatialIndex _frameStreamIndex;
+    
+    /// rebuilds _frameStreamIndex from the streams of the nodes in _frameNodes
+    void buildFrameStreamIndex();
+
+    /// processes the packets the datagram processor queued before this call, once per frame
+    void processQueuedPackets();
 
     void perSecondActions();
     
@@ -69,6 +135,8 @@ private:
     QString getReadPendingDatagramsPacketsPerCallStatsString() const;
     QString getReadPendingDatagramsTimeStatsString() const;
     QString getReadPendingDatagramsHashMatchTimeStatsString() const;
+    QString getMixingWorkerTimeStatsString() const;
+    QString getPacketRingStatsString() const;
     
     void parseSettingsObject(const QJsonObject& settingsObject);
     
@@ -80,6 +148,7 @@ private:
     int _numStatFrames;
     int _sumListeners;
     int _sumMixes;
+    int _sumCandidateStreams;
     
     QHash<QString, AABox> _audioZones;
     struct ZonesSettings {
@@ -110,6 +179,12 @@ private:
     MovingMinMaxAvg<quint64> _timeSpentPerHashMatchCallStats; // update with usecs spent inside each packetVersionAndHashMatch call
 
     MovingMinMaxAvg<int> _readPendingCallsPerSecondStats;     // update with # of readPendingDatagrams calls in the last second
+
+    // filled by the datagram processor thread, drained by processQueuedPackets
+    PacketRing _packetRing;
+    MovingMinMaxAvg<int> _packetRingDepthStats;     // update with the # of packets queued at the start of each frame
+    MovingMinMaxAvg<int> _packetRingDropsPerSecondStats;     // update with the # of packets dropped in the last second
+    int _packetRingDropsAtLastSecond;
 };
 
 #endif // hifi_AudioMixer_h
@@ -23,6 +23,7 @@
 AudioMixerClientData::AudioMixerClientData() :
     _audioStreams(),
     _outgoingMixedAudioSequenceNumber(0),
+    _streamsMixedForFrame(0),
     _downstreamAudioStreamStats()
 {
 }
@@ -192,7 +193,7 @@ void AudioMixerClientData::sendAudioStreamStatsPackets(const SharedNodePointer&
         numStreamStatsRemaining -= numStreamStatsToPack;
 
         // send the current packet
-        nodeList->writeDatagram(packet, dataAt - packet, destinationNode);
+        nodeList->writeDatagramInPlace(packet, dataAt - packet, destinationNode);
     }
 }
 
@@ -313,3 +314,10 @@ PerListenerSourcePairData* AudioMixerClientData::getListenerSourcePairData(const
     }
     return _listenerSourcePairData[sourceUUID]; 
 }
+
+void AudioMixerClientData::setMixForFrame(const int16_t* mixSamples, int streamsMixed) {
+    _streamsMixedForFrame = streamsMixed;
+    if (streamsMixed > 0) {
+        memcpy(_mixSamples, mixSamples, sizeof(_mixSamples));
+    }
+}
@@ -56,6 +56,11 @@ public:
     void printUpstreamDownstreamStats() const;
 
     PerListenerSourcePairData* getListenerSourcePairData(const QUuid& sourceUUID);
+    
+    /// stores the mix prepared for this listener by a mixing thread, to be sent from the mixer thread
+    void setMixForFrame(const int16_t* mixSamples, int streamsMixed);
+    const int16_t* getMixSamples() const { return _mixSamples; }
+    int getStreamsMixedForFrame() const { return _streamsMixedForFrame; }
 private:
     void printAudioStreamStats(const AudioStreamStats& streamStats) const;
 
@@ -66,6 +71,9 @@ private:
     QHash<QUuid, PerListenerSourcePairData*> _listenerSourcePairData;
 
     quint16 _outgoingMixedAudioSequenceNumber;
+    
+    int16_t _mixSamples[AudioConstants::NETWORK_FRAME_SAMPLES_STEREO];
+    int _streamsMixedForFrame;
 
     AudioStreamStats _downstreamAudioStreamStats;
 };
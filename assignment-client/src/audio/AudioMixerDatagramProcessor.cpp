@@ -11,14 +11,18 @@
 
 #include <QDebug>
 
+#include <DatagramBatch.h>
 #include <HifiSockAddr.h>
 #include <NodeList.h>
+#include <PacketRing.h>
 
 #include "AudioMixerDatagramProcessor.h"
 
-AudioMixerDatagramProcessor::AudioMixerDatagramProcessor(QUdpSocket& nodeSocket, QThread* previousNodeSocketThread) :
+AudioMixerDatagramProcessor::AudioMixerDatagramProcessor(QUdpSocket& nodeSocket, QThread* previousNodeSocketThread,
+                                                         PacketRing& packetRing) :
     _nodeSocket(nodeSocket),
-    _previousNodeSocketThread(previousNodeSocketThread)
+    _previousNodeSocketThread(previousNodeSocketThread),
+    _packetRing(packetRing)
 {
     
 }
@@ -30,18 +34,40 @@ AudioMixerDatagramProcessor::~AudioMixerDatagramProcessor() {
 
 void AudioMixerDatagramProcessor::readPendingDatagrams() {
     
-    HifiSockAddr senderSockAddr;
-    static QByteArray incomingPacket;
-    
-    // read everything that is available
+    // read everything that is available, straight into the free slots of the ring a batch at a time
     while (_nodeSocket.hasPendingDatagrams()) {
-        incomingPacket.resize(_nodeSocket.pendingDatagramSize());
+        int numFreeSlots = qMin(_packetRing.getNumFreeSlots(), MAX_DATAGRAMS_PER_BATCH);
+        
+        if (numFreeSlots == 0) {
+            // the mixer is behind, throw this one away rather than leave it to back up the socket
+            _nodeSocket.readDatagram(NULL, 0);
+            _packetRing.recordDrop();
+            continue;
+        }
+        
+        char* buffers[MAX_DATAGRAMS_PER_BATCH];
+        int sizes[MAX_DATAGRAMS_PER_BATCH];
+        HifiSockAddr* senderSockAddrs[MAX_DATAGRAMS_PER_BATCH];
+        
+        for (int i = 0; i < numFreeSlots; i++) {
+            PacketRing::Slot* slot = _packetRing.getFreeSlot(i);
+            slot->packet.resize(MAX_PACKET_SIZE);
+            buffers[i] = slot->packet.data();
+            senderSockAddrs[i] = &slot->senderSockAddr;
+        }
+        
+        int numRead = DatagramBatch::receiveInto(_nodeSocket, numFreeSlots, buffers, MAX_PACKET_SIZE,
+                                                 sizes, senderSockAddrs);
+        for (int i = 0; i < numRead; i++) {
+            _packetRing.getFreeSlot(i)->packet.resize(sizes[i]);
+        }
         
-        // just get this packet off the stack
-        _nodeSocket.readDatagram(incomingPacket.data(), incomingPacket.size(),
-                                  senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+        if (numRead == 0) {
+            // nothing we could keep, the socket will tell us again if there is more
+            break;
+        }
         
-        // emit the signal to tell AudioMixer it needs to process a packet
-        emit packetRequiresProcessing(incomingPacket, senderSockAddr);
+        // the mixer will pick them up at the start of its next frame
+        _packetRing.endWrite(numRead);
     }
 }
@@ -15,18 +15,21 @@
 #include <qobject.h>
 #include <qudpsocket.h>
 
+class PacketRing;
+
+/// Reads datagrams off the node socket on its own thread and queues them in a PacketRing, which the mixer drains
+/// once per frame.
 class AudioMixerDatagramProcessor : public QObject {
     Q_OBJECT
 public:
-    AudioMixerDatagramProcessor(QUdpSocket& nodeSocket, QThread* previousNodeSocketThread);
+    AudioMixerDatagramProcessor(QUdpSocket& nodeSocket, QThread* previousNodeSocketThread, PacketRing& packetRing);
     ~AudioMixerDatagramProcessor();
 public slots:
     void readPendingDatagrams();
-signals:
-    void packetRequiresProcessing(const QByteArray& receivedPacket, const HifiSockAddr& senderSockAddr);
 private:
     QUdpSocket& _nodeSocket;
     QThread* _previousNodeSocketThread;
+    PacketRing& _packetRing;
 };
 
 #endif // hifi_AudioMixerDatagramProcessor_h
\ No newline at end of file
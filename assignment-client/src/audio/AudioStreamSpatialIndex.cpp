@@ -0,0 +1,135 @@
+//
+//  AudioStreamSpatialIndex.cpp
+//  assignment-client/src/audio
+//
+//  Created on 4/9/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <math.h>
+
+#include "PositionalAudioStream.h"
+
+#include "AudioStreamSpatialIndex.h"
+
+// the smallest cells are a meter across, every level up doubles that
+const float LEVEL_ZERO_CELL_SIZE = 1.0f;
+
+// grow the audible radius a little so that rounding in the cell math can never cull a stream that is audible
+const float AUDIBLE_RADIUS_SLOP = 1.01f;
+
+// each cell coordinate is packed into 21 bits of the cell key
+const int CELL_COORDINATE_BITS = 21;
+const int CELL_COORDINATE_OFFSET = 1 << (CELL_COORDINATE_BITS - 1);
+const quint64 CELL_COORDINATE_MASK = (1 << CELL_COORDINATE_BITS) - 1;
+
+AudioStreamSpatialIndex::AudioStreamSpatialIndex() :
+    _streams(),
+    _unboundedStreams()
+{
+}
+
+void AudioStreamSpatialIndex::clear() {
+    _streams.clear();
+    for (int i = 0; i < NUM_LEVELS; i++) {
+        _levels[i].clear();
+    }
+    _unboundedStreams.clear();
+}
+
+quint64 AudioStreamSpatialIndex::keyForCell(int x, int y, int z) {
+    return (((quint64)(x + CELL_COORDINATE_OFFSET) & CELL_COORDINATE_MASK) << (2 * CELL_COORDINATE_BITS))
+        | (((quint64)(y + CELL_COORDINATE_OFFSET) & CELL_COORDINATE_MASK) << CELL_COORDINATE_BITS)
+        | ((quint64)(z + CELL_COORDINATE_OFFSET) & CELL_COORDINATE_MASK);
+}
+
+float AudioStreamSpatialIndex::cellSizeForLevel(int level) {
+    return LEVEL_ZERO_CELL_SIZE * (float)(1 << level);
+}
+
+void AudioStreamSpatialIndex::addStream(Node* node, const QUuid& streamUUID, PositionalAudioStream* stream,
+                                        float minAudibilityThreshold) {
+    float trailingLoudness = stream->getLastPopOutputTrailingLoudness();
+
+    if (trailingLoudness <= 0.0f) {
+        // a stream with no trailing loudness can't clear any audibility threshold, it never needs to be visited
+        return;
+    }
+
+    int streamIndex = (int)_streams.size();
+    IndexedAudioStream indexedStream = { node, streamUUID, stream };
+    _streams.push_back(indexedStream);
+
+    // the mixer only adds a stream when trailing loudness / distance is above the threshold
+    float audibleRadius = AUDIBLE_RADIUS_SLOP * trailingLoudness / minAudibilityThreshold;
+
+    for (int level = 0; level < NUM_LEVELS; level++) {
+        float cellSize = cellSizeForLevel(level);
+
+        if (cellSize >= audibleRadius) {
+            const glm::vec3& position = stream->getPosition();
+            CellEntry entry = {
+                keyForCell((int)floorf(position.x / cellSize), (int)floorf(position.y / cellSize),
+                           (int)floorf(position.z / cellSize)),
+                streamIndex
+            };
+            _levels[level].push_back(entry);
+            return;
+        }
+    }
+
+    _unboundedStreams.push_back(streamIndex);
+}
+
+void AudioStreamSpatialIndex::finalize() {
+    for (int i = 0; i < NUM_LEVELS; i++) {
+        std::sort(_levels[i].begin(), _levels[i].end());
+    }
+}
+
+void AudioStreamSpatialIndex::findCandidates(const glm::vec3& listenerPosition, std::vector<int>& candidates) const {
+    candidates.clear();
+
+    if ((int)_unboundedStreams.size() == getNumStreams()) {
+        // nothing was culled, hand back every stream
+        candidates = _unboundedStreams;
+        return;
+    }
+
+    candidates.insert(candidates.end(), _unboundedStreams.begin(), _unboundedStreams.end());
+
+    for (int level = 0; level < NUM_LEVELS; level++) {
+        const std::vector<CellEntry>& cells = _levels[level];
+
+        if (cells.empty()) {
+            continue;
+        }
+
+        float cellSize = cellSizeForLevel(level);
+        int listenerX = (int)floorf(listenerPosition.x / cellSize);
+        int listenerY = (int)floorf(listenerPosition.y / cellSize);
+        int listenerZ = (int)floorf(listenerPosition.z / cellSize);
+
+        // any stream on this level more than one cell away is further than its audible radius
+        for (int x = listenerX - 1; x <= listenerX + 1; x++) {
+            for (int y = listenerY - 1; y <= listenerY + 1; y++) {
+                for (int z = listenerZ - 1; z <= listenerZ + 1; z++) {
+                    CellEntry firstEntry = { keyForCell(x, y, z), 0 };
+
+                    std::vector<CellEntry>::const_iterator it = std::lower_bound(cells.begin(), cells.end(), firstEntry);
+                    while (it != cells.end() && it->cellKey == firstEntry.cellKey) {
+                        candidates.push_back(it->streamIndex);
+                        ++it;
+                    }
+                }
+            }
+        }
+    }
+
+    // mix in the same order as an unculled walk of the nodes would have
+    std::sort(candidates.begin(), candidates.end());
+}
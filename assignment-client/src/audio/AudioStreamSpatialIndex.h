@@ -0,0 +1,76 @@
+//
+//  AudioStreamSpatialIndex.h
+//  assignment-client/src/audio
+//
+//  Created on 4/9/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioStreamSpatialIndex_h
+#define hifi_AudioStreamSpatialIndex_h
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <QtCore/QUuid>
+
+class Node;
+class PositionalAudioStream;
+
+/// A stream that had a frame to mix this frame, along with what the mixer needs to know about it.
+struct IndexedAudioStream {
+    Node* node;
+    QUuid streamUUID;
+    PositionalAudioStream* stream;
+};
+
+/// Per-frame hierarchical grid of the streams that can be heard by someone. Each stream is placed on the level whose
+/// cells are at least as large as the distance at which it drops below the audibility threshold, so a listener only
+/// needs to look at the 27 cells around it on each level to find every stream that it could possibly hear.
+class AudioStreamSpatialIndex {
+public:
+    AudioStreamSpatialIndex();
+
+    /// drops every stream from the index, keeping the allocated storage for the next frame
+    void clear();
+
+    /// adds a stream to the index, trailing loudness and position are read from the stream
+    void addStream(Node* node, const QUuid& streamUUID, PositionalAudioStream* stream, float minAudibilityThreshold);
+
+    /// sorts the cells of each level, must be called after the last addStream and before any findCandidates
+    void finalize();
+
+    /// fills candidates with the indices of streams that could clear the audibility threshold at listenerPosition,
+    /// in the order they were added. Safe to call from several threads once the index is finalized.
+    void findCandidates(const glm::vec3& listenerPosition, std::vector<int>& candidates) const;
+
+    const IndexedAudioStream& getStream(int index) const { return _streams[index]; }
+    int getNumStreams() const { return (int)_streams.size(); }
+
+private:
+    struct CellEntry {
+        quint64 cellKey;
+        int streamIndex;
+
+        bool operator<(const CellEntry& other) const {
+            return cellKey < other.cellKey || (cellKey == other.cellKey && streamIndex < other.streamIndex);
+        }
+    };
+
+    static const int NUM_LEVELS = 16;
+
+    static quint64 keyForCell(int x, int y, int z);
+    static float cellSizeForLevel(int level);
+
+    std::vector<IndexedAudioStream> _streams;
+    std::vector<CellEntry> _levels[NUM_LEVELS];
+
+    // streams audible further than the largest cell size, these are candidates for every listener
+    std::vector<int> _unboundedStreams;
+};
+
+#endif // hifi_AudioStreamSpatialIndex_h
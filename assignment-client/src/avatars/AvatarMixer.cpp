@@ -9,12 +9,17 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <algorithm>
+#include <cfloat>
+
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDateTime>
+#include <QtCore/QEventLoop>
 #include <QtCore/QJsonObject>
 #include <QtCore/QTimer>
 #include <QtCore/QThread>
 
+#include <GLMHelpers.h>
 #include <LogHandler.h>
 #include <NodeList.h>
 #include <PacketHeaders.h>
@@ -29,6 +34,21 @@ const QString AVATAR_MIXER_LOGGING_NAME = "avatar-mixer";
 
 const unsigned int AVATAR_DATA_SEND_INTERVAL_MSECS = (1.0f / 60.0f) * 1000;
 
+// every avatar that is sent gets its billboard and identity re-sent this often, in case the last ones were lost
+const quint64 BILLBOARD_AND_IDENTITY_RESEND_INTERVAL_MSECS = 5 * MSECS_PER_SECOND;
+
+// avatars closer than this are all scored as if they were this far away, so they all get the full rate
+const float FULL_RATE_DISTANCE = 2.0f;
+
+// how much an avatar directly behind the listener's head counts for, relative to one straight ahead
+const float BEHIND_LISTENER_PRIORITY_WEIGHT = 0.25f;
+
+// forget what listeners were sent about avatars that have left every so many frames
+const int STALE_AVATAR_STATE_CHECK_FRAMES = 60;
+
+const QString AVATAR_MIXER_SETTINGS_KEY = "avatar_mixer";
+const float DEFAULT_NODE_SEND_BANDWIDTH_MBPS = 5.0f;
+
 AvatarMixer::AvatarMixer(const QByteArray& packet) :
     ThreadedAssignment(packet),
     _broadcastThread(),
@@ -38,10 +58,17 @@ AvatarMixer::AvatarMixer(const QByteArray& packet) :
     _sumListeners(0),
     _numStatFrames(0),
     _sumBillboardPackets(0),
-    _sumIdentityPackets(0)
+    _sumIdentityPackets(0),
+    _sumAvatarsSent(0),
+    _sumAvatarsDeferred(0),
+    _maxNodeSendBandwidthMbps(DEFAULT_NODE_SEND_BANDWIDTH_MBPS),
+    _maxBytesPerListener(0),
+    _frameNumber(0)
 {
     // make sure we hear about node kills so we can tell the other nodes
     connect(DependencyManager::get<NodeList>().data(), &NodeList::nodeKilled, this, &AvatarMixer::nodeKilled);
+    
+    setupBroadcastThreads(DEFAULT_NUM_BROADCAST_THREADS);
 }
 
 AvatarMixer::~AvatarMixer() {
@@ -50,6 +77,71 @@ AvatarMixer::~AvatarMixer() {
     }
     _broadcastThread.quit();
     _broadcastThread.wait();
+    
+    _broadcastThreadPool.waitForDone();
+    
+    qDeleteAll(_workers);
+    qDeleteAll(_workerStates);
+}
+
+AvatarMixerWorkerState::AvatarMixerWorkerState() :
+    priorityQueue(),
+    outgoingBulkPackets(),
+    pendingBulkPackets(),
+    pendingSnapshotPackets(),
+    sumListeners(0),
+    sumBillboardPackets(0),
+    sumIdentityPackets(0),
+    sumAvatarsSent(0),
+    sumAvatarsDeferred(0)
+{
+}
+
+/// runs on a thread of the broadcast thread pool, claiming listeners and building their packets until none are left
+class AvatarMixerWorker : public QRunnable {
+public:
+    AvatarMixerWorker(AvatarMixer* mixer, AvatarMixerWorkerState* state) :
+        _mixer(mixer),
+        _state(state)
+    {
+        // the same worker is handed to the pool every frame
+        setAutoDelete(false);
+    }
+    
+    void run() {
+        _mixer->broadcastToClaimedListeners(*_state);
+        _mixer->_workersDoneSemaphore.release();
+    }
+    
+private:
+    AvatarMixer* _mixer;
+    AvatarMixerWorkerState* _state;
+};
+
+void AvatarMixer::setupBroadcastThreads(int numBroadcastThreads) {
+    numBroadcastThreads = glm::clamp(numBroadcastThreads, 1, MAX_NUM_BROADCAST_THREADS);
+    
+    _broadcastThreadPool.waitForDone();
+    
+    qDeleteAll(_workers);
+    _workers.clear();
+    qDeleteAll(_workerStates);
+    _workerStates.clear();
+    
+    for (int i = 0; i < numBroadcastThreads; i++) {
+        _workerStates.append(new AvatarMixerWorkerState());
+        
+        // the broadcast thread builds packets alongside the pool, so it needs no runnable of its own
+        if (i > 0) {
+            _workers.append(new AvatarMixerWorker(this, _workerStates[i]));
+        }
+    }
+    
+    _broadcastThreadPool.setMaxThreadCount(glm::max(numBroadcastThreads - 1, 1));
+    
+    // keep the pool threads around between frames, we need them again in 16ms
+    const int BROADCAST_THREAD_EXPIRY_MSECS = 10 * 1000;
+    _broadcastThreadPool.setExpiryTimeout(BROADCAST_THREAD_EXPIRY_MSECS);
 }
 
 void attachAvatarDataToNode(Node* newNode) {
@@ -58,11 +150,11 @@ void attachAvatarDataToNode(Node* newNode) {
     }
 }
 
-const float BILLBOARD_AND_IDENTITY_SEND_PROBABILITY = 1.0f / 300.0f;
+bool AvatarPriority::operator<(const AvatarPriority& other) const {
+    // the earlier avatar wins a tie, so the order of a frame never depends on how the heap was built
+    return priority < other.priority || (priority == other.priority && avatarIndex > other.avatarIndex);
+}
 
-// NOTE: some additional optimizations to consider.
-//    1) use the view frustum to cull those avatars that are out of view. Since avatar data doesn't need to be present
-//       if the avatar is not in view or in the keyhole.
 void AvatarMixer::broadcastAvatarData() {
     
     int idleTime = QDateTime::currentMSecsSinceEpoch() - _lastFrameTimestamp;
@@ -116,133 +208,260 @@ void AvatarMixer::broadcastAvatarData() {
         ++framesSinceCutoffEvent;
     }
     
-    static QByteArray mixedAvatarByteArray;
+    // encode each avatar once for this frame, every listener that is sent the avatar gets a copy of the same bytes
+    // if an avatar's data is being written to right now keep sending what we encoded for it last frame
+    // from here until the packets are sent the snapshots are not changed, so the workers read them without locks
+    auto nodeList = DependencyManager::get<NodeList>();
+    
+    _frameAvatars.clear();
+    _frameListeners.clear();
+    
+    nodeList->eachNode([&](const SharedNodePointer& node) {
+        AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData());
+        if (!nodeData) {
+            return;
+        }
+        
+        MutexTryLocker lock(nodeData->getMutex());
+        if (lock.isLocked()) {
+            nodeData->updateFrameSnapshot(node->getUUID());
+        }
+        
+        if (nodeData->hasFrameSnapshot()) {
+            if (node->getType() == NodeType::Agent && node->getActiveSocket()) {
+                _frameListeners.append(_frameAvatars.size());
+            }
+            _frameAvatars.append(node);
+        }
+    });
+    
+    ++_frameNumber;
+    
+    // when we are struggling every listener gets a smaller share of bandwidth, the furthest avatars go first
+    float maxBytesPerSecond = _maxNodeSendBandwidthMbps * 1000000.0f / BITS_IN_BYTE;
+    _maxBytesPerListener = (1.0f - _performanceThrottlingRatio) * maxBytesPerSecond
+        * AVATAR_DATA_SEND_INTERVAL_MSECS / (float) MSECS_PER_SECOND;
     
-    int numPacketHeaderBytes = populatePacketHeader(mixedAvatarByteArray, PacketTypeBulkAvatarData);
+    _bulkAvatarPacketHeader = byteArrayWithPopulatedHeader(PacketTypeBulkAvatarData);
     
+    broadcastToFrameListeners();
+    
+    _lastFrameTimestamp = QDateTime::currentMSecsSinceEpoch();
+}
+
+void AvatarMixer::broadcastToClaimedListeners(AvatarMixerWorkerState& worker) {
+    int listenerIndex;
+    while ((listenerIndex = _nextListenerIndex.fetchAndAddRelaxed(1)) < _frameListeners.size()) {
+        broadcastToListener(worker, _frameListeners[listenerIndex]);
+    }
+}
+
+void AvatarMixer::broadcastToFrameListeners() {
+    _nextListenerIndex.store(0);
+    
+    // only wake up as many pool threads as there are listeners beyond the one the broadcast thread takes
+    int numPoolWorkers = glm::min(_workers.size(), _frameListeners.size() - 1);
+    
+    for (int i = 0; i < numPoolWorkers; i++) {
+        _broadcastThreadPool.start(_workers[i]);
+    }
+    
+    // the broadcast thread does its share of the frame instead of sitting idle
+    broadcastToClaimedListeners(*_workerStates[0]);
+    
+    if (numPoolWorkers > 0) {
+        // every pool worker releases once when it runs out of listeners to claim
+        _workersDoneSemaphore.acquire(numPoolWorkers);
+    }
+    
+    // the node socket is only written to from this thread
     auto nodeList = DependencyManager::get<NodeList>();
+    nodeList->beginBatchedSends();
     
-    nodeList->eachMatchingNode(
-        [&](const SharedNodePointer& node)->bool {
-            if (!node->getLinkedData()) {
-                return false;
-            }
-            if (node->getType() != NodeType::Agent) {
-                return false;
-            }
-            if (!node->getActiveSocket()) {
-                return false;
-            }
-            return true;
-        },
-        [&](const SharedNodePointer& node) {
-            AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData());
-            MutexTryLocker lock(nodeData->getMutex());
-            if (!lock.isLocked()) {
-                return;
-            }
-            ++_sumListeners;
+    foreach (AvatarMixerWorkerState* workerState, _workerStates) {
+        for (size_t i = 0; i < workerState->pendingBulkPackets.size(); i++) {
+            const AvatarMixerWorkerState::PendingBulkPacket& pendingPacket = workerState->pendingBulkPackets[i];
+            nodeList->writeDatagramInPlace(workerState->outgoingBulkPackets.data() + pendingPacket.offset,
+                                           pendingPacket.size, _frameAvatars[pendingPacket.listenerIndex]);
+        }
+        
+        for (size_t i = 0; i < workerState->pendingSnapshotPackets.size(); i++) {
+            const AvatarMixerWorkerState::PendingSnapshotPacket& pendingPacket = workerState->pendingSnapshotPackets[i];
+            nodeList->writeDatagram(*pendingPacket.packet, _frameAvatars[pendingPacket.listenerIndex]);
+        }
+        
+        // keep the allocations for the next frame
+        workerState->outgoingBulkPackets.resize(0);
+        workerState->pendingBulkPackets.clear();
+        workerState->pendingSnapshotPackets.clear();
+        
+        _sumListeners += workerState->sumListeners;
+        workerState->sumListeners = 0;
+        _sumBillboardPackets += workerState->sumBillboardPackets;
+        workerState->sumBillboardPackets = 0;
+        _sumIdentityPackets += workerState->sumIdentityPackets;
+        workerState->sumIdentityPackets = 0;
+        _sumAvatarsSent += workerState->sumAvatarsSent;
+        workerState->sumAvatarsSent = 0;
+        _sumAvatarsDeferred += workerState->sumAvatarsDeferred;
+        workerState->sumAvatarsDeferred = 0;
+    }
+    
+    nodeList->flushBatchedSends();
+}
+
+void AvatarMixer::broadcastToListener(AvatarMixerWorkerState& worker, int listenerIndex) {
+    const SharedNodePointer& node = _frameAvatars[listenerIndex];
+    AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData());
+    ++worker.sumListeners;
+    
+    const glm::vec3& myPosition = nodeData->getSnapshotPosition();
+    glm::vec3 myFront = nodeData->getSnapshotHeadOrientation() * IDENTITY_FRONT;
+    
+    quint64 now = usecTimestampNow();
+    quint64 nowMsecs = QDateTime::currentMSecsSinceEpoch();
+    
+    // score every other avatar by how long this listener has been without an update for it, weighted up for
+    // avatars that are close by and in front of the listener
+    std::vector<AvatarPriority>& priorityQueue = worker.priorityQueue;
+    priorityQueue.clear();
+    
+    for (int i = 0; i < _frameAvatars.size(); i++) {
+        if (i == listenerIndex) {
+            continue;
+        }
+        
+        const SharedNodePointer& otherNode = _frameAvatars[i];
+        AvatarMixerClientData* otherNodeData = reinterpret_cast<AvatarMixerClientData*>(otherNode->getLinkedData());
+        AvatarMixerClientData::OtherAvatarState& otherState = nodeData->getOtherAvatarState(otherNode->getUUID());
+        otherState.lastScheduledFrame = _frameNumber;
+        
+        glm::vec3 offset = otherNodeData->getSnapshotPosition() - myPosition;
+        float distance = glm::length(offset);
+        
+        float viewWeight = 1.0f;
+        if (distance > 0.0f) {
+            float cosineToAvatar = glm::dot(myFront, offset / distance);
+            viewWeight = BEHIND_LISTENER_PRIORITY_WEIGHT
+                + (1.0f - BEHIND_LISTENER_PRIORITY_WEIGHT) * (0.5f + 0.5f * cosineToAvatar);
+        }
+        
+        // an avatar this listener has never been sent goes ahead of everything else
+        float priority = FLT_MAX;
+        if (otherState.lastBroadcastTime != 0) {
+            float timeSinceLastSent = (float) (now - otherState.lastBroadcastTime);
+            priority = timeSinceLastSent * viewWeight / glm::max(distance, FULL_RATE_DISTANCE);
+        }
+        
+        AvatarPriority avatarPriority = { priority, i };
+        priorityQueue.push_back(avatarPriority);
+    }
+    
+    std::make_heap(priorityQueue.begin(), priorityQueue.end());
+    
+    // fill this listener's packets from the top of the queue until its budget for the frame is spent
+    // whatever doesn't fit waits, and has a higher priority next frame
+    QByteArray& outgoingBulkPackets = worker.outgoingBulkPackets;
+    int numPacketHeaderBytes = _bulkAvatarPacketHeader.size();
+    
+    AvatarMixerWorkerState::PendingBulkPacket bulkPacket = { listenerIndex, outgoingBulkPackets.size(), 0 };
+    outgoingBulkPackets.append(_bulkAvatarPacketHeader);
+    bulkPacket.size = numPacketHeaderBytes;
+    
+    int bytesSent = numPacketHeaderBytes;
+    int numAvatarsSent = 0;
+    
+    while (!priorityQueue.empty()) {
+        const SharedNodePointer& otherNode = _frameAvatars[priorityQueue.front().avatarIndex];
+        AvatarMixerClientData* otherNodeData = reinterpret_cast<AvatarMixerClientData*>(otherNode->getLinkedData());
+        AvatarMixerClientData::OtherAvatarState& otherState = nodeData->getOtherAvatarState(otherNode->getUUID());
+        
+        const QByteArray& avatarByteArray = otherNodeData->getEncodedAvatarData();
+        
+        // send the billboard and identity with the avatar if this listener has not seen the latest ones,
+        // or if it is time to send them again
+        bool resendBillboardAndIdentity =
+            nowMsecs - otherState.lastBillboardAndIdentityResendTime >= BILLBOARD_AND_IDENTITY_RESEND_INTERVAL_MSECS;
+        
+        quint64 billboardChangeTimestamp = otherNodeData->getSnapshotBillboardChangeTimestamp();
+        bool sendBillboard = billboardChangeTimestamp > 0
+            && (resendBillboardAndIdentity || billboardChangeTimestamp != otherState.sentBillboardChangeTimestamp);
+        
+        quint64 identityChangeTimestamp = otherNodeData->getSnapshotIdentityChangeTimestamp();
+        bool sendIdentity = identityChangeTimestamp > 0
+            && (resendBillboardAndIdentity || identityChangeTimestamp != otherState.sentIdentityChangeTimestamp);
+        
+        bool needsNewBulkPacket = bulkPacket.size + avatarByteArray.size() > MAX_PACKET_SIZE;
+        
+        int avatarBytes = avatarByteArray.size();
+        if (needsNewBulkPacket) {
+            avatarBytes += numPacketHeaderBytes;
+        }
+        if (sendBillboard) {
+            avatarBytes += otherNodeData->getBillboardPacket().size();
+        }
+        if (sendIdentity) {
+            avatarBytes += otherNodeData->getIdentityPacket().size();
+        }
+        
+        // always send at least one avatar, so a budget that is too small for any can't stall a listener
+        if (numAvatarsSent > 0 && bytesSent + avatarBytes > _maxBytesPerListener) {
+            break;
+        }
+        
+        if (needsNewBulkPacket) {
+            worker.pendingBulkPackets.push_back(bulkPacket);
             
-            // reset packet pointers for this node
-            mixedAvatarByteArray.resize(numPacketHeaderBytes);
+            // start the next packet right after this one
+            bulkPacket.offset = outgoingBulkPackets.size();
+            outgoingBulkPackets.append(_bulkAvatarPacketHeader);
+            bulkPacket.size = numPacketHeaderBytes;
+        }
+        
+        // copy the avatar into the bulk packet
+        outgoingBulkPackets.append(avatarByteArray.constData(), avatarByteArray.size());
+        bulkPacket.size += avatarByteArray.size();
+        
+        if (sendBillboard) {
+            AvatarMixerWorkerState::PendingSnapshotPacket billboardPacket = {
+                listenerIndex, &otherNodeData->getBillboardPacket()
+            };
+            worker.pendingSnapshotPackets.push_back(billboardPacket);
+            otherState.sentBillboardChangeTimestamp = billboardChangeTimestamp;
             
-            AvatarData& avatar = nodeData->getAvatar();
-            glm::vec3 myPosition = avatar.getPosition();
-            // TODO use this along with the distance in the calculation of whether to send an update 
-            // about a given otherNode to this node
-            // FIXME does this mean we should sort the othernodes by distance before iterating 
-            // over them?
-            // float outputBandwidth =
-            node->getOutboundBandwidth();
+            ++worker.sumBillboardPackets;
+        }
+        
+        if (sendIdentity) {
+            AvatarMixerWorkerState::PendingSnapshotPacket identityPacket = {
+                listenerIndex, &otherNodeData->getIdentityPacket()
+            };
+            worker.pendingSnapshotPackets.push_back(identityPacket);
+            otherState.sentIdentityChangeTimestamp = identityChangeTimestamp;
             
-            // this is an AGENT we have received head data from
-            // send back a packet with other active node data to this node
-            nodeList->eachMatchingNode(
-                [&](const SharedNodePointer& otherNode)->bool {
-                    if (!otherNode->getLinkedData()) {
-                        return false;
-                    }
-                    if (otherNode->getUUID() == node->getUUID()) {
-                        return false;
-                    }
-
-                    //  Check throttling value
-                    if (!(_performanceThrottlingRatio == 0 || randFloat() < (1.0f - _performanceThrottlingRatio))) {
-                        return false;
-                    }
-                    return true;
-                },
-                [&](const SharedNodePointer& otherNode) {
-                    AvatarMixerClientData* otherNodeData = reinterpret_cast<AvatarMixerClientData*>(otherNode->getLinkedData());
-                    MutexTryLocker lock(otherNodeData->getMutex());
-                    if (!lock.isLocked()) {
-                        return;
-                    }
-                    AvatarData& otherAvatar = otherNodeData->getAvatar();
-                    //  Decide whether to send this avatar's data based on it's distance from us
-                    //  The full rate distance is the distance at which EVERY update will be sent for this avatar
-                    //  at a distance of twice the full rate distance, there will be a 50% chance of sending this avatar's update
-                    const float FULL_RATE_DISTANCE = 2.0f;
-                    glm::vec3 otherPosition = otherAvatar.getPosition();
-                    float distanceToAvatar = glm::length(myPosition - otherPosition);
-
-                    if (!(distanceToAvatar == 0.0f || randFloat() < FULL_RATE_DISTANCE / distanceToAvatar)) {
-                        return;
-                    }
-
-                    QByteArray avatarByteArray;
-                    avatarByteArray.append(otherNode->getUUID().toRfc4122());
-                    avatarByteArray.append(otherAvatar.toByteArray());
-                    
-                    if (avatarByteArray.size() + mixedAvatarByteArray.size() > MAX_PACKET_SIZE) {
-                        nodeList->writeDatagram(mixedAvatarByteArray, node);
-                            
-                        // reset the packet
-                        mixedAvatarByteArray.resize(numPacketHeaderBytes);
-                    }
-                        
-                    // copy the avatar into the mixedAvatarByteArray packet
-                    mixedAvatarByteArray.append(avatarByteArray);
-                        
-                    // if the receiving avatar has just connected make sure we send out the mesh and billboard
-                    // for this avatar (assuming they exist)
-                    bool forceSend = !nodeData->checkAndSetHasReceivedFirstPackets();
-                        
-                    // we will also force a send of billboard or identity packet
-                    // if either has changed in the last frame
-                        
-                    if (otherNodeData->getBillboardChangeTimestamp() > 0
-                        && (forceSend
-                            || otherNodeData->getBillboardChangeTimestamp() > _lastFrameTimestamp
-                            || randFloat() < BILLBOARD_AND_IDENTITY_SEND_PROBABILITY)) {
-                        QByteArray billboardPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarBillboard);
-                        billboardPacket.append(otherNode->getUUID().toRfc4122());
-                        billboardPacket.append(otherNodeData->getAvatar().getBillboard());
-                        nodeList->writeDatagram(billboardPacket, node);
-                            
-                        ++_sumBillboardPackets;
-                    }
-                        
-                    if (otherNodeData->getIdentityChangeTimestamp() > 0
-                        && (forceSend
-                            || otherNodeData->getIdentityChangeTimestamp() > _lastFrameTimestamp
-                            || randFloat() < BILLBOARD_AND_IDENTITY_SEND_PROBABILITY)) {
-                                
-                        QByteArray identityPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarIdentity);
-                            
-                        QByteArray individualData = otherNodeData->getAvatar().identityByteArray();
-                        individualData.replace(0, NUM_BYTES_RFC4122_UUID, otherNode->getUUID().toRfc4122());
-                        identityPacket.append(individualData);
-                            
-                        nodeList->writeDatagram(identityPacket, node);
-                                
-                        ++_sumIdentityPackets;
-                    }
-            });
-            nodeList->writeDatagram(mixedAvatarByteArray, node);
-    });
+            ++worker.sumIdentityPackets;
+        }
+        
+        if (resendBillboardAndIdentity) {
+            otherState.lastBillboardAndIdentityResendTime = nowMsecs;
+        }
+        
+        otherState.lastBroadcastTime = now;
+        bytesSent += avatarBytes;
+        ++numAvatarsSent;
+        
+        std::pop_heap(priorityQueue.begin(), priorityQueue.end());
+        priorityQueue.pop_back();
+    }
     
-    _lastFrameTimestamp = QDateTime::currentMSecsSinceEpoch();
+    worker.pendingBulkPackets.push_back(bulkPacket);
+    
+    worker.sumAvatarsSent += numAvatarsSent;
+    worker.sumAvatarsDeferred += (int) priorityQueue.size();
+    
+    if (_frameNumber % STALE_AVATAR_STATE_CHECK_FRAMES == 0) {
+        nodeData->removeStaleOtherAvatarStates(_frameNumber);
+    }
 }
 
 void AvatarMixer::nodeKilled(SharedNodePointer killedNode) {
@@ -259,62 +478,75 @@ void AvatarMixer::nodeKilled(SharedNodePointer killedNode) {
 }
 
 void AvatarMixer::readPendingDatagrams() {
-    QByteArray receivedPacket;
-    HifiSockAddr senderSockAddr;
+    auto nodeList = DependencyManager::get<NodeList>();
     
+    // read what is waiting a batch at a time, with a single system call per batch where we can
+    while (true) {
+        _receiveBatch.receive(nodeList->getNodeSocket());
+        if (_receiveBatch.getNumDatagrams() == 0) {
+            break;
+        }
+        
+        for (int i = 0; i < _receiveBatch.getNumDatagrams(); i++) {
+            // wraps the batch's buffer without copying it, nothing below holds on to the packet
+            QByteArray receivedPacket = QByteArray::fromRawData(_receiveBatch.getData(i), _receiveBatch.getSize(i));
+            processDatagram(receivedPacket, _receiveBatch.getSockAddr(i));
+        }
+    }
+}
+
+void AvatarMixer::processDatagram(const QByteArray& receivedPacket, const HifiSockAddr& senderSockAddr) {
     auto nodeList = DependencyManager::get<NodeList>();
     
-    while (readAvailableDatagram(receivedPacket, senderSockAddr)) {
-        if (nodeList->packetVersionAndHashMatch(receivedPacket)) {
-            switch (packetTypeForPacket(receivedPacket)) {
-                case PacketTypeAvatarData: {
-                    nodeList->findNodeAndUpdateWithDataFromPacket(receivedPacket);
-                    break;
-                }
-                case PacketTypeAvatarIdentity: {
-                    
-                    // check if we have a matching node in our list
-                    SharedNodePointer avatarNode = nodeList->sendingNodeForPacket(receivedPacket);
+    if (nodeList->packetVersionAndHashMatch(receivedPacket)) {
+        switch (packetTypeForPacket(receivedPacket)) {
+            case PacketTypeAvatarData: {
+                nodeList->findNodeAndUpdateWithDataFromPacket(receivedPacket);
+                break;
+            }
+            case PacketTypeAvatarIdentity: {
+                
+                // check if we have a matching node in our list
+                SharedNodePointer avatarNode = nodeList->sendingNodeForPacket(receivedPacket);
+                
+                if (avatarNode && avatarNode->getLinkedData()) {
+                    AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(avatarNode->getLinkedData());
+                    AvatarData& avatar = nodeData->getAvatar();
                     
-                    if (avatarNode && avatarNode->getLinkedData()) {
-                        AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(avatarNode->getLinkedData());
-                        AvatarData& avatar = nodeData->getAvatar();
-                        
-                        // parse the identity packet and update the change timestamp if appropriate
-                        if (avatar.hasIdentityChangedAfterParsing(receivedPacket)) {
-                            QMutexLocker nodeDataLocker(&nodeData->getMutex());
-                            nodeData->setIdentityChangeTimestamp(QDateTime::currentMSecsSinceEpoch());
-                        }
+                    // parse the identity packet and update the change timestamp if appropriate
+                    if (avatar.hasIdentityChangedAfterParsing(receivedPacket)) {
+                        QMutexLocker nodeDataLocker(&nodeData->getMutex());
+                        nodeData->setIdentityChangeTimestamp(QDateTime::currentMSecsSinceEpoch());
                     }
-                    break;
                 }
-                case PacketTypeAvatarBillboard: {
-                    
-                    // check if we have a matching node in our list
-                    SharedNodePointer avatarNode = nodeList->sendingNodeForPacket(receivedPacket);
+                break;
+            }
+            case PacketTypeAvatarBillboard: {
+                
+                // check if we have a matching node in our list
+                SharedNodePointer avatarNode = nodeList->sendingNodeForPacket(receivedPacket);
+                
+                if (avatarNode && avatarNode->getLinkedData()) {
+                    AvatarMixerClientData* nodeData = static_cast<AvatarMixerClientData*>(avatarNode->getLinkedData());
+                    AvatarData& avatar = nodeData->getAvatar();
                     
-                    if (avatarNode && avatarNode->getLinkedData()) {
-                        AvatarMixerClientData* nodeData = static_cast<AvatarMixerClientData*>(avatarNode->getLinkedData());
-                        AvatarData& avatar = nodeData->getAvatar();
-                        
-                        // parse the billboard packet and update the change timestamp if appropriate
-                        if (avatar.hasBillboardChangedAfterParsing(receivedPacket)) {
-                            QMutexLocker nodeDataLocker(&nodeData->getMutex());
-                            nodeData->setBillboardChangeTimestamp(QDateTime::currentMSecsSinceEpoch());
-                        }
-                        
+                    // parse the billboard packet and update the change timestamp if appropriate
+                    if (avatar.hasBillboardChangedAfterParsing(receivedPacket)) {
+                        QMutexLocker nodeDataLocker(&nodeData->getMutex());
+                        nodeData->setBillboardChangeTimestamp(QDateTime::currentMSecsSinceEpoch());
                     }
-                    break;
-                }
-                case PacketTypeKillAvatar: {
-                    nodeList->processKillNode(receivedPacket);
-                    break;
+                    
                 }
-                default:
-                    // hand this off to the NodeList
-                    nodeList->processNodeData(senderSockAddr, receivedPacket);
-                    break;
+                break;
             }
+            case PacketTypeKillAvatar: {
+                nodeList->processKillNode(receivedPacket);
+                break;
+            }
+            default:
+                // hand this off to the NodeList
+                nodeList->processNodeData(senderSockAddr, receivedPacket);
+                break;
         }
     }
 }
@@ -326,6 +558,13 @@ void AvatarMixer::sendStatsPacket() {
     statsObject["average_billboard_packets_per_frame"] = (float) _sumBillboardPackets / (float) _numStatFrames;
     statsObject["average_identity_packets_per_frame"] = (float) _sumIdentityPackets / (float) _numStatFrames;
     
+    if (_sumListeners > 0) {
+        statsObject["average_avatars_sent_per_listener"] = (float) _sumAvatarsSent / (float) _sumListeners;
+        statsObject["average_avatars_deferred_per_listener"] = (float) _sumAvatarsDeferred / (float) _sumListeners;
+    }
+    statsObject["max_node_send_bandwidth_mbps"] = _maxNodeSendBandwidthMbps;
+    statsObject["broadcast_threads"] = _workerStates.size();
+    
     statsObject["trailing_sleep_percentage"] = _trailingSleepRatio * 100;
     statsObject["performance_throttling_ratio"] = _performanceThrottlingRatio;
     
@@ -334,6 +573,8 @@ void AvatarMixer::sendStatsPacket() {
     _sumListeners = 0;
     _sumBillboardPackets = 0;
     _sumIdentityPackets = 0;
+    _sumAvatarsSent = 0;
+    _sumAvatarsDeferred = 0;
     _numStatFrames = 0;
 }
 
@@ -345,6 +586,26 @@ void AvatarMixer::run() {
     
     nodeList->linkedDataCreateCallback = attachAvatarDataToNode;
     
+    // wait until we have the domain-server settings, otherwise we bail
+    DomainHandler& domainHandler = nodeList->getDomainHandler();
+    
+    qDebug() << "Waiting for domain settings from domain-server.";
+    
+    // block until we get the settingsRequestComplete signal
+    QEventLoop loop;
+    connect(&domainHandler, &DomainHandler::settingsReceived, &loop, &QEventLoop::quit);
+    connect(&domainHandler, &DomainHandler::settingsReceiveFail, &loop, &QEventLoop::quit);
+    domainHandler.requestDomainSettings();
+    loop.exec();
+    
+    if (domainHandler.getSettingsObject().isEmpty()) {
+        qDebug() << "Failed to retreive settings object from domain-server. Bailing on assignment.";
+        setFinished(true);
+        return;
+    }
+    
+    parseSettingsObject(domainHandler.getSettingsObject());
+    
     // setup the timer that will be fired on the broadcast thread
     _broadcastTimer = new QTimer();
     _broadcastTimer->setInterval(AVATAR_DATA_SEND_INTERVAL_MSECS);
@@ -357,3 +618,33 @@ void AvatarMixer::run() {
     // start the broadcastThread
     _broadcastThread.start();
 }
+
+void AvatarMixer::parseSettingsObject(const QJsonObject& settingsObject) {
+    if (settingsObject.contains(AVATAR_MIXER_SETTINGS_KEY)) {
+        QJsonObject avatarMixerGroupObject = settingsObject[AVATAR_MIXER_SETTINGS_KEY].toObject();
+        
+        const QString NODE_SEND_BANDWIDTH_KEY = "max_node_send_bandwidth";
+        
+        bool ok = false;
+        float maxNodeSendBandwidthMbps = avatarMixerGroupObject[NODE_SEND_BANDWIDTH_KEY].toString().toFloat(&ok);
+        if (ok && maxNodeSendBandwidthMbps > 0.0f) {
+            _maxNodeSendBandwidthMbps = maxNodeSendBandwidthMbps;
+        } else {
+            _maxNodeSendBandwidthMbps = DEFAULT_NODE_SEND_BANDWIDTH_MBPS;
+        }
+        qDebug() << "Sending avatar data at up to" << _maxNodeSendBandwidthMbps << "Mbps per node.";
+        
+        const QString NUM_BROADCAST_THREADS_KEY = "broadcast_threads";
+        if (avatarMixerGroupObject[NUM_BROADCAST_THREADS_KEY].isString()) {
+            int numBroadcastThreads = avatarMixerGroupObject[NUM_BROADCAST_THREADS_KEY].toString().toInt(&ok);
+            if (ok) {
+                if (numBroadcastThreads <= 0) {
+                    // 0 means use one broadcast thread per core
+                    numBroadcastThreads = QThread::idealThreadCount();
+                }
+                setupBroadcastThreads(numBroadcastThreads);
+                qDebug() << "Building avatar packets on" << _workerStates.size() << "threads";
+            }
+        }
+    }
+}
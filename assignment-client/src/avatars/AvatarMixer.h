@@ -15,8 +15,59 @@
 #ifndef hifi_AvatarMixer_h
 #define hifi_AvatarMixer_h
 
+#include <vector>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
+
+#include <DatagramBatch.h>
 #include <ThreadedAssignment.h>
 
+class AvatarMixerWorker;
+
+const int DEFAULT_NUM_BROADCAST_THREADS = 1;
+const int MAX_NUM_BROADCAST_THREADS = 32;
+
+/// An avatar competing for a spot in a listener's packets this frame, highest priority is sent first.
+struct AvatarPriority {
+    float priority;
+    int avatarIndex;
+    
+    bool operator<(const AvatarPriority& other) const;
+};
+
+/// scratch space, outgoing packets and stats for one thread that builds the packets of a subset of the listeners
+struct AvatarMixerWorkerState {
+    AvatarMixerWorkerState();
+    
+    /// a bulk avatar packet built in outgoingBulkPackets, for the listener at that index of the frame's avatars
+    struct PendingBulkPacket {
+        int listenerIndex;
+        int offset;
+        int size;
+    };
+    
+    /// a billboard or identity packet from an avatar's frame snapshot, for the listener at that index
+    struct PendingSnapshotPacket {
+        int listenerIndex;
+        const QByteArray* packet;
+    };
+    
+    std::vector<AvatarPriority> priorityQueue;
+    
+    // the bulk packets for every listener this worker claimed, back to back, sent once all workers are done
+    QByteArray outgoingBulkPackets;
+    std::vector<PendingBulkPacket> pendingBulkPackets;
+    std::vector<PendingSnapshotPacket> pendingSnapshotPackets;
+    
+    int sumListeners;
+    int sumBillboardPackets;
+    int sumIdentityPackets;
+    int sumAvatarsSent;
+    int sumAvatarsDeferred;
+};
+
 /// Handles assignments of type AvatarMixer - distribution of avatar data to various clients
 class AvatarMixer : public ThreadedAssignment {
 public:
@@ -25,6 +76,8 @@ public:
 public slots:
     /// runs the avatar mixer
     void run();
+    
+    void setupBroadcastThreads(int numBroadcastThreads);
 
     void nodeAdded(SharedNodePointer nodeAdded);
     void nodeKilled(SharedNodePointer killedNode);
@@ -34,8 +87,24 @@ public slots:
     void sendStatsPacket();
     
 private:
+    friend class AvatarMixerWorker;
+    
+    void processDatagram(const QByteArray& receivedPacket, const HifiSockAddr& senderSockAddr);
+    
     void broadcastAvatarData();
     
+    /// queues up packets with the other avatars that are most overdue for an update for one listener, up to
+    /// _maxBytesPerListener for the frame. Only reads the frame snapshots, so several workers can run it at once.
+    void broadcastToListener(AvatarMixerWorkerState& worker, int listenerIndex);
+    
+    /// claims listeners of the frame and queues up their packets until there are none left
+    void broadcastToClaimedListeners(AvatarMixerWorkerState& worker);
+    
+    /// queues up packets for every listener of the frame across the worker threads, then sends them
+    void broadcastToFrameListeners();
+    
+    void parseSettingsObject(const QJsonObject& settingsObject);
+    
     QThread _broadcastThread;
     
     quint64 _lastFrameTimestamp;
@@ -47,8 +116,31 @@ private:
     int _numStatFrames;
     int _sumBillboardPackets;
     int _sumIdentityPackets;
+    int _sumAvatarsSent;
+    int _sumAvatarsDeferred;
+    
+    float _maxNodeSendBandwidthMbps;
+    
+    // state for each of the threads building packets in a frame, index 0 is always used by the broadcast thread
+    QVector<AvatarMixerWorkerState*> _workerStates;
+    QVector<AvatarMixerWorker*> _workers;
+    QThreadPool _broadcastThreadPool;
+    QSemaphore _workersDoneSemaphore;
+    
+    // the avatars with a snapshot this frame, the indices of the listeners among them,
+    // and the index of the next listener that has not been claimed by a worker
+    QVector<SharedNodePointer> _frameAvatars;
+    QVector<int> _frameListeners;
+    QAtomicInt _nextListenerIndex;
+    
+    QByteArray _bulkAvatarPacketHeader;
+    int _maxBytesPerListener;
+    int _frameNumber;
 
     QTimer* _broadcastTimer = nullptr;
+    
+    // what readPendingDatagrams read off the socket with its last system call
+    DatagramBatch _receiveBatch;
 };
 
 #endif // hifi_AvatarMixer_h
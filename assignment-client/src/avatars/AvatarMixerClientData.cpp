@@ -9,15 +9,26 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <cstring>
+
+#include <LimitedNodeList.h>
 #include <PacketHeaders.h>
 
 #include "AvatarMixerClientData.h"
 
 AvatarMixerClientData::AvatarMixerClientData() :
     NodeData(),
-    _hasReceivedFirstPackets(false),
     _billboardChangeTimestamp(0),
-    _identityChangeTimestamp(0)
+    _identityChangeTimestamp(0),
+    _hasFrameSnapshot(false),
+    _snapshotPosition(),
+    _snapshotHeadOrientation(),
+    _snapshotBillboardChangeTimestamp(0),
+    _snapshotIdentityChangeTimestamp(0),
+    _encodedAvatarData(),
+    _billboardPacket(),
+    _identityPacket(),
+    _otherAvatarStates()
 {
     
 }
@@ -28,8 +39,46 @@ int AvatarMixerClientData::parseData(const QByteArray& packet) {
     return _avatar.parseDataAtOffset(packet, offset);
 }
 
-bool AvatarMixerClientData::checkAndSetHasReceivedFirstPackets() {
-    bool oldValue = _hasReceivedFirstPackets;
-    _hasReceivedFirstPackets = true;
-    return oldValue;
+void AvatarMixerClientData::updateFrameSnapshot(const QUuid& nodeUUID) {
+    // the encoded data keeps its allocation from frame to frame, it is only ever resized within it
+    _encodedAvatarData.resize(NUM_BYTES_RFC4122_UUID + MAX_PACKET_SIZE);
+    memcpy(_encodedAvatarData.data(), nodeUUID.toRfc4122().constData(), NUM_BYTES_RFC4122_UUID);
+    
+    int numAvatarBytes = _avatar.packAvatarData(reinterpret_cast<unsigned char*>(_encodedAvatarData.data())
+                                                + NUM_BYTES_RFC4122_UUID);
+    _encodedAvatarData.resize(NUM_BYTES_RFC4122_UUID + numAvatarBytes);
+    
+    _snapshotPosition = _avatar.getPosition();
+    _snapshotHeadOrientation = _avatar.getHeadOrientation();
+    
+    if (_billboardChangeTimestamp != _snapshotBillboardChangeTimestamp) {
+        _billboardPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarBillboard);
+        _billboardPacket.append(nodeUUID.toRfc4122());
+        _billboardPacket.append(_avatar.getBillboard());
+        
+        _snapshotBillboardChangeTimestamp = _billboardChangeTimestamp;
+    }
+    
+    if (_identityChangeTimestamp != _snapshotIdentityChangeTimestamp) {
+        _identityPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarIdentity);
+        
+        QByteArray individualData = _avatar.identityByteArray();
+        individualData.replace(0, NUM_BYTES_RFC4122_UUID, nodeUUID.toRfc4122());
+        _identityPacket.append(individualData);
+        
+        _snapshotIdentityChangeTimestamp = _identityChangeTimestamp;
+    }
+    
+    _hasFrameSnapshot = true;
+}
+
+void AvatarMixerClientData::removeStaleOtherAvatarStates(int currentFrame) {
+    QHash<QUuid, OtherAvatarState>::iterator it = _otherAvatarStates.begin();
+    while (it != _otherAvatarStates.end()) {
+        if (it.value().lastScheduledFrame != currentFrame) {
+            it = _otherAvatarStates.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
@@ -12,7 +12,9 @@
 #ifndef hifi_AvatarMixerClientData_h
 #define hifi_AvatarMixerClientData_h
 
+#include <QtCore/QHash>
 #include <QtCore/QUrl>
+#include <QtCore/QUuid>
 
 #include <AvatarData.h>
 #include <NodeData.h>
@@ -25,19 +27,57 @@ public:
     int parseData(const QByteArray& packet);
     AvatarData& getAvatar() { return _avatar; }
     
-    bool checkAndSetHasReceivedFirstPackets();
-    
     quint64 getBillboardChangeTimestamp() const { return _billboardChangeTimestamp; }
     void setBillboardChangeTimestamp(quint64 billboardChangeTimestamp) { _billboardChangeTimestamp = billboardChangeTimestamp; }
     
     quint64 getIdentityChangeTimestamp() const { return _identityChangeTimestamp; }
     void setIdentityChangeTimestamp(quint64 identityChangeTimestamp) { _identityChangeTimestamp = identityChangeTimestamp; }
     
+    /// re-encodes the avatar for this frame, and its billboard and identity packets if they changed since the last
+    /// snapshot. Called by the broadcast thread with the node data mutex held, the snapshot is only ever read there.
+    void updateFrameSnapshot(const QUuid& nodeUUID);
+    
+    bool hasFrameSnapshot() const { return _hasFrameSnapshot; }
+    const glm::vec3& getSnapshotPosition() const { return _snapshotPosition; }
+    const glm::quat& getSnapshotHeadOrientation() const { return _snapshotHeadOrientation; }
+    quint64 getSnapshotBillboardChangeTimestamp() const { return _snapshotBillboardChangeTimestamp; }
+    quint64 getSnapshotIdentityChangeTimestamp() const { return _snapshotIdentityChangeTimestamp; }
+    
+    /// the node UUID followed by the avatar data, ready to be copied into a bulk avatar data packet
+    const QByteArray& getEncodedAvatarData() const { return _encodedAvatarData; }
+    const QByteArray& getBillboardPacket() const { return _billboardPacket; }
+    const QByteArray& getIdentityPacket() const { return _identityPacket; }
+    
+    /// what this listener has been sent about another avatar, only touched by the broadcast thread
+    struct OtherAvatarState {
+        quint64 lastBroadcastTime;
+        quint64 sentBillboardChangeTimestamp;
+        quint64 sentIdentityChangeTimestamp;
+        quint64 lastBillboardAndIdentityResendTime;
+        int lastScheduledFrame;
+    };
+    
+    /// returns the state for the given avatar, zeroed if this listener has never been sent anything about it
+    OtherAvatarState& getOtherAvatarState(const QUuid& otherUUID) { return _otherAvatarStates[otherUUID]; }
+    
+    /// forgets the avatars that were not considered for this listener in the given frame, since they have left
+    void removeStaleOtherAvatarStates(int currentFrame);
+    
 private:
     AvatarData _avatar;
-    bool _hasReceivedFirstPackets;
     quint64 _billboardChangeTimestamp;
     quint64 _identityChangeTimestamp;
+    
+    bool _hasFrameSnapshot;
+    glm::vec3 _snapshotPosition;
+    glm::quat _snapshotHeadOrientation;
+    quint64 _snapshotBillboardChangeTimestamp;
+    quint64 _snapshotIdentityChangeTimestamp;
+    QByteArray _encodedAvatarData;
+    QByteArray _billboardPacket;
+    QByteArray _identityPacket;
+    
+    QHash<QUuid, OtherAvatarState> _otherAvatarStates;
 };
 
 #endif // hifi_AvatarMixerClientData_h
@@ -20,15 +20,16 @@ class EntityNodeData : public OctreeQueryNode {
 public:
     EntityNodeData() :
         OctreeQueryNode(),
-        _lastDeletedEntitiesSentAt(0) { }
+        _nextDeletedEntitySequence(0) { }
 
     virtual PacketType getMyPacketType() const { return PacketTypeEntityData; }
 
-    quint64 getLastDeletedEntitiesSentAt() const { return _lastDeletedEntitiesSentAt; }
-    void setLastDeletedEntitiesSentAt(quint64 sentAt) { _lastDeletedEntitiesSentAt = sentAt; }
+    /// the sequence number in the tree's deletion log of the first deleted entity this node hasn't been sent
+    quint64 getNextDeletedEntitySequence() const { return _nextDeletedEntitySequence; }
+    void setNextDeletedEntitySequence(quint64 sequence) { _nextDeletedEntitySequence = sequence; }
 
 private:
-    quint64 _lastDeletedEntitiesSentAt;
+    quint64 _nextDeletedEntitySequence;
 };
 
 #endif // hifi_EntityNodeData_h
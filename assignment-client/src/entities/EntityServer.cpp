@@ -9,6 +9,8 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <limits>
+
 #include <QTimer>
 #include <EntityTree.h>
 #include <SimpleEntitySimulation.h>
@@ -92,10 +94,8 @@ bool EntityServer::hasSpecialPacketToSend(const SharedNodePointer& node) {
     // check to see if any new entities have been added since we last sent to this node...
     EntityNodeData* nodeData = static_cast<EntityNodeData*>(node->getLinkedData());
     if (nodeData) {
-        quint64 deletedEntitiesSentAt = nodeData->getLastDeletedEntitiesSentAt();
-
         EntityTree* tree = static_cast<EntityTree*>(_tree);
-        shouldSendDeletedEntities = tree->hasEntitiesDeletedSince(deletedEntitiesSentAt);
+        shouldSendDeletedEntities = tree->hasEntitiesDeletedSince(nodeData->getNextDeletedEntitySequence());
     }
 
     return shouldSendDeletedEntities;
@@ -107,8 +107,7 @@ int EntityServer::sendSpecialPacket(const SharedNodePointer& node, OctreeQueryNo
 
     EntityNodeData* nodeData = static_cast<EntityNodeData*>(node->getLinkedData());
     if (nodeData) {
-        quint64 deletedEntitiesSentAt = nodeData->getLastDeletedEntitiesSentAt();
-        quint64 deletePacketSentAt = usecTimestampNow();
+        quint64 nextDeletedEntitySequence = nodeData->getNextDeletedEntitySequence();
 
         EntityTree* tree = static_cast<EntityTree*>(_tree);
         bool hasMoreToSend = true;
@@ -116,7 +115,7 @@ int EntityServer::sendSpecialPacket(const SharedNodePointer& node, OctreeQueryNo
         // TODO: is it possible to send too many of these packets? what if you deleted 1,000,000 entities?
         packetsSent = 0;
         while (hasMoreToSend) {
-            hasMoreToSend = tree->encodeEntitiesDeletedSince(queryNode->getSequenceNumber(), deletedEntitiesSentAt,
+            hasMoreToSend = tree->encodeEntitiesDeletedSince(queryNode->getSequenceNumber(), nextDeletedEntitySequence,
                                                 outputBuffer, MAX_PACKET_SIZE, packetLength);
 
             DependencyManager::get<NodeList>()->writeDatagram((char*) outputBuffer, packetLength,
@@ -125,7 +124,7 @@ int EntityServer::sendSpecialPacket(const SharedNodePointer& node, OctreeQueryNo
             packetsSent++;
         }
 
-        nodeData->setLastDeletedEntitiesSentAt(deletePacketSentAt);
+        nodeData->setNextDeletedEntitySequence(nextDeletedEntitySequence);
     }
 
     // TODO: caller is expecting a packetLength, what if we send more than one packet??
@@ -136,19 +135,17 @@ void EntityServer::pruneDeletedEntities() {
     EntityTree* tree = static_cast<EntityTree*>(_tree);
     if (tree->hasAnyDeletedEntities()) {
 
-        quint64 earliestLastDeletedEntitiesSent = usecTimestampNow() + 1; // in the future
-        
-        DependencyManager::get<NodeList>()->eachNode([&earliestLastDeletedEntitiesSent](const SharedNodePointer& node) {
+        // with no nodes, every deletion can be forgotten
+        quint64 earliestNextSequence = std::numeric_limits<quint64>::max();
+
+        DependencyManager::get<NodeList>()->eachNode([&earliestNextSequence](const SharedNodePointer& node) {
             if (node->getLinkedData()) {
                 EntityNodeData* nodeData = static_cast<EntityNodeData*>(node->getLinkedData());
-                quint64 nodeLastDeletedEntitiesSentAt = nodeData->getLastDeletedEntitiesSentAt();
-                if (nodeLastDeletedEntitiesSentAt < earliestLastDeletedEntitiesSent) {
-                    earliestLastDeletedEntitiesSent = nodeLastDeletedEntitiesSentAt;
-                }
+                earliestNextSequence = qMin(earliestNextSequence, nodeData->getNextDeletedEntitySequence());
             }
         });
-        
-        tree->forgetEntitiesDeletedBefore(earliestLastDeletedEntitiesSent);
+
+        tree->forgetEntitiesDeletedBefore(earliestNextSequence);
     }
 }
 
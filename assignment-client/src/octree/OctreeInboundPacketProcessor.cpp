@@ -10,6 +10,10 @@
 //
 
 #include <limits>
+
+#include <QtCore/QRunnable>
+
+#include <OctreeEditBatch.h>
 #include <PacketHeaders.h>
 #include <PerfStat.h>
 
@@ -29,10 +33,70 @@ OctreeInboundPacketProcessor::OctreeInboundPacketProcessor(OctreeServer* myServe
     _totalElementsInPacket(0),
     _totalPackets(0),
     _lastNackTime(usecTimestampNow()),
-    _shuttingDown(false)
+    _shuttingDown(false),
+    _editBatch(NULL),
+    _editBatchIntervalUsecs(0),
+    _nextEditBatchApply(0),
+    _editBatchSenders(),
+    _editBatchDecodeTimes(),
+    _nextPacketToDecode(0),
+    _decodeWorkers(),
+    _decodeThreadPool(),
+    _workersDoneSemaphore(),
+    _editBatchesApplied(0),
+    _editsCoalesced(0)
 {
 }
 
+OctreeInboundPacketProcessor::~OctreeInboundPacketProcessor() {
+    _decodeThreadPool.waitForDone();
+    qDeleteAll(_decodeWorkers);
+    delete _editBatch;
+}
+
+/// runs on a thread of the decode thread pool, claiming queued packets and decoding their edits until none are left
+class OctreeEditBatchWorker : public QRunnable {
+public:
+    OctreeEditBatchWorker(OctreeInboundPacketProcessor* processor) :
+        _processor(processor)
+    {
+        // the same worker is handed to the pool every batch
+        setAutoDelete(false);
+    }
+
+    void run() {
+        _processor->decodeClaimedPackets();
+        _processor->_workersDoneSemaphore.release();
+    }
+
+private:
+    OctreeInboundPacketProcessor* _processor;
+};
+
+void OctreeInboundPacketProcessor::setEditBatchInterval(int intervalMsecs) {
+    if (intervalMsecs <= 0 || _editBatch) {
+        return;
+    }
+
+    _editBatch = _myServer->getOctree()->createEditBatch();
+    if (!_editBatch) {
+        qDebug() << "This server's tree applies its edits one packet at a time, editBatchInterval is ignored.";
+        return;
+    }
+    _editBatchIntervalUsecs = (quint64)intervalMsecs * USECS_PER_MSEC;
+
+    // the processing thread decodes alongside the pool, so it needs no worker of its own
+    int numDecodeThreads = QThread::idealThreadCount();
+    for (int i = 1; i < numDecodeThreads; i++) {
+        _decodeWorkers.append(new OctreeEditBatchWorker(this));
+    }
+    _decodeThreadPool.setMaxThreadCount(qMax(numDecodeThreads - 1, 1));
+
+    // keep the pool threads around between batches
+    const int DECODE_THREAD_EXPIRY_MSECS = 10 * 1000;
+    _decodeThreadPool.setExpiryTimeout(DECODE_THREAD_EXPIRY_MSECS);
+}
+
 void OctreeInboundPacketProcessor::resetStats() {
     _totalTransitTime = 0;
     _totalProcessTime = 0;
@@ -40,18 +104,23 @@ void OctreeInboundPacketProcessor::resetStats() {
     _totalElementsInPacket = 0;
     _totalPackets = 0;
     _lastNackTime = usecTimestampNow();
+    _editBatchesApplied = 0;
+    _editsCoalesced = 0;
 
     _singleSenderStats.clear();
 }
 
 unsigned long OctreeInboundPacketProcessor::getMaxWait() const {
-    // calculate time until next sendNackPackets()
-    quint64 nextNackTime = _lastNackTime + TOO_LONG_SINCE_LAST_NACK;
+    // calculate time until next sendNackPackets(), or until the pending edit batch is due if that's sooner
+    quint64 nextWakeTime = _lastNackTime + TOO_LONG_SINCE_LAST_NACK;
+    if (_editBatch && _editBatch->getNumPackets() > 0) {
+        nextWakeTime = std::min(nextWakeTime, _nextEditBatchApply);
+    }
     quint64 now = usecTimestampNow();
-    if (now >= nextNackTime) {
+    if (now >= nextWakeTime) {
         return 0;
     }
-    return (nextNackTime - now) / USECS_PER_MSEC + 1;
+    return (nextWakeTime - now) / USECS_PER_MSEC + 1;
 }
 
 void OctreeInboundPacketProcessor::preProcess() {
@@ -72,6 +141,72 @@ void OctreeInboundPacketProcessor::midProcess() {
     }
 }
 
+void OctreeInboundPacketProcessor::postProcess() {
+    // while shutting down, whatever is pending is applied right away so that it can still be persisted
+    if (_editBatch && _editBatch->getNumPackets() > 0 && (_shuttingDown || usecTimestampNow() >= _nextEditBatchApply)) {
+        applyEditBatch();
+    }
+}
+
+void OctreeInboundPacketProcessor::decodeClaimedPackets() {
+    int packetIndex;
+    while ((packetIndex = _nextPacketToDecode.fetchAndAddRelaxed(1)) < _editBatchDecodeTimes.size()) {
+        quint64 startDecode = usecTimestampNow();
+        _editBatch->decodePacket(packetIndex);
+        _editBatchDecodeTimes[packetIndex] = usecTimestampNow() - startDecode;
+    }
+}
+
+void OctreeInboundPacketProcessor::applyEditBatch() {
+    int numPackets = _editBatch->getNumPackets();
+    _editBatchDecodeTimes.fill(0, numPackets);
+    _nextPacketToDecode.store(0);
+
+    // only wake up as many pool threads as there are packets beyond the one the processing thread takes
+    int numPoolWorkers = std::min(_decodeWorkers.size(), numPackets - 1);
+    for (int i = 0; i < numPoolWorkers; i++) {
+        _decodeThreadPool.start(_decodeWorkers[i]);
+    }
+    decodeClaimedPackets();
+    if (numPoolWorkers > 0) {
+        // every pool worker releases once when it runs out of packets to claim
+        _workersDoneSemaphore.acquire(numPoolWorkers);
+    }
+
+    QVector<int> editsInPacket(numPackets);
+    int editsInBatch = 0;
+    for (int i = 0; i < numPackets; i++) {
+        editsInPacket[i] = _editBatch->getNumEditsInPacket(i);
+        editsInBatch += editsInPacket[i];
+    }
+
+    quint64 startLock = usecTimestampNow();
+    _myServer->getOctree()->lockForWrite();
+    quint64 startProcess = usecTimestampNow();
+    int editsCoalesced = _editBatch->apply();
+    _myServer->getOctree()->unlock();
+    quint64 endProcess = usecTimestampNow();
+
+    if (_myServer->wantsDebugReceiving()) {
+        qDebug() << "PROCESSING THREAD: applied edit batch of" << numPackets << "packets," << editsInBatch << "edits,"
+            << editsCoalesced << "coalesced, in" << (endProcess - startProcess) << "usecs";
+    }
+
+    // each packet keeps its own decode time, and takes its share of the lock wait and of applying the batch by edits
+    quint64 applyTime = endProcess - startProcess;
+    quint64 lockWaitTime = startProcess - startLock;
+    for (int i = 0; i < numPackets; i++) {
+        quint64 applyShare = editsInBatch == 0 ? applyTime / numPackets : applyTime * editsInPacket[i] / editsInBatch;
+        quint64 lockWaitShare = editsInBatch == 0 ? lockWaitTime / numPackets
+                                                  : lockWaitTime * editsInPacket[i] / editsInBatch;
+        trackBatchedEdits(_editBatchSenders[i], editsInPacket[i], _editBatchDecodeTimes[i] + applyShare, lockWaitShare);
+    }
+    _editBatchSenders.clear();
+
+    _editBatchesApplied++;
+    _editsCoalesced += editsCoalesced;
+}
+
 void OctreeInboundPacketProcessor::processPacket(const SharedNodePointer& sendingNode, const QByteArray& packet) {
     if (_shuttingDown) {
         qDebug() << "OctreeInboundPacketProcessor::processPacket() while shutting down... ignoring incoming packet";
@@ -140,50 +275,59 @@ void OctreeInboundPacketProcessor::processPacket(const SharedNodePointer& sendin
         
 
         unsigned char* editData = (unsigned char*)&packetData[atByte];
-        while (atByte < packet.size()) {
-        
-            int maxSize = packet.size() - atByte;
-
-            if (debugProcessPacket) {
-                qDebug() << " --- inside while loop ---";
-                qDebug() << "    maxSize=" << maxSize;
-                qDebug("OctreeInboundPacketProcessor::processPacket() %c "
-                       "packetData=%p packetLength=%d editData=%p atByte=%d maxSize=%d",
-                        packetType, packetData, packet.size(), editData, atByte, maxSize);
-            }
-
-            quint64 startLock = usecTimestampNow();
-            _myServer->getOctree()->lockForWrite();
-            quint64 startProcess = usecTimestampNow();
-            int editDataBytesRead = _myServer->getOctree()->processEditPacketData(packetType,
-                                                                                  reinterpret_cast<const unsigned char*>(packet.data()),
-                                                                                  packet.size(),
-                                                                                  editData, maxSize, sendingNode);
-
-            if (debugProcessPacket) {
-                qDebug() << "OctreeInboundPacketProcessor::processPacket() after processEditPacketData()..."
-                                << "editDataBytesRead=" << editDataBytesRead;
+        if (_editBatch) {
+            // the edits are decoded and applied with the rest of the batch, and counted in the stats then
+            if (_editBatch->getNumPackets() == 0) {
+                _nextEditBatchApply = usecTimestampNow() + _editBatchIntervalUsecs;
             }
+            _editBatch->addPacket(sendingNode, packet, atByte);
+            _editBatchSenders.append(sendingNode ? sendingNode->getUUID() : QUuid());
+        } else {
+            while (atByte < packet.size()) {
+        
+                int maxSize = packet.size() - atByte;
+
+                if (debugProcessPacket) {
+                    qDebug() << " --- inside while loop ---";
+                    qDebug() << "    maxSize=" << maxSize;
+                    qDebug("OctreeInboundPacketProcessor::processPacket() %c "
+                           "packetData=%p packetLength=%d editData=%p atByte=%d maxSize=%d",
+                            packetType, packetData, packet.size(), editData, atByte, maxSize);
+                }
+
+                quint64 startLock = usecTimestampNow();
+                _myServer->getOctree()->lockForWrite();
+                quint64 startProcess = usecTimestampNow();
+                int editDataBytesRead = _myServer->getOctree()->processEditPacketData(packetType,
+                                                                                      reinterpret_cast<const unsigned char*>(packet.data()),
+                                                                                      packet.size(),
+                                                                                      editData, maxSize, sendingNode);
+
+                if (debugProcessPacket) {
+                    qDebug() << "OctreeInboundPacketProcessor::processPacket() after processEditPacketData()..."
+                                    << "editDataBytesRead=" << editDataBytesRead;
+                }
+
+                _myServer->getOctree()->unlock();
+                quint64 endProcess = usecTimestampNow();
+
+                editsInPacket++;
+                quint64 thisProcessTime = endProcess - startProcess;
+                quint64 thisLockWaitTime = startProcess - startLock;
+                processTime += thisProcessTime;
+                lockWaitTime += thisLockWaitTime;
+
+                // skip to next edit record in the packet
+                editData += editDataBytesRead;
+                atByte += editDataBytesRead;
+
+                if (debugProcessPacket) {
+                    qDebug() << "    editDataBytesRead=" << editDataBytesRead;
+                    qDebug() << "    AFTER processEditPacketData atByte=" << atByte;
+                    qDebug() << "    AFTER processEditPacketData packet.size()=" << packet.size();
+                }
 
-            _myServer->getOctree()->unlock();
-            quint64 endProcess = usecTimestampNow();
-
-            editsInPacket++;
-            quint64 thisProcessTime = endProcess - startProcess;
-            quint64 thisLockWaitTime = startProcess - startLock;
-            processTime += thisProcessTime;
-            lockWaitTime += thisLockWaitTime;
-
-            // skip to next edit record in the packet
-            editData += editDataBytesRead;
-            atByte += editDataBytesRead;
-
-            if (debugProcessPacket) {
-                qDebug() << "    editDataBytesRead=" << editDataBytesRead;
-                qDebug() << "    AFTER processEditPacketData atByte=" << atByte;
-                qDebug() << "    AFTER processEditPacketData packet.size()=" << packet.size();
             }
-
         }
 
         if (debugProcessPacket) {
@@ -232,6 +376,20 @@ void OctreeInboundPacketProcessor::trackInboundPacket(const QUuid& nodeUUID, uns
     }
 }
 
+void OctreeInboundPacketProcessor::trackBatchedEdits(const QUuid& nodeUUID, int editsInPacket, quint64 processTime,
+                                                     quint64 lockWaitTime) {
+    // the packet itself was tracked when it was queued
+    _totalProcessTime += processTime;
+    _totalLockWaitTime += lockWaitTime;
+    _totalElementsInPacket += editsInPacket;
+
+    // a sender whose stats were reset or pruned since then isn't tracked again
+    NodeToSenderStatsMapIterator i = _singleSenderStats.find(nodeUUID);
+    if (i != _singleSenderStats.end()) {
+        i.value().trackBatchedEdits(editsInPacket, processTime, lockWaitTime);
+    }
+}
+
 int OctreeInboundPacketProcessor::sendNackPackets() {
     int packetsSent = 0;
 
@@ -334,3 +492,9 @@ void SingleSenderStats::trackInboundPacket(unsigned short int incomingSequence,
     _totalElementsInPacket += editsInPacket;
     _totalPackets++;
 }
+
+void SingleSenderStats::trackBatchedEdits(int editsInPacket, quint64 processTime, quint64 lockWaitTime) {
+    _totalProcessTime += processTime;
+    _totalLockWaitTime += lockWaitTime;
+    _totalElementsInPacket += editsInPacket;
+}
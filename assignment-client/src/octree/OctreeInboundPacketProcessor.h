@@ -14,10 +14,17 @@
 #ifndef hifi_OctreeInboundPacketProcessor_h
 #define hifi_OctreeInboundPacketProcessor_h
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+
 #include <ReceivedPacketProcessor.h>
 
 #include "SequenceNumberStats.h"
 
+class OctreeEditBatch;
+class OctreeEditBatchWorker;
 class OctreeServer;
 
 class SingleSenderStats {
@@ -40,6 +47,9 @@ public:
     void trackInboundPacket(unsigned short int incomingSequence, quint64 transitTime,
         int editsInPacket, quint64 processTime, quint64 lockWaitTime);
 
+    /// adds the edits of a packet that was already tracked, once they're applied with the rest of their batch
+    void trackBatchedEdits(int editsInPacket, quint64 processTime, quint64 lockWaitTime);
+
     quint64 _totalTransitTime; 
     quint64 _totalProcessTime;
     quint64 _totalLockWaitTime;
@@ -59,6 +69,13 @@ class OctreeInboundPacketProcessor : public ReceivedPacketProcessor {
     Q_OBJECT
 public:
     OctreeInboundPacketProcessor(OctreeServer* myServer);
+    ~OctreeInboundPacketProcessor();
+
+    /// Queues edit packets and applies their edits together, under one write lock, at most an interval after the first
+    /// one arrived. The packets are decoded on a thread pool first, without the lock. An interval of 0, or a tree that
+    /// can't batch its edits, applies the edits of each packet as it's processed. Call before the thread starts.
+    void setEditBatchInterval(int intervalMsecs);
+    bool isBatchingEdits() const { return _editBatch != NULL; }
 
     quint64 getAverageTransitTimePerPacket() const { return _totalPackets == 0 ? 0 : _totalTransitTime / _totalPackets; }
     quint64 getAverageProcessTimePerPacket() const { return _totalPackets == 0 ? 0 : _totalProcessTime / _totalPackets; }
@@ -69,6 +86,8 @@ public:
                 { return _totalElementsInPacket == 0 ? 0 : _totalProcessTime / _totalElementsInPacket; }
     quint64 getAverageLockWaitTimePerElement() const 
                 { return _totalElementsInPacket == 0 ? 0 : _totalLockWaitTime / _totalElementsInPacket; }
+    quint64 getEditBatchesApplied() const { return _editBatchesApplied; }
+    quint64 getEditsCoalesced() const { return _editsCoalesced; }
 
     void resetStats();
 
@@ -83,13 +102,19 @@ protected:
     virtual unsigned long getMaxWait() const;
     virtual void preProcess();
     virtual void midProcess();
+    virtual void postProcess();
 
 private:
     int sendNackPackets();
 
+    friend class OctreeEditBatchWorker;
+    void decodeClaimedPackets();
+    void applyEditBatch();
+
 private:
     void trackInboundPacket(const QUuid& nodeUUID, unsigned short int sequence, quint64 transitTime, 
             int elementsInPacket, quint64 processTime, quint64 lockWaitTime);
+    void trackBatchedEdits(const QUuid& nodeUUID, int editsInPacket, quint64 processTime, quint64 lockWaitTime);
 
     OctreeServer* _myServer;
     int _receivedPacketCount;
@@ -104,5 +129,18 @@ private:
 
     quint64 _lastNackTime;
     bool _shuttingDown;
+
+    OctreeEditBatch* _editBatch;
+    quint64 _editBatchIntervalUsecs;
+    quint64 _nextEditBatchApply; // when the pending batch is due, an interval after its first packet arrived
+    QVector<QUuid> _editBatchSenders;
+    QVector<quint64> _editBatchDecodeTimes;
+    QAtomicInt _nextPacketToDecode;
+    QVector<OctreeEditBatchWorker*> _decodeWorkers;
+    QThreadPool _decodeThreadPool;
+    QSemaphore _workersDoneSemaphore;
+
+    quint64 _editBatchesApplied;
+    quint64 _editsCoalesced;
 };
 #endif // hifi_OctreeInboundPacketProcessor_h
@@ -40,6 +40,7 @@ OctreeQueryNode::OctreeQueryNode() :
     _lodInitialized(false),
     _sequenceNumber(0),
     _lastRootTimestamp(0),
+    _sceneSnapshot(),
     _myPacketType(PacketTypeUnknown),
     _isShuttingDown(false),
     _sentPacketHistory()
@@ -60,8 +61,8 @@ void OctreeQueryNode::nodeKilled() {
     _isShuttingDown = true;
     elementBag.unhookNotifications(); // if our node is shutting down, then we no longer need octree element notifications
     if (_octreeSendThread) {
-        // just tell our thread we want to shutdown, this is asynchronous, and fast, we don't need or want it to block
-        // while the thread actually shuts down
+        // just tell our sender we want to shutdown, this is asynchronous, and fast, we don't need or want it to block
+        // while the sender finishes its current pass
         _octreeSendThread->setIsShuttingDown();
     }
 }
@@ -70,19 +71,19 @@ void OctreeQueryNode::forceNodeShutdown() {
     _isShuttingDown = true;
     elementBag.unhookNotifications(); // if our node is shutting down, then we no longer need octree element notifications
     if (_octreeSendThread) {
-        // we really need to force our thread to shutdown, this is synchronous, we will block while the thread actually 
-        // shuts down because we really need it to shutdown, and it's ok if we wait for it to complete
+        // we really need to force our sender to shutdown, this is synchronous, we will block while a send thread finishes
+        // processing it because we really need it to shutdown, and it's ok if we wait for it to complete
         OctreeSendThread* sendThread = _octreeSendThread;
         _octreeSendThread = NULL;
         sendThread->setIsShuttingDown();
-        sendThread->terminate();
+        sendThread->stopSending();
         delete sendThread;
     }
 }
 
 void OctreeQueryNode::sendThreadFinished() {
-    // We've been notified by our thread that it is shutting down. So we can clean up our reference to it, and
-    // delete the actual thread object. Cleaning up our thread will correctly unroll all refereces to shared
+    // We've been notified by our sender that it is shutting down. So we can clean up our reference to it, and
+    // delete the actual sender object. Cleaning up our sender will correctly unroll all refereces to shared
     // pointers to our node as well as the octree server assignment
     if (_octreeSendThread) {
         OctreeSendThread* sendThread = _octreeSendThread;
@@ -94,9 +95,9 @@ void OctreeQueryNode::sendThreadFinished() {
 void OctreeQueryNode::initializeOctreeSendThread(const SharedAssignmentPointer& myAssignment, const SharedNodePointer& node) {
     _octreeSendThread = new OctreeSendThread(myAssignment, node);
     
-    // we want to be notified when the thread finishes
-    connect(_octreeSendThread, &GenericThread::finished, this, &OctreeQueryNode::sendThreadFinished);
-    _octreeSendThread->initialize(true);
+    // we want to be notified when the sender finishes
+    connect(_octreeSendThread, &OctreeSendThread::finished, this, &OctreeQueryNode::sendThreadFinished);
+    _octreeSendThread->startSending();
 }
 
 bool OctreeQueryNode::packetIsDuplicate() const {
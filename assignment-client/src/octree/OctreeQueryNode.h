@@ -17,6 +17,7 @@
 
 #include <CoverageMap.h>
 #include <NodeData.h>
+#include <Octree.h>
 #include <OctreeConstants.h>
 #include <OctreeElementBag.h>
 #include <OctreePacketData.h>
@@ -96,6 +97,10 @@ public:
     
     quint64 getLastRootTimestamp() const { return _lastRootTimestamp; }
     void setLastRootTimestamp(quint64 timestamp) { _lastRootTimestamp = timestamp; }
+
+    /// the snapshot the current scene is sent from, when the server sends from snapshots, the bag holds its elements
+    const OctreePointer& getSceneSnapshot() const { return _sceneSnapshot; }
+    void setSceneSnapshot(const OctreePointer& snapshot) { _sceneSnapshot = snapshot; }
     unsigned int getlastOctreePacketLength() const { return _lastOctreePacketLength; }
     int getDuplicatePacketCount() const { return _duplicatePacketCount; }
     
@@ -152,6 +157,7 @@ private:
     OCTREE_PACKET_SEQUENCE _sequenceNumber;
 
     quint64 _lastRootTimestamp;
+    OctreePointer _sceneSnapshot;
     
     PacketType _myPacketType;
     bool _isShuttingDown;
@@ -0,0 +1,170 @@
+//
+//  OctreeSendScheduler.cpp
+//  assignment-client/src/octree
+//
+//  Created on 4/14/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRunnable>
+
+#include <NodeList.h>
+#include <SharedUtil.h>
+
+#include "OctreeSendThread.h"
+
+#include "OctreeSendScheduler.h"
+
+const int MAX_NUM_SEND_THREADS = 64;
+
+class OctreeSendWorker : public QRunnable {
+public:
+    OctreeSendWorker(OctreeSendScheduler* scheduler) : _scheduler(scheduler) { }
+
+    virtual void run() { _scheduler->workerLoop(); }
+
+private:
+    OctreeSendScheduler* _scheduler;
+};
+
+OctreeSendScheduler::OctreeSendScheduler() :
+    _mutex(),
+    _runQueueChanged(),
+    _jobFinishedProcessing(),
+    _runQueue(),
+    _queuedJobs(),
+    _processingJobs(),
+    _removedJobs(),
+    _threadPool(),
+    _numThreads(0),
+    _isStopping(false),
+    _jobsProcessed(0),
+    _missedIntervals(0),
+    _averageLateness(),
+    _averageProcessTime()
+{
+}
+
+OctreeSendScheduler::~OctreeSendScheduler() {
+    {
+        QMutexLocker locker(&_mutex);
+        _isStopping = true;
+        _runQueueChanged.wakeAll();
+    }
+    _threadPool.waitForDone();
+}
+
+void OctreeSendScheduler::startThreads(int numThreads) {
+    if (_numThreads > 0) {
+        return; // already started
+    }
+
+    _numThreads = qBound(1, numThreads, MAX_NUM_SEND_THREADS);
+
+    // the workers never return until we're stopping, so the pool needs a thread for each of them
+    _threadPool.setMaxThreadCount(_numThreads);
+    for (int i = 0; i < _numThreads; i++) {
+        _threadPool.start(new OctreeSendWorker(this));
+    }
+}
+
+void OctreeSendScheduler::addJob(OctreeSendThread* job) {
+    QMutexLocker locker(&_mutex);
+    if (!_queuedJobs.contains(job) && !_processingJobs.contains(job)) {
+        _queuedJobs.insert(job, _runQueue.insert(RunQueue::value_type(usecTimestampNow(), job)));
+        _runQueueChanged.wakeOne();
+    }
+}
+
+void OctreeSendScheduler::removeJob(OctreeSendThread* job) {
+    QMutexLocker locker(&_mutex);
+    if (_queuedJobs.contains(job)) {
+        _runQueue.erase(_queuedJobs.take(job));
+    }
+
+    if (_processingJobs.contains(job)) {
+        _removedJobs.insert(job);
+        while (_processingJobs.contains(job)) {
+            _jobFinishedProcessing.wait(&_mutex);
+        }
+    }
+}
+
+int OctreeSendScheduler::getNumJobs() {
+    QMutexLocker locker(&_mutex);
+    return _queuedJobs.size() + _processingJobs.size();
+}
+
+void OctreeSendScheduler::resetStats() {
+    QMutexLocker locker(&_mutex);
+    _jobsProcessed = 0;
+    _missedIntervals = 0;
+    _averageLateness.reset();
+    _averageProcessTime.reset();
+}
+
+void OctreeSendScheduler::workerLoop() {
+    auto nodeList = DependencyManager::get<NodeList>();
+    QMutexLocker locker(&_mutex);
+
+    while (!_isStopping) {
+        if (_runQueue.empty()) {
+            _runQueueChanged.wait(&_mutex);
+            continue;
+        }
+
+        RunQueue::iterator next = _runQueue.begin();
+        quint64 deadline = next->first;
+        quint64 now = usecTimestampNow();
+
+        if (deadline > now) {
+            // round up, waking before the deadline would just have us wait again
+            _runQueueChanged.wait(&_mutex, (deadline - now + USECS_PER_MSEC - 1) / USECS_PER_MSEC);
+            continue;
+        }
+
+        OctreeSendThread* job = next->second;
+        _runQueue.erase(next);
+        _queuedJobs.remove(job);
+        _processingJobs.insert(job);
+        _averageLateness.updateAverage((float)(now - deadline));
+
+        locker.unlock();
+
+        // a pass can send a whole burst of packets to its client, they go out together once it's done
+        nodeList->beginBatchedSends();
+        bool keepProcessing = job->process();
+        nodeList->flushBatchedSends();
+
+        quint64 processEnd = usecTimestampNow();
+        locker.relock();
+
+        _processingJobs.remove(job);
+        _jobsProcessed++;
+        _averageProcessTime.updateAverage((float)(processEnd - now));
+
+        if (!keepProcessing) {
+            // the job is only deleted by its owner once it hears about this, and can't be deleted under us by
+            // removeJob() because we hold the lock
+            emit job->finished();
+        } else if (!_removedJobs.contains(job)) {
+            quint64 nextDeadline = deadline + job->getUsecsUntilNextProcess();
+            if (nextDeadline < processEnd) {
+                // we're more than a whole interval behind for this client, don't try to catch up on what was missed
+                _missedIntervals++;
+                nextDeadline = processEnd;
+            }
+            _queuedJobs.insert(job, _runQueue.insert(RunQueue::value_type(nextDeadline, job)));
+
+            // make sure a sleeping worker is watching the new deadline too
+            _runQueueChanged.wakeOne();
+        }
+
+        _removedJobs.remove(job);
+        _jobFinishedProcessing.wakeAll();
+    }
+}
@@ -0,0 +1,79 @@
+//
+//  OctreeSendScheduler.h
+//  assignment-client/src/octree
+//
+//  Created on 4/14/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeSendScheduler_h
+#define hifi_OctreeSendScheduler_h
+
+#include <map>
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
+
+#include <SimpleMovingAverage.h>
+
+class OctreeSendThread;
+
+/// Runs the send jobs of every client of an octree server on a fixed number of threads. Each job has a deadline for its
+/// next pass, and workers always take the job with the earliest deadline, so that when the server can't keep up every
+/// client falls behind by the same amount instead of some of them starving.
+class OctreeSendScheduler {
+public:
+    OctreeSendScheduler();
+    ~OctreeSendScheduler();
+
+    /// starts the worker threads, jobs added before this just wait in the run queue
+    void startThreads(int numThreads);
+
+    /// schedules the job to be processed as soon as a worker is free
+    void addJob(OctreeSendThread* job);
+
+    /// takes the job out of the run queue, blocking while a worker is processing it
+    void removeJob(OctreeSendThread* job);
+
+    int getNumThreads() const { return _numThreads; }
+    int getNumJobs();
+
+    quint64 getJobsProcessed() const { return _jobsProcessed; }
+    quint64 getMissedIntervals() const { return _missedIntervals; }
+    float getAverageLateness() const { return _averageLateness.getAverage(); }
+    float getAverageProcessTime() const { return _averageProcessTime.getAverage(); }
+    void resetStats();
+
+private:
+    friend class OctreeSendWorker;
+    void workerLoop();
+
+    typedef std::multimap<quint64, OctreeSendThread*> RunQueue;
+
+    QMutex _mutex;
+    QWaitCondition _runQueueChanged;
+    QWaitCondition _jobFinishedProcessing;
+
+    // jobs by deadline, jobs with the same deadline are run in the order they were queued
+    RunQueue _runQueue;
+    QHash<OctreeSendThread*, RunQueue::iterator> _queuedJobs;
+    QSet<OctreeSendThread*> _processingJobs;
+    QSet<OctreeSendThread*> _removedJobs;
+
+    QThreadPool _threadPool;
+    int _numThreads;
+    bool _isStopping;
+
+    quint64 _jobsProcessed;
+    quint64 _missedIntervals;
+    SimpleMovingAverage _averageLateness;
+    SimpleMovingAverage _averageProcessTime;
+};
+
+#endif // hifi_OctreeSendScheduler_h
@@ -28,14 +28,16 @@ OctreeSendThread::OctreeSendThread(const SharedAssignmentPointer& myAssignment,
     _nodeUUID(node->getUUID()),
     _packetData(),
     _nodeMissingCount(0),
-    _isShuttingDown(false)
+    _isShuttingDown(false),
+    _usecsUntilNextProcess(OCTREE_SEND_INTERVAL_USECS)
 {
     QString safeServerName("Octree");
     if (_myServer) {
         safeServerName = _myServer->getMyServerName();
+        _packetData.setCompressionLevel(_myServer->getCompressionLevel());
     }
     qDebug() << qPrintable(safeServerName)  << "server [" << _myServer << "]: client connected "
-                                            "- starting sending thread [" << this << "]";
+                                            "- starting sending [" << this << "]";
 
     OctreeServer::clientConnected();
 }
@@ -47,7 +49,7 @@ OctreeSendThread::~OctreeSendThread() {
     }
     
     qDebug() << qPrintable(safeServerName)  << "server [" << _myServer << "]: client disconnected "
-                                            "- ending sending thread [" << this << "]";
+                                            "- ending sending [" << this << "]";
 
     OctreeServer::clientDisconnected();
     OctreeServer::stopTrackingThread(this);
@@ -56,11 +58,18 @@ OctreeSendThread::~OctreeSendThread() {
     _myAssignment.clear();
 }
 
+void OctreeSendThread::startSending() {
+    _myServer->getSendScheduler()->addJob(this);
+}
+
+void OctreeSendThread::stopSending() {
+    _myServer->getSendScheduler()->removeJob(this);
+}
+
 void OctreeSendThread::setIsShuttingDown() {
     _isShuttingDown = true;
 }
 
-
 bool OctreeSendThread::process() {
     if (_isShuttingDown) {
         return false; // exit early if we're shutting down
@@ -73,7 +82,7 @@ bool OctreeSendThread::process() {
 
     OctreeServer::didProcess(this);
 
-    quint64  start = usecTimestampNow();
+    _usecsUntilNextProcess = OCTREE_SEND_INTERVAL_USECS;
 
     // don't do any send processing until the initial load of the octree is complete...
     if (_myServer->isInitialLoadComplete()) {
@@ -84,39 +93,27 @@ bool OctreeSendThread::process() {
             // Sometimes the node data has not yet been linked, in which case we can't really do anything
             if (nodeData && !nodeData->isShuttingDown()) {
                 bool viewFrustumChanged = nodeData->updateCurrentViewFrustum();
-                packetDistributor(nodeData, viewFrustumChanged);
+                int packetsSent = packetDistributor(nodeData, viewFrustumChanged);
+
+                // a client that asked for fewer packets per second than we have intervals still gets one packet a pass,
+                // so space out its passes instead
+                int maxPacketsPerSecond = std::min(nodeData->getMaxOctreePacketsPerSecond(),
+                                                   _myServer->getPacketsPerClientPerSecond());
+                if (maxPacketsPerSecond > 0) {
+                    _usecsUntilNextProcess = std::max(_usecsUntilNextProcess,
+                                                      packetsSent * USECS_PER_SECOND / maxPacketsPerSecond);
+                }
             }
         }
     }
 
-    if (_isShuttingDown) {
-        return false; // exit early if we're shutting down
-    }
-
-    // Only sleep if we're still running and we got the lock last time we tried, otherwise try to get the lock asap
-    if (isStillRunning()) {
-        // dynamically sleep until we need to fire off the next set of octree elements
-        int elapsed = (usecTimestampNow() - start);
-        int usecToSleep =  OCTREE_SEND_INTERVAL_USECS - elapsed;
-
-        if (usecToSleep > 0) {
-            PerformanceWarning warn(false,"OctreeSendThread... usleep()",false,&_usleepTime,&_usleepCalls);
-            usleep(usecToSleep);
-        } else {
-            const int MIN_USEC_TO_SLEEP = 1;
-            usleep(MIN_USEC_TO_SLEEP);
-        }
-    }
-
-    return isStillRunning();  // keep running till they terminate us
+    return !_isShuttingDown; // keep going till they shut us down
 }
 
-quint64 OctreeSendThread::_usleepTime = 0;
-quint64 OctreeSendThread::_usleepCalls = 0;
-
 quint64 OctreeSendThread::_totalBytes = 0;
 quint64 OctreeSendThread::_totalWastedBytes = 0;
 quint64 OctreeSendThread::_totalPackets = 0;
+quint64 OctreeSendThread::_totalSkippedPasses = 0;
 
 int OctreeSendThread::handlePacketSend(OctreeQueryNode* nodeData, int& trueBytesSent, int& truePacketsSent) {
     OctreeServer::didHandlePacketSend(this);
@@ -279,6 +276,24 @@ int OctreeSendThread::handlePacketSend(OctreeQueryNode* nodeData, int& trueBytes
     return packetsSent;
 }
 
+/// True when a new pass over the tree could only come up with a duplicate of the last one: the last pass finished
+/// with nothing left over to send, and nothing in the tree has changed since that pass started. An element's change
+/// time covers its whole subtree, so checking the root is enough, and it doesn't need the tree lock.
+bool OctreeSendThread::clientIsUpToDate(OctreeQueryNode* nodeData) {
+    return nodeData->elementBag.isEmpty()
+        && nodeData->getViewSent()
+        && !nodeData->isPacketWaiting()
+        && !nodeData->hasNextNackedPacket()
+        && _myServer->getOctree()->getRoot()->getLastChanged() == nodeData->getLastRootTimestamp()
+        && !_myServer->hasSpecialPacketToSend(_node);
+}
+
+/// The tree the client's current scene is sent from, its snapshot if the server sends from snapshots
+Octree* OctreeSendThread::getSceneTree(OctreeQueryNode* nodeData) {
+    const OctreePointer& snapshot = nodeData->getSceneSnapshot();
+    return snapshot ? snapshot.data() : _myServer->getOctree();
+}
+
 /// Version of octree element distributor that sends the deepest LOD level at once
 int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrustumChanged) {
         
@@ -299,6 +314,12 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
     bool isFullScene = ((!viewFrustumChanged || !nodeData->getWantDelta()) && nodeData->getViewFrustumJustStoppedChanging()) 
                                 || nodeData->hasLodChanged();
 
+    // a client looking at a scene it already has costs nothing until something changes
+    if (!viewFrustumChanged && !isFullScene && clientIsUpToDate(nodeData)) {
+        _totalSkippedPasses++;
+        return 0;
+    }
+
     bool somethingToSend = true; // assume we have something
 
     // FOR NOW... node tells us if it wants to receive only view frustum deltas
@@ -348,8 +369,8 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
 
         // track completed scenes and send out the stats packet accordingly
         nodeData->stats.sceneCompleted();
-        nodeData->setLastRootTimestamp(_myServer->getOctree()->getRoot()->getLastChanged());
-        _myServer->getOctree()->releaseSceneEncodeData(&nodeData->extraEncodeData);
+        nodeData->setLastRootTimestamp(getSceneTree(nodeData)->getRoot()->getLastChanged());
+        getSceneTree(nodeData)->releaseSceneEncodeData(&nodeData->extraEncodeData);
 
         // TODO: add these to stats page
         //::endSceneSleepTime = _usleepTime;
@@ -365,20 +386,28 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
             nodeData->elementBag.deleteAll();
         }
 
+        // the new scene is sent from the newest snapshot, what's left in the bag belongs to the old one
+        OctreePointer latestSnapshot = _myServer->getSnapshotPublisher()->getLatest();
+        if (latestSnapshot != nodeData->getSceneSnapshot()) {
+            nodeData->elementBag.deleteAll();
+            nodeData->setSceneSnapshot(latestSnapshot);
+        }
+
         // TODO: add these to stats page
         //::startSceneSleepTime = _usleepTime;
         
         // start tracking our stats
-        nodeData->stats.sceneStarted(isFullScene, viewFrustumChanged, _myServer->getOctree()->getRoot(), _myServer->getJurisdiction());
+        nodeData->stats.sceneStarted(isFullScene, viewFrustumChanged, getSceneTree(nodeData)->getRoot(),
+                                     _myServer->getJurisdiction());
 
         // This is the start of "resending" the scene.
         bool dontRestartSceneOnMove = false; // this is experimental
         if (dontRestartSceneOnMove) {
             if (nodeData->elementBag.isEmpty()) {
-                nodeData->elementBag.insert(_myServer->getOctree()->getRoot());
+                nodeData->elementBag.insert(getSceneTree(nodeData)->getRoot());
             }
         } else {
-            nodeData->elementBag.insert(_myServer->getOctree()->getRoot());
+            nodeData->elementBag.insert(getSceneTree(nodeData)->getRoot());
         }
     }
 
@@ -404,36 +433,20 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
 
             bool lastNodeDidntFit = false; // assume each node fits
             if (!nodeData->elementBag.isEmpty()) {
-                
+                Octree* sceneTree = getSceneTree(nodeData);
+
+                // nothing ever writes to a snapshot, so there's no lock to wait for
+                bool lockSceneTree = !nodeData->getSceneSnapshot();
                 quint64 lockWaitStart = usecTimestampNow();
-                _myServer->getOctree()->lockForRead();
+                if (lockSceneTree) {
+                    sceneTree->lockForRead();
+                }
                 quint64 lockWaitEnd = usecTimestampNow();
                 lockWaitElapsedUsec = (float)(lockWaitEnd - lockWaitStart);
                 quint64 encodeStart = usecTimestampNow();
 
                 OctreeElement* subTree = nodeData->elementBag.extract();
 
-                /* TODO: Looking for a way to prevent locking and encoding a tree that is not
-                // going to result in any packets being sent...
-                //
-                // If our node is root, and the root hasn't changed, and our view hasn't changed,
-                // and we've already seen at least one duplicate packet, then we probably don't need 
-                // to lock the tree and encode, because the result should be that no bytes will be 
-                // encoded, and this will be a duplicate packet from the  last one we sent...
-                OctreeElement* root = _myServer->getOctree()->getRoot();
-                bool skipEncode = false;
-                if (
-                        (subTree == root)
-                        && (nodeData->getLastRootTimestamp() == root->getLastChanged())
-                        && !viewFrustumChanged 
-                        && (nodeData->getDuplicatePacketCount() > 0)
-                ) {
-                    qDebug() << "is root, root not changed, view not changed, already seen a duplicate!"
-                        << "Can we skip it?";
-                    skipEncode = true;
-                }
-                */
-
                 bool wantOcclusionCulling = nodeData->getWantOcclusionCulling();
                 CoverageMap* coverageMap = wantOcclusionCulling ? &nodeData->map : IGNORE_COVERAGE_MAP;
                 
@@ -449,13 +462,14 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
                                              nodeData->getLastTimeBagEmpty(),
                                              isFullScene, &nodeData->stats, _myServer->getJurisdiction(),
                                              &nodeData->extraEncodeData);
+                params.encodeCache = _myServer->getEncodeCache();
 
                 // TODO: should this include the lock time or not? This stat is sent down to the client,
                 // it seems like it may be a good idea to include the lock time as part of the encode time
                 // are reported to client. Since you can encode without the lock
                 nodeData->stats.encodeStarted();
 
-                bytesWritten = _myServer->getOctree()->encodeTreeBitstream(subTree, &_packetData, nodeData->elementBag, params);
+                bytesWritten = sceneTree->encodeTreeBitstream(subTree, &_packetData, nodeData->elementBag, params);
 
                 quint64 encodeEnd = usecTimestampNow();
                 encodeElapsedUsec = (float)(encodeEnd - encodeStart);
@@ -482,7 +496,9 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
                 }
 
                 nodeData->stats.encodeStopped();
-                _myServer->getOctree()->unlock();
+                if (lockSceneTree) {
+                    sceneTree->unlock();
+                }
             } else {
                 // If the bag was empty then we didn't even attempt to encode, and so we know the bytesWritten were 0
                 bytesWritten = 0;
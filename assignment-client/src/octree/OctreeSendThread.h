@@ -5,7 +5,7 @@
 //  Created by Brad Hefta-Gaub on 8/21/13.
 //  Copyright 2013 High Fidelity, Inc.
 //
-//  Threaded or non-threaded object for sending octree data packets to a client
+//  Object for sending octree data packets to a client
 //
 //  Distributed under the Apache License, Version 2.0.
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
@@ -14,7 +14,8 @@
 #ifndef hifi_OctreeSendThread_h
 #define hifi_OctreeSendThread_h
 
-#include <GenericThread.h>
+#include <QtCore/QObject>
+
 #include <NetworkPacket.h>
 #include <OctreeElementBag.h>
 
@@ -22,25 +23,36 @@
 
 class OctreeServer;
 
-/// Threaded processor for sending octree packets to a single client
-class OctreeSendThread : public GenericThread {
+/// Sends octree packets to a single client. Rather than having a thread of its own, it is processed once per send
+/// interval by one of the threads of its server's OctreeSendScheduler.
+class OctreeSendThread : public QObject {
     Q_OBJECT
 public:
     OctreeSendThread(const SharedAssignmentPointer& myAssignment, const SharedNodePointer& node);
     virtual ~OctreeSendThread();
     
+    /// hands this client to the server's send scheduler
+    void startSending();
+
+    /// takes this client off the server's send scheduler, blocking while it is being processed
+    void stopSending();
+
     void setIsShuttingDown();
 
+    /// sends this interval's packets to the client, returns false once the client is done and should not be processed again
+    bool process();
+
+    /// how long the scheduler should wait after the start of the last process() before the next one, which keeps the
+    /// packets we send under the rate that both the client and the server allow
+    quint64 getUsecsUntilNextProcess() const { return _usecsUntilNextProcess; }
+
     static quint64 _totalBytes;
     static quint64 _totalWastedBytes;
     static quint64 _totalPackets;
+    static quint64 _totalSkippedPasses;
 
-    static quint64 _usleepTime;
-    static quint64 _usleepCalls;
-
-protected:
-    /// Implements generic processing behavior for this thread.
-    virtual bool process();
+signals:
+    void finished();
 
 private:
     SharedAssignmentPointer _myAssignment;
@@ -50,11 +62,14 @@ private:
 
     int handlePacketSend(OctreeQueryNode* nodeData, int& trueBytesSent, int& truePacketsSent);
     int packetDistributor(OctreeQueryNode* nodeData, bool viewFrustumChanged);
+    bool clientIsUpToDate(OctreeQueryNode* nodeData);
+    Octree* getSceneTree(OctreeQueryNode* nodeData);
 
     OctreePacketData _packetData;
     
     int _nodeMissingCount;
     bool _isShuttingDown;
+    quint64 _usecsUntilNextProcess;
 };
 
 #endif // hifi_OctreeSendThread_h
@@ -104,6 +104,10 @@ void OctreeServer::resetSendingStats() {
 
     _averageNodeWaitTime.reset();
 
+    _encodeCache.resetStats();
+    _sendScheduler.resetStats();
+    _snapshotPublisher.resetStats();
+
     _averageCompressAndWriteTime.reset();
     _averageShortCompressTime.reset();
     _averageLongCompressTime.reset();
@@ -238,6 +242,11 @@ OctreeServer::OctreeServer(const QByteArray& packet) :
     _jurisdictionSender(NULL),
     _octreeInboundPacketProcessor(NULL),
     _persistThread(NULL),
+    _encodeCache(),
+    _sendScheduler(),
+    _snapshotPublisher(),
+    _compressionLevel(DEFAULT_OCTREE_COMPRESSION_LEVEL),
+    _editBatchInterval(0),
     _started(time(0)),
     _startedUSecs(usecTimestampNow())
 {
@@ -439,6 +448,21 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
         statsString += QString("      writeDatagram() last second: %1 clients\r\n\r\n")
             .arg(locale.toString((uint)howManyThreadsDidCallWriteDatagram(oneSecondAgo)).rightJustified(COLUMN_WIDTH, ' '));
 
+        statsString += QString("                     Send Threads: %1 threads\r\n")
+            .arg(locale.toString(_sendScheduler.getNumThreads()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("                  Scheduled Sends: %1 clients\r\n")
+            .arg(locale.toString(_sendScheduler.getNumJobs()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("                  Sends Processed: %1 passes\r\n")
+            .arg(locale.toString((uint)_sendScheduler.getJobsProcessed()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("            Missed Send Intervals: %1 passes\r\n")
+            .arg(locale.toString((uint)_sendScheduler.getMissedIntervals()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("       Skipped, Client Up To Date: %1 passes\r\n")
+            .arg(locale.toString((uint)OctreeSendThread::_totalSkippedPasses).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString().sprintf("      Average Send Start Lateness:    %9.2f usecs\r\n",
+                                         _sendScheduler.getAverageLateness());
+        statsString += QString().sprintf("        Average Send Process Time:    %9.2f usecs\r\n\r\n",
+                                         _sendScheduler.getAverageProcessTime());
+
         float averageLoopTime = getAverageLoopTime();
         statsString += QString().sprintf("           Average packetLoop() time:      %7.2f msecs"
                                          "                 samples: %12d \r\n", 
@@ -514,6 +538,17 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
                                          _averageTreeExtraLongWaitTime.getAverage(), 
                                          extraLongVsTotal * AS_PERCENT, _extraLongTreeWait);
 
+        if (_snapshotPublisher.isEnabled()) {
+            statsString += QString().sprintf("                 Snapshots published:    %9llu\r\n",
+                                             _snapshotPublisher.getSnapshotsPublished());
+            statsString += QString().sprintf("                    Snapshots in use:    %9d\r\n",
+                                             OctreeSnapshotPublisher::getSnapshotsInUse());
+            statsString += QString().sprintf("     Average snapshot lock wait time:    %9.2f usecs\r\n",
+                                             _snapshotPublisher.getAverageLockWaitTime());
+            statsString += QString().sprintf("          Average snapshot copy time:    %9.2f usecs\r\n\r\n",
+                                             _snapshotPublisher.getAverageCopyTime());
+        }
+
         // encode
         float averageEncodeTime = getAverageEncodeTime();
         statsString += QString().sprintf("                 Average encode time:    %9.2f usecs\r\n", averageEncodeTime);
@@ -625,6 +660,23 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
             locale.toString((uint)totalBytesOfColor).rightJustified(COLUMN_WIDTH, ' ').toLocal8Bit().constData(),
             ((float)totalBytesOfColor / (float)totalOutboundBytes) * AS_PERCENT);
 
+        statsString += "\r\n";
+
+        quint64 encodeCacheHits = _encodeCache.getHits();
+        quint64 encodeCacheLookups = encodeCacheHits + _encodeCache.getMisses();
+        statsString += QString("                Encode Cache Hits: %1 elements\r\n")
+            .arg(locale.toString((uint)encodeCacheHits).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("              Encode Cache Misses: %1 elements\r\n")
+            .arg(locale.toString((uint)_encodeCache.getMisses()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString().sprintf("           Encode Cache Hit Ratio: %5.2f%%\r\n",
+            encodeCacheLookups == 0 ? 0.0f : ((float)encodeCacheHits / (float)encodeCacheLookups) * AS_PERCENT);
+        statsString += QString("        Encode Cache Bytes Reused: %1 bytes\r\n")
+            .arg(locale.toString((uint)_encodeCache.getBytesReused()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("             Encode Cache Entries: %1 elements\r\n")
+            .arg(locale.toString(_encodeCache.getNumEntries()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("                Encode Cache Size: %1 bytes\r\n")
+            .arg(locale.toString(_encodeCache.getSizeBytes()).rightJustified(COLUMN_WIDTH, ' '));
+
         statsString += "\r\n";
         statsString += "\r\n";
 
@@ -656,6 +708,14 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
             .arg(locale.toString((uint)averageProcessTimePerElement).rightJustified(COLUMN_WIDTH, ' '));
         statsString += QString("  Average Wait Lock Time/Element: %1 usecs\r\n")
             .arg(locale.toString((uint)averageLockWaitTimePerElement).rightJustified(COLUMN_WIDTH, ' '));
+        if (_octreeInboundPacketProcessor->isBatchingEdits()) {
+            statsString += QString("           Edit Batches Applied: %1 batches\r\n")
+                .arg(locale.toString((uint)_octreeInboundPacketProcessor->getEditBatchesApplied())
+                     .rightJustified(COLUMN_WIDTH, ' '));
+            statsString += QString("     Edits Coalesced In Batches: %1 elements\r\n")
+                .arg(locale.toString((uint)_octreeInboundPacketProcessor->getEditsCoalesced())
+                     .rightJustified(COLUMN_WIDTH, ' '));
+        }
 
 
         int senderNumber = 0;
@@ -725,6 +785,8 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
         statsString += "                                 -----------\r\n";
         statsString += QString().sprintf("                         Total:  %8.2f %s\r\n",
                                          OctreeElement::getTotalMemoryUsage() / memoryScale, memoryScaleLabel);
+        statsString += QString().sprintf("Reserved By Element Pools:       %8.2f %s\r\n",
+                                         OctreeElement::getPoolMemoryReserved() / memoryScale, memoryScaleLabel);
         statsString += "\r\n";
 
         statsString += "OctreeElement Children Population Statistics...\r\n";
@@ -1051,6 +1113,15 @@ void OctreeServer::readConfiguration() {
         readOptionInt(QString("persistInterval"), settingsSectionObject, _persistInterval);
         qDebug() << "persistInterval=" << _persistInterval;
 
+        // how often edits are appended to the edit journal, 0 saves only by writing the whole tree
+        _journalInterval = 0;
+        readOptionInt(QString("journalInterval"), settingsSectionObject, _journalInterval);
+        qDebug() << "journalInterval=" << _journalInterval;
+
+        // whether the tree is copied and the copy saved, instead of holding the tree's lock for the whole save
+        readOptionBool(QString("persistFromSnapshot"), settingsSectionObject, _persistFromSnapshot);
+        qDebug() << "persistFromSnapshot=" << _persistFromSnapshot;
+
         bool noBackup;
         readOptionBool(QString("NoBackup"), settingsSectionObject, noBackup);
         _wantBackup = !noBackup;
@@ -1092,6 +1163,34 @@ void OctreeServer::readConfiguration() {
     }
     qDebug("packetsPerSecondTotalMax=%d _packetsTotalPerInterval=%d", 
                     packetsPerSecondTotalMax, _packetsTotalPerInterval);
+
+    // the number of threads sending to clients, 0 means one per core
+    int sendThreads = 0;
+    readOptionInt(QString("sendThreads"), settingsSectionObject, sendThreads);
+    if (sendThreads <= 0) {
+        sendThreads = QThread::idealThreadCount();
+    }
+    _sendScheduler.startThreads(sendThreads);
+    qDebug("sendThreads=%d", _sendScheduler.getNumThreads());
+
+    int encodeCacheSizeMB = DEFAULT_ENCODE_CACHE_SIZE_MB;
+    readOptionInt(QString("encodeCacheSize"), settingsSectionObject, encodeCacheSizeMB);
+    _encodeCache.setMaxSizeMB(encodeCacheSizeMB);
+    qDebug("encodeCacheSize=%d", encodeCacheSizeMB);
+
+    // the zlib level for clients that asked for compressed packets
+    readOptionInt(QString("compressionLevel"), settingsSectionObject, _compressionLevel);
+    qDebug("compressionLevel=%d", _compressionLevel);
+
+    // how often clients are sent a new copy of the tree, 0 sends straight from the tree under its lock
+    int snapshotInterval = 0;
+    readOptionInt(QString("snapshotInterval"), settingsSectionObject, snapshotInterval);
+    _snapshotPublisher.start(_tree, snapshotInterval);
+    qDebug("snapshotInterval=%d", snapshotInterval);
+
+    // how long edits can wait to be applied together, 0 applies each edit as it arrives
+    readOptionInt(QString("editBatchInterval"), settingsSectionObject, _editBatchInterval);
+    qDebug("editBatchInterval=%d", _editBatchInterval);
                     
                     
     readAdditionalConfiguration(settingsSectionObject);
@@ -1140,7 +1239,8 @@ void OctreeServer::run() {
 
         // now set up PersistThread
         _persistThread = new OctreePersistThread(_tree, _persistFilename, _persistInterval,
-                                                 _wantBackup, _settings, _debugTimestampNow, _persistAsFileType);
+                                                 _wantBackup, _settings, _debugTimestampNow, _persistAsFileType,
+                                                 _journalInterval, _persistFromSnapshot);
         if (_persistThread) {
             _persistThread->initialize(true);
         }
@@ -1157,6 +1257,7 @@ void OctreeServer::run() {
 
     // set up our OctreeServerPacketProcessor
     _octreeInboundPacketProcessor = new OctreeInboundPacketProcessor(this);
+    _octreeInboundPacketProcessor->setEditBatchInterval(_editBatchInterval);
     _octreeInboundPacketProcessor->initialize(true);
 
     // Convert now to tm struct for local timezone
@@ -1181,9 +1282,6 @@ void OctreeServer::nodeAdded(SharedNodePointer node) {
 void OctreeServer::nodeKilled(SharedNodePointer node) {
     quint64 start  = usecTimestampNow();
 
-    // calling this here since nodeKilled slot in ReceivedPacketProcessor can't be triggered by signals yet!!
-    _octreeInboundPacketProcessor->nodeKilled(node);
-
     qDebug() << qPrintable(_safeServerName) << "server killed node:" << *node;
     OctreeQueryNode* nodeData = static_cast<OctreeQueryNode*>(node->getLinkedData());
     if (nodeData) {
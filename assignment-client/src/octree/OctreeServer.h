@@ -20,10 +20,13 @@
 
 #include <ThreadedAssignment.h>
 #include <EnvironmentData.h>
+#include <OctreeEncodeCache.h>
 
 #include "OctreePersistThread.h"
+#include "OctreeSendScheduler.h"
 #include "OctreeSendThread.h"
 #include "OctreeServerConsts.h"
+#include "OctreeSnapshotPublisher.h"
 #include "OctreeInboundPacketProcessor.h"
 
 const int DEFAULT_PACKETS_PER_INTERVAL = 2000; // some 120,000 packets per second total
@@ -43,6 +46,10 @@ public:
     bool wantsVerboseDebug() const { return _verboseDebug; }
 
     Octree* getOctree() { return _tree; }
+    OctreeEncodeCache* getEncodeCache() { return &_encodeCache; }
+    OctreeSendScheduler* getSendScheduler() { return &_sendScheduler; }
+    OctreeSnapshotPublisher* getSnapshotPublisher() { return &_snapshotPublisher; }
+    int getCompressionLevel() const { return _compressionLevel; }
     JurisdictionMap* getJurisdiction() { return _jurisdiction; }
 
     int getPacketsPerClientPerInterval() const { return std::min(_packetsPerClientPerInterval, 
@@ -170,8 +177,15 @@ protected:
     JurisdictionSender* _jurisdictionSender;
     OctreeInboundPacketProcessor* _octreeInboundPacketProcessor;
     OctreePersistThread* _persistThread;
+    OctreeEncodeCache _encodeCache;
+    OctreeSendScheduler _sendScheduler;
+    OctreeSnapshotPublisher _snapshotPublisher;
+    int _compressionLevel;
+    int _editBatchInterval;
     
     int _persistInterval;
+    int _journalInterval;
+    bool _persistFromSnapshot;
     bool _wantBackup;
     QString _backupExtensionFormat;
     int _backupInterval;
@@ -0,0 +1,121 @@
+//
+//  OctreeSnapshotPublisher.cpp
+//  assignment-client/src/octree
+//
+//  Created on 4/20/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutexLocker>
+
+#include <SharedUtil.h>
+
+#include "OctreeSnapshotPublisher.h"
+
+static QBasicAtomicInt snapshotsInUse = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+// whichever send thread lets go of a snapshot last deletes it
+static void deleteSnapshot(Octree* snapshot) {
+    delete snapshot;
+    snapshotsInUse.fetchAndAddRelaxed(-1);
+}
+
+OctreeSnapshotPublisher::OctreeSnapshotPublisher() :
+    _tree(NULL),
+    _intervalUsecs(0),
+    _publishMutex(),
+    _latestMutex(),
+    _latest(),
+    _nextCheck(0),
+    _snapshotsPublished(0),
+    _averageLockWaitTime(),
+    _averageCopyTime()
+{
+}
+
+void OctreeSnapshotPublisher::start(Octree* tree, int intervalMsecs) {
+    if (intervalMsecs > 0) {
+        _tree = tree;
+        _intervalUsecs = (quint64)intervalMsecs * USECS_PER_MSEC;
+    }
+}
+
+OctreePointer OctreeSnapshotPublisher::getLatest() {
+    if (!_tree) {
+        return OctreePointer();
+    }
+
+    OctreePointer latest;
+    {
+        QMutexLocker locker(&_latestMutex);
+        latest = _latest;
+        if (usecTimestampNow() < _nextCheck) {
+            return latest;
+        }
+    }
+
+    if (!latest) {
+        // there's nothing to send from until the first copy is done, or until we know the tree can't be copied
+        _publishMutex.lock();
+    } else if (!_publishMutex.tryLock()) {
+        // another thread is copying the tree, sending from the current snapshot a little longer is fine
+        return latest;
+    }
+
+    {
+        // the thread that was copying before us may have just published
+        QMutexLocker locker(&_latestMutex);
+        latest = _latest;
+        if (usecTimestampNow() < _nextCheck) {
+            _publishMutex.unlock();
+            return latest;
+        }
+    }
+
+    quint64 lockWaitStart = usecTimestampNow();
+    _tree->lockForRead();
+    quint64 copyStart = usecTimestampNow();
+
+    // the root's change time covers its whole tree, so the current snapshot is good until it moves
+    bool published = false;
+    if (!latest || _tree->getRoot()->getLastChanged() != latest->getRoot()->getLastChanged()) {
+        Octree* snapshot = _tree->createSnapshot();
+        if (snapshot) {
+            snapshotsInUse.fetchAndAddRelaxed(1);
+            latest = OctreePointer(snapshot, deleteSnapshot);
+            published = true;
+        }
+    }
+
+    _tree->unlock();
+    quint64 copyEnd = usecTimestampNow();
+
+    {
+        QMutexLocker locker(&_latestMutex);
+        _latest = latest;
+        _nextCheck = copyEnd + _intervalUsecs;
+        if (published) {
+            _snapshotsPublished++;
+            _averageLockWaitTime.updateAverage((float)(copyStart - lockWaitStart));
+            _averageCopyTime.updateAverage((float)(copyEnd - copyStart));
+        }
+    }
+
+    _publishMutex.unlock();
+    return latest;
+}
+
+int OctreeSnapshotPublisher::getSnapshotsInUse() {
+    return snapshotsInUse.load();
+}
+
+void OctreeSnapshotPublisher::resetStats() {
+    QMutexLocker locker(&_latestMutex);
+    _snapshotsPublished = 0;
+    _averageLockWaitTime.reset();
+    _averageCopyTime.reset();
+}
@@ -0,0 +1,60 @@
+//
+//  OctreeSnapshotPublisher.h
+//  assignment-client/src/octree
+//
+//  Created on 4/20/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeSnapshotPublisher_h
+#define hifi_OctreeSnapshotPublisher_h
+
+#include <QtCore/QMutex>
+
+#include <Octree.h>
+#include <SimpleMovingAverage.h>
+
+/// Publishes read only copies of a server's tree for the send threads to encode from, so that sending to clients never
+/// takes the tree's lock and never holds up edits. Each client keeps the snapshot its scene started from until the
+/// scene is done, and a snapshot is deleted once no client is sending from it. The tree is copied under its read lock,
+/// at most once per interval and only if it changed, so the writers wait for one copy per interval instead of for the
+/// encode passes of every client.
+class OctreeSnapshotPublisher {
+public:
+    OctreeSnapshotPublisher();
+
+    /// an interval of 0 leaves snapshots off, and clients are sent straight from the tree under its read lock
+    void start(Octree* tree, int intervalMsecs);
+    bool isEnabled() const { return _tree != NULL; }
+
+    /// The newest snapshot of the tree, after publishing a new one if the tree changed and the newest one is at least an
+    /// interval old. Returns NULL if snapshots are off or the tree can't be copied.
+    OctreePointer getLatest();
+
+    quint64 getSnapshotsPublished() const { return _snapshotsPublished; }
+    float getAverageLockWaitTime() const { return _averageLockWaitTime.getAverage(); }
+    float getAverageCopyTime() const { return _averageCopyTime.getAverage(); }
+
+    /// snapshots that are published or still being sent from, across all servers in the process
+    static int getSnapshotsInUse();
+
+    void resetStats();
+
+private:
+    Octree* _tree;
+    quint64 _intervalUsecs;
+
+    QMutex _publishMutex; // held while copying, so only one thread copies while the others keep the current snapshot
+    QMutex _latestMutex;
+    OctreePointer _latest;
+    quint64 _nextCheck; // the tree isn't looked at again until then
+
+    quint64 _snapshotsPublished;
+    SimpleMovingAverage _averageLockWaitTime;
+    SimpleMovingAverage _averageCopyTime;
+};
+
+#endif // hifi_OctreeSnapshotPublisher_h
@@ -663,10 +663,12 @@ void DomainServer::handleConnectRequest(const QByteArray& packet, const HifiSock
             canRez = canAdjustLocks;
         }
 
-        SharedNodePointer newNode =
-            DependencyManager::get<LimitedNodeList>()->addOrUpdateNode(nodeUUID, nodeType,
-                                                                       publicSockAddr, localSockAddr,
-                                                                       canAdjustLocks, canRez);
+        auto limitedNodeList = DependencyManager::get<LimitedNodeList>();
+        SharedNodePointer newNode = limitedNodeList->addOrUpdateNode(nodeUUID, nodeType, publicSockAddr, localSockAddr,
+                                                                     canAdjustLocks, canRez);
+        if (newNode->getLocalID() == NULL_LOCAL_NODE_ID) {
+            limitedNodeList->setLocalIDForNode(newNode, lowestUnusedLocalID());
+        }
         // when the newNode is created the linked data is also created
         // if this was a static assignment set the UUID, set the sendingSockAddr
         DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(newNode->getLinkedData());
@@ -916,6 +918,16 @@ NodeSet DomainServer::nodeInterestListFromPacket(const QByteArray& packet, int n
     return nodeInterestSet;
 }
 
+LocalNodeID DomainServer::lowestUnusedLocalID() {
+    // reusing the IDs of nodes that left keeps the arrays nodes look each other up in small
+    auto nodeList = DependencyManager::get<LimitedNodeList>();
+    LocalNodeID localID = NULL_LOCAL_NODE_ID + 1;
+    while (nodeList->nodeWithLocalID(localID)) {
+        localID++;
+    }
+    return localID;
+}
+
 void DomainServer::sendDomainListToNode(const SharedNodePointer& node, const HifiSockAddr &senderSockAddr,
                                         const NodeSet& nodeInterestList) {
 
@@ -926,6 +938,7 @@ void DomainServer::sendDomainListToNode(const SharedNodePointer& node, const Hif
     broadcastDataStream << node->getUUID();
     broadcastDataStream << node->getCanAdjustLocks();
     broadcastDataStream << node->getCanRez();
+    broadcastDataStream << node->getLocalID();
 
     int numBroadcastPacketLeadBytes = broadcastDataStream.device()->pos();
 
@@ -973,6 +986,7 @@ void DomainServer::sendDomainListToNode(const SharedNodePointer& node, const Hif
                     }
                     
                     nodeDataStream << secretUUID;
+                    nodeDataStream << otherNode->getLocalID();
                     
                     if (broadcastPacket.size() +  nodeByteArray.size() > dataMTU) {
                         // we need to break here and start a new packet
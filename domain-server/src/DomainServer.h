@@ -97,6 +97,7 @@ private:
                                    HifiSockAddr& localSockAddr,
                                    const HifiSockAddr& senderSockAddr);
     NodeSet nodeInterestListFromPacket(const QByteArray& packet, int numPreceedingBytes);
+    LocalNodeID lowestUnusedLocalID();
     void sendDomainListToNode(const SharedNodePointer& node, const HifiSockAddr& senderSockAddr,
                               const NodeSet& nodeInterestList);
     
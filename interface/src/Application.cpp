@@ -3527,11 +3527,8 @@ void Application::nodeAdded(SharedNodePointer node) {
 
 void Application::nodeKilled(SharedNodePointer node) {
 
-    // These are here because connecting NodeList::nodeKilled to OctreePacketProcessor::nodeKilled doesn't work:
-    // OctreePacketProcessor::nodeKilled is not being called when NodeList::nodeKilled is emitted.
-    // This may have to do with GenericThread::threadRoutine() blocking the QThread event loop
-
-    _octreeProcessor.nodeKilled(node);
+    // This is called directly since slots of a GenericThread aren't reliably called when NodeList::nodeKilled is
+    // emitted. This may have to do with GenericThread::threadRoutine() blocking the QThread event loop
 
     _entityEditSender.nodeKilled(node);
 
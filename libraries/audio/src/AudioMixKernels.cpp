@@ -0,0 +1,209 @@
+//
+//  AudioMixKernels.cpp
+//  libraries/audio/src
+//
+//  Created on 4/10/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <math.h>
+
+#include "AudioConstants.h"
+
+#include "AudioMixKernels.h"
+
+#ifdef HIFI_AUDIO_MIX_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+void AudioMixKernels::mixSaturatedScalar(int16_t* dest, const int16_t* source, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+        int sum = dest[i] + source[i];
+        dest[i] = sum < AudioConstants::MIN_SAMPLE_VALUE ? AudioConstants::MIN_SAMPLE_VALUE
+            : (sum > AudioConstants::MAX_SAMPLE_VALUE ? AudioConstants::MAX_SAMPLE_VALUE : sum);
+    }
+}
+
+void AudioMixKernels::mixScaledSaturatedScalar(int16_t* dest, const int16_t* source, int numSamples, float gain) {
+    for (int i = 0; i < numSamples; i++) {
+        int sum = dest[i] + (int)(source[i] * gain);
+        dest[i] = sum < AudioConstants::MIN_SAMPLE_VALUE ? AudioConstants::MIN_SAMPLE_VALUE
+            : (sum > AudioConstants::MAX_SAMPLE_VALUE ? AudioConstants::MAX_SAMPLE_VALUE : sum);
+    }
+}
+
+void AudioMixKernels::mixScaledIntoInterleavedChannelScalar(int16_t* dest, const int16_t* source,
+                                                            int numSamples, float gain) {
+    for (int i = 0; i < numSamples; i++) {
+        int16_t scaledSample = source[i] * gain;
+        dest[i * 2] += scaledSample;
+    }
+}
+
+void AudioMixKernels::scaleScalar(int16_t* dest, const int16_t* source, int numSamples, float gain) {
+    for (int i = 0; i < numSamples; i++) {
+        dest[i] = (int16_t)((float)source[i] * gain);
+    }
+}
+
+void AudioMixKernels::scaleScalar(float* samples, int numSamples, float gain) {
+    for (int i = 0; i < numSamples; i++) {
+        samples[i] *= gain;
+    }
+}
+
+float AudioMixKernels::sumOfAbsolutesScalar(const int16_t* source, int numSamples) {
+    float sum = 0.0f;
+    for (int i = 0; i < numSamples; i++) {
+        sum += fabsf(source[i]);
+    }
+    return sum;
+}
+
+#ifdef HIFI_AUDIO_MIX_KERNELS_SSE2
+
+const int SAMPLES_PER_VECTOR = 8;
+
+// multiplies 8 int16 samples by gain, truncating each product towards zero like a float to int cast does
+static inline __m128i scaleVector(__m128i samples, __m128 gain) {
+    // sign extend the samples to 32 bits
+    __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+    __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+
+    low = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(low), gain));
+    high = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(high), gain));
+
+    return _mm_packs_epi32(low, high);
+}
+
+void AudioMixKernels::mixSaturated(int16_t* dest, const int16_t* source, int numSamples) {
+    int i = 0;
+    for (; i + SAMPLES_PER_VECTOR <= numSamples; i += SAMPLES_PER_VECTOR) {
+        __m128i destVector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + i));
+        __m128i sourceVector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_adds_epi16(destVector, sourceVector));
+    }
+    mixSaturatedScalar(dest + i, source + i, numSamples - i);
+}
+
+void AudioMixKernels::mixScaledSaturated(int16_t* dest, const int16_t* source, int numSamples, float gain) {
+    __m128 gainVector = _mm_set1_ps(gain);
+
+    int i = 0;
+    for (; i + SAMPLES_PER_VECTOR <= numSamples; i += SAMPLES_PER_VECTOR) {
+        __m128i destVector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + i));
+        __m128i sourceVector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+
+        __m128i sourceLow = _mm_srai_epi32(_mm_unpacklo_epi16(sourceVector, sourceVector), 16);
+        __m128i sourceHigh = _mm_srai_epi32(_mm_unpackhi_epi16(sourceVector, sourceVector), 16);
+        sourceLow = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(sourceLow), gainVector));
+        sourceHigh = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(sourceHigh), gainVector));
+
+        // add in 32 bits so the scaled sample can't saturate before the sum does
+        __m128i sumLow = _mm_add_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(destVector, destVector), 16), sourceLow);
+        __m128i sumHigh = _mm_add_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(destVector, destVector), 16), sourceHigh);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_packs_epi32(sumLow, sumHigh));
+    }
+    mixScaledSaturatedScalar(dest + i, source + i, numSamples - i, gain);
+}
+
+void AudioMixKernels::mixScaledIntoInterleavedChannel(int16_t* dest, const int16_t* source,
+                                                      int numSamples, float gain) {
+    __m128 gainVector = _mm_set1_ps(gain);
+    __m128i zero = _mm_setzero_si128();
+
+    // each pass reads 8 samples of source and writes 16 interleaved samples of dest, the last of which
+    // belongs to the other channel, so stop early enough to never touch past dest[(numSamples - 1) * 2]
+    int i = 0;
+    for (; i + SAMPLES_PER_VECTOR < numSamples; i += SAMPLES_PER_VECTOR) {
+        __m128i scaled = scaleVector(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)), gainVector);
+
+        // spread the scaled samples out to every other slot, adding zero to the other channel
+        __m128i* destLow = reinterpret_cast<__m128i*>(dest + (i * 2));
+        __m128i* destHigh = reinterpret_cast<__m128i*>(dest + (i * 2) + SAMPLES_PER_VECTOR);
+
+        _mm_storeu_si128(destLow, _mm_add_epi16(_mm_loadu_si128(destLow), _mm_unpacklo_epi16(scaled, zero)));
+        _mm_storeu_si128(destHigh, _mm_add_epi16(_mm_loadu_si128(destHigh), _mm_unpackhi_epi16(scaled, zero)));
+    }
+    mixScaledIntoInterleavedChannelScalar(dest + (i * 2), source + i, numSamples - i, gain);
+}
+
+void AudioMixKernels::scale(int16_t* dest, const int16_t* source, int numSamples, float gain) {
+    __m128 gainVector = _mm_set1_ps(gain);
+
+    int i = 0;
+    for (; i + SAMPLES_PER_VECTOR <= numSamples; i += SAMPLES_PER_VECTOR) {
+        __m128i sourceVector = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), scaleVector(sourceVector, gainVector));
+    }
+    scaleScalar(dest + i, source + i, numSamples - i, gain);
+}
+
+void AudioMixKernels::scale(float* samples, int numSamples, float gain) {
+    __m128 gainVector = _mm_set1_ps(gain);
+
+    const int FLOATS_PER_VECTOR = 4;
+
+    int i = 0;
+    for (; i + FLOATS_PER_VECTOR <= numSamples; i += FLOATS_PER_VECTOR) {
+        _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), gainVector));
+    }
+    scaleScalar(samples + i, numSamples - i, gain);
+}
+
+float AudioMixKernels::sumOfAbsolutes(const int16_t* source, int numSamples) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i sums = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + SAMPLES_PER_VECTOR <= numSamples; i += SAMPLES_PER_VECTOR) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+
+        // two's complement absolute value, read as unsigned so that |-32768| survives
+        __m128i sign = _mm_srai_epi16(samples, 15);
+        __m128i absolutes = _mm_sub_epi16(_mm_xor_si128(samples, sign), sign);
+
+        sums = _mm_add_epi32(sums, _mm_unpacklo_epi16(absolutes, zero));
+        sums = _mm_add_epi32(sums, _mm_unpackhi_epi16(absolutes, zero));
+    }
+
+    int32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sums);
+
+    // every partial sum of a network frame fits exactly in a float, so this matches the scalar sum
+    return (float)lanes[0] + (float)lanes[1] + (float)lanes[2] + (float)lanes[3]
+        + sumOfAbsolutesScalar(source + i, numSamples - i);
+}
+
+#else
+
+void AudioMixKernels::mixSaturated(int16_t* dest, const int16_t* source, int numSamples) {
+    mixSaturatedScalar(dest, source, numSamples);
+}
+
+void AudioMixKernels::mixScaledSaturated(int16_t* dest, const int16_t* source, int numSamples, float gain) {
+    mixScaledSaturatedScalar(dest, source, numSamples, gain);
+}
+
+void AudioMixKernels::mixScaledIntoInterleavedChannel(int16_t* dest, const int16_t* source,
+                                                      int numSamples, float gain) {
+    mixScaledIntoInterleavedChannelScalar(dest, source, numSamples, gain);
+}
+
+void AudioMixKernels::scale(int16_t* dest, const int16_t* source, int numSamples, float gain) {
+    scaleScalar(dest, source, numSamples, gain);
+}
+
+void AudioMixKernels::scale(float* samples, int numSamples, float gain) {
+    scaleScalar(samples, numSamples, gain);
+}
+
+float AudioMixKernels::sumOfAbsolutes(const int16_t* source, int numSamples) {
+    return sumOfAbsolutesScalar(source, numSamples);
+}
+
+#endif // HIFI_AUDIO_MIX_KERNELS_SSE2
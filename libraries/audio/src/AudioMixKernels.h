@@ -0,0 +1,54 @@
+//
+//  AudioMixKernels.h
+//  libraries/audio/src
+//
+//  Created on 4/10/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioMixKernels_h
+#define hifi_AudioMixKernels_h
+
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HIFI_AUDIO_MIX_KERNELS_SSE2
+#endif
+
+/// Sample loops used once per listener/source pair per frame by the audio mixer, and by the ring buffers and gain.
+/// Each kernel has the exact rounding and overflow behaviour of the scalar loop it replaced. On x86 builds with SSE2
+/// the kernels process 8 samples at a time, everywhere else they fall through to the scalar versions below.
+namespace AudioMixKernels {
+
+    /// dest[i] = clamp(dest[i] + source[i])
+    void mixSaturated(int16_t* dest, const int16_t* source, int numSamples);
+
+    /// dest[i] = clamp(dest[i] + (int)(source[i] * gain))
+    void mixScaledSaturated(int16_t* dest, const int16_t* source, int numSamples, float gain);
+
+    /// dest[i * 2] += (int16_t)(source[i] * gain), wrapping like the int16_t accumulation it replaces.
+    /// dest points at the first sample of the channel to mix into, in an interleaved stereo buffer.
+    void mixScaledIntoInterleavedChannel(int16_t* dest, const int16_t* source, int numSamples, float gain);
+
+    /// dest[i] = (int16_t)(source[i] * gain), dest and source may be the same buffer
+    void scale(int16_t* dest, const int16_t* source, int numSamples, float gain);
+
+    /// samples[i] *= gain
+    void scale(float* samples, int numSamples, float gain);
+
+    /// returns the sum of |source[i]|
+    float sumOfAbsolutes(const int16_t* source, int numSamples);
+
+    // the scalar versions of the kernels above, always available for reference and comparison
+    void mixSaturatedScalar(int16_t* dest, const int16_t* source, int numSamples);
+    void mixScaledSaturatedScalar(int16_t* dest, const int16_t* source, int numSamples, float gain);
+    void mixScaledIntoInterleavedChannelScalar(int16_t* dest, const int16_t* source, int numSamples, float gain);
+    void scaleScalar(int16_t* dest, const int16_t* source, int numSamples, float gain);
+    void scaleScalar(float* samples, int numSamples, float gain);
+    float sumOfAbsolutesScalar(const int16_t* source, int numSamples);
+};
+
+#endif // hifi_AudioMixKernels_h
@@ -205,14 +205,11 @@ int16_t* AudioRingBuffer::shiftedPositionAccomodatingWrap(int16_t* position, int
 }
 
 float AudioRingBuffer::getFrameLoudness(const int16_t* frameStart) const {
-    float loudness = 0.0f;
-    const int16_t* sampleAt = frameStart;
-    const int16_t* _bufferLastAt = _buffer + _bufferLength - 1;
+    // the frame may wrap around the end of the ring, sum the part before the wrap and then the part after
+    int samplesToEnd = std::min(_numFrameSamples, (int)((_buffer + _bufferLength) - frameStart));
 
-    for (int i = 0; i < _numFrameSamples; ++i) {
-        loudness += fabsf(*sampleAt);
-        sampleAt = sampleAt == _bufferLastAt ? _buffer : sampleAt + 1;
-    }
+    float loudness = AudioMixKernels::sumOfAbsolutes(frameStart, samplesToEnd)
+        + AudioMixKernels::sumOfAbsolutes(_buffer, _numFrameSamples - samplesToEnd);
     loudness /= _numFrameSamples;
     loudness /= AudioConstants::MAX_SAMPLE_VALUE;
 
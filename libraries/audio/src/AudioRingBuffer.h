@@ -12,7 +12,11 @@
 #ifndef hifi_AudioRingBuffer_h
 #define hifi_AudioRingBuffer_h
 
+#include <algorithm>
+#include <string.h>
+
 #include "AudioConstants.h"
+#include "AudioMixKernels.h"
 
 #include <QtCore/QIODevice>
 
@@ -141,21 +145,16 @@ public:
         }
 
         void readSamples(int16_t* dest, int numSamples) {
-            int16_t* at = _at;
-            for (int i = 0; i < numSamples; i++) {
-                *dest = *at;
-                ++dest;
-                at = (at == _bufferLast) ? _bufferFirst : at + 1;
-            }
+            // copy up to the end of the ring, then whatever is left from its start
+            int samplesToEnd = std::min(numSamples, (int)(_bufferLast - _at) + 1);
+            memcpy(dest, _at, samplesToEnd * sizeof(int16_t));
+            memcpy(dest + samplesToEnd, _bufferFirst, (numSamples - samplesToEnd) * sizeof(int16_t));
         }
 
         void readSamplesWithFade(int16_t* dest, int numSamples, float fade) {
-            int16_t* at = _at;
-            for (int i = 0; i < numSamples; i++) {
-                *dest = (float)*at * fade;
-                ++dest;
-                at = (at == _bufferLast) ? _bufferFirst : at + 1;
-            }
+            int samplesToEnd = std::min(numSamples, (int)(_bufferLast - _at) + 1);
+            AudioMixKernels::scale(dest, _at, samplesToEnd, fade);
+            AudioMixKernels::scale(dest + samplesToEnd, _bufferFirst, numSamples - samplesToEnd, fade);
         }
 
     private:
@@ -133,6 +133,14 @@ void AvatarData::setHandPosition(const glm::vec3& handPosition) {
 }
 
 QByteArray AvatarData::toByteArray() {
+    QByteArray avatarDataByteArray;
+    avatarDataByteArray.resize(MAX_PACKET_SIZE);
+    
+    int numBytes = packAvatarData(reinterpret_cast<unsigned char*>(avatarDataByteArray.data()));
+    return avatarDataByteArray.left(numBytes);
+}
+
+int AvatarData::packAvatarData(unsigned char* destinationBuffer) {
     // TODO: DRY this up to a shared method
     // that can pack any type given the number of bytes
     // and return the number of bytes to push the pointer
@@ -145,10 +153,6 @@ QByteArray AvatarData::toByteArray() {
         _headData->_isFaceTrackerConnected = true;
     }
     
-    QByteArray avatarDataByteArray;
-    avatarDataByteArray.resize(MAX_PACKET_SIZE);
-    
-    unsigned char* destinationBuffer = reinterpret_cast<unsigned char*>(avatarDataByteArray.data());
     unsigned char* startPosition = destinationBuffer;
     
     memcpy(destinationBuffer, &_position, sizeof(_position));
@@ -254,7 +258,7 @@ QByteArray AvatarData::toByteArray() {
         }
     }
         
-    return avatarDataByteArray.left(destinationBuffer - startPosition);
+    return destinationBuffer - startPosition;
 }
 
 bool AvatarData::shouldLogError(const quint64& now) {
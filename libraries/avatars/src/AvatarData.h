@@ -169,6 +169,10 @@ public:
 
     virtual QByteArray toByteArray();
 
+    /// packs the avatar data into destinationBuffer, which must have room for MAX_PACKET_SIZE bytes
+    /// \return the number of bytes written
+    int packAvatarData(unsigned char* destinationBuffer);
+
     /// \return true if an error should be logged
     bool shouldLogError(const quint64& now);
 
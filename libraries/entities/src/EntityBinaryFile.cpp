@@ -0,0 +1,408 @@
+//
+//  EntityBinaryFile.cpp
+//  libraries/entities/src
+//
+//  Created on 4/23/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+#include "EntityBinaryFile.h"
+#include "EntityTree.h"
+#include "EntityTreeElement.h"
+
+const char EntityBinaryFile::MAGIC[8] = { 'H', 'F', 'E', 'N', 'T', 'I', 'T', 'Y' };
+
+// the layout is the file format, any change to it needs a new VERSION
+static_assert(sizeof(EntityBinaryFile::Header) == 72, "EntityBinaryFile::Header layout changed");
+static_assert(sizeof(EntityBinaryFile::Cell) == 24, "EntityBinaryFile::Cell layout changed");
+static_assert(sizeof(EntityBinaryFile::StringEntry) == 8, "EntityBinaryFile::StringEntry layout changed");
+static_assert(sizeof(EntityBinaryFile::Record) == 312, "EntityBinaryFile::Record layout changed");
+
+static const quint64 SECTION_ALIGNMENT = 8;
+static const int UUID_BYTES = 16;
+
+static void copyVec3(float* to, const glm::vec3& from) {
+    to[0] = from.x;
+    to[1] = from.y;
+    to[2] = from.z;
+}
+
+static glm::vec3 toVec3(const float* from) {
+    return glm::vec3(from[0], from[1], from[2]);
+}
+
+static void copyColor(quint8* to, const xColor& from) {
+    to[0] = from.red;
+    to[1] = from.green;
+    to[2] = from.blue;
+}
+
+static xColor toColor(const quint8* from) {
+    xColor color = { from[0], from[1], from[2] };
+    return color;
+}
+
+static void copyUuid(quint8* to, const QUuid& from) {
+    memcpy(to, from.toRfc4122().constData(), UUID_BYTES);
+}
+
+static QUuid toUuid(const quint8* from) {
+    return QUuid::fromRfc4122(QByteArray::fromRawData(reinterpret_cast<const char*>(from), UUID_BYTES));
+}
+
+static bool writePadding(QIODevice& output, qint64 start) {
+    qint64 padding = (SECTION_ALIGNMENT - (output.pos() - start) % SECTION_ALIGNMENT) % SECTION_ALIGNMENT;
+    return padding == 0 || output.write(QByteArray(padding, 0)) == padding;
+}
+
+// writes the records element by element, and keeps the cells and strings they need for after them
+class RecurseOctreeToBinaryOperator : public RecurseOctreeOperator {
+public:
+    RecurseOctreeToBinaryOperator(QIODevice& output);
+    bool preRecursion(OctreeElement* element);
+    bool postRecursion(OctreeElement* element) { return !_failed; }
+
+    bool hasFailed() const { return _failed; }
+    int getNumRecords() const { return _numRecords; }
+    const QVector<EntityBinaryFile::Cell>& getCells() const { return _cells; }
+    const QVector<QByteArray>& getStrings() const { return _strings; }
+
+private:
+    quint32 addString(const QString& string);
+    void fillRecord(EntityBinaryFile::Record& record, const EntityItemID& entityItemID,
+                    const EntityItemProperties& properties);
+
+    QIODevice& _output;
+    bool _failed;
+    int _numRecords;
+    QVector<EntityBinaryFile::Cell> _cells;
+    QVector<QByteArray> _strings;
+    QHash<QString, quint32> _stringIndexes;
+};
+
+RecurseOctreeToBinaryOperator::RecurseOctreeToBinaryOperator(QIODevice& output) :
+    RecurseOctreeOperator(),
+    _output(output),
+    _failed(false),
+    _numRecords(0)
+{
+    _strings << QByteArray(); // index 0 is the empty string
+}
+
+bool RecurseOctreeToBinaryOperator::preRecursion(OctreeElement* element) {
+    const QList<EntityItem*>& entities = static_cast<EntityTreeElement*>(element)->getEntities();
+    if (_failed || entities.isEmpty()) {
+        return !_failed;
+    }
+
+    EntityBinaryFile::Cell cell;
+    copyVec3(cell.corner, element->getAACube().getCorner());
+    cell.scale = element->getAACube().getScale();
+    cell.firstRecord = _numRecords;
+    cell.numRecords = entities.size();
+    _cells << cell;
+
+    foreach (EntityItem* entityItem, entities) {
+        EntityBinaryFile::Record record;
+        fillRecord(record, entityItem->getEntityItemID(), entityItem->getProperties());
+        if (_output.write(reinterpret_cast<const char*>(&record), sizeof(record)) != sizeof(record)) {
+            _failed = true;
+            break;
+        }
+        _numRecords++;
+    }
+    return !_failed;
+}
+
+quint32 RecurseOctreeToBinaryOperator::addString(const QString& string) {
+    if (string.isEmpty()) {
+        return 0;
+    }
+    QHash<QString, quint32>::const_iterator found = _stringIndexes.constFind(string);
+    if (found != _stringIndexes.constEnd()) {
+        return found.value();
+    }
+    quint32 stringIndex = _strings.size();
+    _strings << string.toUtf8();
+    _stringIndexes.insert(string, stringIndex);
+    return stringIndex;
+}
+
+void RecurseOctreeToBinaryOperator::fillRecord(EntityBinaryFile::Record& record, const EntityItemID& entityItemID,
+                                               const EntityItemProperties& properties) {
+    memset(&record, 0, sizeof(record));
+
+    copyUuid(record.id, entityItemID.id);
+    copyUuid(record.simulatorID, properties.getSimulatorID());
+    copyVec3(record.position, properties.getPosition());
+    copyVec3(record.dimensions, properties.getDimensions());
+    const glm::quat& rotation = properties.getRotation();
+    record.rotation[0] = rotation.x;
+    record.rotation[1] = rotation.y;
+    record.rotation[2] = rotation.z;
+    record.rotation[3] = rotation.w;
+    copyVec3(record.velocity, properties.getVelocity());
+    copyVec3(record.gravity, properties.getGravity());
+    copyVec3(record.acceleration, properties.getAcceleration());
+    copyVec3(record.registrationPoint, properties.getRegistrationPoint());
+    copyVec3(record.angularVelocity, properties.getAngularVelocity());
+    copyVec3(record.emitDirection, properties.getEmitDirection());
+    copyVec3(record.keyLightDirection, properties.getKeyLightDirection());
+
+    record.damping = properties.getDamping();
+    record.density = properties.getDensity();
+    record.lifetime = properties.getLifetime();
+    record.angularDamping = properties.getAngularDamping();
+    record.animationFPS = properties.getAnimationFPS();
+    record.animationFrameIndex = properties.getAnimationFrameIndex();
+    record.glowLevel = properties.getGlowLevel();
+    record.localRenderAlpha = properties.getLocalRenderAlpha();
+    record.intensity = properties.getIntensity();
+    record.exponent = properties.getExponent();
+    record.cutoff = properties.getCutoff();
+    record.lineHeight = properties.getLineHeight();
+    record.lifespan = properties.getLifespan();
+    record.emitRate = properties.getEmitRate();
+    record.emitStrength = properties.getEmitStrength();
+    record.localGravity = properties.getLocalGravity();
+    record.particleRadius = properties.getParticleRadius();
+    record.keyLightIntensity = properties.getKeyLightIntensity();
+    record.keyLightAmbientIntensity = properties.getKeyLightAmbientIntensity();
+    record.stageLatitude = properties.getStageLatitude();
+    record.stageLongitude = properties.getStageLongitude();
+    record.stageAltitude = properties.getStageAltitude();
+    record.stageHour = properties.getStageHour();
+    record.maxParticles = properties.getMaxParticles();
+
+    record.script = addString(properties.getScript());
+    record.modelURL = addString(properties.getModelURL());
+    record.compoundShapeURL = addString(properties.getCompoundShapeURL());
+    record.animationURL = addString(properties.getAnimationURL());
+    record.animationSettings = addString(properties.getAnimationSettings());
+    record.textures = addString(properties.getTextures());
+    record.userData = addString(properties.getUserData());
+    record.text = addString(properties.getText());
+    record.marketplaceID = addString(properties.getMarketplaceID());
+    record.name = addString(properties.getName());
+
+    record.stageDay = properties.getStageDay();
+    record.type = (quint8)properties.getType();
+    record.shapeType = (quint8)properties.getShapeType();
+    copyColor(record.color, properties.getColor());
+    copyColor(record.textColor, properties.getTextColor());
+    copyColor(record.backgroundColor, properties.getBackgroundColor());
+    copyColor(record.keyLightColor, properties.getKeyLightColor());
+
+    record.flags = (properties.getVisible() ? EntityBinaryFile::VISIBLE : 0)
+        | (properties.getAnimationIsPlaying() ? EntityBinaryFile::ANIMATION_IS_PLAYING : 0)
+        | (properties.getIgnoreForCollisions() ? EntityBinaryFile::IGNORE_FOR_COLLISIONS : 0)
+        | (properties.getCollisionsWillMove() ? EntityBinaryFile::COLLISIONS_WILL_MOVE : 0)
+        | (properties.getIsSpotlight() ? EntityBinaryFile::IS_SPOTLIGHT : 0)
+        | (properties.getLocked() ? EntityBinaryFile::LOCKED : 0)
+        | (properties.getStageSunModelEnabled() ? EntityBinaryFile::STAGE_SUN_MODEL_ENABLED : 0);
+}
+
+bool EntityBinaryFile::write(EntityTree* tree, OctreeElement* element, QIODevice& output) {
+    qint64 start = output.pos();
+    Header header;
+    memset(&header, 0, sizeof(header));
+    if (output.write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+
+    header.recordsOffset = sizeof(header);
+    RecurseOctreeToBinaryOperator theOperator(output);
+    tree->recurseElementWithOperator(element ? element : tree->getRoot(), &theOperator);
+    if (theOperator.hasFailed() || !writePadding(output, start)) {
+        return false;
+    }
+
+    const QVector<Cell>& cells = theOperator.getCells();
+    header.cellsOffset = output.pos() - start;
+    qint64 cellsSize = cells.size() * sizeof(Cell);
+    if (output.write(reinterpret_cast<const char*>(cells.constData()), cellsSize) != cellsSize
+            || !writePadding(output, start)) {
+        return false;
+    }
+
+    const QVector<QByteArray>& strings = theOperator.getStrings();
+    header.stringsOffset = output.pos() - start;
+    QVector<StringEntry> stringEntries(strings.size());
+    quint32 stringOffset = 0;
+    for (int i = 0; i < strings.size(); i++) {
+        stringEntries[i].offset = stringOffset;
+        stringEntries[i].length = strings[i].size();
+        stringOffset += strings[i].size();
+    }
+    qint64 stringEntriesSize = stringEntries.size() * sizeof(StringEntry);
+    if (output.write(reinterpret_cast<const char*>(stringEntries.constData()), stringEntriesSize) != stringEntriesSize) {
+        return false;
+    }
+    foreach (const QByteArray& string, strings) {
+        if (output.write(string) != string.size()) {
+            return false;
+        }
+    }
+
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.headerSize = sizeof(Header);
+    header.recordSize = sizeof(Record);
+    header.numRecords = theOperator.getNumRecords();
+    header.numCells = cells.size();
+    header.numStrings = strings.size();
+    header.fileSize = output.pos() - start;
+
+    qint64 end = output.pos();
+    return output.seek(start)
+        && output.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header)
+        && output.seek(end);
+}
+
+EntityBinaryFile::EntityBinaryFile(const uchar* data, qint64 size) :
+    _data(data),
+    _size(size),
+    _isValid(false),
+    _header(NULL),
+    _cells(NULL),
+    _strings(NULL),
+    _stringBytes(NULL),
+    _stringBytesSize(0)
+{
+    if (!data || size < (qint64)sizeof(Header)) {
+        return;
+    }
+    _header = reinterpret_cast<const Header*>(data);
+    if (memcmp(_header->magic, MAGIC, sizeof(MAGIC)) != 0 || _header->version != VERSION
+            || _header->byteOrder != BYTE_ORDER_MARK || _header->headerSize < sizeof(Header)
+            || _header->recordSize != sizeof(Record) || _header->fileSize > (quint64)size) {
+        return;
+    }
+
+    // every section has to be aligned for its records to be read in place, and has to end inside the file
+    quint64 recordsEnd = _header->recordsOffset + (quint64)_header->numRecords * _header->recordSize;
+    quint64 cellsEnd = _header->cellsOffset + (quint64)_header->numCells * sizeof(Cell);
+    quint64 stringEntriesEnd = _header->stringsOffset + (quint64)_header->numStrings * sizeof(StringEntry);
+    if (_header->recordsOffset % SECTION_ALIGNMENT != 0 || _header->cellsOffset % SECTION_ALIGNMENT != 0
+            || _header->stringsOffset % SECTION_ALIGNMENT != 0 || _header->recordsOffset < _header->headerSize
+            || recordsEnd > _header->fileSize || cellsEnd > _header->fileSize
+            || stringEntriesEnd > _header->fileSize || _header->numStrings == 0) {
+        return;
+    }
+
+    _cells = reinterpret_cast<const Cell*>(data + _header->cellsOffset);
+    _strings = reinterpret_cast<const StringEntry*>(data + _header->stringsOffset);
+    _stringBytes = reinterpret_cast<const char*>(data + stringEntriesEnd);
+    _stringBytesSize = _header->fileSize - stringEntriesEnd;
+
+    for (quint32 i = 0; i < _header->numCells; i++) {
+        if ((quint64)_cells[i].firstRecord + _cells[i].numRecords > _header->numRecords) {
+            return;
+        }
+    }
+    _isValid = true;
+}
+
+AACube EntityBinaryFile::getCellCube(int cellIndex) const {
+    const Cell& cell = getCell(cellIndex);
+    return AACube(toVec3(cell.corner), cell.scale);
+}
+
+const EntityBinaryFile::Record& EntityBinaryFile::getRecord(int recordIndex) const {
+    return *reinterpret_cast<const Record*>(_data + _header->recordsOffset + (quint64)recordIndex * _header->recordSize);
+}
+
+QString EntityBinaryFile::getString(quint32 stringIndex) const {
+    if (stringIndex == 0 || stringIndex >= _header->numStrings) {
+        return QString();
+    }
+    const StringEntry& entry = _strings[stringIndex];
+    if ((qint64)entry.offset + entry.length > _stringBytesSize) {
+        return QString();
+    }
+    return QString::fromUtf8(_stringBytes + entry.offset, entry.length);
+}
+
+EntityItemID EntityBinaryFile::getEntityItemID(int recordIndex) const {
+    return EntityItemID(toUuid(getRecord(recordIndex).id));
+}
+
+EntityItemProperties EntityBinaryFile::getProperties(int recordIndex) const {
+    const Record& record = getRecord(recordIndex);
+    EntityItemProperties properties;
+
+    properties.setType((EntityTypes::EntityType)record.type);
+    properties.setSimulatorID(toUuid(record.simulatorID));
+    properties.setPosition(toVec3(record.position));
+    properties.setDimensions(toVec3(record.dimensions));
+    properties.setRotation(glm::quat(record.rotation[3], record.rotation[0], record.rotation[1], record.rotation[2]));
+    properties.setVelocity(toVec3(record.velocity));
+    properties.setGravity(toVec3(record.gravity));
+    properties.setAcceleration(toVec3(record.acceleration));
+    properties.setRegistrationPoint(toVec3(record.registrationPoint));
+    properties.setAngularVelocity(toVec3(record.angularVelocity));
+    properties.setEmitDirection(toVec3(record.emitDirection));
+    properties.setKeyLightDirection(toVec3(record.keyLightDirection));
+
+    properties.setDamping(record.damping);
+    properties.setDensity(record.density);
+    properties.setLifetime(record.lifetime);
+    properties.setAngularDamping(record.angularDamping);
+    properties.setAnimationFPS(record.animationFPS);
+    properties.setAnimationFrameIndex(record.animationFrameIndex);
+    properties.setGlowLevel(record.glowLevel);
+    properties.setLocalRenderAlpha(record.localRenderAlpha);
+    properties.setIntensity(record.intensity);
+    properties.setExponent(record.exponent);
+    properties.setCutoff(record.cutoff);
+    properties.setLineHeight(record.lineHeight);
+    properties.setLifespan(record.lifespan);
+    properties.setEmitRate(record.emitRate);
+    properties.setEmitStrength(record.emitStrength);
+    properties.setLocalGravity(record.localGravity);
+    properties.setParticleRadius(record.particleRadius);
+    properties.setKeyLightIntensity(record.keyLightIntensity);
+    properties.setKeyLightAmbientIntensity(record.keyLightAmbientIntensity);
+    properties.setStageLatitude(record.stageLatitude);
+    properties.setStageLongitude(record.stageLongitude);
+    properties.setStageAltitude(record.stageAltitude);
+    properties.setStageHour(record.stageHour);
+    properties.setMaxParticles(record.maxParticles);
+
+    properties.setScript(getString(record.script));
+    properties.setModelURL(getString(record.modelURL));
+    properties.setCompoundShapeURL(getString(record.compoundShapeURL));
+    properties.setAnimationURL(getString(record.animationURL));
+    properties.setAnimationSettings(getString(record.animationSettings));
+    properties.setTextures(getString(record.textures));
+    properties.setUserData(getString(record.userData));
+    properties.setText(getString(record.text));
+    properties.setMarketplaceID(getString(record.marketplaceID));
+    properties.setName(getString(record.name));
+
+    properties.setStageDay(record.stageDay);
+    properties.setShapeType((ShapeType)record.shapeType);
+    properties.setColor(toColor(record.color));
+    properties.setTextColor(toColor(record.textColor));
+    properties.setBackgroundColor(toColor(record.backgroundColor));
+    properties.setKeyLightColor(toColor(record.keyLightColor));
+
+    properties.setVisible(record.flags & VISIBLE);
+    properties.setAnimationIsPlaying(record.flags & ANIMATION_IS_PLAYING);
+    properties.setIgnoreForCollisions(record.flags & IGNORE_FOR_COLLISIONS);
+    properties.setCollisionsWillMove(record.flags & COLLISIONS_WILL_MOVE);
+    properties.setIsSpotlight(record.flags & IS_SPOTLIGHT);
+    properties.setLocked(record.flags & LOCKED);
+    properties.setStageSunModelEnabled(record.flags & STAGE_SUN_MODEL_ENABLED);
+
+    return properties;
+}
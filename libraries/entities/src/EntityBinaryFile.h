@@ -0,0 +1,174 @@
+//
+//  EntityBinaryFile.h
+//  libraries/entities/src
+//
+//  Created on 4/23/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_EntityBinaryFile_h
+#define hifi_EntityBinaryFile_h
+
+#include <QtCore/QIODevice>
+
+#include <AACube.h>
+
+#include "EntityItemID.h"
+#include "EntityItemProperties.h"
+
+class EntityTree;
+class OctreeElement;
+
+/// The binary persist format of an entity tree, laid out to be read in place from a memory mapped file:
+///
+///     Header | Record * numRecords | Cell * numCells | StringEntry * numStrings | string bytes
+///
+/// Records have a fixed layout and are grouped by the tree element, the cell, they were in. The cells are the index to
+/// them, so a reader can put each group of entities straight into its element. Strings are stored once each in a table
+/// that records refer to by index, index 0 being the empty string. Sections start on 8 byte boundaries and everything is
+/// in the byte order of the machine that wrote the file, which the header records.
+///
+/// An EntityBinaryFile is a read only view of such a file, and doesn't copy anything out of it. It can be used to look
+/// through a file without loading it into a tree.
+class EntityBinaryFile {
+public:
+    static const char MAGIC[8];
+    static const quint32 VERSION = 1;
+    static const quint32 BYTE_ORDER_MARK = 0x01020304;
+
+    struct Header {
+        char magic[8];
+        quint32 version;
+        quint32 byteOrder;
+        quint32 headerSize;
+        quint32 recordSize;
+        quint32 numRecords;
+        quint32 numCells;
+        quint32 numStrings;
+        quint32 reserved;
+        quint64 recordsOffset;
+        quint64 cellsOffset;
+        quint64 stringsOffset;
+        quint64 fileSize;
+    };
+
+    struct Cell {
+        float corner[3];
+        float scale;
+        quint32 firstRecord;
+        quint32 numRecords;
+    };
+
+    struct StringEntry {
+        quint32 offset; // from the end of the string entries
+        quint32 length; // in bytes of UTF-8
+    };
+
+    enum RecordFlags {
+        VISIBLE = 1 << 0,
+        ANIMATION_IS_PLAYING = 1 << 1,
+        IGNORE_FOR_COLLISIONS = 1 << 2,
+        COLLISIONS_WILL_MOVE = 1 << 3,
+        IS_SPOTLIGHT = 1 << 4,
+        LOCKED = 1 << 5,
+        STAGE_SUN_MODEL_ENABLED = 1 << 6
+    };
+
+    struct Record {
+        quint8 id[16];
+        quint8 simulatorID[16];
+        float position[3];
+        float dimensions[3];
+        float rotation[4];
+        float velocity[3];
+        float gravity[3];
+        float acceleration[3];
+        float registrationPoint[3];
+        float angularVelocity[3];
+        float emitDirection[3];
+        float keyLightDirection[3];
+        float damping;
+        float density;
+        float lifetime;
+        float angularDamping;
+        float animationFPS;
+        float animationFrameIndex;
+        float glowLevel;
+        float localRenderAlpha;
+        float intensity;
+        float exponent;
+        float cutoff;
+        float lineHeight;
+        float lifespan;
+        float emitRate;
+        float emitStrength;
+        float localGravity;
+        float particleRadius;
+        float keyLightIntensity;
+        float keyLightAmbientIntensity;
+        float stageLatitude;
+        float stageLongitude;
+        float stageAltitude;
+        float stageHour;
+        quint32 maxParticles;
+
+        // indexes into the string table
+        quint32 script;
+        quint32 modelURL;
+        quint32 compoundShapeURL;
+        quint32 animationURL;
+        quint32 animationSettings;
+        quint32 textures;
+        quint32 userData;
+        quint32 text;
+        quint32 marketplaceID;
+        quint32 name;
+
+        quint16 stageDay;
+        quint8 type;
+        quint8 shapeType;
+        quint8 color[3];
+        quint8 textColor[3];
+        quint8 backgroundColor[3];
+        quint8 keyLightColor[3];
+        quint16 flags;
+        quint8 padding[2];
+    };
+
+    /// Writes the entities of the tree, or of everything under element if it isn't NULL. The device must be able to seek,
+    /// the header is written last.
+    static bool write(EntityTree* tree, OctreeElement* element, QIODevice& output);
+
+    /// a view of a file's contents, which must stay mapped while the view is used
+    EntityBinaryFile(const uchar* data, qint64 size);
+
+    /// whether the header is one this version reads and every section lies inside the file
+    bool isValid() const { return _isValid; }
+
+    const Header& getHeader() const { return *_header; }
+    int getNumCells() const { return _isValid ? _header->numCells : 0; }
+    const Cell& getCell(int cellIndex) const { return _cells[cellIndex]; }
+    AACube getCellCube(int cellIndex) const;
+    int getNumRecords() const { return _isValid ? _header->numRecords : 0; }
+    const Record& getRecord(int recordIndex) const;
+    QString getString(quint32 stringIndex) const;
+
+    EntityItemID getEntityItemID(int recordIndex) const;
+    EntityItemProperties getProperties(int recordIndex) const;
+
+private:
+    const uchar* _data;
+    qint64 _size;
+    bool _isValid;
+
+    const Header* _header;
+    const Cell* _cells;
+    const StringEntry* _strings;
+    const char* _stringBytes;
+    qint64 _stringBytesSize;
+};
+
+#endif // hifi_EntityBinaryFile_h
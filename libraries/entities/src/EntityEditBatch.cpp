@@ -0,0 +1,142 @@
+//
+//  EntityEditBatch.cpp
+//  libraries/entities/src
+//
+//  Created on 4/21/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QHash>
+
+#include "EntityTree.h"
+#include "EntityEditBatch.h"
+
+EntityEditBatch::EntityEditBatch(EntityTree* tree) :
+    _tree(tree),
+    _packets()
+{
+}
+
+void EntityEditBatch::addPacket(const SharedNodePointer& sendingNode, const QByteArray& packet, int editOffset) {
+    QueuedPacket queuedPacket;
+    queuedPacket.sendingNode = sendingNode;
+    queuedPacket.packet = packet;
+    queuedPacket.editOffset = editOffset;
+    queuedPacket.packetType = packetTypeForPacket(packet);
+    queuedPacket.numEdits = 0;
+    _packets.append(queuedPacket);
+}
+
+void EntityEditBatch::decodePacket(int packetIndex) {
+    QueuedPacket& queuedPacket = _packets[packetIndex];
+
+    if (queuedPacket.packetType != PacketTypeEntityAddOrEdit) {
+        // erases need the tree to find their entities, they're applied from the packet itself
+        queuedPacket.numEdits = 1;
+        return;
+    }
+
+    const unsigned char* packetData = reinterpret_cast<const unsigned char*>(queuedPacket.packet.constData());
+    int packetLength = queuedPacket.packet.size();
+    int atByte = queuedPacket.editOffset;
+    while (atByte < packetLength) {
+        DecodedEdit edit;
+        int processedBytes = 0;
+        bool validEditPacket = EntityItemProperties::decodeEntityEditPacket(packetData + atByte, packetLength - atByte,
+                                                                            processedBytes, edit.entityItemID,
+                                                                            edit.properties);
+        if (processedBytes <= 0) {
+            // nothing more can be read from this packet
+            break;
+        }
+        atByte += processedBytes;
+        queuedPacket.numEdits++;
+
+        if (validEditPacket) {
+            edit.changedProperties = edit.properties.getChangedProperties();
+            edit.isDropped = false;
+            queuedPacket.edits.append(edit);
+        }
+    }
+}
+
+// true if every property the earlier edit sets is also set by the later one
+static bool isOverwrittenBy(const EntityPropertyFlags& earlier, const EntityPropertyFlags& later) {
+    for (int flag = (int)earlier.firstFlag(); flag <= (int)earlier.lastFlag(); flag++) {
+        if (earlier.getHasProperty((EntityPropertyList)flag) && !later.getHasProperty((EntityPropertyList)flag)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int EntityEditBatch::apply() {
+    // first pass, in arrival order: drop each edit the next edit of the same entity from the same sender overwrites
+    struct PendingEdit {
+        DecodedEdit* edit;
+        Node* sendingNode;
+    };
+    QHash<EntityItemID, PendingEdit> pendingEdits;
+    int numDropped = 0;
+
+    for (int i = 0; i < _packets.size(); i++) {
+        QueuedPacket& queuedPacket = _packets[i];
+        if (queuedPacket.packetType != PacketTypeEntityAddOrEdit) {
+            // an erase may remove an entity an edit touches, so edits on either side of it are kept apart
+            pendingEdits.clear();
+            continue;
+        }
+        for (int j = 0; j < queuedPacket.edits.size(); j++) {
+            DecodedEdit& edit = queuedPacket.edits[j];
+
+            // adds are never dropped, each one makes a new entity
+            if (!edit.entityItemID.isKnownID) {
+                continue;
+            }
+
+            PendingEdit& pending = pendingEdits[edit.entityItemID];
+            if (pending.edit && pending.sendingNode == queuedPacket.sendingNode.data()
+                    && isOverwrittenBy(pending.edit->changedProperties, edit.changedProperties)) {
+                pending.edit->isDropped = true;
+                numDropped++;
+            }
+            pending.edit = &edit;
+            pending.sendingNode = queuedPacket.sendingNode.data();
+        }
+    }
+
+    // second pass, in arrival order again: apply what's left
+    for (int i = 0; i < _packets.size(); i++) {
+        const QueuedPacket& queuedPacket = _packets[i];
+        if (queuedPacket.packetType != PacketTypeEntityAddOrEdit) {
+            applyUndecodedPacket(queuedPacket);
+            continue;
+        }
+        foreach (const DecodedEdit& edit, queuedPacket.edits) {
+            if (!edit.isDropped) {
+                _tree->processDecodedEdit(edit.entityItemID, edit.properties, queuedPacket.sendingNode);
+            }
+        }
+    }
+
+    _packets.clear();
+    return numDropped;
+}
+
+void EntityEditBatch::applyUndecodedPacket(const QueuedPacket& queuedPacket) {
+    const unsigned char* packetData = reinterpret_cast<const unsigned char*>(queuedPacket.packet.constData());
+    int packetLength = queuedPacket.packet.size();
+    int atByte = queuedPacket.editOffset;
+    while (atByte < packetLength) {
+        int processedBytes = _tree->processEditPacketData(queuedPacket.packetType, packetData, packetLength,
+                                                          packetData + atByte, packetLength - atByte,
+                                                          queuedPacket.sendingNode);
+        if (processedBytes <= 0) {
+            break;
+        }
+        atByte += processedBytes;
+    }
+}
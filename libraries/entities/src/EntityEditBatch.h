@@ -0,0 +1,61 @@
+//
+//  EntityEditBatch.h
+//  libraries/entities/src
+//
+//  Created on 4/21/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_EntityEditBatch_h
+#define hifi_EntityEditBatch_h
+
+#include <QtCore/QVector>
+
+#include <OctreeEditBatch.h>
+#include <PacketHeaders.h>
+
+#include "EntityItemID.h"
+#include "EntityItemProperties.h"
+
+class EntityTree;
+
+/// Queues entity add/edit and erase packets for an EntityTree. An edit is dropped when a later edit in the batch, from
+/// the same sender, sets every property the earlier one did. Erases are applied straight from their packets, in the
+/// order they arrived, and no edit is dropped across one.
+class EntityEditBatch : public OctreeEditBatch {
+public:
+    EntityEditBatch(EntityTree* tree);
+
+    virtual void addPacket(const SharedNodePointer& sendingNode, const QByteArray& packet, int editOffset);
+    virtual int getNumPackets() const { return _packets.size(); }
+    virtual void decodePacket(int packetIndex);
+    virtual int getNumEditsInPacket(int packetIndex) const { return _packets[packetIndex].numEdits; }
+    virtual int apply();
+
+private:
+    struct DecodedEdit {
+        EntityItemID entityItemID;
+        EntityItemProperties properties;
+        EntityPropertyFlags changedProperties;
+        bool isDropped;
+    };
+
+    struct QueuedPacket {
+        SharedNodePointer sendingNode;
+        QByteArray packet;
+        int editOffset;
+        PacketType packetType;
+        int numEdits;
+        QVector<DecodedEdit> edits;
+    };
+
+    void applyUndecodedPacket(const QueuedPacket& queuedPacket);
+
+    EntityTree* _tree;
+    QVector<QueuedPacket> _packets;
+};
+
+#endif // hifi_EntityEditBatch_h
@@ -412,6 +412,81 @@ QScriptValue EntityItemProperties::copyToScriptValue(QScriptEngine* engine, bool
     return properties;
 }
 
+QJsonObject EntityItemProperties::copyToJsonObject(bool skipDefaults) const {
+    QJsonObject properties;
+    EntityItemProperties defaultEntityProperties;
+
+    if (_idSet) {
+        COPY_PROPERTY_TO_QJSONOBJECT_GETTER(id, _id.toString());
+        COPY_PROPERTY_TO_QJSONOBJECT_GETTER_NO_SKIP(isKnownID, (_id != UNKNOWN_ENTITY_ID));
+    } else {
+        COPY_PROPERTY_TO_QJSONOBJECT_GETTER_NO_SKIP(isKnownID, false);
+    }
+
+    COPY_PROPERTY_TO_QJSONOBJECT_GETTER(type, EntityTypes::getEntityTypeName(_type));
+    COPY_PROPERTY_TO_QJSONOBJECT_VEC3(position);
+    COPY_PROPERTY_TO_QJSONOBJECT_VEC3(dimensions);
+    COPY_PROPERTY_TO_QJSONOBJECT_QUAT(rotation);
+    COPY_PROPERTY_TO_QJSONOBJECT_VEC3(velocity);
+    COPY_PROPERTY_TO_QJSONOBJECT_VEC3(gravity);
+    COPY_PROPERTY_TO_QJSONOBJECT_VEC3(acceleration);
+    COPY_PROPERTY_TO_QJSONOBJECT(damping);
+    COPY_PROPERTY_TO_QJSONOBJECT(density);
+    COPY_PROPERTY_TO_QJSONOBJECT(lifetime);
+    COPY_PROPERTY_TO_QJSONOBJECT(script);
+    COPY_PROPERTY_TO_QJSONOBJECT_VEC3(registrationPoint);
+    COPY_PROPERTY_TO_QJSONOBJECT_VEC3(angularVelocity);
+    COPY_PROPERTY_TO_QJSONOBJECT(angularDamping);
+    COPY_PROPERTY_TO_QJSONOBJECT(visible);
+    COPY_PROPERTY_TO_QJSONOBJECT_COLOR(color);
+    COPY_PROPERTY_TO_QJSONOBJECT(modelURL);
+    COPY_PROPERTY_TO_QJSONOBJECT(compoundShapeURL);
+    COPY_PROPERTY_TO_QJSONOBJECT(animationURL);
+    COPY_PROPERTY_TO_QJSONOBJECT(animationIsPlaying);
+    COPY_PROPERTY_TO_QJSONOBJECT(animationFPS);
+    COPY_PROPERTY_TO_QJSONOBJECT(animationFrameIndex);
+    COPY_PROPERTY_TO_QJSONOBJECT_GETTER(animationSettings, getAnimationSettings());
+    COPY_PROPERTY_TO_QJSONOBJECT(glowLevel);
+    COPY_PROPERTY_TO_QJSONOBJECT(localRenderAlpha);
+    COPY_PROPERTY_TO_QJSONOBJECT(ignoreForCollisions);
+    COPY_PROPERTY_TO_QJSONOBJECT(collisionsWillMove);
+    COPY_PROPERTY_TO_QJSONOBJECT(isSpotlight);
+    COPY_PROPERTY_TO_QJSONOBJECT(intensity);
+    COPY_PROPERTY_TO_QJSONOBJECT(exponent);
+    COPY_PROPERTY_TO_QJSONOBJECT(cutoff);
+    COPY_PROPERTY_TO_QJSONOBJECT(locked);
+    COPY_PROPERTY_TO_QJSONOBJECT(textures);
+    COPY_PROPERTY_TO_QJSONOBJECT(userData);
+    COPY_PROPERTY_TO_QJSONOBJECT_GETTER(simulatorID, getSimulatorIDAsString());
+    COPY_PROPERTY_TO_QJSONOBJECT(text);
+    COPY_PROPERTY_TO_QJSONOBJECT(lineHeight);
+    COPY_PROPERTY_TO_QJSONOBJECT_COLOR_GETTER(textColor, getTextColor());
+    COPY_PROPERTY_TO_QJSONOBJECT_COLOR_GETTER(backgroundColor, getBackgroundColor());
+    COPY_PROPERTY_TO_QJSONOBJECT_GETTER(shapeType, getShapeTypeAsString());
+    COPY_PROPERTY_TO_QJSONOBJECT_GETTER(maxParticles, (double)_maxParticles);
+    COPY_PROPERTY_TO_QJSONOBJECT(lifespan);
+    COPY_PROPERTY_TO_QJSONOBJECT(emitRate);
+    COPY_PROPERTY_TO_QJSONOBJECT_VEC3(emitDirection);
+    COPY_PROPERTY_TO_QJSONOBJECT(emitStrength);
+    COPY_PROPERTY_TO_QJSONOBJECT(localGravity);
+    COPY_PROPERTY_TO_QJSONOBJECT(particleRadius);
+    COPY_PROPERTY_TO_QJSONOBJECT(marketplaceID);
+    COPY_PROPERTY_TO_QJSONOBJECT(name);
+
+    COPY_PROPERTY_TO_QJSONOBJECT_COLOR(keyLightColor);
+    COPY_PROPERTY_TO_QJSONOBJECT(keyLightIntensity);
+    COPY_PROPERTY_TO_QJSONOBJECT(keyLightAmbientIntensity);
+    COPY_PROPERTY_TO_QJSONOBJECT_VEC3(keyLightDirection);
+    COPY_PROPERTY_TO_QJSONOBJECT(stageSunModelEnabled);
+    COPY_PROPERTY_TO_QJSONOBJECT(stageLatitude);
+    COPY_PROPERTY_TO_QJSONOBJECT(stageLongitude);
+    COPY_PROPERTY_TO_QJSONOBJECT(stageAltitude);
+    COPY_PROPERTY_TO_QJSONOBJECT(stageDay);
+    COPY_PROPERTY_TO_QJSONOBJECT(stageHour);
+
+    return properties;
+}
+
 void EntityItemProperties::copyFromScriptValue(const QScriptValue& object) {
     QScriptValue typeScriptValue = object.property("type");
     if (typeScriptValue.isValid()) {
@@ -481,6 +556,75 @@ void EntityItemProperties::copyFromScriptValue(const QScriptValue& object) {
     _lastEdited = usecTimestampNow();
 }
 
+void EntityItemProperties::copyFromJsonObject(const QJsonObject& object) {
+    QJsonValue typeValue = object.value("type");
+    if (!typeValue.isUndefined()) {
+        setType(typeValue.toVariant().toString());
+    }
+
+    COPY_PROPERTY_FROM_QJSONOBJECT_VEC3(position, setPosition);
+    COPY_PROPERTY_FROM_QJSONOBJECT_VEC3(dimensions, setDimensions);
+    COPY_PROPERTY_FROM_QJSONOBJECT_QUAT(rotation, setRotation);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(density, setDensity);
+    COPY_PROPERTY_FROM_QJSONOBJECT_VEC3(velocity, setVelocity);
+    COPY_PROPERTY_FROM_QJSONOBJECT_VEC3(gravity, setGravity);
+    COPY_PROPERTY_FROM_QJSONOBJECT_VEC3(acceleration, setAcceleration);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(damping, setDamping);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(lifetime, setLifetime);
+    COPY_PROPERTY_FROM_QJSONOBJECT_STRING(script, setScript);
+    COPY_PROPERTY_FROM_QJSONOBJECT_VEC3(registrationPoint, setRegistrationPoint);
+    COPY_PROPERTY_FROM_QJSONOBJECT_VEC3(angularVelocity, setAngularVelocity);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(angularDamping, setAngularDamping);
+    COPY_PROPERTY_FROM_QJSONOBJECT_BOOL(visible, setVisible);
+    COPY_PROPERTY_FROM_QJSONOBJECT_COLOR(color, setColor);
+    COPY_PROPERTY_FROM_QJSONOBJECT_STRING(modelURL, setModelURL);
+    COPY_PROPERTY_FROM_QJSONOBJECT_STRING(compoundShapeURL, setCompoundShapeURL);
+    COPY_PROPERTY_FROM_QJSONOBJECT_STRING(animationURL, setAnimationURL);
+    COPY_PROPERTY_FROM_QJSONOBJECT_BOOL(animationIsPlaying, setAnimationIsPlaying);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(animationFPS, setAnimationFPS);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(animationFrameIndex, setAnimationFrameIndex);
+    COPY_PROPERTY_FROM_QJSONOBJECT_STRING(animationSettings, setAnimationSettings);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(glowLevel, setGlowLevel);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(localRenderAlpha, setLocalRenderAlpha);
+    COPY_PROPERTY_FROM_QJSONOBJECT_BOOL(ignoreForCollisions, setIgnoreForCollisions);
+    COPY_PROPERTY_FROM_QJSONOBJECT_BOOL(collisionsWillMove, setCollisionsWillMove);
+    COPY_PROPERTY_FROM_QJSONOBJECT_BOOL(isSpotlight, setIsSpotlight);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(intensity, setIntensity);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(exponent, setExponent);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(cutoff, setCutoff);
+    COPY_PROPERTY_FROM_QJSONOBJECT_BOOL(locked, setLocked);
+    COPY_PROPERTY_FROM_QJSONOBJECT_STRING(textures, setTextures);
+    COPY_PROPERTY_FROM_QJSONOBJECT_STRING(userData, setUserData);
+    COPY_PROPERTY_FROM_QJSONOBJECT_UUID(simulatorID, setSimulatorID);
+    COPY_PROPERTY_FROM_QJSONOBJECT_STRING(text, setText);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(lineHeight, setLineHeight);
+    COPY_PROPERTY_FROM_QJSONOBJECT_COLOR(textColor, setTextColor);
+    COPY_PROPERTY_FROM_QJSONOBJECT_COLOR(backgroundColor, setBackgroundColor);
+    COPY_PROPERTY_FROM_QJSONOBJECT_ENUM(shapeType, ShapeType);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(maxParticles, setMaxParticles);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(lifespan, setLifespan);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(emitRate, setEmitRate);
+    COPY_PROPERTY_FROM_QJSONOBJECT_VEC3(emitDirection, setEmitDirection);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(emitStrength, setEmitStrength);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(localGravity, setLocalGravity);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(particleRadius, setParticleRadius);
+    COPY_PROPERTY_FROM_QJSONOBJECT_STRING(marketplaceID, setMarketplaceID);
+    COPY_PROPERTY_FROM_QJSONOBJECT_STRING(name, setName);
+
+    COPY_PROPERTY_FROM_QJSONOBJECT_COLOR(keyLightColor, setKeyLightColor);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(keyLightIntensity, setKeyLightIntensity);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(keyLightAmbientIntensity, setKeyLightAmbientIntensity);
+    COPY_PROPERTY_FROM_QJSONOBJECT_VEC3(keyLightDirection, setKeyLightDirection);
+    COPY_PROPERTY_FROM_QJSONOBJECT_BOOL(stageSunModelEnabled, setStageSunModelEnabled);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(stageLatitude, setStageLatitude);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(stageLongitude, setStageLongitude);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(stageAltitude, setStageAltitude);
+    COPY_PROPERTY_FROM_QJSONOBJECT_INT(stageDay, setStageDay);
+    COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(stageHour, setStageHour);
+
+    _lastEdited = usecTimestampNow();
+}
+
 QScriptValue EntityItemPropertiesToScriptValue(QScriptEngine* engine, const EntityItemProperties& properties) {
     return properties.copyToScriptValue(engine, false);
 }
@@ -18,6 +18,7 @@
 #include <glm/gtx/extented_min_max.hpp>
 
 #include <QtScript/QScriptEngine>
+#include <QtCore/QJsonObject>
 #include <QtCore/QObject>
 #include <QVector>
 #include <QString>
@@ -163,6 +164,14 @@ public:
     virtual QScriptValue copyToScriptValue(QScriptEngine* engine, bool skipDefaults) const;
     virtual void copyFromScriptValue(const QScriptValue& object);
 
+    /// Writes the properties the way copyToScriptValue() does, for the JSON persist format, without a script engine. The
+    /// values that can be read but not set are left out, as the persist file never has them.
+    QJsonObject copyToJsonObject(bool skipDefaults) const;
+
+    /// reads the properties of an entity in the JSON persist format, the same as copyFromScriptValue() would after
+    /// converting the JSON to a script value, but without a script engine
+    void copyFromJsonObject(const QJsonObject& object);
+
     // editing related features supported by all entities
     quint64 getLastEdited() const { return _lastEdited; }
     float getEditedAgo() const /// Elapsed seconds since this entity was last edited
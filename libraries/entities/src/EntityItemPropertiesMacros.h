@@ -234,6 +234,47 @@
         properties.setProperty(#P, _##P); \
     }
 
+#define COPY_PROPERTY_TO_QJSONOBJECT_VEC3(P) \
+    if (!skipDefaults || defaultEntityProperties._##P != _##P) { \
+        QJsonObject P; \
+        P["x"] = _##P.x; \
+        P["y"] = _##P.y; \
+        P["z"] = _##P.z; \
+        properties[#P] = P; \
+    }
+
+#define COPY_PROPERTY_TO_QJSONOBJECT_QUAT(P) \
+    if (!skipDefaults || defaultEntityProperties._##P != _##P) { \
+        QJsonObject P; \
+        P["x"] = _##P.x; \
+        P["y"] = _##P.y; \
+        P["z"] = _##P.z; \
+        P["w"] = _##P.w; \
+        properties[#P] = P; \
+    }
+
+#define COPY_PROPERTY_TO_QJSONOBJECT_COLOR_GETTER(P, G) \
+    if (!skipDefaults || defaultEntityProperties._##P != _##P) { \
+        xColor P##Color = G; \
+        QJsonObject P; \
+        P["red"] = P##Color.red; \
+        P["green"] = P##Color.green; \
+        P["blue"] = P##Color.blue; \
+        properties[#P] = P; \
+    }
+
+#define COPY_PROPERTY_TO_QJSONOBJECT_COLOR(P) COPY_PROPERTY_TO_QJSONOBJECT_COLOR_GETTER(P, _##P)
+
+#define COPY_PROPERTY_TO_QJSONOBJECT_GETTER_NO_SKIP(P, G) \
+    properties[#P] = G;
+
+#define COPY_PROPERTY_TO_QJSONOBJECT_GETTER(P, G) \
+    if (!skipDefaults || defaultEntityProperties._##P != _##P) { \
+        properties[#P] = G; \
+    }
+
+#define COPY_PROPERTY_TO_QJSONOBJECT(P) COPY_PROPERTY_TO_QJSONOBJECT_GETTER(P, _##P)
+
 #define COPY_PROPERTY_FROM_QSCRIPTVALUE_FLOAT(P, S) \
     QScriptValue P = object.property(#P);           \
     if (P.isValid()) {                              \
@@ -353,6 +394,129 @@
         }                                                         \
     }
     
+// The same as the COPY_PROPERTY_FROM_QSCRIPTVALUE macros, for reading straight from parsed JSON without a script engine
+#define COPY_PROPERTY_FROM_QJSONOBJECT_FLOAT(P, S)  \
+    QJsonValue P = object.value(#P);                \
+    if (!P.isUndefined()) {                         \
+        float newValue = P.toVariant().toFloat();   \
+        if (_defaultSettings || newValue != _##P) { \
+            S(newValue);                            \
+        }                                           \
+    }
+
+#define COPY_PROPERTY_FROM_QJSONOBJECT_INT(P, S)    \
+    QJsonValue P = object.value(#P);                \
+    if (!P.isUndefined()) {                         \
+        int newValue = P.toVariant().toInt();       \
+        if (_defaultSettings || newValue != _##P) { \
+            S(newValue);                            \
+        }                                           \
+    }
+
+#define COPY_PROPERTY_FROM_QJSONOBJECT_BOOL(P, S)   \
+    QJsonValue P = object.value(#P);                \
+    if (!P.isUndefined()) {                         \
+        bool newValue = P.toVariant().toBool();     \
+        if (_defaultSettings || newValue != _##P) { \
+            S(newValue);                            \
+        }                                           \
+    }
+
+#define COPY_PROPERTY_FROM_QJSONOBJECT_STRING(P, S) \
+    QJsonValue P = object.value(#P);                \
+    if (!P.isUndefined()) {                         \
+        QString newValue = P.toVariant().toString().trimmed();\
+        if (_defaultSettings || newValue != _##P) { \
+            S(newValue);                            \
+        }                                           \
+    }
+
+#define COPY_PROPERTY_FROM_QJSONOBJECT_UUID(P, S)             \
+    QJsonValue P = object.value(#P);                         \
+    if (!P.isUndefined()) {                                  \
+        QUuid newValue = P.toVariant().toUuid();             \
+        if (_defaultSettings || newValue != _##P) {          \
+            S(newValue);                                     \
+        }                                                    \
+    }
+
+#define COPY_PROPERTY_FROM_QJSONOBJECT_VEC3(P, S)         \
+    QJsonValue P = object.value(#P);                      \
+    if (!P.isUndefined()) {                               \
+        QJsonObject P##Object = P.toObject();             \
+        QJsonValue x = P##Object.value("x");              \
+        QJsonValue y = P##Object.value("y");              \
+        QJsonValue z = P##Object.value("z");              \
+        if (!x.isUndefined() && !y.isUndefined() && !z.isUndefined()) { \
+            glm::vec3 newValue;                           \
+            newValue.x = x.toVariant().toFloat();         \
+            newValue.y = y.toVariant().toFloat();         \
+            newValue.z = z.toVariant().toFloat();         \
+            bool isValid = !glm::isnan(newValue.x) &&     \
+                         !glm::isnan(newValue.y) &&       \
+                         !glm::isnan(newValue.z);         \
+            if (isValid &&                                \
+                (_defaultSettings || newValue != _##P)) { \
+                S(newValue);                              \
+            }                                             \
+        }                                                 \
+    }
+
+#define COPY_PROPERTY_FROM_QJSONOBJECT_QUAT(P, S)                       \
+    QJsonValue P = object.value(#P);                                    \
+    if (!P.isUndefined()) {                                             \
+        QJsonObject P##Object = P.toObject();                           \
+        QJsonValue x = P##Object.value("x");                            \
+        QJsonValue y = P##Object.value("y");                            \
+        QJsonValue z = P##Object.value("z");                            \
+        QJsonValue w = P##Object.value("w");                            \
+        if (!x.isUndefined() && !y.isUndefined() && !z.isUndefined() && !w.isUndefined()) { \
+            glm::quat newValue;                                         \
+            newValue.x = x.toVariant().toFloat();                       \
+            newValue.y = y.toVariant().toFloat();                       \
+            newValue.z = z.toVariant().toFloat();                       \
+            newValue.w = w.toVariant().toFloat();                       \
+            bool isValid = !glm::isnan(newValue.x) &&                   \
+                           !glm::isnan(newValue.y) &&                   \
+                           !glm::isnan(newValue.z) &&                   \
+                           !glm::isnan(newValue.w);                     \
+            if (isValid &&                                              \
+                (_defaultSettings || newValue != _##P)) {               \
+                S(newValue);                                            \
+            }                                                           \
+        }                                                               \
+    }
+
+#define COPY_PROPERTY_FROM_QJSONOBJECT_COLOR(P, S)      \
+    QJsonValue P = object.value(#P);                    \
+    if (!P.isUndefined()) {                             \
+        QJsonObject P##Object = P.toObject();           \
+        QJsonValue r = P##Object.value("red");          \
+        QJsonValue g = P##Object.value("green");        \
+        QJsonValue b = P##Object.value("blue");         \
+        if (!r.isUndefined() && !g.isUndefined() && !b.isUndefined()) {\
+            xColor newColor;                            \
+            newColor.red = r.toVariant().toInt();       \
+            newColor.green = g.toVariant().toInt();     \
+            newColor.blue = b.toVariant().toInt();      \
+            if (_defaultSettings ||                     \
+                (newColor.red != _color.red ||          \
+                newColor.green != _color.green ||       \
+                newColor.blue != _color.blue)) {        \
+                S(newColor);                            \
+            }                                           \
+        }                                               \
+    }
+
+#define COPY_PROPERTY_FROM_QJSONOBJECT_ENUM(P, S)                 \
+    QJsonValue P = object.value(#P);                              \
+    if (!P.isUndefined()) {                                       \
+        QString newValue = P.toVariant().toString();              \
+        if (_defaultSettings || newValue != get##S##AsString()) { \
+            set##S##FromString(newValue);                         \
+        }                                                         \
+    }
+
 #define CONSTRUCT_PROPERTY(n, V)        \
     _##n(V),                            \
     _##n##Changed(false)
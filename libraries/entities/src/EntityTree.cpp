@@ -9,8 +9,13 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <algorithm>
+
 #include <PerfStat.h>
 #include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutexLocker>
 #include <QtScript/QScriptEngine>
 
 #include "EntityTree.h"
@@ -18,10 +23,13 @@
 #include "VariantMapToScriptValue.h"
 
 #include "AddEntityOperator.h"
+#include "EntityBinaryFile.h"
+#include "EntityEditBatch.h"
 #include "MovingEntitiesOperator.h"
 #include "UpdateEntityOperator.h"
 #include "QVariantGLM.h"
 #include "EntitiesLogging.h"
+#include "RecurseOctreeToJSONOperator.h"
 #include "RecurseOctreeToMapOperator.h"
 
 
@@ -62,6 +70,14 @@ void EntityTree::eraseAllOctreeElements(bool createNewRoot) {
     Octree::eraseAllOctreeElements(createNewRoot);
 }
 
+Octree* EntityTree::createSnapshot() {
+    // the snapshot has no simulation, its entities never change
+    EntityTree* snapshot = new EntityTree(getShouldReaverage());
+    snapshot->setIsServer(getIsServer());
+    copyElementsInto(snapshot);
+    return snapshot;
+}
+
 bool EntityTree::handlesEditPacketType(PacketType packetType) const {
     // we handle these types of "edit" packets
     switch (packetType) {
@@ -342,11 +358,9 @@ void EntityTree::processRemovedEntities(const DeleteEntityOperator& theOperator)
         EntityItem* theEntity = details.entity;
 
         if (getIsServer()) {
-            // set up the deleted entities ID
-            quint64 deletedAt = usecTimestampNow();
-            _recentlyDeletedEntitiesLock.lockForWrite();
-            _recentlyDeletedEntityItemIDs.insert(deletedAt, theEntity->getEntityItemID().id);
-            _recentlyDeletedEntitiesLock.unlock();
+            logDeletedEntity(theEntity->getEntityItemID().id);
+
+            journalEntityDeleted(theEntity->getEntityItemID());
         }
 
         if (_simulation) {
@@ -627,6 +641,10 @@ EntityItemID EntityTree::assignEntityID(const EntityItemID& entityItemID) {
     return entityItemID.assignActualIDForToken();
 }
 
+OctreeEditBatch* EntityTree::createEditBatch() {
+    return new EntityEditBatch(this);
+}
+
 int EntityTree::processEditPacketData(PacketType packetType, const unsigned char* packetData, int packetLength,
                     const unsigned char* editData, int maxLength, const SharedNodePointer& senderNode) {
 
@@ -653,46 +671,7 @@ int EntityTree::processEditPacketData(PacketType packetType, const unsigned char
             // If we got a valid edit packet, then it could be a new entity or it could be an update to
             // an existing entity... handle appropriately
             if (validEditPacket) {
-            
-                // If this is a knownID, then it should exist in our tree
-                if (entityItemID.isKnownID) {
-                    // search for the entity by EntityItemID
-                    EntityItem* existingEntity = findEntityByEntityItemID(entityItemID);
-                    
-                    // if the EntityItem exists, then update it
-                    if (existingEntity) {
-                        if (wantEditLogging()) {
-                            qCDebug(entities) << "User [" << senderNode->getUUID() << "] editing entity. ID:" << entityItemID;
-                            qCDebug(entities) << "   properties:" << properties;
-                        }
-                        updateEntity(entityItemID, properties, senderNode->getCanAdjustLocks());
-                        existingEntity->markAsChangedOnServer();
-                    } else {
-                        qCDebug(entities) << "User attempted to edit an unknown entity. ID:" << entityItemID;
-                    }
-                } else {
-                    if (senderNode->getCanRez()) {
-                        // this is a new entity... assign a new entityID
-                        entityItemID = assignEntityID(entityItemID);
-                        if (wantEditLogging()) {
-                            qCDebug(entities) << "User [" << senderNode->getUUID() << "] adding entity.";
-                            qCDebug(entities) << "   properties:" << properties;
-                        }
-                        EntityItem* newEntity = addEntity(entityItemID, properties);
-                        if (newEntity) {
-                            newEntity->markAsChangedOnServer();
-                            notifyNewlyCreatedEntity(*newEntity, senderNode);
-                            if (wantEditLogging()) {
-                                qCDebug(entities) << "User [" << senderNode->getUUID() << "] added entity. ID:" 
-                                                << newEntity->getEntityItemID();
-                                qCDebug(entities) << "   properties:" << properties;
-                            }
-
-                        }
-                    } else {
-                        qCDebug(entities) << "User without 'rez rights' [" << senderNode->getUUID() << "] attempted to add an entity.";
-                    }
-                }
+                processDecodedEdit(entityItemID, properties, senderNode);
             }
             break;
         }
@@ -705,6 +684,51 @@ int EntityTree::processEditPacketData(PacketType packetType, const unsigned char
 }
 
 
+void EntityTree::processDecodedEdit(EntityItemID entityItemID, const EntityItemProperties& properties,
+                                    const SharedNodePointer& senderNode) {
+    // If this is a knownID, then it should exist in our tree
+    if (entityItemID.isKnownID) {
+        // search for the entity by EntityItemID
+        EntityItem* existingEntity = findEntityByEntityItemID(entityItemID);
+        
+        // if the EntityItem exists, then update it
+        if (existingEntity) {
+            if (wantEditLogging()) {
+                qCDebug(entities) << "User [" << senderNode->getUUID() << "] editing entity. ID:" << entityItemID;
+                qCDebug(entities) << "   properties:" << properties;
+            }
+            updateEntity(entityItemID, properties, senderNode->getCanAdjustLocks());
+            existingEntity->markAsChangedOnServer();
+            journalEntityChanged(existingEntity->getEntityItemID());
+        } else {
+            qCDebug(entities) << "User attempted to edit an unknown entity. ID:" << entityItemID;
+        }
+    } else {
+        if (senderNode->getCanRez()) {
+            // this is a new entity... assign a new entityID
+            entityItemID = assignEntityID(entityItemID);
+            if (wantEditLogging()) {
+                qCDebug(entities) << "User [" << senderNode->getUUID() << "] adding entity.";
+                qCDebug(entities) << "   properties:" << properties;
+            }
+            EntityItem* newEntity = addEntity(entityItemID, properties);
+            if (newEntity) {
+                newEntity->markAsChangedOnServer();
+                notifyNewlyCreatedEntity(*newEntity, senderNode);
+                journalEntityChanged(newEntity->getEntityItemID());
+                if (wantEditLogging()) {
+                    qCDebug(entities) << "User [" << senderNode->getUUID() << "] added entity. ID:" 
+                                    << newEntity->getEntityItemID();
+                    qCDebug(entities) << "   properties:" << properties;
+                }
+
+            }
+        } else {
+            qCDebug(entities) << "User without 'rez rights' [" << senderNode->getUUID() << "] attempted to add an entity.";
+        }
+    }
+}
+
 void EntityTree::notifyNewlyCreatedEntity(const EntityItem& newEntity, const SharedNodePointer& senderNode) {
     _newlyCreatedHooksLock.lockForRead();
     for (int i = 0; i < _newlyCreatedHooks.size(); i++) {
@@ -766,27 +790,42 @@ void EntityTree::update() {
     }
 }
 
-bool EntityTree::hasEntitiesDeletedSince(quint64 sinceTime) {
-    // we can probably leverage the ordered nature of QMultiMap to do this quickly...
-    bool hasSomethingNewer = false;
+void EntityTree::logDeletedEntity(const QUuid& entityID) {
+    const int INITIAL_DELETED_ENTITIES_CAPACITY = 256;
 
-    _recentlyDeletedEntitiesLock.lockForRead();
-    QMultiMap<quint64, QUuid>::const_iterator iterator = _recentlyDeletedEntityItemIDs.constBegin();
-    while (iterator != _recentlyDeletedEntityItemIDs.constEnd()) {
-        if (iterator.key() > sinceTime) {
-            hasSomethingNewer = true;
+    _recentlyDeletedEntitiesLock.lockForWrite();
+    int capacity = _recentlyDeletedEntityItemIDs.size();
+    if (_nextDeletedEntitySequence - _firstDeletedEntitySequence == (quint64)capacity) {
+        // full, so move the deletions into a ring twice the size, where they have to be at their new positions
+        int newCapacity = capacity > 0 ? capacity * 2 : INITIAL_DELETED_ENTITIES_CAPACITY;
+        QVector<QUuid> newRing(newCapacity);
+        for (quint64 sequence = _firstDeletedEntitySequence; sequence < _nextDeletedEntitySequence; sequence++) {
+            newRing[sequence & (newCapacity - 1)] = _recentlyDeletedEntityItemIDs[sequence & (capacity - 1)];
         }
-        ++iterator;
+        _recentlyDeletedEntityItemIDs.swap(newRing);
+        capacity = newCapacity;
     }
+    _recentlyDeletedEntityItemIDs[_nextDeletedEntitySequence & (capacity - 1)] = entityID;
+    _nextDeletedEntitySequence++;
     _recentlyDeletedEntitiesLock.unlock();
-    return hasSomethingNewer;
 }
 
-// sinceTime is an in/out parameter - it will be side effected with the last time sent out
-bool EntityTree::encodeEntitiesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber, quint64& sinceTime, unsigned char* outputBuffer,
-                                            size_t maxLength, size_t& outputLength) {
-    bool hasMoreToSend = true;
+bool EntityTree::hasAnyDeletedEntities() {
+    _recentlyDeletedEntitiesLock.lockForRead();
+    bool hasAnyDeleted = _nextDeletedEntitySequence > _firstDeletedEntitySequence;
+    _recentlyDeletedEntitiesLock.unlock();
+    return hasAnyDeleted;
+}
+
+bool EntityTree::hasEntitiesDeletedSince(quint64 deletedSequence) {
+    _recentlyDeletedEntitiesLock.lockForRead();
+    bool hasSomethingNewer = deletedSequence < _nextDeletedEntitySequence;
+    _recentlyDeletedEntitiesLock.unlock();
+    return hasSomethingNewer;
+}
 
+bool EntityTree::encodeEntitiesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber, quint64& deletedSequence,
+                                            unsigned char* outputBuffer, size_t maxLength, size_t& outputLength) {
     unsigned char* copyAt = outputBuffer;
     size_t numBytesPacketHeader = populatePacketHeader(reinterpret_cast<char*>(outputBuffer), PacketTypeEntityErase);
     copyAt += numBytesPacketHeader;
@@ -818,45 +857,19 @@ bool EntityTree::encodeEntitiesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumbe
     copyAt += sizeof(numberOfIds);
     outputLength += sizeof(numberOfIds);
     
-    // we keep a multi map of entity IDs to timestamps, we only want to include the entity IDs that have been
-    // deleted since we last sent to this node
+    // the deletions are in order, so the ones this node hasn't been sent yet are the ones from its sequence number on
     _recentlyDeletedEntitiesLock.lockForRead();
-
-    QMultiMap<quint64, QUuid>::const_iterator iterator = _recentlyDeletedEntityItemIDs.constBegin();
-    while (iterator != _recentlyDeletedEntityItemIDs.constEnd()) {
-        QList<QUuid> values = _recentlyDeletedEntityItemIDs.values(iterator.key());
-        for (int valueItem = 0; valueItem < values.size(); ++valueItem) {
-
-            // if the timestamp is more recent then out last sent time, include it
-            if (iterator.key() > sinceTime) {
-                QUuid entityID = values.at(valueItem);
-                QByteArray encodedEntityID = entityID.toRfc4122();
-                memcpy(copyAt, encodedEntityID.constData(), NUM_BYTES_RFC4122_UUID);
-                copyAt += NUM_BYTES_RFC4122_UUID;
-                outputLength += NUM_BYTES_RFC4122_UUID;
-                numberOfIds++;
-
-                // check to make sure we have room for one more id...
-                if (outputLength + NUM_BYTES_RFC4122_UUID > maxLength) {
-                    break;
-                }
-            }
-        }
-
-        // check to make sure we have room for one more id...
-        if (outputLength + NUM_BYTES_RFC4122_UUID > maxLength) {
-
-            // let our caller know how far we got
-            sinceTime = iterator.key();
-            break;
-        }
-        ++iterator;
-    }
-
-    // if we got to the end, then we're done sending
-    if (iterator == _recentlyDeletedEntityItemIDs.constEnd()) {
-        hasMoreToSend = false;
+    quint64 capacityMask = _recentlyDeletedEntityItemIDs.size() - 1;
+    deletedSequence = qMax(deletedSequence, _firstDeletedEntitySequence);
+    while (deletedSequence < _nextDeletedEntitySequence && outputLength + NUM_BYTES_RFC4122_UUID <= maxLength) {
+        QByteArray encodedEntityID = _recentlyDeletedEntityItemIDs.at(deletedSequence & capacityMask).toRfc4122();
+        memcpy(copyAt, encodedEntityID.constData(), NUM_BYTES_RFC4122_UUID);
+        copyAt += NUM_BYTES_RFC4122_UUID;
+        outputLength += NUM_BYTES_RFC4122_UUID;
+        numberOfIds++;
+        deletedSequence++;
     }
+    bool hasMoreToSend = deletedSequence < _nextDeletedEntitySequence;
     _recentlyDeletedEntitiesLock.unlock();
 
     // replace the correct count for ids included
@@ -866,26 +879,10 @@ bool EntityTree::encodeEntitiesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumbe
 }
 
 
-// called by the server when it knows all nodes have been sent deleted packets
-void EntityTree::forgetEntitiesDeletedBefore(quint64 sinceTime) {
-    QSet<quint64> keysToRemove;
-
+// called by the server when it knows all nodes have been sent the deletions before this one
+void EntityTree::forgetEntitiesDeletedBefore(quint64 deletedSequence) {
     _recentlyDeletedEntitiesLock.lockForWrite();
-    QMultiMap<quint64, QUuid>::iterator iterator = _recentlyDeletedEntityItemIDs.begin();
-
-    // First find all the keys in the map that are older and need to be deleted
-    while (iterator != _recentlyDeletedEntityItemIDs.end()) {
-        if (iterator.key() <= sinceTime) {
-            keysToRemove << iterator.key();
-        }
-        ++iterator;
-    }
-
-    // Now run through the keysToRemove and remove them
-    foreach (quint64 value, keysToRemove) {
-        _recentlyDeletedEntityItemIDs.remove(value);
-    }
-    
+    _firstDeletedEntitySequence = qBound(_firstDeletedEntitySequence, deletedSequence, _nextDeletedEntitySequence);
     _recentlyDeletedEntitiesLock.unlock();
 }
 
@@ -1145,6 +1142,89 @@ bool EntityTree::writeToMap(QVariantMap& entityDescription, OctreeElement* eleme
     return true;
 }
 
+bool EntityTree::writeToJSON(QIODevice& output, OctreeElement* element, bool skipDefaultValues) {
+    // the same file writeToMap() describes, but each entity is written out as soon as it's been converted
+    const QByteArray JSON_START = "{\n    \"Entities\": [\n";
+    const QByteArray JSON_END = "\n    ]\n}\n";
+
+    if (output.write(JSON_START) != JSON_START.size()) {
+        return false;
+    }
+    RecurseOctreeToJSONOperator theOperator(output, skipDefaultValues);
+    recurseElementWithOperator(element ? element : _rootElement, &theOperator);
+    if (theOperator.hasFailed()) {
+        return false;
+    }
+    return output.write(JSON_END) == JSON_END.size();
+}
+
+bool EntityTree::writeToBinary(QIODevice& output, OctreeElement* element) {
+    return EntityBinaryFile::write(this, element, output);
+}
+
+bool EntityTree::readFromBinary(const uchar* data, qint64 size) {
+    EntityBinaryFile file(data, size);
+    if (!file.isValid()) {
+        qCDebug(entities) << "Binary entities file is not one this version can read.";
+        return false;
+    }
+
+    if (getIsClient()) {
+        // if our Node isn't allowed to create entities in this domain, don't try.
+        auto nodeList = DependencyManager::get<NodeList>();
+        if (!nodeList->getThisNodeCanRez()) {
+            return true;
+        }
+    }
+
+    // each cell is the element its entities were in when the file was written, so they go straight back into it
+    for (int cellIndex = 0; cellIndex < file.getNumCells(); cellIndex++) {
+        const EntityBinaryFile::Cell& cell = file.getCell(cellIndex);
+        AACube cellCube = file.getCellCube(cellIndex);
+        EntityTreeElement* element = NULL;
+        if (_rootElement->getAACube().contains(cellCube)) {
+            element = static_cast<EntityTreeElement*>(getOrCreateChildElementAt(cellCube.getCorner().x,
+                cellCube.getCorner().y, cellCube.getCorner().z, cellCube.getScale()));
+            if (element->getAACube() != cellCube) {
+                element = NULL; // the file's cells don't line up with this tree's elements
+            }
+        }
+
+        for (quint32 i = 0; i < cell.numRecords; i++) {
+            int recordIndex = cell.firstRecord + i;
+            EntityItemID entityItemID = file.getEntityItemID(recordIndex);
+            if (getContainingElement(entityItemID)) {
+                qCDebug(entities) << "UNEXPECTED!!! ----- don't call addEntity() on existing entity items. entityID="
+                    << entityItemID;
+                continue;
+            }
+
+            EntityItemProperties properties = file.getProperties(recordIndex);
+            EntityItem* entity = EntityTypes::constructEntityItem(properties.getType(), entityItemID, properties);
+            if (!entity) {
+                qCDebug(entities) << "adding Entity failed:" << entityItemID << properties.getType();
+                continue;
+            }
+
+            if (element) {
+                element->addEntityItem(entity);
+                setContainingElement(entityItemID, element);
+            } else if (!addEntityToBestFitElement(entity)) {
+                AddEntityOperator theOperator(this, entity);
+                recurseTreeWithOperator(&theOperator);
+            }
+            postAddEntity(entity);
+        }
+        if (element) {
+            element->markWithChangedTime();
+        }
+    }
+
+    // the root's change time covers the whole tree
+    _rootElement->markWithChangedTime();
+    return true;
+}
+
 bool EntityTree::readFromMap(QVariantMap& map) {
     // map will have a top-level list keyed as "Entities".  This will be extracted
     // and iterated over.  Each member of this list is converted to a QVariantMap, then
@@ -1175,3 +1255,217 @@ bool EntityTree::readFromMap(QVariantMap& map) {
 
     return true;
 }
+
+bool EntityTree::readFromJSON(const QJsonObject& description) {
+    // the same as readFromMap(), but the properties are read straight from the JSON, and the entities are all
+    // constructed before any of them are added to the tree
+    if (getIsClient()) {
+        // if our Node isn't allowed to create entities in this domain, don't try.
+        auto nodeList = DependencyManager::get<NodeList>();
+        if (!nodeList->getThisNodeCanRez()) {
+            return true;
+        }
+    }
+
+    QJsonArray entitiesArray = description.value("Entities").toArray();
+    QVector<EntityItem*> newEntities;
+    newEntities.reserve(entitiesArray.size());
+
+    foreach (const QJsonValue& entityValue, entitiesArray) {
+        QJsonObject entityObject = entityValue.toObject();
+        EntityItemProperties properties;
+        properties.copyFromJsonObject(entityObject);
+
+        EntityItemID entityItemID;
+        if (entityObject.contains("id")) {
+            entityItemID = EntityItemID(QUuid(entityObject.value("id").toString()));
+        } else {
+            entityItemID = EntityItemID(QUuid::createUuid());
+        }
+
+        EntityItem* entity = EntityTypes::constructEntityItem(properties.getType(), entityItemID, properties);
+        if (entity) {
+            newEntities << entity;
+        } else {
+            qCDebug(entities) << "adding Entity failed:" << entityItemID << properties.getType();
+        }
+    }
+
+    addEntitiesInSpatialOrder(newEntities);
+    return true;
+}
+
+// interleaves the bits of a point's tree coordinates, so that points close in the tree are close in the ordering
+static quint64 spatialOrderKey(const glm::vec3& point) {
+    const int BITS_PER_AXIS = 21;
+    const float MAX_COORDINATE = (float)((1 << BITS_PER_AXIS) - 1);
+    glm::vec3 scaled = glm::clamp(point / (float)TREE_SCALE, 0.0f, 1.0f) * MAX_COORDINATE;
+    quint32 coordinates[] = { (quint32)scaled.x, (quint32)scaled.y, (quint32)scaled.z };
+
+    quint64 key = 0;
+    for (int bit = BITS_PER_AXIS - 1; bit >= 0; bit--) {
+        for (int axis = 0; axis < 3; axis++) {
+            key = (key << 1) | ((coordinates[axis] >> bit) & 1);
+        }
+    }
+    return key;
+}
+
+void EntityTree::addEntitiesInSpatialOrder(const QVector<EntityItem*>& newEntities) {
+    // entities that are near each other walk down the same elements one after another, while they're still cached
+    QVector<QPair<quint64, EntityItem*> > sortedEntities;
+    sortedEntities.reserve(newEntities.size());
+    foreach (EntityItem* entity, newEntities) {
+        sortedEntities << qMakePair(spatialOrderKey(entity->getMaximumAACube().calcCenter()), entity);
+    }
+    std::sort(sortedEntities.begin(), sortedEntities.end());
+
+    for (int i = 0; i < sortedEntities.size(); i++) {
+        EntityItem* entity = sortedEntities[i].second;
+
+        // You should not call this on existing entities that are already part of the tree! Call updateEntity()
+        if (getContainingElement(entity->getEntityItemID())) {
+            qCDebug(entities) << "UNEXPECTED!!! ----- don't call addEntity() on existing entity items. entityID="
+                << entity->getEntityItemID();
+            delete entity;
+            continue;
+        }
+
+        if (!addEntityToBestFitElement(entity)) {
+            // Recurse the tree and store the entity in the correct tree element
+            AddEntityOperator theOperator(this, entity);
+            recurseTreeWithOperator(&theOperator);
+        }
+        postAddEntity(entity);
+    }
+}
+
+/// Walks straight down to the element AddEntityOperator would pick for the entity, creating elements on the way, and
+/// adds the entity there. Returns false, without adding it, if the walk runs into a case it leaves to the operator.
+bool EntityTree::addEntityToBestFitElement(EntityItem* entity) {
+    AABox entityBox = entity->getMaximumAACube().clamp(0.0f, (float)TREE_SCALE);
+    EntityTreeElement* element = static_cast<EntityTreeElement*>(_rootElement);
+    if (!element->getAACube().contains(entityBox)) {
+        return false;
+    }
+
+    while (!element->bestFitBounds(entityBox)) {
+        EntityTreeElement* childContainingEntity = NULL;
+        for (int i = 0; i < NUMBER_OF_CHILDREN && !childContainingEntity; i++) {
+            OctreeElement* child = element->getChildAtIndex(i);
+            if (child && child->getAACube().contains(entityBox)) {
+                childContainingEntity = static_cast<EntityTreeElement*>(child);
+            }
+        }
+        if (!childContainingEntity) {
+            float childElementScale = element->getAACube().getScale() / 2.0f;
+            if (entityBox.getLargestDimension() > childElementScale) {
+                return false;
+            }
+            int childIndex = element->getMyChildContaining(entityBox);
+            if (childIndex == OctreeElement::CHILD_UNKNOWN) {
+                return false;
+            }
+            childContainingEntity = static_cast<EntityTreeElement*>(element->addChildAtIndex(childIndex));
+        }
+        element->markWithChangedTime();
+        element = childContainingEntity;
+    }
+
+    element->addEntityItem(entity);
+    element->markWithChangedTime();
+    setContainingElement(entity->getEntityItemID(), element);
+    return true;
+}
+
+void EntityTree::setWantEditJournal(bool wantEditJournal) {
+    QMutexLocker locker(&_editJournalMutex);
+    _wantEditJournal = wantEditJournal;
+    _journalChangedEntityIDs.clear();
+    _journalDeletedEntityIDs.clear();
+}
+
+void EntityTree::journalEntityChanged(const EntityItemID& entityID) {
+    QMutexLocker locker(&_editJournalMutex);
+    if (_wantEditJournal) {
+        _journalChangedEntityIDs.insert(entityID);
+    }
+}
+
+void EntityTree::journalEntityDeleted(const EntityItemID& entityID) {
+    QMutexLocker locker(&_editJournalMutex);
+    if (_wantEditJournal) {
+        _journalChangedEntityIDs.remove(entityID);
+        _journalDeletedEntityIDs.insert(entityID);
+    }
+}
+
+void EntityTree::writeEditJournalRecords(QList<QByteArray>& records) {
+    QSet<EntityItemID> changedEntityIDs;
+    QSet<EntityItemID> deletedEntityIDs;
+    {
+        QMutexLocker locker(&_editJournalMutex);
+        changedEntityIDs.swap(_journalChangedEntityIDs);
+        deletedEntityIDs.swap(_journalDeletedEntityIDs);
+    }
+
+    foreach (const EntityItemID& entityID, deletedEntityIDs) {
+        QVariantMap record;
+        record["delete"] = entityID.id.toString();
+        records << QJsonDocument::fromVariant(record).toJson(QJsonDocument::Compact);
+    }
+
+    if (changedEntityIDs.isEmpty()) {
+        return;
+    }
+
+    // the same encoding as the JSON persist file, but with every property, since a record replaces the whole entity
+    QScriptEngine scriptEngine;
+    foreach (const EntityItemID& entityID, changedEntityIDs) {
+        EntityItem* entity = findEntityByEntityItemID(entityID);
+        if (!entity) {
+            continue;
+        }
+        QVariantMap record;
+        record["edit"] = EntityItemPropertiesToScriptValue(&scriptEngine, entity->getProperties()).toVariant();
+        records << QJsonDocument::fromVariant(record).toJson(QJsonDocument::Compact);
+    }
+}
+
+int EntityTree::readEditJournalRecords(const QList<QByteArray>& records) {
+    QScriptEngine scriptEngine;
+    int recordsRead = 0;
+
+    foreach (const QByteArray& record, records) {
+        QJsonDocument recordDocument = QJsonDocument::fromJson(record);
+        if (!recordDocument.isObject()) {
+            qCDebug(entities) << "unreadable edit journal record, stopping after" << recordsRead << "records";
+            break;
+        }
+        QVariantMap recordMap = recordDocument.toVariant().toMap();
+
+        if (recordMap.contains("delete")) {
+            EntityItemID entityItemID(QUuid(recordMap["delete"].toString()));
+            deleteEntity(entityItemID, true, true);
+        } else if (recordMap.contains("edit")) {
+            // QVariantMap --> QScriptValue --> EntityItemProperties, the same as readFromMap()
+            QVariantMap entityMap = recordMap["edit"].toMap();
+            QScriptValue entityScriptValue = variantMapToScriptValue(entityMap, scriptEngine);
+            EntityItemProperties properties;
+            EntityItemPropertiesFromScriptValue(entityScriptValue, properties);
+
+            EntityItemID entityItemID(QUuid(entityMap["id"].toString()));
+            if (findEntityByEntityItemID(entityItemID)) {
+                updateEntity(entityItemID, properties, true);
+            } else if (!addEntity(entityItemID, properties)) {
+                qCDebug(entities) << "adding Entity from edit journal failed:" << entityItemID;
+            }
+        } else {
+            qCDebug(entities) << "unknown edit journal record, stopping after" << recordsRead << "records";
+            break;
+        }
+        recordsRead++;
+    }
+
+    return recordsRead;
+}
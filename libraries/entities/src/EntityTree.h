@@ -12,6 +12,7 @@
 #ifndef hifi_EntityTree_h
 #define hifi_EntityTree_h
 
+#include <QMutex>
 #include <QSet>
 
 #include <Octree.h>
@@ -57,6 +58,7 @@ public:
     EntityTreeElement* getRoot() { return static_cast<EntityTreeElement*>(_rootElement); }
 
     virtual void eraseAllOctreeElements(bool createNewRoot = true);
+    virtual Octree* createSnapshot();
 
     // These methods will allow the OctreeServer to send your tree inbound edit packets of your
     // own definition. Implement these to allow your octree based server to support editing
@@ -67,6 +69,11 @@ public:
     virtual bool handlesEditPacketType(PacketType packetType) const;
     virtual int processEditPacketData(PacketType packetType, const unsigned char* packetData, int packetLength,
                     const unsigned char* editData, int maxLength, const SharedNodePointer& senderNode);
+    virtual OctreeEditBatch* createEditBatch();
+
+    /// adds or updates an entity from an already decoded edit, the way processEditPacketData() does for a packet's edit
+    void processDecodedEdit(EntityItemID entityItemID, const EntityItemProperties& properties,
+                            const SharedNodePointer& senderNode);
 
     virtual bool rootElementHasData() const { return true; }
     
@@ -126,11 +133,16 @@ public:
     void addNewlyCreatedHook(NewlyCreatedEntityHook* hook);
     void removeNewlyCreatedHook(NewlyCreatedEntityHook* hook);
 
-    bool hasAnyDeletedEntities() const { return _recentlyDeletedEntityItemIDs.size() > 0; }
-    bool hasEntitiesDeletedSince(quint64 sinceTime);
-    bool encodeEntitiesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber, quint64& sinceTime, 
+    // Deleted entities are logged in order, each with the next deletion sequence number. A client keeps the sequence
+    // number of the first deletion it hasn't been sent yet, starting from 0, and the log forgets deletions once every
+    // client is past them.
+    bool hasAnyDeletedEntities();
+    bool hasEntitiesDeletedSince(quint64 deletedSequence);
+
+    /// deletedSequence is an in/out parameter, it's moved past the deletions encoded into the packet
+    bool encodeEntitiesDeletedSince(OCTREE_PACKET_SEQUENCE sequenceNumber, quint64& deletedSequence,
                                     unsigned char* packetData, size_t maxLength, size_t& outputLength);
-    void forgetEntitiesDeletedBefore(quint64 sinceTime);
+    void forgetEntitiesDeletedBefore(quint64 deletedSequence);
 
     int processEraseMessage(const QByteArray& dataByteArray, const SharedNodePointer& sourceNode);
     int processEraseMessageDetails(const QByteArray& dataByteArray, const SharedNodePointer& sourceNode);
@@ -164,7 +176,16 @@ public:
     void setWantEditLogging(bool value) { _wantEditLogging = value; }
 
     bool writeToMap(QVariantMap& entityDescription, OctreeElement* element, bool skipDefaultValues);
+    virtual bool writeToJSON(QIODevice& output, OctreeElement* element, bool skipDefaultValues);
+    virtual bool writeToBinary(QIODevice& output, OctreeElement* element);
+    virtual bool readFromBinary(const uchar* data, qint64 size);
     bool readFromMap(QVariantMap& entityDescription);
+    virtual bool readFromJSON(const QJsonObject& description);
+
+    virtual bool supportsEditJournal() const { return true; }
+    virtual void setWantEditJournal(bool wantEditJournal);
+    virtual void writeEditJournalRecords(QList<QByteArray>& records);
+    virtual int readEditJournalRecords(const QList<QByteArray>& records);
 
 signals:
     void deletingEntity(const EntityItemID& entityID);
@@ -185,12 +206,22 @@ private:
     static bool sendEntitiesOperation(OctreeElement* element, void* extraData);
 
     void notifyNewlyCreatedEntity(const EntityItem& newEntity, const SharedNodePointer& senderNode);
+    void addEntitiesInSpatialOrder(const QVector<EntityItem*>& newEntities);
+    bool addEntityToBestFitElement(EntityItem* entity);
+    void journalEntityChanged(const EntityItemID& entityID);
+    void journalEntityDeleted(const EntityItemID& entityID);
 
     QReadWriteLock _newlyCreatedHooksLock;
     QVector<NewlyCreatedEntityHook*> _newlyCreatedHooks;
 
+    void logDeletedEntity(const QUuid& entityID);
+
+    // a ring of the deletions from _firstDeletedEntitySequence up to _nextDeletedEntitySequence, the entry for a
+    // sequence number is at (sequence & (size - 1)), and the ring doubles in size when it fills
     QReadWriteLock _recentlyDeletedEntitiesLock;
-    QMultiMap<quint64, QUuid> _recentlyDeletedEntityItemIDs;
+    QVector<QUuid> _recentlyDeletedEntityItemIDs;
+    quint64 _firstDeletedEntitySequence = 0;
+    quint64 _nextDeletedEntitySequence = 0;
     EntityItemFBXService* _fbxService;
 
     QHash<EntityItemID, EntityTreeElement*> _entityToElementMap;
@@ -199,6 +230,12 @@ private:
     EntitySimulation* _simulation;
     
     bool _wantEditLogging = false;
+
+    // the entities changed and deleted since the edit journal was last written, an entity is only ever in one of them
+    QMutex _editJournalMutex;
+    bool _wantEditJournal = false;
+    QSet<EntityItemID> _journalChangedEntityIDs;
+    QSet<EntityItemID> _journalDeletedEntityIDs;
 };
 
 #endif // hifi_EntityTree_h
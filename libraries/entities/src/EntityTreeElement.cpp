@@ -13,6 +13,7 @@
 
 #include <FBXReader.h>
 #include <GeometryUtil.h>
+#include <OctreeEncodeCache.h>
 
 #include "EntityTree.h"
 #include "EntitiesLogging.h"
@@ -233,6 +234,22 @@ void EntityTreeElement::elementEncodeComplete(EncodeBitstreamParams& params, Oct
     }
 }
 
+// digest of which entities were included in an element encode and when each of them last changed
+static quint64 encodeCacheSignature(const QList<EntityItem*>& entityItems, const QVector<uint16_t>& indexes) {
+    const quint64 MIX = 0x9E3779B97F4A7C15ULL;
+    quint64 signature = indexes.size();
+    foreach (uint16_t i, indexes) {
+        EntityItem* entity = entityItems[i];
+        quint64 values[] = { i, qHash(entity->getID()), entity->getLastEdited(), entity->getLastUpdated(),
+                             entity->getLastSimulated(), entity->getLastChangedOnServer() };
+        for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++) {
+            signature = (signature ^ values[v]) * MIX;
+            signature ^= signature >> 29;
+        }
+    }
+    return signature;
+}
+
 OctreeElement::AppendState EntityTreeElement::appendElementData(OctreePacketData* packetData, 
                                                                     EncodeBitstreamParams& params) const {
 
@@ -315,6 +332,38 @@ OctreeElement::AppendState EntityTreeElement::appendElementData(OctreePacketData
         }
     }
 
+    // On a full scene send of an element we haven't started on, the data we write depends only on which entities
+    // are in view and their state, so another client may have already encoded exactly the bytes we need.
+    OctreeEncodeCacheKey encodeCacheKey = { this, _lastChanged, 0 };
+    bool useEncodeCache = params.encodeCache && params.encodeCache->isEnabled() && params.forceSendScene
+                            && !hadElementExtraData && numberOfEntities > 0;
+    if (useEncodeCache) {
+        encodeCacheKey.contentSignature = encodeCacheSignature(*_entityItems, indexesOfEntitiesToInclude);
+
+        QByteArray cachedData;
+        if (params.encodeCache->find(encodeCacheKey, cachedData)) {
+            if (packetData->appendRawData((const unsigned char*)cachedData.constData(), cachedData.size())) {
+                packetData->endLevel(elementLevel);
+
+                foreach (uint16_t i, indexesOfEntitiesToInclude) {
+                    entityTreeElementExtraEncodeData->entities.remove((*_entityItems)[i]->getEntityItemID());
+                }
+                if (entityTreeElementExtraEncodeData->entities.size() == 0) {
+                    entityTreeElementExtraEncodeData->elementCompleted = true;
+                }
+                if (extraEncodeData) {
+                    extraEncodeData->insert(this, entityTreeElementExtraEncodeData);
+                } else {
+                    delete entityTreeElementExtraEncodeData;
+                }
+                return OctreeElement::COMPLETED;
+            }
+            // it didn't fit in the room left in this packet, encode as usual so that we send what does fit
+            packetData->discardLevel(elementLevel);
+            elementLevel = packetData->startLevel();
+        }
+    }
+
     int numberOfEntitiesOffset = packetData->getUncompressedByteOffset();
     bool successAppendEntityCount = packetData->appendValue(numberOfEntities);
 
@@ -403,6 +452,12 @@ OctreeElement::AppendState EntityTreeElement::appendElementData(OctreePacketData
         packetData->discardLevel(elementLevel);
         appendElementState = OctreeElement::NONE;
     } else {
+        if (useEncodeCache && appendElementState == OctreeElement::COMPLETED
+                && actualNumberOfEntities == numberOfEntities) {
+            int cacheableBytes = packetData->getUncompressedByteOffset() - numberOfEntitiesOffset;
+            params.encodeCache->insert(encodeCacheKey, packetData->getUncompressedData(numberOfEntitiesOffset),
+                                       cacheableBytes);
+        }
         packetData->endLevel(elementLevel);
     }
     return appendElementState;
@@ -791,6 +846,29 @@ void EntityTreeElement::addEntityItem(EntityItem* entity) {
     entity->_element = this;
 }
 
+void EntityTreeElement::copyContentsInto(OctreeElement* snapshotElement) const {
+    EntityTreeElement* entityTreeElement = static_cast<EntityTreeElement*>(snapshotElement);
+    uint16_t numberOfEntities = _entityItems->size();
+    for (uint16_t i = 0; i < numberOfEntities; i++) {
+        EntityItem* entity = (*_entityItems)[i];
+        EntityItem* copy = EntityTypes::constructEntityItem(entity->getType(), entity->getEntityItemID(),
+                                                            entity->getProperties());
+        if (!copy) {
+            continue;
+        }
+
+        // constructing the copy stamped it with the current time, but clients are sent deltas based on these
+        copy->_created = entity->_created;
+        copy->_lastEdited = entity->_lastEdited;
+        copy->_lastUpdated = entity->_lastUpdated;
+        copy->_lastSimulated = entity->_lastSimulated;
+        copy->_changedOnServer = entity->_changedOnServer;
+
+        entityTreeElement->addEntityItem(copy);
+        entityTreeElement->_myTree->setContainingElement(copy->getEntityItemID(), entityTreeElement);
+    }
+}
+
 // will average a "common reduced LOD view" from the the child elements...
 void EntityTreeElement::calculateAverageFromChildren() {
     // nothing to do here yet...
@@ -127,6 +127,8 @@ public:
     /// from the network.
     virtual int readElementDataFromBuffer(const unsigned char* data, int bytesLeftToRead, ReadBitstreamToTreeParams& args);
 
+    virtual void copyContentsInto(OctreeElement* snapshotElement) const;
+
     /// Override to indicate that the item is currently rendered in the rendering engine. By default we assume that if
     /// the element should be rendered, then your rendering engine is rendering. But some rendering engines my have cases
     /// where an element is not actually rendering all should render elements. If the isRendered() state doesn't match the
@@ -0,0 +1,48 @@
+//
+//  RecurseOctreeToJSONOperator.cpp
+//  libraries/entities/src
+//
+//  Created on 4/22/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QJsonDocument>
+
+#include "RecurseOctreeToJSONOperator.h"
+
+RecurseOctreeToJSONOperator::RecurseOctreeToJSONOperator(QIODevice& output, bool skipDefaultValues) :
+    RecurseOctreeOperator(),
+    _output(output),
+    _skipDefaultValues(skipDefaultValues),
+    _entitiesWritten(0),
+    _failed(false)
+{
+}
+
+bool RecurseOctreeToJSONOperator::preRecursion(OctreeElement* element) {
+    return !_failed;
+}
+
+bool RecurseOctreeToJSONOperator::postRecursion(OctreeElement* element) {
+    EntityTreeElement* entityTreeElement = static_cast<EntityTreeElement*>(element);
+    const QList<EntityItem*>& entities = entityTreeElement->getEntities();
+
+    foreach (EntityItem* entityItem, entities) {
+        if (_failed) {
+            break;
+        }
+
+        // each entity goes on a line of its own
+        QByteArray entityJSON = _entitiesWritten > 0 ? ",\n" : "";
+        entityJSON += QJsonDocument(entityItem->getProperties().copyToJsonObject(_skipDefaultValues))
+            .toJson(QJsonDocument::Compact);
+        if (_output.write(entityJSON) != entityJSON.size()) {
+            _failed = true;
+        }
+        _entitiesWritten++;
+    }
+    return !_failed;
+}
@@ -0,0 +1,37 @@
+//
+//  RecurseOctreeToJSONOperator.h
+//  libraries/entities/src
+//
+//  Created on 4/22/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_RecurseOctreeToJSONOperator_h
+#define hifi_RecurseOctreeToJSONOperator_h
+
+#include <QtCore/QIODevice>
+
+#include "EntityTree.h"
+
+/// Writes the entities of a tree to a device as the elements of a JSON array, one entity at a time, so that the
+/// description of the whole tree is never held in memory.
+class RecurseOctreeToJSONOperator : public RecurseOctreeOperator {
+public:
+    RecurseOctreeToJSONOperator(QIODevice& output, bool skipDefaultValues);
+    bool preRecursion(OctreeElement* element);
+    bool postRecursion(OctreeElement* element);
+
+    int getEntitiesWritten() const { return _entitiesWritten; }
+    bool hasFailed() const { return _failed; }
+
+private:
+    QIODevice& _output;
+    bool _skipDefaultValues;
+    int _entitiesWritten;
+    bool _failed;
+};
+
+#endif // hifi_RecurseOctreeToJSONOperator_h
@@ -0,0 +1,235 @@
+//
+//  DatagramBatch.cpp
+//  libraries/networking/src
+//
+//  Created on 4/18/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include "LimitedNodeList.h"
+#include "NetworkLogging.h"
+
+#include "DatagramBatch.h"
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+DatagramBatch::DatagramBatch() :
+    _bufferSize(MAX_PACKET_SIZE),
+    _numDatagrams(0),
+    _buffers(MAX_DATAGRAMS_PER_BATCH * MAX_PACKET_SIZE)
+{
+}
+
+void DatagramBatch::append(const char* data, int size, const HifiSockAddr& sockAddr) {
+    Q_ASSERT(!isFull());
+    
+    if (size > _bufferSize) {
+        // the batch only holds datagrams up to the largest we send, anything else can't wait for it
+        qCDebug(networking) << "Dropping a datagram of" << size << "bytes too large to batch for" << sockAddr;
+        return;
+    }
+    
+    memcpy(_buffers.data() + _numDatagrams * _bufferSize, data, size);
+    _sizes[_numDatagrams] = size;
+    _sockAddrs[_numDatagrams] = sockAddr;
+    ++_numDatagrams;
+}
+
+#ifdef Q_OS_LINUX
+
+static socklen_t sockAddrToNative(const HifiSockAddr& sockAddr, sockaddr_storage* nativeSockAddr) {
+    memset(nativeSockAddr, 0, sizeof(sockaddr_storage));
+    
+    if (sockAddr.getAddress().protocol() == QAbstractSocket::IPv6Protocol) {
+        sockaddr_in6* ipv6SockAddr = reinterpret_cast<sockaddr_in6*>(nativeSockAddr);
+        ipv6SockAddr->sin6_family = AF_INET6;
+        ipv6SockAddr->sin6_port = htons(sockAddr.getPort());
+        Q_IPV6ADDR ipv6Address = sockAddr.getAddress().toIPv6Address();
+        memcpy(&ipv6SockAddr->sin6_addr, &ipv6Address, sizeof(ipv6Address));
+        return sizeof(sockaddr_in6);
+    } else {
+        sockaddr_in* ipv4SockAddr = reinterpret_cast<sockaddr_in*>(nativeSockAddr);
+        ipv4SockAddr->sin_family = AF_INET;
+        ipv4SockAddr->sin_port = htons(sockAddr.getPort());
+        ipv4SockAddr->sin_addr.s_addr = htonl(sockAddr.getAddress().toIPv4Address());
+        return sizeof(sockaddr_in);
+    }
+}
+
+int DatagramBatch::send(QUdpSocket& socket) {
+    if (_numDatagrams == 0) {
+        return 0;
+    }
+    
+    mmsghdr messages[MAX_DATAGRAMS_PER_BATCH];
+    iovec dataVectors[MAX_DATAGRAMS_PER_BATCH];
+    sockaddr_storage destinations[MAX_DATAGRAMS_PER_BATCH];
+    
+    memset(messages, 0, _numDatagrams * sizeof(mmsghdr));
+    for (int i = 0; i < _numDatagrams; i++) {
+        dataVectors[i].iov_base = _buffers.data() + i * _bufferSize;
+        dataVectors[i].iov_len = _sizes[i];
+        messages[i].msg_hdr.msg_iov = &dataVectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+        messages[i].msg_hdr.msg_name = &destinations[i];
+        messages[i].msg_hdr.msg_namelen = sockAddrToNative(_sockAddrs[i], &destinations[i]);
+    }
+    
+    int numSystemCalls = 0;
+    int numSent = 0;
+    while (numSent < _numDatagrams) {
+        int result = sendmmsg(socket.socketDescriptor(), messages + numSent, _numDatagrams - numSent, 0);
+        ++numSystemCalls;
+        
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // same as a failed QUdpSocket write, what didn't go out is gone
+            qCDebug(networking) << "ERROR in sendmmsg:" << strerror(errno) << "-" << _numDatagrams - numSent
+                << "datagrams not sent";
+            break;
+        }
+        
+        // the kernel can stop part way through a batch, carry on from there
+        numSent += result;
+    }
+    
+    _numDatagrams = 0;
+    return numSystemCalls;
+}
+
+// QUdpSocket turns off its read notifications when readyRead is handled without reading through it, so the first
+// datagram of a batch is always read by Qt
+static int receiveFirstThroughSocket(QUdpSocket& socket, char* buffer, int bufferSize, int* size,
+                                     HifiSockAddr* senderSockAddr) {
+    if (!socket.hasPendingDatagrams()) {
+        return 0;
+    }
+    
+    if (socket.pendingDatagramSize() > bufferSize) {
+        qCDebug(networking) << "Dropping a datagram larger than the" << bufferSize << "byte receive buffer";
+        socket.readDatagram(NULL, 0);
+        return 0;
+    }
+    
+    *size = socket.readDatagram(buffer, bufferSize, senderSockAddr->getAddressPointer(), senderSockAddr->getPortPointer());
+    return *size < 0 ? 0 : 1;
+}
+
+int DatagramBatch::receiveInto(QUdpSocket& socket, int numDatagrams, char* const* buffers, int bufferSize,
+                               int* sizes, HifiSockAddr* const* senderSockAddrs) {
+    numDatagrams = qMin(numDatagrams, MAX_DATAGRAMS_PER_BATCH);
+    if (numDatagrams <= 0) {
+        return 0;
+    }
+    
+    int numKept = receiveFirstThroughSocket(socket, buffers[0], bufferSize, &sizes[0], senderSockAddrs[0]);
+    
+    mmsghdr messages[MAX_DATAGRAMS_PER_BATCH];
+    iovec dataVectors[MAX_DATAGRAMS_PER_BATCH];
+    sockaddr_storage senders[MAX_DATAGRAMS_PER_BATCH];
+    
+    int numToReceive = numDatagrams - numKept;
+    if (numToReceive == 0) {
+        return numKept;
+    }
+    
+    memset(messages, 0, numToReceive * sizeof(mmsghdr));
+    for (int i = 0; i < numToReceive; i++) {
+        dataVectors[i].iov_base = buffers[numKept + i];
+        dataVectors[i].iov_len = bufferSize;
+        messages[i].msg_hdr.msg_iov = &dataVectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+        messages[i].msg_hdr.msg_name = &senders[i];
+        messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+    }
+    
+    int numReceived = recvmmsg(socket.socketDescriptor(), messages, numToReceive, MSG_DONTWAIT, NULL);
+    if (numReceived < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            qCDebug(networking) << "ERROR in recvmmsg:" << strerror(errno);
+        }
+        return numKept;
+    }
+    
+    int firstReceived = numKept;
+    for (int i = 0; i < numReceived; i++) {
+        if (messages[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            qCDebug(networking) << "Dropping a datagram larger than the" << bufferSize << "byte receive buffer";
+            continue;
+        }
+        
+        if (numKept != firstReceived + i) {
+            // close the gap left by a dropped datagram
+            memmove(buffers[numKept], buffers[firstReceived + i], messages[i].msg_len);
+        }
+        sizes[numKept] = messages[i].msg_len;
+        
+        // set in place, a HifiSockAddr is a QObject and constructing one for every datagram would allocate
+        const sockaddr* sender = reinterpret_cast<const sockaddr*>(&senders[i]);
+        senderSockAddrs[numKept]->getAddressPointer()->setAddress(sender);
+        if (sender->sa_family == AF_INET6) {
+            senderSockAddrs[numKept]->setPort(ntohs(reinterpret_cast<const sockaddr_in6*>(sender)->sin6_port));
+        } else {
+            senderSockAddrs[numKept]->setPort(ntohs(reinterpret_cast<const sockaddr_in*>(sender)->sin_port));
+        }
+        ++numKept;
+    }
+    return numKept;
+}
+
+#else
+
+int DatagramBatch::send(QUdpSocket& socket) {
+    for (int i = 0; i < _numDatagrams; i++) {
+        socket.writeDatagram(getData(i), _sizes[i], _sockAddrs[i].getAddress(), _sockAddrs[i].getPort());
+    }
+    
+    int numSystemCalls = _numDatagrams;
+    _numDatagrams = 0;
+    return numSystemCalls;
+}
+
+int DatagramBatch::receiveInto(QUdpSocket& socket, int numDatagrams, char* const* buffers, int bufferSize,
+                               int* sizes, HifiSockAddr* const* senderSockAddrs) {
+    int numKept = 0;
+    while (numKept < numDatagrams && socket.hasPendingDatagrams()) {
+        if (socket.pendingDatagramSize() > bufferSize) {
+            qCDebug(networking) << "Dropping a datagram larger than the" << bufferSize << "byte receive buffer";
+            socket.readDatagram(NULL, 0);
+            continue;
+        }
+        
+        sizes[numKept] = socket.readDatagram(buffers[numKept], bufferSize, senderSockAddrs[numKept]->getAddressPointer(),
+                                             senderSockAddrs[numKept]->getPortPointer());
+        if (sizes[numKept] < 0) {
+            break;
+        }
+        ++numKept;
+    }
+    return numKept;
+}
+
+#endif
+
+int DatagramBatch::receive(QUdpSocket& socket) {
+    char* buffers[MAX_DATAGRAMS_PER_BATCH];
+    HifiSockAddr* senderSockAddrs[MAX_DATAGRAMS_PER_BATCH];
+    for (int i = 0; i < MAX_DATAGRAMS_PER_BATCH; i++) {
+        buffers[i] = _buffers.data() + i * _bufferSize;
+        senderSockAddrs[i] = &_sockAddrs[i];
+    }
+    
+    _numDatagrams = receiveInto(socket, MAX_DATAGRAMS_PER_BATCH, buffers, _bufferSize, _sizes, senderSockAddrs);
+    return _numDatagrams;
+}
@@ -0,0 +1,59 @@
+//
+//  DatagramBatch.h
+//  libraries/networking/src
+//
+//  Created on 4/18/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_DatagramBatch_h
+#define hifi_DatagramBatch_h
+
+#include <QtCore/QVector>
+#include <QtNetwork/QUdpSocket>
+
+#include "HifiSockAddr.h"
+
+const int MAX_DATAGRAMS_PER_BATCH = 64;
+
+/// Datagrams sent or received together, with a single sendmmsg or recvmmsg system call on Linux and one call per
+/// datagram elsewhere. The buffers are allocated once, so filling and sending a batch doesn't allocate.
+class DatagramBatch {
+public:
+    DatagramBatch();
+
+    int getNumDatagrams() const { return _numDatagrams; }
+    bool isFull() const { return _numDatagrams == MAX_DATAGRAMS_PER_BATCH; }
+    void clear() { _numDatagrams = 0; }
+
+    const char* getData(int index) const { return _buffers.constData() + index * _bufferSize; }
+    int getSize(int index) const { return _sizes[index]; }
+    const HifiSockAddr& getSockAddr(int index) const { return _sockAddrs[index]; }
+
+    /// copies a datagram into the batch, to be sent to sockAddr with the rest of it, the batch must not be full
+    void append(const char* data, int size, const HifiSockAddr& sockAddr);
+
+    /// sends every datagram in the batch and clears it, returns the number of system calls it took
+    int send(QUdpSocket& socket);
+
+    /// replaces what is in the batch with as many of the waiting datagrams as fit, returns how many that was
+    int receive(QUdpSocket& socket);
+
+    /// Reads up to numDatagrams waiting datagrams into buffers of bufferSize bytes. On Linux the first is read through
+    /// the QUdpSocket, so that it keeps notifying us, and the rest with a single recvmmsg. Returns the number read, and
+    /// sets the size and sender of each. Datagrams too large for their buffer are dropped.
+    static int receiveInto(QUdpSocket& socket, int numDatagrams, char* const* buffers, int bufferSize,
+                           int* sizes, HifiSockAddr* const* senderSockAddrs);
+
+private:
+    int _bufferSize;
+    int _numDatagrams;
+    QVector<char> _buffers;
+    int _sizes[MAX_DATAGRAMS_PER_BATCH];
+    HifiSockAddr _sockAddrs[MAX_DATAGRAMS_PER_BATCH];
+};
+
+#endif // hifi_DatagramBatch_h
@@ -16,6 +16,7 @@
 #include <QtCore/QDataStream>
 #include <QtCore/QDebug>
 #include <QtCore/QJsonDocument>
+#include <QtCore/QThreadStorage>
 #include <QtCore/QUrl>
 #include <QtNetwork/QHostInfo>
 
@@ -25,6 +26,7 @@
 
 #include "AccountManager.h"
 #include "Assignment.h"
+#include "DatagramBatch.h"
 #include "HifiSockAddr.h"
 #include "LimitedNodeList.h"
 #include "PacketHeaders.h"
@@ -40,7 +42,9 @@ const char SOLO_NODE_TYPES[2] = {
 LimitedNodeList::LimitedNodeList(unsigned short socketListenPort, unsigned short dtlsListenPort) :
     linkedDataCreateCallback(NULL),
     _sessionUUID(),
+    _sessionLocalID(NULL_LOCAL_NODE_ID),
     _nodeHash(),
+    _localIDNodes(),
     _nodeMutex(QReadWriteLock::Recursive),
     _nodeSocket(this),
     _dtlsSocket(NULL),
@@ -162,7 +166,7 @@ bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
     PacketType checkType = packetTypeForPacket(packet);
     int numPacketTypeBytes = numBytesArithmeticCodingFromBuffer(packet.data());
     
-    if (packet[numPacketTypeBytes] != versionForPacketType(checkType)
+    if (!isAcceptedVersionForPacketType(checkType, packet[numPacketTypeBytes])
         && checkType != PacketTypeStunResponse) {
         PacketType mismatchType = packetTypeForPacket(packet);
         
@@ -186,8 +190,14 @@ bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
         // figure out which node this is from
         SharedNodePointer sendingNode = sendingNodeForPacket(packet);
         if (sendingNode) {
-            // check if the md5 hash in the header matches the hash we would expect
-            if (hashFromPacketHeader(packet) == hashForPacketAndConnectionUUID(packet, sendingNode->getConnectionSecret())) {
+            // check if the hash in the header matches the hash we would expect
+            if (packet.size() >= numBytesForPacketHeader(packet)
+                && packetHashMatchesConnectionUUID(packet.constData(), packet.size(), sendingNode->getConnectionSecret())) {
+                PacketHashMode packetHashMode = hashModeForPacket(packet.constData());
+                if (sendingNode->getPacketHashMode() < packetHashMode) {
+                    // a verified packet in a better mode is as good as being told the node can handle that mode too
+                    sendingNode->setPacketHashMode(packetHashMode);
+                }
                 return true;
             } else {
                 static QMultiMap<QUuid, PacketType> hashDebugSuppressMap;
@@ -229,21 +239,110 @@ qint64 LimitedNodeList::readDatagram(QByteArray& incomingPacket, QHostAddress* a
     return result;
 }
 
+// each sending thread stamps hashes into its own copy of const datagrams, kept between sends
+static QThreadStorage<QByteArray> scratchDatagrams;
+
 qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr,
-                                      const QUuid& connectionSecret) {
-    QByteArray datagramCopy = datagram;
-    
-    if (!connectionSecret.isNull()) {
-        // setup the MD5 hash for source verification in the header
-        replaceHashInPacketGivenConnectionUUID(datagramCopy, connectionSecret);
+                                      const QUuid& connectionSecret, PacketHashMode peerHashMode) {
+    return writeDatagram(datagram.constData(), datagram.size(), destinationSockAddr, connectionSecret, peerHashMode);
+}
+
+qint64 LimitedNodeList::writeDatagram(const char* data, qint64 size, const HifiSockAddr& destinationSockAddr,
+                                      const QUuid& connectionSecret, PacketHashMode peerHashMode) {
+    if (connectionSecret.isNull()) {
+        // nothing to stamp, the caller's data can go out as is
+        return writeDatagramToSocket(data, size, destinationSockAddr);
+    }
+
+    QByteArray& scratchDatagram = scratchDatagrams.localData();
+    if (scratchDatagram.size() < size) {
+        scratchDatagram.resize(qMax((int)size, MAX_PACKET_SIZE));
+    }
+    memcpy(scratchDatagram.data(), data, size);
+
+    return writeDatagramInPlace(scratchDatagram.data(), size, destinationSockAddr, connectionSecret, peerHashMode);
+}
+
+qint64 LimitedNodeList::writeDatagramInPlace(char* data, qint64 size, const HifiSockAddr& destinationSockAddr,
+                                             const QUuid& connectionSecret, PacketHashMode peerHashMode) {
+    if (connectionSecret.isNull()) {
+        return writeDatagramToSocket(data, size, destinationSockAddr);
+    }
+
+    // the version tells the peer which hash to check, so pick it before setting up the hash in the header
+    setVersionForPeerHashMode(data, peerHashMode);
+
+    if (peerHashMode >= PacketHashModeCompactSipHash && _sessionLocalID != NULL_LOCAL_NODE_ID
+        && compactHeaderVersionForPacketType(packetTypeForPacket(data)) > 0) {
+        char sessionUUID[NUM_BYTES_RFC4122_UUID];
+        uuidToRfc4122(_sessionUUID, sessionUUID);
+
+        // only a header naming us can name us by our local ID instead
+        int numBytesFullHeader = numBytesForPacketHeader(data);
+        if (memcmp(data + numBytesArithmeticCodingFromBuffer(data) + sizeof(PacketVersion), sessionUUID,
+                   NUM_BYTES_RFC4122_UUID) == 0) {
+            // callers can send the same buffer on to other nodes, so the full header goes back once this one is sent
+            char fullHeader[MAX_PACKET_HEADER_BYTES];
+            memcpy(fullHeader, data, numBytesFullHeader);
+
+            int offset = compactPacketHeader(data, _sessionLocalID);
+            replaceHashInPacketGivenConnectionUUID(data + offset, size - offset, connectionSecret);
+            qint64 bytesWritten = writeDatagramToSocket(data + offset, size - offset, destinationSockAddr);
+
+            memcpy(data, fullHeader, numBytesFullHeader);
+            return bytesWritten;
+        }
     }
+
+    replaceHashInPacketGivenConnectionUUID(data, size, connectionSecret);
+    return writeDatagramToSocket(data, size, destinationSockAddr);
+}
+
+// the sends queued by each thread between beginBatchedSends() and flushBatchedSends()
+struct ThreadSendBatch {
+    ThreadSendBatch() : isBatching(false), batch() { }
     
+    bool isBatching;
+    DatagramBatch batch;
+};
+
+static QThreadStorage<ThreadSendBatch*> threadSendBatches;
+
+void LimitedNodeList::beginBatchedSends() {
+    if (!threadSendBatches.hasLocalData()) {
+        threadSendBatches.setLocalData(new ThreadSendBatch());
+    }
+    threadSendBatches.localData()->isBatching = true;
+}
+
+void LimitedNodeList::flushBatchedSends() {
+    if (threadSendBatches.hasLocalData()) {
+        ThreadSendBatch* threadSendBatch = threadSendBatches.localData();
+        _numSendSystemCalls.fetchAndAddRelaxed(threadSendBatch->batch.send(_nodeSocket));
+        threadSendBatch->isBatching = false;
+    }
+}
+
+qint64 LimitedNodeList::writeDatagramToSocket(const char* data, qint64 size, const HifiSockAddr& destinationSockAddr) {
     // XXX can BandwidthRecorder be used for this?
     // stat collection for packets
     ++_numCollectedPackets;
-    _numCollectedBytes += datagram.size();
+    _numCollectedBytes += size;
     
-    qint64 bytesWritten = _nodeSocket.writeDatagram(datagramCopy,
+    if (threadSendBatches.hasLocalData() && threadSendBatches.localData()->isBatching) {
+        DatagramBatch& batch = threadSendBatches.localData()->batch;
+        if (batch.isFull()) {
+            _numSendSystemCalls.fetchAndAddRelaxed(batch.send(_nodeSocket));
+        }
+        
+        // the copy means the caller can reuse its buffer right away, as it could after a real send
+        batch.append(data, size, destinationSockAddr);
+        return size;
+    }
+    
+    _numSendSystemCalls.fetchAndAddRelaxed(1);
+    
+    qint64 bytesWritten = _nodeSocket.writeDatagram(data, size,
                                                     destinationSockAddr.getAddress(), destinationSockAddr.getPort());
     
     if (bytesWritten < 0) {
@@ -253,24 +352,43 @@ qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const HifiSock
     return bytesWritten;
 }
 
+const HifiSockAddr* LimitedNodeList::destinationSockAddrForNode(const SharedNodePointer& destinationNode,
+                                                                const HifiSockAddr& overridenSockAddr) {
+    // if we don't have an overridden address, assume they want to send to the node's active socket
+    if (overridenSockAddr.isNull()) {
+        // NULL if we don't have a socket to send to
+        return destinationNode->getActiveSocket();
+    }
+    return &overridenSockAddr;
+}
+
 qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram,
                                       const SharedNodePointer& destinationNode,
                                       const HifiSockAddr& overridenSockAddr) {
+    return writeDatagram(datagram.constData(), datagram.size(), destinationNode, overridenSockAddr);
+}
+
+qint64 LimitedNodeList::writeUnverifiedDatagram(const QByteArray& datagram, const SharedNodePointer& destinationNode,
+                               const HifiSockAddr& overridenSockAddr) {
+    return writeUnverifiedDatagram(datagram.constData(), datagram.size(), destinationNode, overridenSockAddr);
+}
+
+qint64 LimitedNodeList::writeUnverifiedDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr) {
+    return writeDatagram(datagram, destinationSockAddr, QUuid());
+}
+
+qint64 LimitedNodeList::writeDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
+                               const HifiSockAddr& overridenSockAddr) {
     if (destinationNode) {
-        // if we don't have an overridden address, assume they want to send to the node's active socket
-        const HifiSockAddr* destinationSockAddr = &overridenSockAddr;
-        if (overridenSockAddr.isNull()) {
-            if (destinationNode->getActiveSocket()) {
-                // use the node's active socket as the destination socket
-                destinationSockAddr = destinationNode->getActiveSocket();
-            } else {
-                // we don't have a socket to send to, return 0
-                return 0;
-            }
+        const HifiSockAddr* destinationSockAddr = destinationSockAddrForNode(destinationNode, overridenSockAddr);
+        if (!destinationSockAddr) {
+            // we don't have a socket to send to, return 0
+            return 0;
         }
 
-        emit dataSent(destinationNode->getType(), datagram.size());
-        auto bytesWritten = writeDatagram(datagram, *destinationSockAddr, destinationNode->getConnectionSecret());
+        emit dataSent(destinationNode->getType(), size);
+        auto bytesWritten = writeDatagram(data, size, *destinationSockAddr, destinationNode->getConnectionSecret(),
+                                          destinationNode->getPacketHashMode());
         // Keep track of per-destination-node bandwidth
         destinationNode->recordBytesSent(bytesWritten);
         return bytesWritten;
@@ -280,41 +398,47 @@ qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram,
     return 0;
 }
 
-qint64 LimitedNodeList::writeUnverifiedDatagram(const QByteArray& datagram, const SharedNodePointer& destinationNode,
+qint64 LimitedNodeList::writeUnverifiedDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
                                const HifiSockAddr& overridenSockAddr) {
     if (destinationNode) {
-        // if we don't have an ovveriden address, assume they want to send to the node's active socket
-        const HifiSockAddr* destinationSockAddr = &overridenSockAddr;
-        if (overridenSockAddr.isNull()) {
-            if (destinationNode->getActiveSocket()) {
-                // use the node's active socket as the destination socket
-                destinationSockAddr = destinationNode->getActiveSocket();
-            } else {
-                // we don't have a socket to send to, return 0
-                return 0;
-            }
+        const HifiSockAddr* destinationSockAddr = destinationSockAddrForNode(destinationNode, overridenSockAddr);
+        if (!destinationSockAddr) {
+            // we don't have a socket to send to, return 0
+            return 0;
         }
-        
+
         // don't use the node secret!
-        return writeDatagram(datagram, *destinationSockAddr, QUuid());
+        return writeDatagram(data, size, *destinationSockAddr, QUuid());
     }
     
     // didn't have a destinationNode to send to, return 0
     return 0;
 }
 
-qint64 LimitedNodeList::writeUnverifiedDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr) {
-    return writeDatagram(datagram, destinationSockAddr, QUuid());
-}
+qint64 LimitedNodeList::writeDatagramInPlace(char* data, qint64 size, const SharedNodePointer& destinationNode,
+                                             const HifiSockAddr& overridenSockAddr) {
+    if (destinationNode) {
+        const HifiSockAddr* destinationSockAddr = destinationSockAddrForNode(destinationNode, overridenSockAddr);
+        if (!destinationSockAddr) {
+            // we don't have a socket to send to, return 0
+            return 0;
+        }
 
-qint64 LimitedNodeList::writeDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
-                               const HifiSockAddr& overridenSockAddr) {
-    return writeDatagram(QByteArray(data, size), destinationNode, overridenSockAddr);
+        emit dataSent(destinationNode->getType(), size);
+        auto bytesWritten = writeDatagramInPlace(data, size, *destinationSockAddr, destinationNode->getConnectionSecret(),
+                                                 destinationNode->getPacketHashMode());
+        // Keep track of per-destination-node bandwidth
+        destinationNode->recordBytesSent(bytesWritten);
+        return bytesWritten;
+    }
+    
+    // didn't have a destinationNode to send to, return 0
+    return 0;
 }
 
-qint64 LimitedNodeList::writeUnverifiedDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
-                               const HifiSockAddr& overridenSockAddr) {
-    return writeUnverifiedDatagram(QByteArray(data, size), destinationNode, overridenSockAddr);
+qint64 LimitedNodeList::writeDatagramInPlace(QByteArray& datagram, const SharedNodePointer& destinationNode,
+                                             const HifiSockAddr& overridenSockAddr) {
+    return writeDatagramInPlace(datagram.data(), datagram.size(), destinationNode, overridenSockAddr);
 }
 
 void LimitedNodeList::processNodeData(const HifiSockAddr& senderSockAddr, const QByteArray& packet) {
@@ -362,12 +486,45 @@ SharedNodePointer LimitedNodeList::nodeWithUUID(const QUuid& nodeUUID) {
  }
 
 SharedNodePointer LimitedNodeList::sendingNodeForPacket(const QByteArray& packet) {
+    if (hasCompactHeader(packet.constData())) {
+        return nodeWithLocalID(localIDFromPacketHeader(packet.constData()));
+    }
+
     QUuid nodeUUID = uuidFromPacketHeader(packet);
     
     // return the matching node, or NULL if there is no match
     return nodeWithUUID(nodeUUID);
 }
 
+SharedNodePointer LimitedNodeList::nodeWithLocalID(LocalNodeID localID) {
+    QReadLocker readLocker(&_nodeMutex);
+    
+    return localID == NULL_LOCAL_NODE_ID ? SharedNodePointer() : _localIDNodes.value(localID);
+}
+
+void LimitedNodeList::setLocalIDForNode(const SharedNodePointer& node, LocalNodeID localID) {
+    QWriteLocker writeLocker(&_nodeMutex);
+    
+    removeLocalIDForNode(node);
+    node->setLocalID(localID);
+    
+    if (localID != NULL_LOCAL_NODE_ID) {
+        // the domain-server hands out the lowest free IDs, so this stays about as big as the node hash
+        if (localID >= _localIDNodes.size()) {
+            _localIDNodes.resize(localID + 1);
+        }
+        _localIDNodes[localID] = node;
+    }
+}
+
+void LimitedNodeList::removeLocalIDForNode(const SharedNodePointer& node) {
+    // the ID may have been handed to another node since, only clear it if it's still this one's
+    LocalNodeID localID = node->getLocalID();
+    if (localID != NULL_LOCAL_NODE_ID && localID < _localIDNodes.size() && _localIDNodes[localID] == node) {
+        _localIDNodes[localID].clear();
+    }
+}
+
 void LimitedNodeList::eraseAllNodes() {
     qCDebug(networking) << "Clearing the NodeList. Deleting all nodes in list.";
     
@@ -379,6 +536,7 @@ void LimitedNodeList::eraseAllNodes() {
     // iterate the current nodes, emit that they are dying and remove them from the hash
     _nodeMutex.lockForWrite();
     _nodeHash.clear();
+    _localIDNodes.clear();
     _nodeMutex.unlock();
     
     foreach(const SharedNodePointer& killedNode, killedNodes) {
@@ -401,6 +559,7 @@ void LimitedNodeList::killNodeWithUUID(const QUuid& nodeUUID) {
         
         _nodeMutex.lockForWrite();
         _nodeHash.unsafe_erase(it);
+        removeLocalIDForNode(matchingNode);
         _nodeMutex.unlock();
         
         handleNodeKill(matchingNode);
@@ -472,6 +631,7 @@ QByteArray LimitedNodeList::constructPingPacket(PingType_t pingType, bool isVeri
     
     packetStream << pingType;
     packetStream << usecTimestampNow();
+    packetStream << (quint8) BEST_PACKET_HASH_MODE;
     
     return pingPacket;
 }
@@ -493,24 +653,42 @@ QByteArray LimitedNodeList::constructPingReplyPacket(const QByteArray& pingPacke
     QDataStream packetStream(&replyPacket, QIODevice::Append);
     
     packetStream << typeFromOriginalPing << timeFromOriginalPing << usecTimestampNow();
+    packetStream << (quint8) BEST_PACKET_HASH_MODE;
     
     return replyPacket;
 }
 
+void LimitedNodeList::updatePacketHashModeFromPing(const QByteArray& pingPacket, const SharedNodePointer& sendingNode) {
+    int hashModeOffset = numBytesForPacketHeader(pingPacket) + sizeof(PingType_t) + sizeof(quint64);
+    if (packetTypeForPacket(pingPacket) == PacketTypePingReply) {
+        // replies carry our original timestamp and theirs
+        hashModeOffset += sizeof(quint64);
+    }
+
+    PacketHashMode peerHashMode = PacketHashModeMD5;
+    if (pingPacket.size() > hashModeOffset) {
+        // a newer peer may know modes we don't, use the best one we both have
+        peerHashMode = (PacketHashMode) qMin((int) (quint8) pingPacket[hashModeOffset], (int) BEST_PACKET_HASH_MODE);
+    }
+    sendingNode->setPacketHashMode(peerHashMode);
+}
+
 SharedNodePointer LimitedNodeList::soloNodeOfType(char nodeType) {
     return nodeMatchingPredicate([&](const SharedNodePointer& node){
         return node->getType() == nodeType;
     });
 }
 
-void LimitedNodeList::getPacketStats(float& packetsPerSecond, float& bytesPerSecond) {
+void LimitedNodeList::getPacketStats(float& packetsPerSecond, float& bytesPerSecond, float& sendSystemCallsPerSecond) {
     packetsPerSecond = (float) _numCollectedPackets / ((float) _packetStatTimer.elapsed() / 1000.0f);
     bytesPerSecond = (float) _numCollectedBytes / ((float) _packetStatTimer.elapsed() / 1000.0f);
+    sendSystemCallsPerSecond = (float) _numSendSystemCalls.load() / ((float) _packetStatTimer.elapsed() / 1000.0f);
 }
 
 void LimitedNodeList::resetPacketStats() {
     _numCollectedPackets = 0;
     _numCollectedBytes = 0;
+    _numSendSystemCalls.store(0);
     _packetStatTimer.restart();
 }
 
@@ -525,6 +703,7 @@ void LimitedNodeList::removeSilentNodes() {
         if ((usecTimestampNow() - node->getLastHeardMicrostamp()) > (NODE_SILENCE_THRESHOLD_MSECS * USECS_PER_MSEC)) {
             // call the NodeHash erase to get rid of this node
             it = _nodeHash.unsafe_erase(it);
+            removeLocalIDForNode(node);
             
             killedNodes.insert(node);
         } else {
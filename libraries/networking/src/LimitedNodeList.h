@@ -20,10 +20,12 @@
 #include <unistd.h> // not on windows, not needed for mac or windows
 #endif
 
+#include <qatomic.h>
 #include <qelapsedtimer.h>
 #include <qreadwritelock.h>
 #include <qset.h>
 #include <qsharedpointer.h>
+#include <qvector.h>
 #include <QtNetwork/qudpsocket.h>
 #include <QtNetwork/qhostaddress.h>
 #include <QSharedMemory>
@@ -82,6 +84,10 @@ public:
     const QUuid& getSessionUUID() const { return _sessionUUID; }
     void setSessionUUID(const QUuid& sessionUUID);
 
+    /// the ID the domain server gave us, while we have one peers that can handle it get packets with compact headers
+    LocalNodeID getSessionLocalID() const { return _sessionLocalID; }
+    void setSessionLocalID(LocalNodeID sessionLocalID) { _sessionLocalID = sessionLocalID; }
+
     bool getThisNodeCanAdjustLocks() const { return _thisNodeCanAdjustLocks; }
     void setThisNodeCanAdjustLocks(bool canAdjustLocks);
 
@@ -109,12 +115,29 @@ public:
     qint64 writeUnverifiedDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
                          const HifiSockAddr& overridenSockAddr = HifiSockAddr());
 
+    /// Sends a datagram from a buffer the caller owns, stamping the verification hash straight into its header.
+    /// Unlike writeDatagram this neither copies nor allocates, so it is the one to use for packets sent every frame.
+    qint64 writeDatagramInPlace(char* data, qint64 size, const SharedNodePointer& destinationNode,
+                                const HifiSockAddr& overridenSockAddr = HifiSockAddr());
+    qint64 writeDatagramInPlace(QByteArray& datagram, const SharedNodePointer& destinationNode,
+                                const HifiSockAddr& overridenSockAddr = HifiSockAddr());
+
+    /// Until flushBatchedSends() is called, datagrams written from the calling thread are queued rather than sent, and
+    /// then go out together with as few system calls as the platform allows (sendmmsg on Linux). For threads that send
+    /// a lot at once, like a mixer at the end of its frame. Other threads keep sending right away.
+    void beginBatchedSends();
+    void flushBatchedSends();
+
     void(*linkedDataCreateCallback)(Node *);
     
     int size() const { return _nodeHash.size(); }
 
     SharedNodePointer nodeWithUUID(const QUuid& nodeUUID);
     SharedNodePointer sendingNodeForPacket(const QByteArray& packet);
+
+    /// a lookup in an array indexed by local ID, cheaper than the UUID hash for the packets that have compact headers
+    SharedNodePointer nodeWithLocalID(LocalNodeID localID);
+    void setLocalIDForNode(const SharedNodePointer& node, LocalNodeID localID);
     
     SharedNodePointer addOrUpdateNode(const QUuid& uuid, NodeType_t nodeType,
                                       const HifiSockAddr& publicSocket, const HifiSockAddr& localSocket,
@@ -132,7 +155,7 @@ public:
     unsigned broadcastToNodes(const QByteArray& packet, const NodeSet& destinationNodeTypes);
     SharedNodePointer soloNodeOfType(char nodeType);
 
-    void getPacketStats(float &packetsPerSecond, float &bytesPerSecond);
+    void getPacketStats(float &packetsPerSecond, float &bytesPerSecond, float &sendSystemCallsPerSecond);
     void resetPacketStats();
     
     QByteArray constructPingPacket(PingType_t pingType = PingType::Agnostic, bool isVerified = true,
@@ -223,14 +246,31 @@ protected:
     void operator=(LimitedNodeList const&); // Don't implement, needed to avoid copies of singleton
     
     qint64 writeDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr,
-                         const QUuid& connectionSecret);
+                         const QUuid& connectionSecret, PacketHashMode peerHashMode = PacketHashModeMD5);
+    qint64 writeDatagram(const char* data, qint64 size, const HifiSockAddr& destinationSockAddr,
+                         const QUuid& connectionSecret, PacketHashMode peerHashMode = PacketHashModeMD5);
+    qint64 writeDatagramInPlace(char* data, qint64 size, const HifiSockAddr& destinationSockAddr,
+                                const QUuid& connectionSecret, PacketHashMode peerHashMode = PacketHashModeMD5);
+    qint64 writeDatagramToSocket(const char* data, qint64 size, const HifiSockAddr& destinationSockAddr);
+
+    const HifiSockAddr* destinationSockAddrForNode(const SharedNodePointer& destinationNode,
+                                                   const HifiSockAddr& overridenSockAddr);
     
+    /// Pings and ping replies end with the best hash mode their sender can verify, which old peers don't send and
+    /// ignore. This reads it so that packets to the node use that mode.
+    void updatePacketHashModeFromPing(const QByteArray& pingPacket, const SharedNodePointer& sendingNode);
+
     void changeSocketBufferSizes(int numBytes);
     
     void handleNodeKill(const SharedNodePointer& node);
 
+    /// takes a node that is leaving the node hash out of the local ID array too, the node mutex must be locked for write
+    void removeLocalIDForNode(const SharedNodePointer& node);
+
     QUuid _sessionUUID;
+    LocalNodeID _sessionLocalID;
     NodeHash _nodeHash;
+    QVector<SharedNodePointer> _localIDNodes;
     QReadWriteLock _nodeMutex;
     QUdpSocket _nodeSocket;
     QUdpSocket* _dtlsSocket;
@@ -241,6 +281,7 @@ protected:
     // XXX can BandwidthRecorder be used for this?
     int _numCollectedPackets;
     int _numCollectedBytes;
+    QAtomicInt _numSendSystemCalls;
 
     QElapsedTimer _packetStatTimer;
     bool _thisNodeCanAdjustLocks;
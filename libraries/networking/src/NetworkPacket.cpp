@@ -11,6 +11,8 @@
 
 #include <cassert>
 #include <cstring>
+#include <utility>
+
 #include <QtDebug>
 
 #include "SharedUtil.h"
@@ -41,15 +43,16 @@ NetworkPacket& NetworkPacket::operator=(NetworkPacket const& other) {
     return *this;
 }
 
-#ifdef HAS_MOVE_SEMANTICS
-// move, same as copy, but other packet won't be used further
-NetworkPacket::NetworkPacket(NetworkPacket && packet) {
-    copyContents(packet.getNode(), packet.getByteArray());
+// move, the other packet won't be used further so its node and data are taken rather than shared
+NetworkPacket::NetworkPacket(NetworkPacket&& packet) {
+    _node.swap(packet._node);
+    _byteArray.swap(packet._byteArray);
 }
 
-// move assignment
+// move assignment, what we had goes with the temporary so that the other packet is left empty
 NetworkPacket& NetworkPacket::operator=(NetworkPacket&& other) {
-    copyContents(other.getNode(), other.getByteArray());
+    NetworkPacket moved(std::move(other));
+    _node.swap(moved._node);
+    _byteArray.swap(moved._byteArray);
     return *this;
 }
-#endif
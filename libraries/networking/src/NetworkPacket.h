@@ -23,10 +23,8 @@ public:
     NetworkPacket(const NetworkPacket& packet); // copy constructor
     NetworkPacket& operator= (const NetworkPacket& other);    // copy assignment
 
-#ifdef HAS_MOVE_SEMANTICS
-    NetworkPacket(NetworkPacket&& packet); // move?? // same as copy, but other packet won't be used further
+    NetworkPacket(NetworkPacket&& packet); // takes the node and data, the other packet is left empty
     NetworkPacket& operator= (NetworkPacket&& other);         // move assignment
-#endif
 
     NetworkPacket(const SharedNodePointer& node, const QByteArray& byteArray);
 
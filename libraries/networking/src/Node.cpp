@@ -48,8 +48,11 @@ Node::Node(const QUuid& uuid, NodeType_t type, const HifiSockAddr& publicSocket,
     _activeSocket(NULL),
     _symmetricSocket(),
     _connectionSecret(),
+    _localID(NULL_LOCAL_NODE_ID),
+    _packetHashMode(PacketHashModeMD5),
     _linkedData(NULL),
     _isAlive(true),
+    _numPacketsToProcess(0),
     _pingMs(-1),  // "Uninitialized"
     _clockSkewUsec(0),
     _mutex(),
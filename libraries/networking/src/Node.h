@@ -15,6 +15,7 @@
 #include <ostream>
 #include <stdint.h>
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QDebug>
 #include <QtCore/QMutex>
 #include <QtCore/QUuid>
@@ -23,6 +24,7 @@
 #include "HifiSockAddr.h"
 #include "NetworkPeer.h"
 #include "NodeData.h"
+#include "PacketHeaders.h"
 #include "SimpleMovingAverage.h"
 #include "MovingPercentile.h"
 
@@ -57,12 +59,24 @@ public:
     const QUuid& getConnectionSecret() const { return _connectionSecret; }
     void setConnectionSecret(const QUuid& connectionSecret) { _connectionSecret = connectionSecret; }
 
+    /// the ID the domain server gave this node, set it through LimitedNodeList::setLocalIDForNode() so lookups see it
+    LocalNodeID getLocalID() const { return _localID; }
+    void setLocalID(LocalNodeID localID) { _localID = localID; }
+
+    /// the best hash mode this node has told us it can verify, MD5 until we hear otherwise
+    PacketHashMode getPacketHashMode() const { return _packetHashMode; }
+    void setPacketHashMode(PacketHashMode packetHashMode) { _packetHashMode = packetHashMode; }
+
     NodeData* getLinkedData() const { return _linkedData; }
     void setLinkedData(NodeData* linkedData) { _linkedData = linkedData; }
 
     bool isAlive() const { return _isAlive; }
     void setAlive(bool isAlive) { _isAlive = isAlive; }
 
+    /// packets from this node that a ReceivedPacketProcessor has queued and not processed yet
+    int getNumPacketsToProcess() const { return _numPacketsToProcess.load(); }
+    void addPacketsToProcess(int numPackets) { _numPacketsToProcess.fetchAndAddRelaxed(numPackets); }
+
     int getPingMs() const { return _pingMs; }
     void setPingMs(int pingMs) { _pingMs = pingMs; }
 
@@ -101,8 +115,11 @@ private:
     HifiSockAddr _symmetricSocket;
     
     QUuid _connectionSecret;
+    LocalNodeID _localID;
+    PacketHashMode _packetHashMode;
     NodeData* _linkedData;
     bool _isAlive;
+    QAtomicInt _numPacketsToProcess;
     int _pingMs;
     int _clockSkewUsec;
     QMutex _mutex;
@@ -134,6 +134,7 @@ void NodeList::processNodeData(const HifiSockAddr& senderSockAddr, const QByteAr
             SharedNodePointer matchingNode = sendingNodeForPacket(packet);
             if (matchingNode) {
                 matchingNode->setLastHeardMicrostamp(usecTimestampNow());
+                updatePacketHashModeFromPing(packet, matchingNode);
                 QByteArray replyPacket = constructPingReplyPacket(packet);
                 writeDatagram(replyPacket, matchingNode, senderSockAddr);
                 
@@ -154,6 +155,7 @@ void NodeList::processNodeData(const HifiSockAddr& senderSockAddr, const QByteAr
             
             if (sendingNode) {
                 sendingNode->setLastHeardMicrostamp(usecTimestampNow());
+                updatePacketHashModeFromPing(packet, sendingNode);
                 
                 // activate the appropriate socket for this node, if not yet updated
                 activateSocketFromNodeCommunication(packet, sendingNode);
@@ -203,6 +205,7 @@ void NodeList::reset() {
 
     // refresh the owner UUID to the NULL UUID
     setSessionUUID(QUuid());
+    setSessionLocalID(NULL_LOCAL_NODE_ID);
     
     if (sender() != &_domainHandler) {
         // clear the domain connection information, unless they're the ones that asked us to reset
@@ -411,6 +414,10 @@ int NodeList::processDomainServerList(const QByteArray& packet) {
     bool thisNodeCanRez;
     packetStream >> thisNodeCanRez;
     setThisNodeCanRez(thisNodeCanRez);
+
+    LocalNodeID newLocalID;
+    packetStream >> newLocalID;
+    setSessionLocalID(newLocalID);
     
     // pull each node in the packet
     while(packetStream.device()->pos() < packet.size()) {
@@ -434,6 +441,10 @@ int NodeList::processDomainServerList(const QByteArray& packet) {
         
         packetStream >> connectionUUID;
         node->setConnectionSecret(connectionUUID);
+
+        LocalNodeID localID;
+        packetStream >> localID;
+        setLocalIDForNode(node, localID);
     }
     
     // ping inactive nodes in conjunction with receipt of list from domain-server
@@ -11,9 +11,12 @@
 
 #include <math.h>
 
+#include <openssl/md5.h>
+
 #include <QtCore/QDebug>
 
 #include "NodeList.h"
+#include "SipHash.h"
 
 #include "PacketHeaders.h"
 
@@ -49,22 +52,24 @@ PacketVersion versionForPacketType(PacketType type) {
     switch (type) {
         case PacketTypeMicrophoneAudioNoEcho:
         case PacketTypeMicrophoneAudioWithEcho:
-            return 2;
-        case PacketTypeSilentAudioFrame:
             return 4;
+        case PacketTypeSilentAudioFrame:
+            return 6;
         case PacketTypeMixedAudio:
-            return 1;
+            return 3;
         case PacketTypeInjectAudio:
-            return 1;
+            return 3;
         case PacketTypeAvatarData:
-            return 5;
+            return 7;
+        case PacketTypeBulkAvatarData:
+            return 2;
         case PacketTypeAvatarIdentity:
             return 1;
         case PacketTypeEnvironmentData:
             return 2;
         case PacketTypeDomainList:
         case PacketTypeDomainListRequest:
-            return 5;
+            return 6;
         case PacketTypeCreateAssignment:
         case PacketTypeRequestAssignment:
             return 2;
@@ -78,12 +83,107 @@ PacketVersion versionForPacketType(PacketType type) {
         case PacketTypeEntityErase:
             return 2;
         case PacketTypeAudioStreamStats:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+PacketVersion sipHashVersionForPacketType(PacketType type) {
+    // the types the mixers send and receive every frame, where the cost of MD5 shows
+    switch (type) {
+        case PacketTypeMicrophoneAudioNoEcho:
+        case PacketTypeMicrophoneAudioWithEcho:
+            return 3;
+        case PacketTypeSilentAudioFrame:
+            return 5;
+        case PacketTypeMixedAudio:
+            return 2;
+        case PacketTypeInjectAudio:
+            return 2;
+        case PacketTypeAvatarData:
+            return 6;
+        case PacketTypeBulkAvatarData:
             return 1;
+        case PacketTypeAudioStreamStats:
+            return 2;
         default:
             return 0;
     }
 }
 
+PacketVersion compactHeaderVersionForPacketType(PacketType type) {
+    PacketVersion sipHashVersion = sipHashVersionForPacketType(type);
+    return sipHashVersion > 0 ? sipHashVersion + 1 : 0;
+}
+
+bool isAcceptedVersionForPacketType(PacketType type, PacketVersion version) {
+    if (version == versionForPacketType(type)) {
+        return true;
+    }
+
+    // old peers can keep sending the MD5 and full header SipHash versions until the type changes in some other way
+    PacketVersion sipHashVersion = sipHashVersionForPacketType(type);
+    return sipHashVersion > 0 && versionForPacketType(type) == compactHeaderVersionForPacketType(type)
+        && version >= sipHashVersion - 1 && version <= sipHashVersion;
+}
+
+PacketHashMode hashModeForPacket(const char* packet) {
+    PacketVersion sipHashVersion = sipHashVersionForPacketType(packetTypeForPacket(packet));
+    if (sipHashVersion == 0) {
+        return PacketHashModeMD5;
+    }
+
+    PacketVersion version = packet[numBytesArithmeticCodingFromBuffer(packet)];
+    if (version > sipHashVersion) {
+        return PacketHashModeCompactSipHash;
+    } else if (version == sipHashVersion) {
+        return PacketHashModeSipHash;
+    } else {
+        return PacketHashModeMD5;
+    }
+}
+
+void setVersionForPeerHashMode(char* packet, PacketHashMode peerHashMode) {
+    PacketVersion sipHashVersion = sipHashVersionForPacketType(packetTypeForPacket(packet));
+    if (sipHashVersion > 0) {
+        PacketVersion& version = packet[numBytesArithmeticCodingFromBuffer(packet)];
+        if (peerHashMode >= PacketHashModeSipHash) {
+            version = sipHashVersion;
+        } else {
+            version = sipHashVersion - 1;
+        }
+    }
+}
+
+bool hasCompactHeader(const char* packet) {
+    return hashModeForPacket(packet) == PacketHashModeCompactSipHash;
+}
+
+int compactPacketHeader(char* packet, LocalNodeID senderLocalID) {
+    PacketType type = packetTypeForPacket(packet);
+    int numTypeBytes = numBytesArithmeticCodingFromBuffer(packet);
+    int offset = numBytesForPacketHeader(packet) - numTypeBytes - NUM_COMPACT_HEADER_BYTES_AFTER_TYPE;
+
+    // the compact header only overlaps the UUID and hash of the full one, which the new hash replaces anyway
+    char* compactPacket = packet + offset;
+    compactPacket[numTypeBytes] = compactHeaderVersionForPacketType(type);
+    memcpy(compactPacket + numTypeBytes + sizeof(PacketVersion), &senderLocalID, sizeof(LocalNodeID));
+    memmove(compactPacket, packet, numTypeBytes);
+
+    return offset;
+}
+
+LocalNodeID localIDFromPacketHeader(const char* packet) {
+    if (!hasCompactHeader(packet)) {
+        return NULL_LOCAL_NODE_ID;
+    }
+
+    LocalNodeID localID;
+    memcpy(&localID, packet + numBytesArithmeticCodingFromBuffer(packet) + sizeof(PacketVersion), sizeof(LocalNodeID));
+    return localID;
+}
+
 #define PACKET_TYPE_NAME_LOOKUP(x) case x:  return QString(#x);
 
 QString nameForPacketType(PacketType type) {
@@ -155,14 +255,16 @@ int populatePacketHeader(QByteArray& packet, PacketType type, const QUuid& conne
 
 int populatePacketHeader(char* packet, PacketType type, const QUuid& connectionUUID) {
     int numTypeBytes = packArithmeticallyCodedValue(type, packet);
-    packet[numTypeBytes] = versionForPacketType(type);
+
+    // packets start out with a full header, any compacting happens as they are sent
+    PacketVersion sipHashVersion = sipHashVersionForPacketType(type);
+    packet[numTypeBytes] = sipHashVersion > 0 ? sipHashVersion : versionForPacketType(type);
     
     char* position = packet + numTypeBytes + sizeof(PacketVersion);
     
     QUuid packUUID = connectionUUID.isNull() ? DependencyManager::get<LimitedNodeList>()->getSessionUUID() : connectionUUID;
     
-    QByteArray rfcUUID = packUUID.toRfc4122();
-    memcpy(position, rfcUUID.constData(), NUM_BYTES_RFC4122_UUID);
+    uuidToRfc4122(packUUID, position);
     position += NUM_BYTES_RFC4122_UUID;
     
     if (!NON_VERIFIED_PACKETS.contains(type)) {
@@ -176,13 +278,14 @@ int populatePacketHeader(char* packet, PacketType type, const QUuid& connectionU
 }
 
 int numBytesForPacketHeader(const QByteArray& packet) {
-    // returns the number of bytes used for the type, version, and UUID
-    return numBytesArithmeticCodingFromBuffer(packet.data())
-    + numHashBytesInPacketHeaderGivenPacketType(packetTypeForPacket(packet))
-    + NUM_STATIC_HEADER_BYTES;
+    return numBytesForPacketHeader(packet.data());
 }
 
 int numBytesForPacketHeader(const char* packet) {
+    if (hasCompactHeader(packet)) {
+        return numBytesArithmeticCodingFromBuffer(packet) + NUM_COMPACT_HEADER_BYTES_AFTER_TYPE;
+    }
+
     // returns the number of bytes used for the type, version, and UUID
     return numBytesArithmeticCodingFromBuffer(packet)
     + numHashBytesInPacketHeaderGivenPacketType(packetTypeForPacket(packet))
@@ -199,23 +302,76 @@ int numHashBytesInPacketHeaderGivenPacketType(PacketType type) {
     return (NON_VERIFIED_PACKETS.contains(type) ? 0 : NUM_BYTES_MD5_HASH);
 }
 
+int numHashBytesInPacketHeader(const char* packet) {
+    if (hasCompactHeader(packet)) {
+        return NUM_BYTES_SIP_HASH;
+    }
+    return numHashBytesInPacketHeaderGivenPacketType(packetTypeForPacket(packet));
+}
+
 QUuid uuidFromPacketHeader(const QByteArray& packet) {
+    if (hasCompactHeader(packet.constData())) {
+        auto nodeList = DependencyManager::get<LimitedNodeList>();
+        SharedNodePointer sendingNode = nodeList ? nodeList->nodeWithLocalID(localIDFromPacketHeader(packet.constData()))
+            : SharedNodePointer();
+        return sendingNode ? sendingNode->getUUID() : QUuid();
+    }
+
     return QUuid::fromRfc4122(packet.mid(numBytesArithmeticCodingFromBuffer(packet.data()) + sizeof(PacketVersion),
                                          NUM_BYTES_RFC4122_UUID));
 }
 
 QByteArray hashFromPacketHeader(const QByteArray& packet) {
-    return packet.mid(numBytesForPacketHeader(packet) - NUM_BYTES_MD5_HASH, NUM_BYTES_MD5_HASH);
+    int numHashBytes = numHashBytesInPacketHeader(packet.constData());
+    return packet.mid(numBytesForPacketHeader(packet) - numHashBytes, numHashBytes);
 }
 
 QByteArray hashForPacketAndConnectionUUID(const QByteArray& packet, const QUuid& connectionUUID) {
-    return QCryptographicHash::hash(packet.mid(numBytesForPacketHeader(packet)) + connectionUUID.toRfc4122(),
-                                    QCryptographicHash::Md5);
+    QByteArray hash(numHashBytesInPacketHeader(packet.constData()), 0);
+    hashForPacketAndConnectionUUID(packet.constData(), packet.size(), connectionUUID, hash.data());
+    return hash;
 }
 
 void replaceHashInPacketGivenConnectionUUID(QByteArray& packet, const QUuid& connectionUUID) {
-    packet.replace(numBytesForPacketHeader(packet) - NUM_BYTES_MD5_HASH, NUM_BYTES_MD5_HASH,
-                   hashForPacketAndConnectionUUID(packet, connectionUUID));
+    replaceHashInPacketGivenConnectionUUID(packet.data(), packet.size(), connectionUUID);
+}
+
+void hashForPacketAndConnectionUUID(const char* packet, int packetLength, const QUuid& connectionUUID, char* hash) {
+    int numBytesPacketHeader = numBytesForPacketHeader(packet);
+
+    char rfcUUID[NUM_BYTES_RFC4122_UUID];
+    uuidToRfc4122(connectionUUID, rfcUUID);
+
+    PacketHashMode hashMode = hashModeForPacket(packet);
+    if (hashMode >= PacketHashModeSipHash) {
+        // the connection secret is the key, and in a full header the rest of the room for an MD5 hash is left zeroed
+        sipHash24(rfcUUID, packet + numBytesPacketHeader, packetLength - numBytesPacketHeader, hash);
+        if (hashMode == PacketHashModeSipHash) {
+            memset(hash + NUM_BYTES_SIP_HASH, 0, NUM_BYTES_MD5_HASH - NUM_BYTES_SIP_HASH);
+        }
+        return;
+    }
+
+    // the hash covers everything after the header, followed by the connection UUID
+    MD5_CTX context;
+    MD5_Init(&context);
+    MD5_Update(&context, packet + numBytesPacketHeader, packetLength - numBytesPacketHeader);
+    MD5_Update(&context, rfcUUID, NUM_BYTES_RFC4122_UUID);
+    MD5_Final(reinterpret_cast<unsigned char*>(hash), &context);
+}
+
+bool packetHashMatchesConnectionUUID(const char* packet, int packetLength, const QUuid& connectionUUID) {
+    char expectedHash[NUM_BYTES_MD5_HASH];
+    hashForPacketAndConnectionUUID(packet, packetLength, connectionUUID, expectedHash);
+
+    int numHashBytes = numHashBytesInPacketHeader(packet);
+    return memcmp(packet + numBytesForPacketHeader(packet) - numHashBytes, expectedHash, numHashBytes) == 0;
+}
+
+void replaceHashInPacketGivenConnectionUUID(char* packet, int packetLength, const QUuid& connectionUUID) {
+    // the hash is computed over bytes after the header, so it can be written straight into the header
+    hashForPacketAndConnectionUUID(packet, packetLength, connectionUUID,
+                                   packet + numBytesForPacketHeader(packet) - numHashBytesInPacketHeader(packet));
 }
 
 PacketType packetTypeForPacket(const QByteArray& packet) {
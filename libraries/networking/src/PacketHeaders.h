@@ -16,6 +16,7 @@
 #include <QtCore/QSet>
 #include <QtCore/QUuid>
 
+#include "SipHash.h"
 #include "UUID.h"
 
 // NOTE: if adding a new packet type, you can replace one marked usable or add at the end
@@ -88,11 +89,60 @@ const QSet<PacketType> NON_VERIFIED_PACKETS = QSet<PacketType>()
     << PacketTypeIceServerHeartbeat << PacketTypeIceServerHeartbeatResponse
     << PacketTypeUnverifiedPing << PacketTypeUnverifiedPingReply << PacketTypeStopNode;
 
+// every verified packet has room in its header for an MD5 hash, faster hashes use the start of it and zero the rest
 const int NUM_BYTES_MD5_HASH = 16;
 const int NUM_STATIC_HEADER_BYTES = sizeof(PacketVersion) + NUM_BYTES_RFC4122_UUID;
 const int MAX_PACKET_HEADER_BYTES = sizeof(PacketType) + NUM_BYTES_MD5_HASH + NUM_STATIC_HEADER_BYTES;
 
+/// the domain server gives every node an ID that is only good within the domain, 0 until it has one
+typedef quint16 LocalNodeID;
+const LocalNodeID NULL_LOCAL_NODE_ID = 0;
+const int NUM_BYTES_LOCAL_NODE_ID = sizeof(LocalNodeID);
+
+/// A compact header names the sender by its local ID and only has room for a SipHash, 22 bytes less than the full one
+const int NUM_COMPACT_HEADER_BYTES_AFTER_TYPE = sizeof(PacketVersion) + NUM_BYTES_LOCAL_NODE_ID + NUM_BYTES_SIP_HASH;
+
+/// how the hash in the header of a verified packet is computed, a peer can verify every mode up to the one it reports
+enum PacketHashMode {
+    PacketHashModeMD5, // MD5 of the payload followed by the connection secret, understood by every peer
+    PacketHashModeSipHash, // SipHash-2-4 of the payload keyed with the connection secret
+    PacketHashModeCompactSipHash // SipHash-2-4 as above, in a compact header
+};
+
+const PacketHashMode BEST_PACKET_HASH_MODE = PacketHashModeCompactSipHash;
+
 PacketVersion versionForPacketType(PacketType type);
+
+/// the version at which packets of this type moved to SipHash verification, 0 for types still verified with MD5.
+/// Peers that haven't told us they can verify SipHash get these types with the version before it, hashed with MD5.
+PacketVersion sipHashVersionForPacketType(PacketType type);
+
+/// the version at which packets of this type can have a compact header, always the one after the SipHash version.
+/// 0 for types that always have a full header.
+PacketVersion compactHeaderVersionForPacketType(PacketType type);
+
+/// true for the current version of the type and, for types verified with SipHash, the older versions still sent to
+/// peers that can't handle the current one
+bool isAcceptedVersionForPacketType(PacketType type, PacketVersion version);
+
+/// the hash mode the header of a packet is verified with, given by its type and version
+PacketHashMode hashModeForPacket(const char* packet);
+
+/// Rewrites the version of a packet with a full header so that it is hashed with the best mode both we and the peer
+/// can use. Full headers stop at SipHash, compactPacketHeader() is what moves a packet to the compact header.
+void setVersionForPeerHashMode(char* packet, PacketHashMode peerHashMode);
+
+/// true if the version of the packet says its header is a compact one
+bool hasCompactHeader(const char* packet);
+
+/// Rewrites the full header of a packet at the SipHash version as a compact header that ends where the full one did,
+/// so that the payload stays where it is. Returns how many bytes into the packet the compact packet now starts.
+/// The bytes of the full header before the end of the compact one are overwritten.
+int compactPacketHeader(char* packet, LocalNodeID senderLocalID);
+
+/// the local ID of the sender of a packet with a compact header, NULL_LOCAL_NODE_ID for a full header
+LocalNodeID localIDFromPacketHeader(const char* packet);
+
 QString nameForPacketType(PacketType type);
 
 const QUuid nullUUID = QUuid();
@@ -102,17 +152,29 @@ int populatePacketHeader(QByteArray& packet, PacketType type, const QUuid& conne
 int populatePacketHeader(char* packet, PacketType type, const QUuid& connectionUUID = nullUUID);
 
 int numHashBytesInPacketHeaderGivenPacketType(PacketType type);
+int numHashBytesInPacketHeader(const char* packet);
 
 int numBytesForPacketHeader(const QByteArray& packet);
 int numBytesForPacketHeader(const char* packet);
 int numBytesForPacketHeaderGivenPacketType(PacketType type);
 
+/// for a compact header this is the UUID of the node we know by the local ID in it, if there is one
 QUuid uuidFromPacketHeader(const QByteArray& packet);
 
 QByteArray hashFromPacketHeader(const QByteArray& packet);
 QByteArray hashForPacketAndConnectionUUID(const QByteArray& packet, const QUuid& connectionUUID);
 void replaceHashInPacketGivenConnectionUUID(QByteArray& packet, const QUuid& connectionUUID);
 
+/// writes the numHashBytesInPacketHeader() byte verification hash of a packet to hash, without any allocation, using
+/// the hash mode of the packet's version
+void hashForPacketAndConnectionUUID(const char* packet, int packetLength, const QUuid& connectionUUID, char* hash);
+
+/// compares the hash in the header of a packet with the one we expect, without any allocation
+bool packetHashMatchesConnectionUUID(const char* packet, int packetLength, const QUuid& connectionUUID);
+
+/// stamps the verification hash into the header of a packet in place, without any allocation
+void replaceHashInPacketGivenConnectionUUID(char* packet, int packetLength, const QUuid& connectionUUID);
+
 PacketType packetTypeForPacket(const QByteArray& packet);
 PacketType packetTypeForPacket(const char* packet);
 
@@ -0,0 +1,75 @@
+//
+//  PacketRing.cpp
+//  libraries/networking/src
+//
+//  Created on 4/17/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "LimitedNodeList.h"
+
+#include "PacketRing.h"
+
+PacketRing::PacketRing(int numSlots) :
+    _numSlots(qMax(numSlots, 1) + 1),
+    _slots(new Slot[_numSlots]),
+    _writeIndex(0),
+    _readIndex(0),
+    _numDropped(0)
+{
+    for (int i = 0; i < _numSlots; i++) {
+        // the full size up front, so that receiving into a slot never allocates
+        _slots[i].packet.reserve(MAX_PACKET_SIZE);
+    }
+}
+
+PacketRing::~PacketRing() {
+    delete[] _slots;
+}
+
+int PacketRing::getDepth() const {
+    return (_writeIndex.loadAcquire() - _readIndex.loadAcquire() + _numSlots) % _numSlots;
+}
+
+PacketRing::Slot* PacketRing::beginWrite() {
+    int writeIndex = _writeIndex.load();
+    if ((writeIndex + 1) % _numSlots == _readIndex.loadAcquire()) {
+        // the consumer hasn't given back the slot after this one
+        return NULL;
+    }
+    return &_slots[writeIndex];
+}
+
+void PacketRing::endWrite() {
+    endWrite(1);
+}
+
+int PacketRing::getNumFreeSlots() const {
+    return _numSlots - 1 - getDepth();
+}
+
+PacketRing::Slot* PacketRing::getFreeSlot(int index) {
+    Q_ASSERT(index < getNumFreeSlots());
+    return &_slots[(_writeIndex.load() + index) % _numSlots];
+}
+
+void PacketRing::endWrite(int numSlots) {
+    // the release makes what was written into the slots visible before the consumer can see them
+    _writeIndex.storeRelease((_writeIndex.load() + numSlots) % _numSlots);
+}
+
+PacketRing::Slot* PacketRing::beginRead() {
+    int readIndex = _readIndex.load();
+    if (readIndex == _writeIndex.loadAcquire()) {
+        return NULL;
+    }
+    return &_slots[readIndex];
+}
+
+void PacketRing::endRead() {
+    // the release makes sure we're done with the slot before the producer can reuse it
+    _readIndex.storeRelease((_readIndex.load() + 1) % _numSlots);
+}
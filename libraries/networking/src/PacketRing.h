@@ -0,0 +1,79 @@
+//
+//  PacketRing.h
+//  libraries/networking/src
+//
+//  Created on 4/17/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_PacketRing_h
+#define hifi_PacketRing_h
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QByteArray>
+
+#include "HifiSockAddr.h"
+
+/// A bounded ring of preallocated packet slots, handing received packets from the one thread reading a socket to the
+/// one thread processing them without locks or allocation. When the ring is full new packets are dropped and counted.
+class PacketRing {
+public:
+    struct Slot {
+        QByteArray packet;
+        HifiSockAddr senderSockAddr;
+    };
+
+    PacketRing(int numSlots);
+    ~PacketRing();
+
+    int getNumSlots() const { return _numSlots - 1; }
+
+    /// the number of packets waiting, exact from either thread for what that thread has done
+    int getDepth() const;
+
+    /// the number of packets dropped because the ring was full
+    int getNumDropped() const { return _numDropped.load(); }
+
+    /// producer side: the slot to fill with the next packet, NULL if the ring is full
+    Slot* beginWrite();
+
+    /// producer side: hands the slot from beginWrite() to the consumer
+    void endWrite();
+
+    /// producer side: how many slots can be filled before the consumer gives any back
+    int getNumFreeSlots() const;
+
+    /// producer side: the index-th free slot, counting from the one beginWrite() returns, to fill several at once
+    Slot* getFreeSlot(int index);
+
+    /// producer side: hands the next numSlots free slots to the consumer
+    void endWrite(int numSlots);
+
+    /// producer side: counts a packet that had to be dropped because beginWrite() returned NULL
+    void recordDrop() { _numDropped.fetchAndAddRelaxed(1); }
+
+    /// consumer side: the oldest packet waiting, NULL if there are none
+    Slot* beginRead();
+
+    /// consumer side: gives the slot from beginRead() back to the producer
+    void endRead();
+
+private:
+    // not copyable, the slots are owned
+    PacketRing(const PacketRing& otherRing);
+    PacketRing& operator=(const PacketRing& otherRing);
+
+    // one more slot than asked for, so that a full ring can be told apart from an empty one
+    int _numSlots;
+    Slot* _slots;
+
+    // the producer only writes _writeIndex and the consumer only writes _readIndex
+    QAtomicInt _writeIndex;
+    QAtomicInt _readIndex;
+    QAtomicInt _numDropped;
+};
+
+#endif // hifi_PacketRing_h
@@ -9,6 +9,8 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <utility>
+
 #include "NodeList.h"
 #include "ReceivedPacketProcessor.h"
 #include "SharedUtil.h"
@@ -22,41 +24,47 @@ void ReceivedPacketProcessor::queueReceivedPacket(const SharedNodePointer& sendi
     sendingNode->setLastHeardMicrostamp(usecTimestampNow());
 
     NetworkPacket networkPacket(sendingNode, packet);
-    lock();
-    _packets.push_back(networkPacket);
-    _nodePacketCounts[sendingNode->getUUID()]++;
-    unlock();
+    if (networkPacket.getNode().isNull()) {
+        // the packet was too big or empty, there's nothing to process
+        return;
+    }
+
+    // count it before it can be popped, so that the counts never go below zero
+    sendingNode->addPacketsToProcess(1);
+    _numPacketsToProcess.fetchAndAddRelaxed(1);
+    _packets.push(std::move(networkPacket));
     
     // Make sure to  wake our actual processing thread because we  now have packets for it to process.
     _hasPackets.wakeAll();
 }
 
+bool ReceivedPacketProcessor::isAlive(const QUuid& nodeUUID) const {
+    return !DependencyManager::get<LimitedNodeList>()->nodeWithUUID(nodeUUID).isNull();
+}
+
+bool ReceivedPacketProcessor::hasPacketsToProcessFrom(const QUuid& nodeUUID) const {
+    SharedNodePointer node = DependencyManager::get<LimitedNodeList>()->nodeWithUUID(nodeUUID);
+    return node && hasPacketsToProcessFrom(node);
+}
+
 bool ReceivedPacketProcessor::process() {
 
-    if (_packets.size() == 0) {
+    if (!hasPacketsToProcess()) {
         _waitingOnPacketsMutex.lock();
         _hasPackets.wait(&_waitingOnPacketsMutex, getMaxWait());
         _waitingOnPacketsMutex.unlock();
     }
     preProcess();
-    while (_packets.size() > 0) {
-        lock(); // lock to make sure nothing changes on us
-        NetworkPacket& packet = _packets.front(); // get the oldest packet
-        NetworkPacket temporary = packet; // make a copy of the packet in case the vector is resized on us
-        _packets.erase(_packets.begin()); // remove the oldest packet
-        if (!temporary.getNode().isNull()) {
-            _nodePacketCounts[temporary.getNode()->getUUID()]--;
-        }
-        unlock(); // let others add to the packets
-        processPacket(temporary.getNode(), temporary.getByteArray()); // process our temporary copy
+
+    // packets are moved out of the queue one at a time, and receiving threads can keep queueing while we process
+    NetworkPacket packet;
+    while (_packets.pop(packet)) {
+        _numPacketsToProcess.fetchAndAddRelaxed(-1);
+        packet.getNode()->addPacketsToProcess(-1);
+
+        processPacket(packet.getNode(), packet.getByteArray());
         midProcess();
     }
     postProcess();
     return isStillRunning();  // keep running till they terminate us
 }
-
-void ReceivedPacketProcessor::nodeKilled(SharedNodePointer node) {
-    lock();
-    _nodePacketCounts.remove(node->getUUID());
-    unlock();
-}
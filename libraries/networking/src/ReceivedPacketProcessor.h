@@ -12,46 +12,44 @@
 #ifndef hifi_ReceivedPacketProcessor_h
 #define hifi_ReceivedPacketProcessor_h
 
+#include <QAtomicInt>
 #include <QWaitCondition>
 
+#include <MPSCQueue.h>
+
 #include "GenericThread.h"
 #include "NetworkPacket.h"
 
-/// Generalized threaded processor for handling received inbound packets. 
+/// Generalized threaded processor for handling received inbound packets. Packets are queued without taking a lock, so
+/// receiving threads never wait on the processing thread.
 class ReceivedPacketProcessor : public GenericThread {
     Q_OBJECT
 public:
-    ReceivedPacketProcessor() { }
+    ReceivedPacketProcessor() : _numPacketsToProcess(0) { }
 
     /// Add packet from network receive thread to the processing queue.
     void queueReceivedPacket(const SharedNodePointer& sendingNode, const QByteArray& packet);
 
     /// Are there received packets waiting to be processed
-    bool hasPacketsToProcess() const { return _packets.size() > 0; }
+    bool hasPacketsToProcess() const { return _numPacketsToProcess.load() > 0; }
 
     /// Is a specified node still alive?
-    bool isAlive(const QUuid& nodeUUID) const {
-        return _nodePacketCounts.contains(nodeUUID);
-    }
+    bool isAlive(const QUuid& nodeUUID) const;
 
-    /// Are there received packets waiting to be processed from a specified node
+    /// Are there received packets waiting to be processed from a specified node. The count is kept on the node, so it
+    /// covers packets from that node waiting in any ReceivedPacketProcessor.
     bool hasPacketsToProcessFrom(const SharedNodePointer& sendingNode) const {
-        return hasPacketsToProcessFrom(sendingNode->getUUID());
+        return sendingNode->getNumPacketsToProcess() > 0;
     }
 
     /// Are there received packets waiting to be processed from a specified node
-    bool hasPacketsToProcessFrom(const QUuid& nodeUUID) const {
-        return _nodePacketCounts[nodeUUID] > 0;
-    }
+    bool hasPacketsToProcessFrom(const QUuid& nodeUUID) const;
 
     /// How many received packets waiting are to be processed
-    int packetsToProcessCount() const { return _packets.size(); }
+    int packetsToProcessCount() const { return _numPacketsToProcess.load(); }
 
     virtual void terminating();
 
-public slots:
-    void nodeKilled(SharedNodePointer node);
-
 protected:
     /// Callback for processing of recieved packets. Implement this to process the incoming packets.
     /// \param SharedNodePointer& sendingNode the node that sent this packet
@@ -75,8 +73,8 @@ protected:
 
 protected:
 
-    QVector<NetworkPacket> _packets;
-    QHash<QUuid, int> _nodePacketCounts;
+    MPSCQueue<NetworkPacket> _packets;
+    QAtomicInt _numPacketsToProcess;
 
     QWaitCondition _hasPackets;
     QMutex _waitingOnPacketsMutex;
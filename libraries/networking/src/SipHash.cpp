@@ -0,0 +1,80 @@
+//
+//  SipHash.cpp
+//  libraries/networking/src
+//
+//  Created on 4/16/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QtEndian>
+
+#include "SipHash.h"
+
+static inline quint64 rotateLeft(quint64 value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline void sipRound(quint64& v0, quint64& v1, quint64& v2, quint64& v3) {
+    v0 += v1;
+    v1 = rotateLeft(v1, 13);
+    v1 ^= v0;
+    v0 = rotateLeft(v0, 32);
+    v2 += v3;
+    v3 = rotateLeft(v3, 16);
+    v3 ^= v2;
+    v0 += v3;
+    v3 = rotateLeft(v3, 21);
+    v3 ^= v0;
+    v2 += v1;
+    v1 = rotateLeft(v1, 17);
+    v1 ^= v2;
+    v2 = rotateLeft(v2, 32);
+}
+
+quint64 sipHash24(const char* key, const char* data, int length) {
+    const uchar* keyBytes = reinterpret_cast<const uchar*>(key);
+    quint64 k0 = qFromLittleEndian<quint64>(keyBytes);
+    quint64 k1 = qFromLittleEndian<quint64>(keyBytes + sizeof(quint64));
+
+    quint64 v0 = k0 ^ 0x736f6d6570736575ULL;
+    quint64 v1 = k1 ^ 0x646f72616e646f6dULL;
+    quint64 v2 = k0 ^ 0x6c7967656e657261ULL;
+    quint64 v3 = k1 ^ 0x7465646279746573ULL;
+
+    const uchar* position = reinterpret_cast<const uchar*>(data);
+    const uchar* wholeWordsEnd = position + (length - (length % sizeof(quint64)));
+
+    for (; position != wholeWordsEnd; position += sizeof(quint64)) {
+        quint64 word = qFromLittleEndian<quint64>(position);
+        v3 ^= word;
+        sipRound(v0, v1, v2, v3);
+        sipRound(v0, v1, v2, v3);
+        v0 ^= word;
+    }
+
+    // the last word holds the leftover bytes with the message length in its top byte
+    quint64 lastWord = ((quint64)length) << 56;
+    for (int i = length % sizeof(quint64) - 1; i >= 0; i--) {
+        lastWord |= ((quint64)position[i]) << (8 * i);
+    }
+
+    v3 ^= lastWord;
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+    v0 ^= lastWord;
+
+    v2 ^= 0xff;
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+void sipHash24(const char* key, const char* data, int length, char* hash) {
+    qToLittleEndian<quint64>(sipHash24(key, data, length), reinterpret_cast<uchar*>(hash));
+}
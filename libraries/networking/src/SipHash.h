@@ -0,0 +1,27 @@
+//
+//  SipHash.h
+//  libraries/networking/src
+//
+//  Created on 4/16/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SipHash_h
+#define hifi_SipHash_h
+
+#include <QtCore/QtGlobal>
+
+const int NUM_BYTES_SIP_HASH_KEY = 16;
+const int NUM_BYTES_SIP_HASH = 8;
+
+/// SipHash-2-4 (Aumasson and Bernstein) of data keyed with NUM_BYTES_SIP_HASH_KEY bytes of key. It is a keyed hash
+/// made for short messages, several times cheaper than MD5 per byte and much cheaper to set up.
+quint64 sipHash24(const char* key, const char* data, int length);
+
+/// writes the NUM_BYTES_SIP_HASH bytes of the SipHash-2-4 of data to hash, in the little-endian order of the reference
+void sipHash24(const char* key, const char* data, int length, char* hash);
+
+#endif // hifi_SipHash_h
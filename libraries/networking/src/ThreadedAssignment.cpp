@@ -89,13 +89,14 @@ void ThreadedAssignment::commonInit(const QString& targetName, NodeType_t nodeTy
 void ThreadedAssignment::addPacketStatsAndSendStatsPacket(QJsonObject &statsObject) {
     auto nodeList = DependencyManager::get<NodeList>();
     
-    float packetsPerSecond, bytesPerSecond;
+    float packetsPerSecond, bytesPerSecond, sendSystemCallsPerSecond;
     // XXX can BandwidthRecorder be used for this?
-    nodeList->getPacketStats(packetsPerSecond, bytesPerSecond);
+    nodeList->getPacketStats(packetsPerSecond, bytesPerSecond, sendSystemCallsPerSecond);
     nodeList->resetPacketStats();
     
     statsObject["packets_per_second"] = packetsPerSecond;
     statsObject["bytes_per_second"] = bytesPerSecond;
+    statsObject["send_syscalls_per_second"] = sendSystemCallsPerSecond;
     
     nodeList->sendStatsToDomainServer(statsObject);
 }
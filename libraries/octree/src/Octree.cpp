@@ -17,6 +17,7 @@
 #include <cstdio>
 #include <cmath>
 #include <fstream> // to load voxels from file
+#include <zlib.h>
 
 #include <QDataStream>
 #include <QDebug>
@@ -26,6 +27,7 @@
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QNetworkAccessManager>
+#include <QSaveFile>
 #include <QVector>
 #include <QFile>
 #include <QJsonDocument>
@@ -49,7 +51,7 @@
 #include "OctreeLogging.h"
 
 
-QVector<QString> PERSIST_EXTENSIONS = {"svo", "json"};
+QVector<QString> PERSIST_EXTENSIONS = {"svo", "json", "json.gz", "bin"};
 
 float boundaryDistanceForRenderLevel(unsigned int renderLevel, float voxelSizeScale) {
     return voxelSizeScale / powf(2, renderLevel);
@@ -198,7 +200,13 @@ bool Octree::recurseElementWithOperator(OctreeElement* element, RecurseOctreeOpe
             }
             
             if (child) {
-                if (!recurseElementWithOperator(child, operatorObject, recursionCount + 1)) {
+                bool keepRecursing = recurseElementWithOperator(child, operatorObject, recursionCount + 1);
+
+                // whatever the operator changed below bubbles up, so an element that hasn't changed proves that
+                // nothing in its subtree has either
+                element->updateChangedTimeFromChild(child);
+
+                if (!keepRecursing) {
                     break; // stop recursing if operator returns false...
                 }
             }
@@ -580,9 +588,28 @@ void Octree::deleteOctalCodeFromTreeRecursion(OctreeElement* element, void* extr
     }
 }
 
+void Octree::copyElementsInto(Octree* snapshot) {
+    copyElementRecursion(_rootElement, snapshot->getRoot());
+}
+
+void Octree::copyElementRecursion(OctreeElement* element, OctreeElement* snapshotElement) {
+    element->copyContentsInto(snapshotElement);
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        OctreeElement* child = element->getChildAtIndex(i);
+        if (child) {
+            copyElementRecursion(child, snapshotElement->addChildAtIndex(i));
+        }
+    }
+    // adding the children marked the copy as changed now, it has to keep the time of the original
+    snapshotElement->becomeSnapshotOf(element);
+}
+
 void Octree::eraseAllOctreeElements(bool createNewRoot) {
     delete _rootElement; // this will recurse and delete all children
     _rootElement = NULL;
+
+    // if that was the last tree, the memory its elements were allocated from can go back in one go
+    OctreeElement::releaseUnusedPools();
     
     if (createNewRoot) {
         _rootElement = createNewElement();
@@ -1854,6 +1881,9 @@ bool Octree::readFromFile(const char* fileName) {
     bool fileOk = false;
 
     QString qFileName = findMostRecentFileExtension(fileName, PERSIST_EXTENSIONS);
+    if (qFileName.endsWith(".bin")) {
+        return readFromBinaryFile(qFileName);
+    }
     QFile file(qFileName);
     fileOk = file.open(QIODevice::ReadOnly);
 
@@ -1876,6 +1906,30 @@ bool Octree::readFromFile(const char* fileName) {
     return fileOk;
 }
 
+bool Octree::readFromBinaryFile(const QString& fileName) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    emit importSize(1.0f, 1.0f, 1.0f);
+    emit importProgress(0);
+
+    // the tree is rebuilt from the mapped file in place, without reading it into memory first
+    qCDebug(octree) << "Loading binary file" << fileName << "...";
+    qint64 fileSize = file.size();
+    uchar* data = file.map(0, fileSize);
+    if (!data) {
+        qCDebug(octree) << "Could not map" << fileName;
+        return false;
+    }
+    bool fileOk = readFromBinary(data, fileSize);
+    file.unmap(data);
+
+    emit importProgress(100);
+    return fileOk;
+}
+
 bool Octree::readFromURL(const QString& urlString) {
     bool readOk = false;
 
@@ -1916,9 +1970,13 @@ bool Octree::readFromStream(unsigned long streamLength, QDataStream& inputStream
     device->getChar(&firstChar);
     device->ungetChar(firstChar);
 
+    const char GZIP_MAGIC[] = { (char)0x1f, (char)0x8b };
     if (firstChar == (char) PacketTypeEntityData) {
         qCDebug(octree) << "Reading from SVO Stream length:" << streamLength;
         return readSVOFromStream(streamLength, inputStream);
+    } else if (device->peek(sizeof(GZIP_MAGIC)) == QByteArray(GZIP_MAGIC, sizeof(GZIP_MAGIC))) {
+        qCDebug(octree) << "Reading from gzipped JSON Stream length:" << streamLength;
+        return readGzippedJSONFromStream(streamLength, inputStream);
     } else {
         qCDebug(octree) << "Reading from JSON Stream length:" << streamLength;
         return readJSONFromStream(streamLength, inputStream);
@@ -2061,14 +2119,55 @@ bool Octree::readJSONFromStream(unsigned long streamLength, QDataStream& inputSt
     rawData[streamLength] = 0; // make sure we null terminate this string
 
     QJsonDocument asDocument = QJsonDocument::fromJson(rawData);
-    QVariant asVariant = asDocument.toVariant();
-    QVariantMap asMap = asVariant.toMap();
-    readFromMap(asMap);
     delete[] rawData;
+    readFromJSON(asDocument.object());
+    return true;
+}
+
+bool Octree::readGzippedJSONFromStream(unsigned long streamLength, QDataStream& inputStream) {
+    QByteArray compressed(streamLength, 0);
+    inputStream.readRawData(compressed.data(), streamLength);
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    const int GZIP_WINDOW_BITS = MAX_WBITS + 16; // the extra 16 has zlib expect a gzip header and trailer
+    if (inflateInit2(&stream, GZIP_WINDOW_BITS) != Z_OK) {
+        return false;
+    }
+    stream.next_in = (Bytef*)compressed.data();
+    stream.avail_in = compressed.size();
+
+    QByteArray json;
+    const int INFLATE_CHUNK_SIZE = 256 * 1024;
+    int result = Z_OK;
+    while (result == Z_OK) {
+        int jsonSize = json.size();
+        json.resize(jsonSize + INFLATE_CHUNK_SIZE);
+        stream.next_out = (Bytef*)json.data() + jsonSize;
+        stream.avail_out = INFLATE_CHUNK_SIZE;
+        result = inflate(&stream, Z_NO_FLUSH);
+        json.resize(jsonSize + INFLATE_CHUNK_SIZE - stream.avail_out);
+    }
+    inflateEnd(&stream);
+    compressed.clear();
+
+    if (result != Z_STREAM_END) {
+        qCDebug(octree) << "UNEXPECTED end of gzipped JSON stream, zlib error:" << result;
+        return false;
+    }
+
+    QJsonDocument asDocument = QJsonDocument::fromJson(json);
+    json.clear();
+    readFromJSON(asDocument.object());
     return true;
 }
 
-void Octree::writeToFile(const char* fileName, OctreeElement* element, QString persistAsFileType) {
+bool Octree::readFromJSON(const QJsonObject& description) {
+    QVariantMap asMap = description.toVariantMap();
+    return readFromMap(asMap);
+}
+
+bool Octree::writeToFile(const char* fileName, OctreeElement* element, QString persistAsFileType) {
     // make the sure file extension makes sense
     QString qFileName = fileNameWithoutExtension(QString(fileName), PERSIST_EXTENSIONS) + "." + persistAsFileType;
     QByteArray byteArray = qFileName.toUtf8();
@@ -2076,17 +2175,88 @@ void Octree::writeToFile(const char* fileName, OctreeElement* element, QString p
 
     if (persistAsFileType == "svo") {
         writeToSVOFile(fileName, element);
+        return true;
     } else if (persistAsFileType == "json") {
-        writeToJSONFile(cFileName, element);
+        return writeToJSONFile(cFileName, element);
+    } else if (persistAsFileType == "json.gz") {
+        return writeToJSONFile(cFileName, element, true);
+    } else if (persistAsFileType == "bin") {
+        return writeToBinaryFile(cFileName, element);
     } else {
         qCDebug(octree) << "unable to write octree to file of type" << persistAsFileType;
+        return false;
     }
 }
 
-void Octree::writeToJSONFile(const char* fileName, OctreeElement* element) {
-    QFile persistFile(fileName);
+// gzips everything written to it onto another device, a chunk at a time
+class GzipOutputDevice : public QIODevice {
+public:
+    GzipOutputDevice(QIODevice& output) : _output(output), _failed(false) {
+        memset(&_stream, 0, sizeof(_stream));
+        const int GZIP_WINDOW_BITS = MAX_WBITS + 16; // the extra 16 has zlib write a gzip header and trailer
+        const int GZIP_MEMORY_LEVEL = 8;
+        _failed = deflateInit2(&_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, GZIP_WINDOW_BITS, GZIP_MEMORY_LEVEL,
+                               Z_DEFAULT_STRATEGY) != Z_OK;
+        open(QIODevice::WriteOnly);
+    }
+
+    ~GzipOutputDevice() {
+        if (!_failed) {
+            deflateEnd(&_stream);
+        }
+    }
+
+    /// writes out the end of the gzip stream, returns false if anything couldn't be written
+    bool finish() {
+        return deflateToOutput(NULL, 0, Z_FINISH);
+    }
+
+protected:
+    virtual qint64 readData(char* data, qint64 maxSize) { return -1; }
+
+    virtual qint64 writeData(const char* data, qint64 size) {
+        return deflateToOutput(data, size, Z_NO_FLUSH) ? size : -1;
+    }
+
+private:
+    bool deflateToOutput(const char* data, qint64 size, int flush) {
+        if (_failed) {
+            return false;
+        }
+        _stream.next_in = (Bytef*)data;
+        _stream.avail_in = (uInt)size;
+
+        const int DEFLATE_CHUNK_SIZE = 64 * 1024;
+        char chunk[DEFLATE_CHUNK_SIZE];
+        do {
+            _stream.next_out = (Bytef*)chunk;
+            _stream.avail_out = DEFLATE_CHUNK_SIZE;
+            int result = deflate(&_stream, flush);
+            qint64 chunkSize = DEFLATE_CHUNK_SIZE - _stream.avail_out;
+            if (result == Z_STREAM_ERROR || (chunkSize > 0 && _output.write(chunk, chunkSize) != chunkSize)) {
+                deflateEnd(&_stream);
+                _failed = true;
+                return false;
+            }
+        } while (_stream.avail_out == 0);
+        return true;
+    }
+
+    QIODevice& _output;
+    z_stream _stream;
+    bool _failed;
+};
+
+bool Octree::writeToJSON(QIODevice& output, OctreeElement* element, bool skipDefaultValues) {
     QVariantMap entityDescription;
+    if (!writeToMap(entityDescription, element, skipDefaultValues)) {
+        return false;
+    }
+    QByteArray json = QJsonDocument::fromVariant(entityDescription).toJson();
+    return output.write(json) == json.size();
+}
 
+bool Octree::writeToJSONFile(const char* fileName, OctreeElement* element, bool doGzip) {
     qCDebug(octree, "Saving JSON SVO to file %s...", fileName);
 
     OctreeElement* top;
@@ -2096,12 +2266,54 @@ void Octree::writeToJSONFile(const char* fileName, OctreeElement* element) {
         top = _rootElement;
     }
 
-    bool entityDescriptionSuccess = writeToMap(entityDescription, top, true);
-    if (entityDescriptionSuccess && persistFile.open(QIODevice::WriteOnly)) {
-        persistFile.write(QJsonDocument::fromVariant(entityDescription).toJson());
+    // the file is written next to the old one and renamed over it on commit(), so a crash mid save can't truncate it
+    QSaveFile persistFile(fileName);
+    if (!persistFile.open(QIODevice::WriteOnly)) {
+        qCritical("Could not open %s to write the JSON description of entities.", fileName);
+        return false;
+    }
+
+    lockForRead();
+    bool entityDescriptionSuccess;
+    if (doGzip) {
+        GzipOutputDevice gzipFile(persistFile);
+        entityDescriptionSuccess = writeToJSON(gzipFile, top, true) && gzipFile.finish();
     } else {
+        entityDescriptionSuccess = writeToJSON(persistFile, top, true);
+    }
+    unlock();
+
+    if (!entityDescriptionSuccess) {
+        persistFile.cancelWriting();
+    }
+    if (!persistFile.commit()) {
         qCritical("Could not write to JSON description of entities.");
+        return false;
     }
+    return true;
+}
+
+bool Octree::writeToBinaryFile(const char* fileName, OctreeElement* element) {
+    qCDebug(octree, "Saving binary file %s...", fileName);
+
+    QSaveFile persistFile(fileName);
+    if (!persistFile.open(QIODevice::WriteOnly)) {
+        qCritical("Could not open %s to write the binary description of the tree.", fileName);
+        return false;
+    }
+
+    lockForRead();
+    bool written = writeToBinary(persistFile, element ? element : _rootElement);
+    unlock();
+
+    if (!written) {
+        persistFile.cancelWriting();
+    }
+    if (!persistFile.commit()) {
+        qCritical("Could not write the binary description of the tree.");
+        return false;
+    }
+    return true;
 }
 
 void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
@@ -20,6 +20,8 @@ class ReadBitstreamToTreeParams;
 class Octree;
 class OctreeElement;
 class OctreeElementBag;
+class OctreeEditBatch;
+class OctreeEncodeCache;
 class OctreePacketData;
 class Shape;
 
@@ -32,8 +34,11 @@ class Shape;
 #include "OctreeSceneStats.h"
 
 #include <QHash>
+#include <QIODevice>
+#include <QJsonObject>
 #include <QObject>
 #include <QReadWriteLock>
+#include <QSharedPointer>
 
 
 extern QVector<QString> PERSIST_EXTENSIONS;
@@ -89,6 +94,7 @@ public:
     CoverageMap* map;
     JurisdictionMap* jurisdictionMap;
     OctreeElementExtraEncodeData* extraEncodeData;
+    OctreeEncodeCache* encodeCache; // optional, element data shared with other clients on full scene sends
 
     // output hints from the encode process
     typedef enum {
@@ -139,6 +145,7 @@ public:
             map(map),
             jurisdictionMap(jurisdictionMap),
             extraEncodeData(extraEncodeData),
+            encodeCache(NULL),
             stopReason(UNKNOWN)
     {}
 
@@ -214,6 +221,8 @@ public:
     {}
 };
 
+typedef QSharedPointer<Octree> OctreePointer;
+
 class Octree : public QObject {
     Q_OBJECT
 public:
@@ -233,6 +242,10 @@ public:
     virtual bool handlesEditPacketType(PacketType packetType) const { return false; }
     virtual int processEditPacketData(PacketType packetType, const unsigned char* packetData, int packetLength,
                     const unsigned char* editData, int maxLength, const SharedNodePointer& sourceNode) { return 0; }
+
+    /// Returns a new batch for queuing edit packets and applying them together, or NULL if this type of tree only
+    /// applies its edits one packet at a time through processEditPacketData(). The caller owns the batch.
+    virtual OctreeEditBatch* createEditBatch() { return NULL; }
                     
     virtual bool recurseChildrenWithData() const { return true; }
     virtual bool rootElementHasData() const { return false; }
@@ -252,6 +265,11 @@ public:
 
     virtual void eraseAllOctreeElements(bool createNewRoot = true);
 
+    /// Makes a read only copy of this tree, with the same elements, content and change times, for readers that
+    /// shouldn't hold this tree's lock while they use it. The caller holds at least the read lock. Returns NULL if this
+    /// type of tree can't be copied.
+    virtual Octree* createSnapshot() { return NULL; }
+
     void processRemoveOctreeElementsBitstream(const unsigned char* bitstream, int bufferSizeBytes);
     void readBitstreamToTree(const unsigned char* bitstream,  unsigned long int bufferSizeBytes, ReadBitstreamToTreeParams& args);
     void deleteOctalCodeFromTree(const unsigned char* codeBuffer, bool collapseEmptyTrees = DONT_COLLAPSE);
@@ -328,19 +346,54 @@ public:
     void loadOctreeFile(const char* fileName, bool wantColorRandomizer);
 
     // Octree exporters
-    void writeToFile(const char* filename, OctreeElement* element = NULL, QString persistAsFileType = "svo");
-    void writeToJSONFile(const char* filename, OctreeElement* element = NULL);
+    bool writeToFile(const char* filename, OctreeElement* element = NULL, QString persistAsFileType = "svo");
+
+    /// Writes the tree under its read lock to a temporary file, gzipped if asked, which only replaces the file once it's
+    /// complete. A failed write leaves the file as it was.
+    bool writeToJSONFile(const char* filename, OctreeElement* element = NULL, bool doGzip = false);
     void writeToSVOFile(const char* filename, OctreeElement* element = NULL);
     virtual bool writeToMap(QVariantMap& entityDescription, OctreeElement* element, bool skipDefaultValues) = 0;
 
+    /// writes the JSON description of the tree, trees that can write it as they go override this to skip building the
+    /// whole description with writeToMap() first
+    virtual bool writeToJSON(QIODevice& output, OctreeElement* element, bool skipDefaultValues);
+
+    /// Writes the tree in its binary persist format under its read lock, replacing the file once it's complete like
+    /// writeToJSONFile() does. Only trees with a binary format can, see writeToBinary().
+    bool writeToBinaryFile(const char* filename, OctreeElement* element = NULL);
+
+    /// Trees with a binary persist format, laid out to be read straight from a mapped file, override these. The device
+    /// written to can seek.
+    virtual bool writeToBinary(QIODevice& output, OctreeElement* element) { return false; }
+    virtual bool readFromBinary(const uchar* data, qint64 size) { return false; }
+
     // Octree importers
     bool readFromFile(const char* filename);
+    bool readFromBinaryFile(const QString& fileName);
     bool readFromURL(const QString& url); // will support file urls as well...
     bool readFromStream(unsigned long streamLength, QDataStream& inputStream);
     bool readSVOFromStream(unsigned long streamLength, QDataStream& inputStream);
     bool readJSONFromStream(unsigned long streamLength, QDataStream& inputStream);
+    bool readGzippedJSONFromStream(unsigned long streamLength, QDataStream& inputStream);
     virtual bool readFromMap(QVariantMap& entityDescription) = 0;
 
+    /// reads a tree from its parsed JSON description, trees that can decode it directly override this to skip
+    /// converting the whole description into a QVariantMap for readFromMap()
+    virtual bool readFromJSON(const QJsonObject& description);
+
+    // Edit journal, so that a persist thread can append what changed instead of rewriting the whole tree. A tree that
+    // supports it remembers what its edits change while journaling is on.
+    virtual bool supportsEditJournal() const { return false; }
+    virtual void setWantEditJournal(bool wantEditJournal) { }
+
+    /// Appends a self contained record for each change since the last call and forgets those changes. The caller holds
+    /// the read lock. Replaying a record on a tree that already has its change is harmless.
+    virtual void writeEditJournalRecords(QList<QByteArray>& records) { }
+
+    /// Replays records from writeEditJournalRecords() in order, stopping at the first that can't be read. The caller
+    /// holds the write lock. Returns how many were replayed.
+    virtual int readEditJournalRecords(const QList<QByteArray>& records) { return 0; }
+
     unsigned long getOctreeElementsCount();
 
     bool getShouldReaverage() const { return _shouldReaverage; }
@@ -381,6 +434,10 @@ public slots:
 protected:
     void deleteOctalCodeFromTreeRecursion(OctreeElement* element, void* extraData);
 
+    /// for createSnapshot(), copies every element of this tree into the snapshot, which only has its root
+    void copyElementsInto(Octree* snapshot);
+    void copyElementRecursion(OctreeElement* element, OctreeElement* snapshotElement);
+
     int encodeTreeBitstreamRecursion(OctreeElement* element,
                                      OctreePacketData* packetData, OctreeElementBag& bag,
                                      EncodeBitstreamParams& params, int& currentEncodeLevel,
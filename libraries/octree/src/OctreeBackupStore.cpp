@@ -0,0 +1,282 @@
+//
+//  OctreeBackupStore.cpp
+//  libraries/octree/src
+//
+//  Created on 4/24/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QRegExp>
+#include <QtCore/QSaveFile>
+#include <QtCore/QSet>
+
+#include <PathUtils.h>
+#include <SharedUtil.h>
+
+#include "Octree.h"
+#include "OctreeLogging.h"
+#include "OctreeBackupStore.h"
+
+const int OctreeBackupStore::MIN_CHUNK_SIZE = 16 * 1024;
+const int OctreeBackupStore::MAX_CHUNK_SIZE = 256 * 1024;
+
+// A chunk ends where the top bits of the rolling hash are all 0, which is about one place in 64k past the minimum size.
+// Each step shifts the hash left by one, so the top bits only depend on the last 64 bytes.
+static const quint64 CHUNK_BOUNDARY_MASK = 0xffff000000000000ULL;
+static const int GEAR_WINDOW = 64;
+
+// a random value for each byte, the same every run so that the same content always chunks the same way
+class GearTable {
+public:
+    GearTable() {
+        quint64 state = 0x9e3779b97f4a7c15ULL;
+        for (int i = 0; i < 256; i++) {
+            // splitmix64
+            state += 0x9e3779b97f4a7c15ULL;
+            quint64 value = state;
+            value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+            values[i] = value ^ (value >> 31);
+        }
+    }
+    quint64 values[256];
+};
+static const GearTable GEAR_TABLE;
+
+static const QString CHUNKS_DIRECTORY = "chunks";
+static const QString VERSIONS_DIRECTORY = "versions";
+
+OctreeBackupStore::OctreeBackupStore(const QString& persistFileName) :
+    _path(fileNameWithoutExtension(persistFileName, PERSIST_EXTENSIONS) + ".backups"),
+    _chunksWritten(0),
+    _chunksReused(0),
+    _bytesWritten(0)
+{
+}
+
+int OctreeBackupStore::findChunkSize(const uchar* data, qint64 size) {
+    if (size <= MIN_CHUNK_SIZE) {
+        return size;
+    }
+    qint64 end = qMin(size, (qint64)MAX_CHUNK_SIZE);
+
+    // no chunk ends before the minimum size, so the hash only has to start a window before it
+    quint64 hash = 0;
+    for (qint64 i = MIN_CHUNK_SIZE - GEAR_WINDOW; i < end; i++) {
+        hash = (hash << 1) + GEAR_TABLE.values[data[i]];
+        if (i >= MIN_CHUNK_SIZE && (hash & CHUNK_BOUNDARY_MASK) == 0) {
+            return i + 1;
+        }
+    }
+    return end;
+}
+
+QString OctreeBackupStore::getChunkPath(const QString& hash) const {
+    return _path + "/" + CHUNKS_DIRECTORY + "/" + hash.left(2) + "/" + hash;
+}
+
+bool OctreeBackupStore::writeChunk(const QString& hash, const QByteArray& chunk) {
+    QString chunkPath = getChunkPath(hash);
+    if (QFile::exists(chunkPath)) {
+        _chunksReused++;
+        return true;
+    }
+
+    QDir().mkpath(QFileInfo(chunkPath).path());
+    QByteArray compressed = qCompress(chunk);
+    QSaveFile chunkFile(chunkPath);
+    if (!chunkFile.open(QIODevice::WriteOnly) || chunkFile.write(compressed) != compressed.size()
+            || !chunkFile.commit()) {
+        qCDebug(octree) << "ERROR writing backup chunk" << chunkPath;
+        return false;
+    }
+    _chunksWritten++;
+    _bytesWritten += compressed.size();
+    return true;
+}
+
+bool OctreeBackupStore::addVersion(const QString& fileName, const QString& rule) {
+    _chunksWritten = 0;
+    _chunksReused = 0;
+    _bytesWritten = 0;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    qint64 size = file.size();
+    uchar* data = NULL;
+    if (size > 0) {
+        data = file.map(0, size);
+        if (!data) {
+            return false;
+        }
+    }
+
+    QJsonArray chunks;
+    bool chunksWritten = true;
+    for (qint64 offset = 0; offset < size && chunksWritten; ) {
+        int chunkSize = findChunkSize(data + offset, size - offset);
+        QByteArray chunk = QByteArray::fromRawData(reinterpret_cast<const char*>(data + offset), chunkSize);
+        QString hash = QCryptographicHash::hash(chunk, QCryptographicHash::Sha1).toHex();
+        chunksWritten = writeChunk(hash, chunk);
+        chunks.append(hash);
+        offset += chunkSize;
+    }
+    if (data) {
+        file.unmap(data);
+    }
+    if (!chunksWritten) {
+        return false;
+    }
+
+    quint64 now = usecTimestampNow();
+    QJsonObject manifest;
+    manifest["rule"] = rule;
+    manifest["fileName"] = QFileInfo(fileName).fileName();
+    manifest["size"] = (double)size;
+    manifest["time"] = (double)now;
+    manifest["chunks"] = chunks;
+
+    // the time comes first and is padded, so that the versions sort by name in the order they were made
+    QString safeRule = rule;
+    safeRule.replace(QRegExp("[^A-Za-z0-9]"), "_");
+    QString versionsPath = _path + "/" + VERSIONS_DIRECTORY;
+    QString manifestPath = versionsPath + "/" + QString("%1-%2.json").arg(now, 20, 10, QChar('0')).arg(safeRule);
+    QDir().mkpath(versionsPath);
+
+    QByteArray manifestJSON = QJsonDocument(manifest).toJson(QJsonDocument::Compact);
+    QSaveFile manifestFile(manifestPath);
+    if (!manifestFile.open(QIODevice::WriteOnly) || manifestFile.write(manifestJSON) != manifestJSON.size()
+            || !manifestFile.commit()) {
+        qCDebug(octree) << "ERROR writing backup version" << manifestPath;
+        return false;
+    }
+    return true;
+}
+
+QList<OctreeBackupStore::Version> OctreeBackupStore::getVersions(const QString& rule) const {
+    QList<Version> versions;
+    QDir versionsDirectory(_path + "/" + VERSIONS_DIRECTORY);
+    QStringList manifestNames = versionsDirectory.entryList(QStringList("*.json"), QDir::Files,
+                                                            QDir::Name | QDir::Reversed);
+    foreach (const QString& manifestName, manifestNames) {
+        QString manifestPath = versionsDirectory.filePath(manifestName);
+        QFile manifestFile(manifestPath);
+        if (!manifestFile.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        QJsonObject manifest = QJsonDocument::fromJson(manifestFile.readAll()).object();
+        if (manifest.isEmpty() || (!rule.isEmpty() && manifest["rule"].toString() != rule)) {
+            continue;
+        }
+
+        Version version;
+        version.manifestPath = manifestPath;
+        version.rule = manifest["rule"].toString();
+        version.fileName = manifest["fileName"].toString();
+        version.size = (qint64)manifest["size"].toDouble();
+        version.time = (quint64)manifest["time"].toDouble();
+        versions << version;
+    }
+    return versions;
+}
+
+bool OctreeBackupStore::readVersionChunks(const QString& manifestPath, QStringList& chunks) const {
+    QFile manifestFile(manifestPath);
+    if (!manifestFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QJsonObject manifest = QJsonDocument::fromJson(manifestFile.readAll()).object();
+    if (!manifest["chunks"].isArray()) {
+        return false;
+    }
+    foreach (const QJsonValue& chunk, manifest["chunks"].toArray()) {
+        chunks << chunk.toString();
+    }
+    return true;
+}
+
+bool OctreeBackupStore::restoreVersion(const Version& version, const QString& toFileName) const {
+    QStringList chunks;
+    if (!readVersionChunks(version.manifestPath, chunks)) {
+        qCDebug(octree) << "ERROR reading backup version" << version.manifestPath;
+        return false;
+    }
+
+    QSaveFile restoredFile(toFileName);
+    if (!restoredFile.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    qint64 restoredSize = 0;
+    foreach (const QString& hash, chunks) {
+        QFile chunkFile(getChunkPath(hash));
+        QByteArray chunk;
+        if (chunkFile.open(QIODevice::ReadOnly)) {
+            chunk = qUncompress(chunkFile.readAll());
+        }
+        if (chunk.isEmpty() || QCryptographicHash::hash(chunk, QCryptographicHash::Sha1).toHex() != hash
+                || restoredFile.write(chunk) != chunk.size()) {
+            qCDebug(octree) << "ERROR restoring backup chunk" << getChunkPath(hash);
+            restoredFile.cancelWriting();
+            return false;
+        }
+        restoredSize += chunk.size();
+    }
+    if (restoredSize != version.size) {
+        qCDebug(octree) << "ERROR restoring backup version" << version.manifestPath << "restored" << restoredSize
+            << "bytes of" << version.size;
+        restoredFile.cancelWriting();
+        return false;
+    }
+    return restoredFile.commit();
+}
+
+void OctreeBackupStore::pruneVersions(const QString& rule, int versionsToKeep) {
+    QList<Version> versions = getVersions(rule);
+    bool removedVersions = false;
+    for (int i = qMax(versionsToKeep, 0); i < versions.size(); i++) {
+        qCDebug(octree) << "removing backup version" << versions[i].manifestPath << "of rule" << rule;
+        removedVersions = QFile::remove(versions[i].manifestPath) || removedVersions;
+    }
+    if (removedVersions) {
+        removeUnusedChunks();
+    }
+}
+
+void OctreeBackupStore::removeUnusedChunks() {
+    QSet<QString> usedChunks;
+    QDir versionsDirectory(_path + "/" + VERSIONS_DIRECTORY);
+    foreach (const QString& manifestName, versionsDirectory.entryList(QStringList("*.json"), QDir::Files)) {
+        QStringList chunks;
+        if (!readVersionChunks(versionsDirectory.filePath(manifestName), chunks)) {
+            // without knowing every chunk still in use, none can be removed
+            qCDebug(octree) << "Can't read backup version" << manifestName << "-- not removing unused chunks.";
+            return;
+        }
+        foreach (const QString& hash, chunks) {
+            usedChunks.insert(hash);
+        }
+    }
+
+    int chunksRemoved = 0;
+    QDirIterator chunkIterator(_path + "/" + CHUNKS_DIRECTORY, QDir::Files, QDirIterator::Subdirectories);
+    while (chunkIterator.hasNext()) {
+        chunkIterator.next();
+        if (!usedChunks.contains(chunkIterator.fileName()) && QFile::remove(chunkIterator.filePath())) {
+            chunksRemoved++;
+        }
+    }
+    qCDebug(octree) << "removed" << chunksRemoved << "backup chunks no version uses";
+}
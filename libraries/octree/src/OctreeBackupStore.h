@@ -0,0 +1,80 @@
+//
+//  OctreeBackupStore.h
+//  libraries/octree/src
+//
+//  Created on 4/24/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeBackupStore_h
+#define hifi_OctreeBackupStore_h
+
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+/// Backups of a persist file, kept as compressed chunks named by their content, so that a chunk shared by several
+/// versions is stored once. Chunk boundaries are found from the content with a rolling hash, so an edit only changes
+/// the chunks around it, and each new version only writes the chunks that changed since the ones already stored.
+///
+/// The store is a directory next to the persist file:
+///
+///     chunks/<first two hex digits>/<sha1 of the uncompressed chunk>
+///     versions/<time>-<rule>.json    the persisted file's name, size, and list of chunks
+class OctreeBackupStore {
+public:
+    static const int MIN_CHUNK_SIZE;
+    static const int MAX_CHUNK_SIZE;
+
+    class Version {
+    public:
+        QString manifestPath;
+        QString rule;
+        QString fileName; // the persist file that was backed up, without its path
+        qint64 size;
+        quint64 time; // usecs since the epoch
+    };
+
+    /// the store for a persist file, in a directory named after it without its extension
+    OctreeBackupStore(const QString& persistFileName);
+
+    const QString& getPath() const { return _path; }
+
+    /// Adds the file as a new version for the backup rule. Returns false, leaving the store as it was apart from some
+    /// unreferenced chunks, if the file can't be read or its chunks can't be written.
+    bool addVersion(const QString& fileName, const QString& rule);
+
+    /// every version, or every version of a rule, newest first
+    QList<Version> getVersions(const QString& rule = QString()) const;
+
+    /// Rebuilds a version into a file, and checks every chunk against its hash. The file is only replaced once all of
+    /// it has been written.
+    bool restoreVersion(const Version& version, const QString& toFileName) const;
+
+    /// removes the oldest versions of a rule past the number to keep, then the chunks no version needs any more
+    void pruneVersions(const QString& rule, int versionsToKeep);
+
+    /// the size of the next chunk, found from the content of the data
+    static int findChunkSize(const uchar* data, qint64 size);
+
+    // for logging, about the last addVersion()
+    int getChunksWritten() const { return _chunksWritten; }
+    int getChunksReused() const { return _chunksReused; }
+    qint64 getBytesWritten() const { return _bytesWritten; }
+
+private:
+    QString getChunkPath(const QString& hash) const;
+    bool writeChunk(const QString& hash, const QByteArray& chunk);
+    bool readVersionChunks(const QString& manifestPath, QStringList& chunks) const;
+    void removeUnusedChunks();
+
+    QString _path;
+    int _chunksWritten;
+    int _chunksReused;
+    qint64 _bytesWritten;
+};
+
+#endif // hifi_OctreeBackupStore_h
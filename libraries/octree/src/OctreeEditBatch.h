@@ -0,0 +1,43 @@
+//
+//  OctreeEditBatch.h
+//  libraries/octree/src
+//
+//  Created on 4/21/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeEditBatch_h
+#define hifi_OctreeEditBatch_h
+
+#include <QtCore/QByteArray>
+
+#include <Node.h>
+
+/// Edit packets queued for a tree, whose edits are decoded ahead of being applied. Decoding doesn't touch the tree, so
+/// it needs no lock and the queued packets can be decoded on several threads at once. The decoded edits are then
+/// applied in the order they arrived under one write lock, and the edits a later one makes redundant are dropped.
+/// Trees whose edits can be decoded this way return one from Octree::createEditBatch().
+class OctreeEditBatch {
+public:
+    virtual ~OctreeEditBatch() { }
+
+    /// queues a packet for the batch, its edits start at editOffset
+    virtual void addPacket(const SharedNodePointer& sendingNode, const QByteArray& packet, int editOffset) = 0;
+    virtual int getNumPackets() const = 0;
+
+    /// Decodes the edits of one queued packet. Different packets can be decoded on different threads at once, and
+    /// alongside edits to the tree.
+    virtual void decodePacket(int packetIndex) = 0;
+
+    /// the number of edits in a decoded packet, before any are dropped
+    virtual int getNumEditsInPacket(int packetIndex) const = 0;
+
+    /// Applies the edits of every decoded packet and empties the batch. The caller holds the tree's write lock. Returns
+    /// how many edits were dropped because a later edit in the batch made them redundant.
+    virtual int apply() = 0;
+};
+
+#endif // hifi_OctreeEditBatch_h
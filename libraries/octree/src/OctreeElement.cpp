@@ -15,7 +15,9 @@
 #include <stdio.h>
 
 #include <QtCore/QDebug>
+#include <QtCore/QMutex>
 
+#include <FixedBlockPool.h>
 #include <LogHandler.h>
 #include <NodeList.h>
 #include <PerfStat.h>
@@ -35,6 +37,115 @@ quint64 OctreeElement::_externalChildrenMemoryUsage = 0;
 quint64 OctreeElement::_voxelNodeCount = 0;
 quint64 OctreeElement::_voxelNodeLeafCount = 0;
 
+// Elements, the octal codes too long to store inline, and the child arrays of elements with more than one child all come
+// out of pools, so a tree is built from a few large slabs rather than millions of separate heap blocks, and the
+// elements a tree adds together sit next to each other. All trees share the pools, and trees can be changed from
+// different threads, so one mutex guards them. The pools are created when first used and never destroyed, so elements
+// can be created and deleted at any point of static initialization and destruction.
+const int BLOCKS_PER_SLAB = 1024;
+const int MAX_ELEMENT_POOLS = 4; // one for each size of element, there are only one or two element types in a process
+const size_t MAX_POOLED_OCTAL_CODE_BYTES = 16; // codes longer than this are rare, they're allocated on their own
+
+static QMutex poolMutex;
+static FixedBlockPool* elementPools[MAX_ELEMENT_POOLS] = { NULL };
+static size_t elementPoolSizes[MAX_ELEMENT_POOLS] = { 0 };
+static FixedBlockPool* octalCodePool = NULL;
+static FixedBlockPool* externalChildrenPool = NULL;
+
+// caller holds poolMutex, returns NULL if there are more sizes of element than pools
+static FixedBlockPool* poolForElementSize(size_t size) {
+    for (int i = 0; i < MAX_ELEMENT_POOLS; i++) {
+        if (!elementPools[i]) {
+            elementPools[i] = new FixedBlockPool(size, BLOCKS_PER_SLAB);
+            elementPoolSizes[i] = size;
+        }
+        if (elementPoolSizes[i] == size) {
+            return elementPools[i];
+        }
+    }
+    return NULL;
+}
+
+void* OctreeElement::operator new(size_t size) {
+    QMutexLocker locker(&poolMutex);
+    FixedBlockPool* pool = poolForElementSize(size);
+    return pool ? pool->allocate() : ::operator new(size);
+}
+
+void OctreeElement::operator delete(void* element, size_t size) {
+    if (!element) {
+        return;
+    }
+    QMutexLocker locker(&poolMutex);
+    FixedBlockPool* pool = poolForElementSize(size);
+    if (pool) {
+        pool->free(element);
+    } else {
+        ::operator delete(element);
+    }
+}
+
+// longer codes keep the buffer they were created in
+static unsigned char* allocatePooledOctalCode() {
+    QMutexLocker locker(&poolMutex);
+    if (!octalCodePool) {
+        octalCodePool = new FixedBlockPool(MAX_POOLED_OCTAL_CODE_BYTES, BLOCKS_PER_SLAB);
+    }
+    return static_cast<unsigned char*>(octalCodePool->allocate());
+}
+
+static void freeOctalCode(unsigned char* octalCode, size_t length) {
+    if (length > MAX_POOLED_OCTAL_CODE_BYTES) {
+        delete[] octalCode;
+        return;
+    }
+    QMutexLocker locker(&poolMutex);
+    octalCodePool->free(octalCode);
+}
+
+#ifdef SIMPLE_EXTERNAL_CHILDREN
+static OctreeElement** allocateExternalChildren() {
+    QMutexLocker locker(&poolMutex);
+    if (!externalChildrenPool) {
+        externalChildrenPool = new FixedBlockPool(NUMBER_OF_CHILDREN * sizeof(OctreeElement*), BLOCKS_PER_SLAB);
+    }
+    return static_cast<OctreeElement**>(externalChildrenPool->allocate());
+}
+
+static void freeExternalChildren(OctreeElement** children) {
+    QMutexLocker locker(&poolMutex);
+    externalChildrenPool->free(children);
+}
+#endif // def SIMPLE_EXTERNAL_CHILDREN
+
+quint64 OctreeElement::getPoolMemoryReserved() {
+    QMutexLocker locker(&poolMutex);
+    quint64 reserved = 0;
+    if (octalCodePool) {
+        reserved += octalCodePool->getReservedBytes();
+    }
+    if (externalChildrenPool) {
+        reserved += externalChildrenPool->getReservedBytes();
+    }
+    for (int i = 0; i < MAX_ELEMENT_POOLS && elementPools[i]; i++) {
+        reserved += elementPools[i]->getReservedBytes();
+    }
+    return reserved;
+}
+
+void OctreeElement::releaseUnusedPools() {
+    QMutexLocker locker(&poolMutex);
+    if (octalCodePool) {
+        octalCodePool->releaseIfUnused();
+    }
+    if (externalChildrenPool) {
+        externalChildrenPool->releaseIfUnused();
+    }
+    for (int i = 0; i < MAX_ELEMENT_POOLS && elementPools[i]; i++) {
+        elementPools[i]->releaseIfUnused();
+    }
+}
+
 void OctreeElement::resetPopulationStatistics() {
     _voxelNodeCount = 0;
     _voxelNodeLeafCount = 0;
@@ -57,7 +168,13 @@ void OctreeElement::init(unsigned char * octalCode) {
 
     size_t octalCodeLength = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(octalCode));
     if (octalCodeLength > sizeof(_octalCode)) {
-        _octalCode.pointer = octalCode;
+        if (octalCodeLength > MAX_POOLED_OCTAL_CODE_BYTES) {
+            _octalCode.pointer = octalCode;
+        } else {
+            _octalCode.pointer = allocatePooledOctalCode();
+            memcpy(_octalCode.pointer, octalCode, octalCodeLength);
+            delete[] octalCode;
+        }
         _octcodePointer = true;
         _octcodeMemoryUsage += octalCodeLength;
     } else {
@@ -69,6 +186,7 @@ void OctreeElement::init(unsigned char * octalCode) {
     // set up the _children union
     _childBitmask = 0;
     _childrenExternal = false;
+    _isSnapshot = false;
     
     
 #ifdef BLENDED_UNION_CHILDREN
@@ -102,15 +220,19 @@ void OctreeElement::init(unsigned char * octalCode) {
 }
 
 OctreeElement::~OctreeElement() {
-    notifyDeleteHooks();
+    // a snapshot is only deleted once no client is sending from it, telling every bag would just make that slow
+    if (!_isSnapshot) {
+        notifyDeleteHooks();
+    }
     _voxelNodeCount--;
     if (isLeaf()) {
         _voxelNodeLeafCount--;
     }
 
     if (_octcodePointer) {
-        _octcodeMemoryUsage -= bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(getOctalCode()));
-        delete[] _octalCode.pointer;
+        size_t octalCodeLength = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(getOctalCode()));
+        _octcodeMemoryUsage -= octalCodeLength;
+        freeOctalCode(_octalCode.pointer, octalCodeLength);
     }
 
     // delete all of this node's children, this also takes care of all population tracking data
@@ -665,7 +787,11 @@ void OctreeElement::deleteAllChildren() {
     
     if (_childrenExternal) {
         // if the children_t union represents _children.external we need to delete it here
+#ifdef SIMPLE_EXTERNAL_CHILDREN
+        freeExternalChildren(_children.external);
+#else
         delete[] _children.external;
+#endif
     }
 
 #ifdef BLENDED_UNION_CHILDREN
@@ -760,7 +886,7 @@ void OctreeElement::setChildAtIndex(int childIndex, OctreeElement* child) {
         _children.single = child;
     } else if (previousChildCount == 1 && newChildCount == 2) {
         OctreeElement* previousChild = _children.single;
-        _children.external = new OctreeElement*[NUMBER_OF_CHILDREN];
+        _children.external = allocateExternalChildren();
         memset(_children.external, 0, sizeof(OctreeElement*) * NUMBER_OF_CHILDREN);
         _children.external[firstIndex] = previousChild;
         _children.external[childIndex] = child;
@@ -774,7 +900,7 @@ void OctreeElement::setChildAtIndex(int childIndex, OctreeElement* child) {
         OctreeElement* previousFirstChild = _children.external[firstIndex];
         OctreeElement* previousSecondChild = _children.external[secondIndex];
 
-        delete[] _children.external;
+        freeExternalChildren(_children.external);
         _childrenExternal = false;
         
         _externalChildrenMemoryUsage -= NUMBER_OF_CHILDREN * sizeof(OctreeElement*);
@@ -61,6 +61,10 @@ public:
     virtual void init(unsigned char * octalCode); /// Your subclass must call init on construction.
     virtual ~OctreeElement();
 
+    /// elements of every type are allocated from pools, see OctreeElement.cpp
+    static void* operator new(size_t size);
+    static void operator delete(void* element, size_t size);
+
     // methods you can and should override to implement your tree functionality
     
     /// Adds a child to the current element. Override this if there is additional child initialization your class needs.
@@ -108,6 +112,10 @@ public:
     virtual int readElementDataFromBuffer(const unsigned char* data, int bytesLeftToRead, ReadBitstreamToTreeParams& args) 
                     { return 0; }
 
+    /// Override to copy the content of this element, not its children, into the matching element of a snapshot of its
+    /// tree, see Octree::createSnapshot()
+    virtual void copyContentsInto(OctreeElement* snapshotElement) const { }
+
     /// Override to indicate that the item is currently rendered in the rendering engine. By default we assume that if
     /// the element should be rendered, then your rendering engine is rendering. But some rendering engines my have cases
     /// where an element is not actually rendering all should render elements. If the isRendered() state doesn't match the
@@ -171,6 +179,19 @@ public:
     void markWithChangedTime();
     quint64 getLastChanged() const { return _lastChanged; }
     void handleSubtreeChanged(Octree* myTree);
+
+    /// called as a recursion unwinds from a child, so an element's change time is never older than any in its subtree
+    void updateChangedTimeFromChild(const OctreeElement* child) {
+        if (child->_lastChanged > _lastChanged) {
+            _lastChanged = child->_lastChanged;
+        }
+    }
+
+    /// called once this copy of the element in a snapshot has all its content and children
+    void becomeSnapshotOf(const OctreeElement* element) {
+        _lastChanged = element->_lastChanged;
+        _isSnapshot = true;
+    }
     
     // Used by VoxelSystem for rendering in/out of view and LOD
     void setShouldRender(bool shouldRender);
@@ -199,6 +220,12 @@ public:
     static quint64 getExternalChildrenMemoryUsage() { return _externalChildrenMemoryUsage; }
     static quint64 getTotalMemoryUsage() { return _octreeMemoryUsage + _octcodeMemoryUsage + _externalChildrenMemoryUsage; }
 
+    /// the bytes the element, octal code and child array pools hold, in use or free for reuse
+    static quint64 getPoolMemoryReserved();
+
+    /// gives the memory of the pools back to the system, when no element is left in any tree to use it
+    static void releaseUnusedPools();
+
     static quint64 getGetChildAtIndexTime() { return _getChildAtIndexTime; }
     static quint64 getGetChildAtIndexCalls() { return _getChildAtIndexCalls; }
     static quint64 getSetChildAtIndexTime() { return _setChildAtIndexTime; }
@@ -282,7 +309,7 @@ protected:
       unsigned char* pointer;
     } _octalCode;  
 
-    quint64 _lastChanged; /// Client and server, timestamp this node was last changed, 8 bytes
+    quint64 _lastChanged; /// Client and server, timestamp this node or a node below it was last changed, 8 bytes
 
     /// Client and server, pointers to child nodes, various encodings
 #ifdef SIMPLE_CHILD_ARRAY
@@ -325,7 +352,8 @@ protected:
          _shouldRender : 1, /// Client only, should this voxel render at this time, 1 bit
          _octcodePointer : 1, /// Client and Server only, is this voxel's octal code a pointer or buffer, 1 bit
          _unknownBufferIndex : 1,
-         _childrenExternal : 1; /// Client only, is this voxel's VBO buffer the unknown buffer index, 1 bit
+         _childrenExternal : 1, /// Client only, is this voxel's VBO buffer the unknown buffer index, 1 bit
+         _isSnapshot : 1; /// Server only, is this element part of a read only snapshot, no bag holds it past the snapshot
 
     static QReadWriteLock _deleteHooksLock;
     static std::vector<OctreeElementDeleteHook*> _deleteHooks;
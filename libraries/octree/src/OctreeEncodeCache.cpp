@@ -0,0 +1,87 @@
+//
+//  OctreeEncodeCache.cpp
+//  libraries/octree/src
+//
+//  Created on 4/13/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QHash>
+#include <QtCore/QMutexLocker>
+
+#include "OctreeEncodeCache.h"
+
+const int BYTES_PER_MB = 1024 * 1024;
+
+uint qHash(const OctreeEncodeCacheKey& key, uint seed) {
+    return qHash(key.element, seed) ^ qHash(key.elementLastChanged, seed) ^ qHash(key.contentSignature, seed);
+}
+
+OctreeEncodeCache::OctreeEncodeCache(int maxSizeMB) :
+    _mutex(),
+    _cache(),
+    _isEnabled(false),
+    _hits(0),
+    _misses(0),
+    _bytesReused(0)
+{
+    setMaxSizeMB(maxSizeMB);
+}
+
+void OctreeEncodeCache::setMaxSizeMB(int maxSizeMB) {
+    QMutexLocker locker(&_mutex);
+    _isEnabled = maxSizeMB > 0;
+    _cache.setMaxCost(_isEnabled ? maxSizeMB * BYTES_PER_MB : 0);
+}
+
+bool OctreeEncodeCache::find(const OctreeEncodeCacheKey& key, QByteArray& bytes) {
+    QMutexLocker locker(&_mutex);
+
+    // object() also moves the entry to the front of the LRU order, so this needs the lock as much as insert does
+    const QByteArray* cachedBytes = _cache.object(key);
+    if (!cachedBytes) {
+        _misses++;
+        return false;
+    }
+
+    bytes = *cachedBytes;
+    _hits++;
+    _bytesReused += bytes.size();
+    return true;
+}
+
+void OctreeEncodeCache::insert(const OctreeEncodeCacheKey& key, const unsigned char* data, int length) {
+    if (!_isEnabled) {
+        return;
+    }
+
+    QByteArray* bytes = new QByteArray(reinterpret_cast<const char*>(data), length);
+
+    QMutexLocker locker(&_mutex);
+    _cache.insert(key, bytes, length);
+}
+
+void OctreeEncodeCache::clear() {
+    QMutexLocker locker(&_mutex);
+    _cache.clear();
+}
+
+int OctreeEncodeCache::getNumEntries() {
+    QMutexLocker locker(&_mutex);
+    return _cache.count();
+}
+
+int OctreeEncodeCache::getSizeBytes() {
+    QMutexLocker locker(&_mutex);
+    return _cache.totalCost();
+}
+
+void OctreeEncodeCache::resetStats() {
+    QMutexLocker locker(&_mutex);
+    _hits = 0;
+    _misses = 0;
+    _bytesReused = 0;
+}
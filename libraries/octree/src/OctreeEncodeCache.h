@@ -0,0 +1,73 @@
+//
+//  OctreeEncodeCache.h
+//  libraries/octree/src
+//
+//  Created on 4/13/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeEncodeCache_h
+#define hifi_OctreeEncodeCache_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QCache>
+#include <QtCore/QMutex>
+
+class OctreeElement;
+
+const int DEFAULT_ENCODE_CACHE_SIZE_MB = 32;
+
+/// Identifies the data an element wrote into a packet for one full scene send. The content signature is a digest of
+/// everything else that went into the encode and is up to the element type, e.g. which of its entities were in view
+/// and when each of them last changed.
+struct OctreeEncodeCacheKey {
+    const OctreeElement* element;
+    quint64 elementLastChanged;
+    quint64 contentSignature;
+
+    bool operator==(const OctreeEncodeCacheKey& other) const {
+        return element == other.element && elementLastChanged == other.elementLastChanged
+            && contentSignature == other.contentSignature;
+    }
+};
+
+uint qHash(const OctreeEncodeCacheKey& key, uint seed = 0);
+
+/// Shared by every client of a server, so that when many clients need the same element data (a crowd arriving at the
+/// same place) it is encoded for the first one and copied into the packets of the rest. Safe to use from several
+/// send threads at once.
+class OctreeEncodeCache {
+public:
+    OctreeEncodeCache(int maxSizeMB = DEFAULT_ENCODE_CACHE_SIZE_MB);
+
+    /// 0 turns the cache off
+    void setMaxSizeMB(int maxSizeMB);
+    bool isEnabled() const { return _isEnabled; }
+
+    /// on a hit, sets bytes to a shared copy of the cached data
+    bool find(const OctreeEncodeCacheKey& key, QByteArray& bytes);
+    void insert(const OctreeEncodeCacheKey& key, const unsigned char* data, int length);
+
+    void clear();
+
+    quint64 getHits() const { return _hits; }
+    quint64 getMisses() const { return _misses; }
+    quint64 getBytesReused() const { return _bytesReused; }
+    int getNumEntries();
+    int getSizeBytes();
+    void resetStats();
+
+private:
+    QMutex _mutex;
+    QCache<OctreeEncodeCacheKey, QByteArray> _cache; // cost is the size in bytes
+    bool _isEnabled;
+
+    quint64 _hits;
+    quint64 _misses;
+    quint64 _bytesReused;
+};
+
+#endif // hifi_OctreeEncodeCache_h
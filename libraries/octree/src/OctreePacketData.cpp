@@ -9,6 +9,8 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <zlib.h>
+
 #include <GLMHelpers.h>
 #include <PerfStat.h>
 
@@ -25,7 +27,11 @@ quint64 OctreePacketData::_totalBytesOfRawData = 0;
 
 
 
-OctreePacketData::OctreePacketData(bool enableCompression, int targetSize) {
+OctreePacketData::OctreePacketData(bool enableCompression, int targetSize) :
+    _compressor(NULL),
+    _compressorLevel(0),
+    _compressionLevel(DEFAULT_OCTREE_COMPRESSION_LEVEL)
+{
     changeSettings(enableCompression, targetSize); // does reset...
 }
 
@@ -41,8 +47,8 @@ void OctreePacketData::reset() {
     _bytesReserved = 0;
     _subTreeAt = 0;
     _compressedBytes = 0;
-    _bytesInUseLastCheck = 0;
     _dirty = false;
+    _bytesCompressed = 0;
 
     _bytesOfOctalCodes = 0;
     _bytesOfBitMasks = 0;
@@ -51,6 +57,14 @@ void OctreePacketData::reset() {
 }
 
 OctreePacketData::~OctreePacketData() {
+    if (_compressor) {
+        deflateEnd(_compressor);
+        delete _compressor;
+    }
+}
+
+void OctreePacketData::setCompressionLevel(int level) {
+    _compressionLevel = qBound(Z_BEST_SPEED, level, Z_BEST_COMPRESSION);
 }
 
 bool OctreePacketData::append(const unsigned char* data, int length) {
@@ -125,6 +139,7 @@ bool OctreePacketData::updatePriorBitMask(int offset, unsigned char bitmask) {
     bool success = false;
     if (offset >= 0 && offset < _bytesInUse) {
         _uncompressed[offset] = bitmask;
+        uncompressedChangedAt(offset);
         success = true;
         _dirty = true;
     }
@@ -139,6 +154,7 @@ bool OctreePacketData::updatePriorBytes(int offset, const unsigned char* replace
         } else {
             memcpy(&_uncompressed[offset], replacementBytes, length); // copy new content
         }
+        uncompressedChangedAt(offset);
         success = true;
         _dirty = true;
     }
@@ -209,6 +225,7 @@ void OctreePacketData::discardSubTree() {
     _bytesInUse -= bytesInSubTree;
     _bytesAvailable += bytesInSubTree; 
     _subTreeAt = _bytesInUse; // should be the same actually...
+    uncompressedChangedAt(_bytesInUse);
     _dirty = true;
 
     // rewind to start of this subtree, other items rewound by endLevel()
@@ -248,6 +265,7 @@ void OctreePacketData::discardLevel(LevelDetails key) {
             
     _bytesInUse -= bytesInLevel;
     _bytesAvailable += bytesInLevel; 
+    uncompressedChangedAt(_bytesInUse);
     _dirty = true;
     
     // reserved bytes are reset to the value when the level started
@@ -454,6 +472,21 @@ bool OctreePacketData::appendRawData(const unsigned char* data, int length) {
 quint64 OctreePacketData::_compressContentTime = 0;
 quint64 OctreePacketData::_compressContentCalls = 0;
 
+// A whole packet fits in a small window, and a small compressor is cheap to keep around and to reset per packet.
+const int COMPRESSOR_WINDOW_BITS = 12;
+const int COMPRESSOR_MEMORY_LEVEL = 6;
+
+// like qCompress() output, the stream follows the uncompressed size, and ends with the adler32 of the content
+const int COMPRESSED_SIZE_BYTES = 4;
+const int CHECKSUM_BYTES = 4;
+
+static void writeBigEndian(unsigned char* destination, quint32 value) {
+    destination[0] = (value >> 24) & 0xff;
+    destination[1] = (value >> 16) & 0xff;
+    destination[2] = (value >> 8) & 0xff;
+    destination[3] = value & 0xff;
+}
+
 bool OctreePacketData::compressContent() { 
     PerformanceWarning warn(false, "OctreePacketData::compressContent()", false, &_compressContentTime, &_compressContentCalls);
     
@@ -462,26 +495,79 @@ bool OctreePacketData::compressContent() {
         return true;
     }
 
-    _bytesInUseLastCheck = _bytesInUse;
+    if (_bytesCompressed > 0 && _bytesCompressed == _bytesInUse) {
+        // the compressor has everything already
+        _dirty = false;
+        return true;
+    }
+
+    if (_bytesCompressed == 0) {
+        if (_compressor && _compressorLevel != _compressionLevel) {
+            deflateEnd(_compressor);
+            delete _compressor;
+            _compressor = NULL;
+        }
 
-    bool success = false;
-    const int MAX_COMPRESSION = 9;
+        if (!_compressor) {
+            _compressor = new z_stream();
+            if (deflateInit2(_compressor, _compressionLevel, Z_DEFLATED, COMPRESSOR_WINDOW_BITS,
+                             COMPRESSOR_MEMORY_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+                delete _compressor;
+                _compressor = NULL;
+                return false;
+            }
+            _compressorLevel = _compressionLevel;
+        } else {
+            deflateReset(_compressor);
+        }
+
+        _compressedStreamBytes = COMPRESSED_SIZE_BYTES;
+        _adler = adler32(0L, Z_NULL, 0);
+    } else {
+        // reopen the stream, the block we closed it with stops being final and the new ones overwrite the checksum
+        _compressed[_finalBlockBitOffset / BITS_IN_BYTE] &= ~(1 << (_finalBlockBitOffset % BITS_IN_BYTE));
+    }
 
-    // we only want to compress the data payload, not the message header
-    const uchar* uncompressedData = &_uncompressed[0];
-    int uncompressedSize = _bytesInUse;
+    // same limit as for a qCompress() buffer, leaving room for the checksum
+    const int MAX_STREAM_BYTES = MAX_OCTREE_PACKET_DATA_SIZE - 1 - CHECKSUM_BYTES;
 
-    QByteArray compressedData = qCompress(uncompressedData, uncompressedSize, MAX_COMPRESSION);
+    _compressor->next_in = &_uncompressed[_bytesCompressed];
+    _compressor->avail_in = _bytesInUse - _bytesCompressed;
+    _compressor->next_out = &_compressed[_compressedStreamBytes];
+    _compressor->avail_out = MAX_STREAM_BYTES - _compressedStreamBytes;
 
-    if (compressedData.size() < (int)MAX_OCTREE_PACKET_DATA_SIZE) {
-        _compressedBytes = compressedData.size();
-        for (int i = 0; i < _compressedBytes; i++) {
-            _compressed[i] = compressedData[i];
-        }
-        _dirty = false;
-        success = true;
+    // Z_BLOCK ends the current block without aligning it, so we know at which bit the next block starts. The sync flush
+    // then writes an empty stored block there, and setting its BFINAL bit closes the stream where it is.
+    unsigned int pendingBytes = 0;
+    int pendingBits = 0;
+    deflate(_compressor, Z_BLOCK);
+    deflatePending(_compressor, &pendingBytes, &pendingBits);
+    bool success = _compressor->avail_in == 0 && pendingBytes == 0;
+
+    if (success) {
+        _finalBlockBitOffset = (_compressor->next_out - &_compressed[0]) * BITS_IN_BYTE + pendingBits;
+        deflate(_compressor, Z_SYNC_FLUSH);
+        deflatePending(_compressor, &pendingBytes, &pendingBits);
+        success = pendingBytes == 0 && pendingBits == 0;
     }
-    return success;
+
+    if (!success) {
+        // it didn't fit, start over if there's another try
+        _bytesCompressed = 0;
+        return false;
+    }
+
+    _compressed[_finalBlockBitOffset / BITS_IN_BYTE] |= 1 << (_finalBlockBitOffset % BITS_IN_BYTE);
+    _compressedStreamBytes = _compressor->next_out - &_compressed[0];
+
+    _adler = adler32(_adler, &_uncompressed[_bytesCompressed], _bytesInUse - _bytesCompressed);
+    _bytesCompressed = _bytesInUse;
+
+    writeBigEndian(&_compressed[0], _bytesInUse);
+    writeBigEndian(&_compressed[_compressedStreamBytes], _adler);
+    _compressedBytes = _compressedStreamBytes + CHECKSUM_BYTES;
+    _dirty = false;
+    return true;
 }
 
 
@@ -491,20 +577,13 @@ void OctreePacketData::loadFinalizedContent(const unsigned char* data, int lengt
     if (data && length > 0) {
 
         if (_enableCompression) {
-            QByteArray compressedData;
-            for (int i = 0; i < length; i++) {
-                compressedData[i] = data[i];
-                _compressed[i] = compressedData[i];
-            }
+            memcpy(_compressed, data, length);
             _compressedBytes = length;
-            QByteArray uncompressedData = qUncompress(compressedData);
+            QByteArray uncompressedData = qUncompress(data, length);
             if (uncompressedData.size() <= _bytesAvailable) {
                 _bytesInUse = uncompressedData.size();
                 _bytesAvailable -= uncompressedData.size();
-
-                for (int i = 0; i < _bytesInUse; i++) {
-                    _uncompressed[i] = uncompressedData[i];
-                }
+                memcpy(_uncompressed, uncompressedData.constData(), _bytesInUse);
             }
         } else {
             for (int i = 0; i < length; i++) {
@@ -29,6 +29,8 @@
 #include "OctreeConstants.h"
 #include "OctreeElement.h"
 
+struct z_stream_s;
+
 typedef unsigned char OCTREE_PACKET_FLAGS;
 typedef uint16_t OCTREE_PACKET_SEQUENCE;
 const uint16_t MAX_OCTREE_PACKET_SEQUENCE = 65535;
@@ -48,6 +50,9 @@ const unsigned int MINIMUM_ATTEMPT_MORE_PACKING = sizeof(OCTREE_PACKET_INTERNAL_
 const unsigned int COMPRESS_PADDING = 15;
 const int REASONABLE_NUMBER_OF_PACKING_ATTEMPTS = 5;
 
+// zlib level used for compressed packets unless the server is configured with another one
+const int DEFAULT_OCTREE_COMPRESSION_LEVEL = 9;
+
 const int PACKET_IS_COLOR_BIT = 0;
 const int PACKET_IS_COMPRESSED_BIT = 1;
 
@@ -194,7 +199,7 @@ public:
     int getUncompressedSize() { return _bytesInUse; }
 
     /// update the size of the packet in uncompressed form
-    void setUncompressedSize(int newSize) { _bytesInUse = newSize; }
+    void setUncompressedSize(int newSize) { _bytesInUse = newSize; uncompressedChangedAt(newSize); _dirty = true; }
 
     /// has some content been written to the packet
     bool hasContent() const { return (_bytesInUse > 0); }
@@ -208,6 +213,10 @@ public:
     /// returns the target uncompressed size
     unsigned int getTargetSize() const { return _targetSize; }
 
+    /// sets the zlib level (1 to 9) compressed packets are made with, this takes effect from the next reset()
+    void setCompressionLevel(int level);
+    int getCompressionLevel() const { return _compressionLevel; }
+
     /// the number of bytes in the packet currently reserved
     int getReservedBytes() { return _bytesReserved; }
 
@@ -221,6 +230,9 @@ public:
     static quint64 getTotalBytesOfColor() { return _totalBytesOfColor; } /// total bytes of color
 
 private:
+    OctreePacketData(const OctreePacketData&); // not copyable, the compressor can't be shared
+    OctreePacketData& operator=(const OctreePacketData&);
+
     /// appends raw bytes, might fail if byte would cause packet to be too large
     bool append(const unsigned char* data, int length);
     
@@ -238,12 +250,26 @@ private:
     int _subTreeBytesReserved; // the number of reserved bytes at start of a subtree
 
     bool compressContent();
+
+    /// called when uncompressed bytes from offset on are changed or dropped, if the compressor already consumed any of
+    /// them it has to start over from the beginning of the packet
+    void uncompressedChangedAt(int offset) { if (offset < _bytesCompressed) { _bytesCompressed = 0; } }
     
     unsigned char _compressed[MAX_OCTREE_UNCOMRESSED_PACKET_SIZE];
     int _compressedBytes;
-    int _bytesInUseLastCheck;
     bool _dirty;
 
+    // The compressor keeps its deflate stream open between calls to compressContent(), so content appended after a
+    // finalize only costs compressing the new bytes. Every call sync flushes the stream and closes it with a trailer
+    // that the next call writes over, so _compressed is always a complete qCompress() compatible buffer.
+    z_stream_s* _compressor; // created the first time a packet is compressed
+    int _compressorLevel; // the level _compressor was created with
+    int _compressionLevel;
+    int _bytesCompressed; // how many bytes of _uncompressed the compressor has consumed
+    int _compressedStreamBytes; // bytes of _compressed before the trailer
+    int _finalBlockBitOffset; // the bit in _compressed that marks the last deflate block of the stream as final
+    unsigned long _adler; // checksum of the bytes the compressor has consumed
+
     // statistics...
     int _bytesOfOctalCodes;
     int _bytesOfBitMasks;
@@ -18,6 +18,7 @@
 #include <QDir>
 #include <QDirIterator>
 #include <QFile>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QJsonDocument>
@@ -33,7 +34,7 @@ const int OctreePersistThread::DEFAULT_PERSIST_INTERVAL = 1000 * 30; // every 30
 
 OctreePersistThread::OctreePersistThread(Octree* tree, const QString& filename, int persistInterval, 
                                          bool wantBackup, const QJsonObject& settings, bool debugTimestampNow,
-                                         QString persistAsFileType) :
+                                         QString persistAsFileType, int journalInterval, bool persistFromSnapshot) :
     _tree(tree),
     _filename(filename),
     _persistInterval(persistInterval),
@@ -41,9 +42,15 @@ OctreePersistThread::OctreePersistThread(Octree* tree, const QString& filename,
     _loadTimeUSecs(0),
     _lastCheck(0),
     _wantBackup(wantBackup),
+    _backupStore(filename),
     _debugTimestampNow(debugTimestampNow),
     _lastTimeDebug(0),
-    _persistAsFileType(persistAsFileType)
+    _persistAsFileType(persistAsFileType),
+    _persistFromSnapshot(persistFromSnapshot),
+    _journalInterval(journalInterval),
+    _lastJournalFlush(0),
+    _journalSize(0),
+    _persistFileSize(0)
 {
     parseSettings(settings);
 
@@ -85,7 +92,7 @@ void OctreePersistThread::parseSettings(const QJsonObject& settings) {
 
             BackupRule newRule = { obj["Name"].toString(), interval, obj["format"].toString(), count, 0};
                                     
-            newRule.lastBackup = getMostRecentBackupTimeInUsecs(obj["format"].toString());
+            newRule.lastBackup = getMostRecentBackupTimeInUsecs(newRule.name, newRule.extensionFormat);
             
             if (newRule.lastBackup > 0) {
                 quint64 now = usecTimestampNow();
@@ -102,8 +109,13 @@ void OctreePersistThread::parseSettings(const QJsonObject& settings) {
     }
 }
 
-quint64 OctreePersistThread::getMostRecentBackupTimeInUsecs(const QString& format) {
+quint64 OctreePersistThread::getMostRecentBackupTimeInUsecs(const QString& ruleName, const QString& format) {
+    QList<OctreeBackupStore::Version> versions = _backupStore.getVersions(ruleName);
+    if (!versions.isEmpty()) {
+        return versions.first().time;
+    }
 
+    // backups from before the backup store are whole copies of the persist file
     quint64 mostRecentBackupInUsecs = 0;
 
     QString mostRecentBackupFileName;
@@ -126,6 +138,7 @@ bool OctreePersistThread::process() {
         qCDebug(octree) << "loading Octrees from file: " << _filename << "...";
 
         bool persistantFileRead;
+        int journalRecordsReplayed = 0;
 
         _tree->lockForWrite();
         {
@@ -150,6 +163,20 @@ bool OctreePersistThread::process() {
             }
 
             persistantFileRead = _tree->readFromFile(qPrintable(_filename.toLocal8Bit()));
+            _persistFileSize = QFileInfo(_filename).size();
+
+            if (_journalInterval > 0 && !_tree->supportsEditJournal()) {
+                qCDebug(octree) << "This tree doesn't support an edit journal, persisting the whole tree instead.";
+                _journalInterval = 0;
+            }
+            if (_journalInterval > 0) {
+                // the edits that came after the last save, up to a crash or shutdown
+                journalRecordsReplayed = replayJournal();
+
+                // journaling starts before the tree is unlocked, so that no edit is missed
+                _tree->setWantEditJournal(true);
+            }
+
             _tree->pruneTree();
         }
         _tree->unlock();
@@ -158,6 +185,9 @@ bool OctreePersistThread::process() {
         _loadTimeUSecs = loadDone - loadStarted;
 
         _tree->clearDirtyBit(); // the tree is clean since we just loaded it
+        if (journalRecordsReplayed > 0) {
+            _tree->setDirtyBit(); // ...unless the journal had edits the file doesn't, then it's saved at the next check
+        }
         qCDebug(octree, "DONE loading Octrees from file... fileRead=%s", debug::valueOf(persistantFileRead));
 
         unsigned long nodeCount = OctreeElement::getNodeCount();
@@ -182,9 +212,9 @@ bool OctreePersistThread::process() {
 
         // Since we just loaded the persistent file, we can consider ourselves as having "just checked" for persistance.
         _lastCheck = usecTimestampNow(); // we just loaded, no need to save again
+        _lastJournalFlush = _lastCheck;
         
-        // This last persist time is not really used until the file is actually persisted. It is only
-        // used in formatting the backup filename in cases of non-rolling backup names. However, we don't
+        // This last persist time is not really used until the file is actually persisted. However, we don't
         // want an uninitialized value for this, so we set it to the current time (startup of the server)
         time(&_lastPersistTime);
 
@@ -206,6 +236,14 @@ bool OctreePersistThread::process() {
         if (sinceLastSave > intervalToCheck) {
             _lastCheck = now;
             persist();
+        } else if (_journalInterval > 0 && now - _lastJournalFlush > (quint64)_journalInterval * MSECS_TO_USECS) {
+            flushJournal();
+
+            // a journal bigger than the persist file costs more to replay than the file does to write, so write it early
+            if (_journalSize > _persistFileSize) {
+                _lastCheck = now;
+                persist();
+            }
         }
     }
     
@@ -226,13 +264,23 @@ bool OctreePersistThread::process() {
 
 void OctreePersistThread::aboutToFinish() {
     qCDebug(octree) << "Persist thread about to finish...";
-    persist();
+    if (_journalInterval > 0) {
+        // the journal is replayed at the next start, so there's no need to hold up shutdown with writing the whole tree
+        flushJournal();
+    } else {
+        persist();
+    }
     qCDebug(octree) << "Persist thread done with about to finish...";
     _stopThread = true;
 }
 
 void OctreePersistThread::persist() {
     if (_tree->isDirty()) {
+        if (_journalInterval > 0) {
+            // everything up to now goes in the journal first, in case this save doesn't make it
+            flushJournal();
+        }
+
         _tree->lockForWrite();
         {
             qCDebug(octree) << "pruning Octree before saving...";
@@ -252,22 +300,125 @@ void OctreePersistThread::persist() {
         if(lockFile.is_open()) {
             qCDebug(octree) << "saving Octree lock file created at:" << lockFileName;
 
-            _tree->writeToFile(qPrintable(_filename), NULL, _persistAsFileType);
+            bool saved;
+            Octree* snapshot = NULL;
+            if (_persistFromSnapshot) {
+                _tree->lockForRead();
+                snapshot = _tree->createSnapshot();
+                if (snapshot) {
+                    // edits made while the snapshot is written dirty the tree again
+                    _tree->clearDirtyBit();
+                }
+                _tree->unlock();
+            }
+            if (snapshot) {
+                qCDebug(octree) << "saving Octree from a snapshot...";
+                saved = snapshot->writeToFile(qPrintable(_filename), NULL, _persistAsFileType);
+                delete snapshot;
+                if (!saved) {
+                    _tree->setDirtyBit();
+                }
+            } else {
+                saved = _tree->writeToFile(qPrintable(_filename), NULL, _persistAsFileType);
+                if (saved) {
+                    _tree->clearDirtyBit(); // tree is clean after saving
+                }
+            }
             time(&_lastPersistTime);
-            _tree->clearDirtyBit(); // tree is clean after saving
             qCDebug(octree) << "DONE saving Octree to file...";
 
             lockFile.close();
             qCDebug(octree) << "saving Octree lock file closed:" << lockFileName;
             remove(qPrintable(lockFileName));
             qCDebug(octree) << "saving Octree lock file removed:" << lockFileName;
+
+            // The file has every edit the journal does now. Edits during the save were kept for the next flush, they
+            // may already be in the file but replaying them on top of it is harmless.
+            if (saved) {
+                _persistFileSize = QFileInfo(_filename).size();
+                if (_journalInterval > 0) {
+                    removeJournal();
+                }
+            }
+        }
+    }
+}
+
+void OctreePersistThread::flushJournal() {
+    _lastJournalFlush = usecTimestampNow();
+
+    QList<QByteArray> records;
+    _tree->lockForRead();
+    _tree->writeEditJournalRecords(records);
+    _tree->unlock();
+
+    if (records.isEmpty()) {
+        return;
+    }
+
+    QFile journalFile(getJournalFileName());
+    if (journalFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        foreach (const QByteArray& record, records) {
+            journalFile.write(record);
+            journalFile.write("\n");
+        }
+        journalFile.close();
+        _journalSize = journalFile.size();
+    } else {
+        // the tree is still dirty, so these edits are lost only if we crash before the next save
+        qCDebug(octree) << "ERROR appending" << records.size() << "records to edit journal" << journalFile.fileName();
+    }
+}
+
+int OctreePersistThread::replayJournal() {
+    QFile journalFile(getJournalFileName());
+    if (!journalFile.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    _journalSize = journalFile.size();
+
+    QList<QByteArray> records;
+    while (!journalFile.atEnd()) {
+        QByteArray record = journalFile.readLine();
+        if (!record.endsWith('\n')) {
+            // the last record was cut short by a crash while it was being appended
+            break;
         }
+        record.chop(1);
+        records << record;
     }
+
+    PerformanceWarning warn(true, "Replaying Octree Edit Journal", true);
+    int recordsReplayed = _tree->readEditJournalRecords(records);
+    qCDebug(octree) << "Replayed" << recordsReplayed << "of" << records.size() << "records from edit journal"
+                    << journalFile.fileName();
+    return recordsReplayed;
+}
+
+void OctreePersistThread::removeJournal() {
+    QFile::remove(getJournalFileName());
+    _journalSize = 0;
 }
 
 void OctreePersistThread::restoreFromMostRecentBackup() {
     qCDebug(octree) << "Restoring from most recent backup...";
-    
+
+    // newest first, an older version is only restored if a newer one can't be rebuilt
+    foreach (const OctreeBackupStore::Version& version, _backupStore.getVersions()) {
+        // the version keeps the name it was persisted with, in case the persist file type changed since
+        QString restoredFileName = QFileInfo(_filename).dir().filePath(version.fileName);
+        qCDebug(octree) << "Restoring backup version" << version.manifestPath << "to" << restoredFileName << "...";
+        if (_backupStore.restoreVersion(version, restoredFileName)) {
+            if (restoredFileName != _filename) {
+                qCDebug(octree) << "Removing old file:" << _filename;
+                remove(qPrintable(_filename));
+            }
+            qCDebug(octree) << "DONE restoring backup version" << version.manifestPath << "to" << restoredFileName;
+            return;
+        }
+    }
+
+    // backups from before the backup store are whole copies of the persist file
     QString mostRecentBackupFileName;
     QDateTime mostRecentBackupTime;
     
@@ -345,43 +496,6 @@ bool OctreePersistThread::getMostRecentBackup(const QString& format,
     return bestBackupFound;
 }
 
-void OctreePersistThread::rollOldBackupVersions(const BackupRule& rule) {
-
-    if (rule.extensionFormat.contains("%N")) {
-        if (rule.maxBackupVersions > 0) {
-            qCDebug(octree) << "Rolling old backup versions for rule" << rule.name << "...";
-            for(int n = rule.maxBackupVersions - 1; n > 0; n--) {
-                QString backupExtensionN = rule.extensionFormat;
-                QString backupExtensionNplusOne = rule.extensionFormat;
-                backupExtensionN.replace(QString("%N"), QString::number(n));
-                backupExtensionNplusOne.replace(QString("%N"), QString::number(n+1));
-
-                QString backupFilenameN = findMostRecentFileExtension(_filename, PERSIST_EXTENSIONS) + backupExtensionN;
-                QString backupFilenameNplusOne = _filename + backupExtensionNplusOne;
-
-                QFile backupFileN(backupFilenameN);
-
-                if (backupFileN.exists()) {
-                    qCDebug(octree) << "rolling backup file " << backupFilenameN << "to" << backupFilenameNplusOne << "...";
-                    int result = rename(qPrintable(backupFilenameN), qPrintable(backupFilenameNplusOne));
-                    if (result == 0) {
-                        qCDebug(octree) << "DONE rolling backup file " << backupFilenameN << "to" << backupFilenameNplusOne << "...";
-                    } else {
-                        qCDebug(octree) << "ERROR in rolling backup file " << backupFilenameN << "to" << backupFilenameNplusOne << "...";
-                        perror("ERROR in rolling backup file");
-                    }
-                }
-            }
-            qCDebug(octree) << "Done rolling old backup versions...";
-        } else {
-            qCDebug(octree) << "Rolling backups for rule" << rule.name << "."
-                     << " Max Rolled Backup Versions less than 1 [" << rule.maxBackupVersions << "]."
-                     << " No need to roll backups...";
-        }
-    }
-}
-
-
 void OctreePersistThread::backup() {
     qCDebug(octree) << "backup operation wantBackup:" << _wantBackup;
     if (_wantBackup) {
@@ -401,31 +515,22 @@ void OctreePersistThread::backup() {
                 qCDebug(octree) << "Time since last backup [" << sinceLastBackup << "] for rule [" << rule.name 
                                         << "] exceeds backup interval [" << intervalToBackup << "] doing backup now...";
 
-                struct tm* localTime = localtime(&_lastPersistTime);
-
-                QString backupFileName;
-            
-                // check to see if they asked for version rolling format
-                if (rule.extensionFormat.contains("%N")) {
-                    rollOldBackupVersions(rule); // rename all the old backup files accordingly
-                    QString backupExtension = rule.extensionFormat;
-                    backupExtension.replace(QString("%N"), QString("1"));
-                    backupFileName = _filename + backupExtension;
-                } else {
-                    char backupExtension[256];
-                    strftime(backupExtension, sizeof(backupExtension), qPrintable(rule.extensionFormat), localTime);
-                    backupFileName = _filename + backupExtension;
-                }
-
-
                 if (rule.maxBackupVersions > 0) {
                     QFile persistFile(_filename);
                     if (persistFile.exists()) {
-                        qCDebug(octree) << "backing up persist file " << _filename << "to" << backupFileName << "...";
-                        bool result = QFile::copy(_filename, backupFileName);
+                        // only the chunks of the file that no earlier version has are written
+                        qCDebug(octree) << "backing up persist file " << _filename << "to" << _backupStore.getPath() << "...";
+                        bool result = _backupStore.addVersion(_filename, rule.name);
                         if (result) {
-                            qCDebug(octree) << "DONE backing up persist file...";
+                            qCDebug(octree) << "DONE backing up persist file..." << _backupStore.getChunksWritten()
+                                << "chunks written," << _backupStore.getBytesWritten() << "bytes,"
+                                << _backupStore.getChunksReused() << "chunks already stored";
                             rule.lastBackup = now; // only record successful backup in this case.
+
+                            // a rolling rule keeps its newest versions, which used to be renamed from .1 up to .N
+                            if (rule.extensionFormat.contains("%N")) {
+                                _backupStore.pruneVersions(rule.name, rule.maxBackupVersions);
+                            }
                         } else {
                             qCDebug(octree) << "ERROR in backing up persist file...";
                             perror("ERROR in backing up persist file");
@@ -17,6 +17,7 @@
 #include <QString>
 #include <GenericThread.h>
 #include "Octree.h"
+#include "OctreeBackupStore.h"
 
 /// Generalized threaded processor for handling received inbound packets.
 class OctreePersistThread : public GenericThread {
@@ -35,7 +36,8 @@ public:
 
     OctreePersistThread(Octree* tree, const QString& filename, int persistInterval = DEFAULT_PERSIST_INTERVAL, 
                         bool wantBackup = false, const QJsonObject& settings = QJsonObject(), 
-                        bool debugTimestampNow = false, QString persistAsFileType="svo");
+                        bool debugTimestampNow = false, QString persistAsFileType="svo", int journalInterval = 0,
+                        bool persistFromSnapshot = false);
 
     bool isInitialLoadComplete() const { return _initialLoadComplete; }
     quint64 getLoadElapsedTime() const { return _loadTimeUSecs; }
@@ -51,11 +53,15 @@ protected:
     
     void persist();
     void backup();
-    void rollOldBackupVersions(const BackupRule& rule);
     void restoreFromMostRecentBackup();
     bool getMostRecentBackup(const QString& format, QString& mostRecentBackupFileName, QDateTime& mostRecentBackupTime);
-    quint64 getMostRecentBackupTimeInUsecs(const QString& format);
+    quint64 getMostRecentBackupTimeInUsecs(const QString& ruleName, const QString& format);
     void parseSettings(const QJsonObject& settings);
+
+    QString getJournalFileName() const { return _filename + ".journal"; }
+    void flushJournal();
+    int replayJournal();
+    void removeJournal();
     
 private:
     Octree* _tree;
@@ -69,11 +75,21 @@ private:
     quint64 _lastCheck;
     bool _wantBackup;
     QVector<BackupRule> _backupRules;
+    OctreeBackupStore _backupStore; // a rolling rule keeps its newest versions, the others keep every version
     
     bool _debugTimestampNow;
     quint64 _lastTimeDebug;
 
     QString _persistAsFileType;
+    bool _persistFromSnapshot; // the tree is copied under its lock, and the copy written while edits carry on
+
+    // With an edit journal, the tree's edits are appended to the journal every journal interval, and the whole tree
+    // is only written every persist interval, or sooner once the journal outgrows the persist file. At startup the
+    // journal is replayed on top of the persist file.
+    int _journalInterval;
+    quint64 _lastJournalFlush;
+    qint64 _journalSize;
+    qint64 _persistFileSize;
 };
 
 #endif // hifi_OctreePersistThread_h
@@ -0,0 +1,76 @@
+//
+//  FixedBlockPool.cpp
+//  libraries/shared/src
+//
+//  Created on 4/19/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <assert.h>
+
+#include "FixedBlockPool.h"
+
+// blocks are aligned for anything that might be stored in them
+const size_t BLOCK_ALIGNMENT = 16;
+
+FixedBlockPool::FixedBlockPool(size_t blockSize, int blocksPerSlab) :
+    _blockSize((blockSize + BLOCK_ALIGNMENT - 1) & ~(BLOCK_ALIGNMENT - 1)),
+    _blocksPerSlab(blocksPerSlab),
+    _slabs(),
+    _freeBlocks(NULL),
+    _nextBlockInSlab(blocksPerSlab),
+    _blocksInUse(0)
+{
+}
+
+FixedBlockPool::~FixedBlockPool() {
+    foreach (char* slab, _slabs) {
+        delete[] slab;
+    }
+}
+
+void* FixedBlockPool::allocate() {
+    _blocksInUse++;
+
+    if (_freeBlocks) {
+        FreeBlock* block = _freeBlocks;
+        _freeBlocks = block->next;
+        return block;
+    }
+
+    if (_nextBlockInSlab == _blocksPerSlab) {
+        // the allocators of the platforms we build for align blocks this large to at least BLOCK_ALIGNMENT
+        _slabs.append(new char[_blockSize * _blocksPerSlab]);
+        _nextBlockInSlab = 0;
+    }
+    return _slabs.last() + _blockSize * _nextBlockInSlab++;
+}
+
+void FixedBlockPool::free(void* block) {
+    if (!block) {
+        return;
+    }
+    assert(_blocksInUse > 0);
+    _blocksInUse--;
+
+    FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+    freeBlock->next = _freeBlocks;
+    _freeBlocks = freeBlock;
+}
+
+bool FixedBlockPool::releaseIfUnused() {
+    if (_blocksInUse > 0) {
+        return false;
+    }
+
+    foreach (char* slab, _slabs) {
+        delete[] slab;
+    }
+    _slabs.clear();
+    _freeBlocks = NULL;
+    _nextBlockInSlab = _blocksPerSlab;
+    return true;
+}
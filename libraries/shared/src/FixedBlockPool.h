@@ -0,0 +1,55 @@
+//
+//  FixedBlockPool.h
+//  libraries/shared/src
+//
+//  Created on 4/19/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_FixedBlockPool_h
+#define hifi_FixedBlockPool_h
+
+#include <stddef.h>
+
+#include <QtCore/QVector>
+
+/// Hands out blocks of one size, carved in order out of large slabs, so that blocks allocated together end up next to
+/// each other in memory. Freed blocks are kept for reuse, and the slabs only go back to the system all at once, when
+/// nothing is allocated from the pool anymore. Not thread safe, callers that share a pool need to lock around it.
+class FixedBlockPool {
+public:
+    FixedBlockPool(size_t blockSize, int blocksPerSlab);
+    ~FixedBlockPool();
+
+    void* allocate();
+    void free(void* block);
+
+    /// gives every slab back to the system if no block is in use, returns whether it did
+    bool releaseIfUnused();
+
+    size_t getBlockSize() const { return _blockSize; }
+    int getBlocksInUse() const { return _blocksInUse; }
+
+    /// the bytes held by this pool's slabs, whether their blocks are in use or not
+    quint64 getReservedBytes() const { return (quint64)_slabs.size() * _blockSize * _blocksPerSlab; }
+
+private:
+    FixedBlockPool(const FixedBlockPool&); // not copyable
+    FixedBlockPool& operator=(const FixedBlockPool&);
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    size_t _blockSize;
+    int _blocksPerSlab;
+    QVector<char*> _slabs;
+    FreeBlock* _freeBlocks; // blocks that were freed, reused before the rest of the newest slab
+    int _nextBlockInSlab; // the first block of the newest slab that was never handed out
+    int _blocksInUse;
+};
+
+#endif // hifi_FixedBlockPool_h
@@ -0,0 +1,71 @@
+//
+//  MPSCQueue.h
+//  libraries/shared/src
+//
+//  Created on 4/17/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_MPSCQueue_h
+#define hifi_MPSCQueue_h
+
+#include <utility>
+
+#include <QtCore/QAtomicPointer>
+
+/// An unbounded queue that any number of threads can push to without a lock, for a single thread to pop from. Items are
+/// moved in and moved out, never copied. This is the node based queue by Dmitry Vyukov: a push is one atomic exchange,
+/// and never waits on other pushes or on the pop.
+template <typename T>
+class MPSCQueue {
+public:
+    MPSCQueue() : _head(new Node()), _tail(_head.load()) { }
+
+    ~MPSCQueue() {
+        T item;
+        while (pop(item)) { }
+        delete _tail;
+    }
+
+    /// can be called from any thread
+    void push(T&& item) {
+        Node* node = new Node(std::move(item));
+        Node* previous = _head.fetchAndStoreAcqRel(node);
+        previous->next.storeRelease(node);
+    }
+
+    /// Must only be called from the consumer thread. Returns false if there was nothing to pop. While a push is half
+    /// done the items pushed after it stay hidden, and show up on a later call once it finishes.
+    bool pop(T& item) {
+        Node* next = _tail->next.loadAcquire();
+        if (!next) {
+            return false;
+        }
+
+        // the popped node becomes the new empty tail, and the old one can go
+        item = std::move(next->item);
+        delete _tail;
+        _tail = next;
+        return true;
+    }
+
+private:
+    MPSCQueue(const MPSCQueue&); // not copyable
+    MPSCQueue& operator=(const MPSCQueue&);
+
+    struct Node {
+        Node() : next(NULL), item() { }
+        Node(T&& item) : next(NULL), item(std::move(item)) { }
+
+        QAtomicPointer<Node> next;
+        T item;
+    };
+
+    QAtomicPointer<Node> _head; // the last node pushed
+    Node* _tail; // the node before the next one to pop, only touched by the consumer
+};
+
+#endif // hifi_MPSCQueue_h
@@ -9,9 +9,21 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <string.h>
+
+#include <QtCore/QtEndian>
+
 #include "UUID.h"
 
 QString uuidStringWithoutCurlyBraces(const QUuid& uuid) {
     QString uuidStringNoBraces = uuid.toString().mid(1, uuid.toString().length() - 2);
     return uuidStringNoBraces;
 }
+
+void uuidToRfc4122(const QUuid& uuid, char* destination) {
+    uchar* bytes = reinterpret_cast<uchar*>(destination);
+    qToBigEndian(uuid.data1, bytes);
+    qToBigEndian(uuid.data2, bytes + sizeof(uuid.data1));
+    qToBigEndian(uuid.data3, bytes + sizeof(uuid.data1) + sizeof(uuid.data2));
+    memcpy(bytes + sizeof(uuid.data1) + sizeof(uuid.data2) + sizeof(uuid.data3), uuid.data4, sizeof(uuid.data4));
+}
@@ -0,0 +1,169 @@
+//
+//  AudioMixKernelsTests.cpp
+//  tests/audio/src
+//
+//  Created on 4/10/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+
+#include "AudioConstants.h"
+
+#include "AudioMixKernelsTests.h"
+
+// room for a stereo network frame plus the slack the mixer keeps for phase delay
+const int TEST_BUFFER_SAMPLES = AudioConstants::NETWORK_FRAME_SAMPLES_STEREO + 64;
+
+static void fillWithRandomSamples(int16_t* samples, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+        samples[i] = (int16_t)((rand() % 65536) - 32768);
+    }
+}
+
+static bool assertSamplesMatch(const char* kernelName, const int16_t* vectorized, const int16_t* scalar) {
+    for (int i = 0; i < TEST_BUFFER_SAMPLES; i++) {
+        if (vectorized[i] != scalar[i]) {
+            qDebug("%s mismatch at sample %d!  Expected: %d  Actual: %d", kernelName, i, scalar[i], vectorized[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+void AudioMixKernelsTests::runAllTests() {
+    int16_t source[TEST_BUFFER_SAMPLES];
+    int16_t original[TEST_BUFFER_SAMPLES];
+    int16_t vectorized[TEST_BUFFER_SAMPLES];
+    int16_t scalar[TEST_BUFFER_SAMPLES];
+
+    const int NUM_ITERATIONS = 1000;
+
+    for (int T = 0; T < NUM_ITERATIONS; T++) {
+        fillWithRandomSamples(source, TEST_BUFFER_SAMPLES);
+        fillWithRandomSamples(original, TEST_BUFFER_SAMPLES);
+
+        // odd sample counts exercise the scalar tail of each kernel
+        int numSamples = rand() % (AudioConstants::NETWORK_FRAME_SAMPLES_STEREO + 1);
+        float gain = rand() / (float)RAND_MAX;
+
+        memcpy(vectorized, original, sizeof(original));
+        memcpy(scalar, original, sizeof(original));
+        AudioMixKernels::mixSaturated(vectorized, source, numSamples);
+        AudioMixKernels::mixSaturatedScalar(scalar, source, numSamples);
+        if (!assertSamplesMatch("mixSaturated", vectorized, scalar)) {
+            return;
+        }
+
+        memcpy(vectorized, original, sizeof(original));
+        memcpy(scalar, original, sizeof(original));
+        AudioMixKernels::mixScaledSaturated(vectorized, source, numSamples, gain);
+        AudioMixKernels::mixScaledSaturatedScalar(scalar, source, numSamples, gain);
+        if (!assertSamplesMatch("mixScaledSaturated", vectorized, scalar)) {
+            return;
+        }
+
+        // write the right channel, the left channel has to come out untouched
+        int numChannelSamples = numSamples / 2;
+        memcpy(vectorized, original, sizeof(original));
+        memcpy(scalar, original, sizeof(original));
+        AudioMixKernels::mixScaledIntoInterleavedChannel(vectorized + 1, source, numChannelSamples, gain);
+        AudioMixKernels::mixScaledIntoInterleavedChannelScalar(scalar + 1, source, numChannelSamples, gain);
+        if (!assertSamplesMatch("mixScaledIntoInterleavedChannel", vectorized, scalar)) {
+            return;
+        }
+
+        memcpy(vectorized, original, sizeof(original));
+        memcpy(scalar, original, sizeof(original));
+        AudioMixKernels::scale(vectorized, source, numSamples, gain);
+        AudioMixKernels::scaleScalar(scalar, source, numSamples, gain);
+        if (!assertSamplesMatch("scale", vectorized, scalar)) {
+            return;
+        }
+
+        float vectorizedSum = AudioMixKernels::sumOfAbsolutes(source, numSamples);
+        float scalarSum = AudioMixKernels::sumOfAbsolutesScalar(source, numSamples);
+        if (vectorizedSum != scalarSum) {
+            qDebug("sumOfAbsolutes mismatch!  Expected: %f  Actual: %f", scalarSum, vectorizedSum);
+            return;
+        }
+    }
+
+    qDebug() << "AudioMixKernels passed all tests";
+}
+
+template<typename Kernel>
+static void printSamplesPerSecond(const char* kernelName, Kernel kernel) {
+    const int NUM_FRAMES = 200000;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < NUM_FRAMES; i++) {
+        kernel();
+    }
+
+    double seconds = timer.nsecsElapsed() / 1.0e9;
+    double samplesPerSecond = ((double)NUM_FRAMES * AudioConstants::NETWORK_FRAME_SAMPLES_STEREO) / seconds;
+    qDebug("%40s | %8.1f Msamples/sec", kernelName, samplesPerSecond / 1.0e6);
+}
+
+void AudioMixKernelsTests::runBenchmarks() {
+    static int16_t source[TEST_BUFFER_SAMPLES];
+    static int16_t dest[TEST_BUFFER_SAMPLES];
+
+    fillWithRandomSamples(source, TEST_BUFFER_SAMPLES);
+    fillWithRandomSamples(dest, TEST_BUFFER_SAMPLES);
+
+    const int FRAME_SAMPLES = AudioConstants::NETWORK_FRAME_SAMPLES_STEREO;
+    const float GAIN = 0.5f;
+
+#ifdef HIFI_AUDIO_MIX_KERNELS_SSE2
+    qDebug() << "Benchmarking audio mix kernels, SSE2 enabled";
+#else
+    qDebug() << "Benchmarking audio mix kernels, no SIMD support in this build";
+#endif
+
+    printSamplesPerSecond("mixSaturatedScalar", [&]{
+        AudioMixKernels::mixSaturatedScalar(dest, source, FRAME_SAMPLES);
+    });
+    printSamplesPerSecond("mixSaturated", [&]{
+        AudioMixKernels::mixSaturated(dest, source, FRAME_SAMPLES);
+    });
+    printSamplesPerSecond("mixScaledSaturatedScalar", [&]{
+        AudioMixKernels::mixScaledSaturatedScalar(dest, source, FRAME_SAMPLES, GAIN);
+    });
+    printSamplesPerSecond("mixScaledSaturated", [&]{
+        AudioMixKernels::mixScaledSaturated(dest, source, FRAME_SAMPLES, GAIN);
+    });
+    printSamplesPerSecond("mixScaledIntoInterleavedChannelScalar", [&]{
+        AudioMixKernels::mixScaledIntoInterleavedChannelScalar(dest, source, FRAME_SAMPLES / 2, GAIN);
+        AudioMixKernels::mixScaledIntoInterleavedChannelScalar(dest + 1, source, FRAME_SAMPLES / 2, GAIN);
+    });
+    printSamplesPerSecond("mixScaledIntoInterleavedChannel", [&]{
+        AudioMixKernels::mixScaledIntoInterleavedChannel(dest, source, FRAME_SAMPLES / 2, GAIN);
+        AudioMixKernels::mixScaledIntoInterleavedChannel(dest + 1, source, FRAME_SAMPLES / 2, GAIN);
+    });
+    printSamplesPerSecond("scaleScalar", [&]{
+        AudioMixKernels::scaleScalar(dest, source, FRAME_SAMPLES, GAIN);
+    });
+    printSamplesPerSecond("scale", [&]{
+        AudioMixKernels::scale(dest, source, FRAME_SAMPLES, GAIN);
+    });
+
+    // keep the compiler from dropping the loudness loops
+    volatile float sum = 0.0f;
+    printSamplesPerSecond("sumOfAbsolutesScalar", [&]{
+        sum = sum + AudioMixKernels::sumOfAbsolutesScalar(source, FRAME_SAMPLES);
+    });
+    printSamplesPerSecond("sumOfAbsolutes", [&]{
+        sum = sum + AudioMixKernels::sumOfAbsolutes(source, FRAME_SAMPLES);
+    });
+}
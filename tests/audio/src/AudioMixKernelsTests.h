@@ -0,0 +1,26 @@
+//
+//  AudioMixKernelsTests.h
+//  tests/audio/src
+//
+//  Created on 4/10/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioMixKernelsTests_h
+#define hifi_AudioMixKernelsTests_h
+
+#include "AudioMixKernels.h"
+
+namespace AudioMixKernelsTests {
+
+    /// checks that every kernel produces exactly what its scalar version does
+    void runAllTests();
+
+    /// prints samples/sec for the scalar and vectorized version of each kernel
+    void runBenchmarks();
+};
+
+#endif // hifi_AudioMixKernelsTests_h
@@ -11,10 +11,12 @@
 #include <WS2tcpip.h>
 #else
 #include <sys/socket.h>
+#include <sys/resource.h>
 #include <arpa/inet.h>
 #endif
 #include <cerrno>
 #include <stdio.h>
+#include <vector>
 
 #include <MovingMinMaxAvg.h>
 #include <SequenceNumberStats.h>
@@ -24,13 +26,85 @@
 
 const quint64 MSEC_TO_USEC = 1000;
 const quint64 LARGE_STATS_TIME = 500; // we don't expect stats calculation to take more than this many usecs
+const int MAX_PACKETS_PER_BATCH = 64; // the most the batched modes hand to a single sendmmsg or recvmmsg
 
-void runSend(const char* addressOption, int port, int gap, int size, int report);
-void runReceive(const char* addressOption, int port, int gap, int size, int report);
+void runSend(const char* addressOption, int port, int gap, int size, int report, int packetsPerGap, bool batched);
+void runReceive(const char* addressOption, int port, int gap, int size, int report, bool batched);
+
+// the user and system CPU time this process has used so far
+quint64 usecsOfCPUTime() {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (quint64)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * USECS_PER_SECOND
+        + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#endif
+}
+
+// sends count copies of the packet, with sendmmsg if batched and where we have it, returns the system calls it took
+int sendPackets(int sockfd, char* const* buffers, int size, int count, struct sockaddr_in& servaddr, bool batched) {
+    int numCalls = 0;
+#ifdef __linux__
+    if (batched) {
+        struct mmsghdr messages[MAX_PACKETS_PER_BATCH];
+        struct iovec iovecs[MAX_PACKETS_PER_BATCH];
+        memset(messages, 0, sizeof(messages));
+        for (int i = 0; i < count; i++) {
+            iovecs[i].iov_base = buffers[i];
+            iovecs[i].iov_len = size;
+            messages[i].msg_hdr.msg_name = &servaddr;
+            messages[i].msg_hdr.msg_namelen = sizeof(servaddr);
+            messages[i].msg_hdr.msg_iov = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        int sent = 0;
+        while (sent < count) {
+            int n = sendmmsg(sockfd, messages + sent, count - sent, 0);
+            numCalls++;
+            if (n < 0) {
+                std::cout << "Send error: " << strerror(errno) << "\n";
+                break;
+            }
+            sent += n;
+        }
+        return numCalls;
+    }
+#endif
+    for (int i = 0; i < count; i++) {
+        int n = sendto(sockfd, buffers[i], size, 0, (struct sockaddr *)&servaddr, sizeof(servaddr));
+        numCalls++;
+        if (n < 0) {
+            std::cout << "Send error: " << strerror(errno) << "\n";
+        }
+    }
+    return numCalls;
+}
+
+// blocks for at least one packet, and with recvmmsg if batched also takes whatever else is already waiting
+int receivePackets(int sockfd, char* const* buffers, int size, bool batched) {
+#ifdef __linux__
+    if (batched) {
+        struct mmsghdr messages[MAX_PACKETS_PER_BATCH];
+        struct iovec iovecs[MAX_PACKETS_PER_BATCH];
+        memset(messages, 0, sizeof(messages));
+        for (int i = 0; i < MAX_PACKETS_PER_BATCH; i++) {
+            iovecs[i].iov_base = buffers[i];
+            iovecs[i].iov_len = size;
+            messages[i].msg_hdr.msg_iov = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        return recvmmsg(sockfd, messages, MAX_PACKETS_PER_BATCH, MSG_WAITFORONE, NULL);
+    }
+#endif
+    return recvfrom(sockfd, buffers[0], size, 0, NULL, NULL) < 0 ? -1 : 1; // we don't care about where it came from
+}
 
 int main(int argc, const char * argv[]) {
-    if (argc != 7) {
-        printf("usage: jitter-tests <--send|--receive> <address> <port> <gap in usecs> <packet size> <report interval in msecs>\n");
+    if (argc != 7 && argc != 8) {
+        printf("usage: jitter-tests <--send|--receive|--send-batched|--receive-batched> <address> <port> "
+               "<gap in usecs> <packet size> <report interval in msecs> [packets per gap]\n");
         exit(1);
     }
     const char* typeOption = argv[1];
@@ -43,22 +117,28 @@ int main(int argc, const char * argv[]) {
     int gap = atoi(gapOption);
     int size = atoi(sizeOption);
     int report = atoi(reportOption);
+    int packetsPerGap = (argc == 8) ? qBound(1, atoi(argv[7]), MAX_PACKETS_PER_BATCH) : 1;
 
     std::cout << "type:" << typeOption << "\n";
     std::cout << "address:" << addressOption << "\n";
     std::cout << "port:" << port << "\n";
     std::cout << "gap:" << gap << "\n";
     std::cout << "size:" << size << "\n";
+    std::cout << "packetsPerGap:" << packetsPerGap << "\n";
 
     if (strcmp(typeOption, "--send") == 0) {
-        runSend(addressOption, port, gap, size, report);
+        runSend(addressOption, port, gap, size, report, packetsPerGap, false);
     } else if (strcmp(typeOption, "--receive") == 0) {
-        runReceive(addressOption, port, gap, size, report);
+        runReceive(addressOption, port, gap, size, report, false);
+    } else if (strcmp(typeOption, "--send-batched") == 0) {
+        runSend(addressOption, port, gap, size, report, packetsPerGap, true);
+    } else if (strcmp(typeOption, "--receive-batched") == 0) {
+        runReceive(addressOption, port, gap, size, report, true);
     }
     exit(1);
 }
 
-void runSend(const char* addressOption, int port, int gap, int size, int report) {
+void runSend(const char* addressOption, int port, int gap, int size, int report, int packetsPerGap, bool batched) {
     std::cout << "runSend...\n";
 
 #ifdef _WIN32
@@ -96,11 +176,19 @@ void runSend(const char* addressOption, int port, int gap, int size, int report)
     MovingMinMaxAvg<int> timeGaps(SAMPLES_FOR_SECOND, INTERVALS_PER_30_SECONDS);
     MovingMinMaxAvg<int> timeGapsPerReport(SAMPLES_FOR_SECOND, intervalsPerReport);
 
-    char* outputBuffer = new char[size];
-    memset(outputBuffer, 0, size);
+    // each packet of a gap gets its own buffer, since a batch hands them all to the kernel at once
+    std::vector<char*> outputBuffers(packetsPerGap);
+    for (int i = 0; i < packetsPerGap; i++) {
+        outputBuffers[i] = new char[size];
+        memset(outputBuffers[i], 0, size);
+    }
 
     quint16 outgoingSequenceNumber = 0;
 
+    quint64 packetsSinceReport = 0;
+    quint64 systemCallsSinceReport = 0;
+    quint64 cpuTimeAtLastReport = usecsOfCPUTime();
+
 
     StDev stDevReportInterval;
     StDev stDev30s;
@@ -122,18 +210,17 @@ void runSend(const char* addressOption, int port, int gap, int size, int report)
 
         if (actualGap >= gap) {
 
-            // pack seq num
-            memcpy(outputBuffer, &outgoingSequenceNumber, sizeof(quint16));
+            // pack seq nums
+            for (int i = 0; i < packetsPerGap; i++) {
+                memcpy(outputBuffers[i], &outgoingSequenceNumber, sizeof(quint16));
+                outgoingSequenceNumber++;
+            }
 
             quint64 networkStart = usecTimestampNow();
-            int n = sendto(sockfd, outputBuffer, size, 0, (struct sockaddr *)&servaddr, sizeof(servaddr));
+            systemCallsSinceReport += sendPackets(sockfd, &outputBuffers[0], size, packetsPerGap, servaddr, batched);
             quint64 networkEnd = usecTimestampNow();
             float networkElapsed = (float)(networkEnd - networkStart);
-
-            if (n < 0) {
-                std::cout << "Send error: " << strerror(errno) << "\n";
-            }
-            outgoingSequenceNumber++;
+            packetsSinceReport += packetsPerGap;
 
             quint64 statsCalcultionStart = usecTimestampNow();
 
@@ -181,6 +268,14 @@ void runSend(const char* addressOption, int port, int gap, int size, int report)
                     << "      stats: " << averageStatsCalcultionTime.getAverage() << " usecs average"
                     << "\n";
 
+                quint64 cpuTime = usecsOfCPUTime();
+                std::cout << "Cost Per Packet Last report interval:\n"
+                    << "system calls: " << (float)systemCallsSinceReport / packetsSinceReport << ", "
+                    << "cpu: " << (float)(cpuTime - cpuTimeAtLastReport) / packetsSinceReport << " usecs\n";
+                packetsSinceReport = 0;
+                systemCallsSinceReport = 0;
+                cpuTimeAtLastReport = cpuTime;
+
                 stDevReportInterval.reset();
                 if (stDev30s.getSamples() > SAMPLES_FOR_30_SECONDS) {
                     stDev30s.reset();
@@ -198,14 +293,16 @@ void runSend(const char* addressOption, int port, int gap, int size, int report)
 
         }
     }
-    delete[] outputBuffer;
+    for (int i = 0; i < packetsPerGap; i++) {
+        delete[] outputBuffers[i];
+    }
 
 #ifdef _WIN32
     WSACleanup();
 #endif
 }
 
-void runReceive(const char* addressOption, int port, int gap, int size, int report) {
+void runReceive(const char* addressOption, int port, int gap, int size, int report, bool batched) {
     std::cout << "runReceive...\n";
 
 #ifdef _WIN32
@@ -216,7 +313,7 @@ void runReceive(const char* addressOption, int port, int gap, int size, int repo
     }
 #endif
 
-    int sockfd, n;
+    int sockfd;
     struct sockaddr_in myaddr;
 
     sockfd = socket(AF_INET, SOCK_DGRAM, 0);
@@ -244,9 +341,16 @@ void runReceive(const char* addressOption, int port, int gap, int size, int repo
     MovingMinMaxAvg<int> timeGaps(SAMPLES_FOR_SECOND, INTERVALS_PER_30_SECONDS);
     MovingMinMaxAvg<int> timeGapsPerReport(SAMPLES_FOR_SECOND, intervalsPerReport);
 
-    char* inputBuffer = new char[size];
-    memset(inputBuffer, 0, size);
+    // a whole batch of packets can come back from a single recvmmsg
+    char* inputBuffers[MAX_PACKETS_PER_BATCH];
+    for (int i = 0; i < MAX_PACKETS_PER_BATCH; i++) {
+        inputBuffers[i] = new char[size];
+        memset(inputBuffers[i], 0, size);
+    }
 
+    quint64 packetsSinceReport = 0;
+    quint64 systemCallsSinceReport = 0;
+    quint64 cpuTimeAtLastReport = usecsOfCPUTime();
 
     SequenceNumberStats seqStats(REPORTS_FOR_30_SECONDS);
 
@@ -270,18 +374,23 @@ void runReceive(const char* addressOption, int port, int gap, int size, int repo
     while (true) {
     
         quint64 networkStart = usecTimestampNow();
-        n = recvfrom(sockfd, inputBuffer, size, 0, NULL, NULL); // we don't care about where it came from
+        int numPackets = receivePackets(sockfd, inputBuffers, size, batched);
 
         quint64 networkEnd = usecTimestampNow();
         float networkElapsed = (float)(networkEnd - networkStart);
 
-        if (n < 0) {
+        systemCallsSinceReport++;
+        if (numPackets < 0) {
             std::cout << "Receive error: " << strerror(errno) << "\n";
+            continue;
         }
+        packetsSinceReport += numPackets;
 
-        // parse seq num
-        quint16 incomingSequenceNumber = *(reinterpret_cast<quint16*>(inputBuffer));
-        seqStats.sequenceNumberReceived(incomingSequenceNumber);
+        // parse seq nums, the gap stats below are per wake up of the receiver rather than per packet
+        for (int i = 0; i < numPackets; i++) {
+            quint16 incomingSequenceNumber = *(reinterpret_cast<quint16*>(inputBuffers[i]));
+            seqStats.sequenceNumberReceived(incomingSequenceNumber);
+        }
 
         if (last == 0) {
             last = usecTimestampNow();
@@ -337,6 +446,15 @@ void runReceive(const char* addressOption, int port, int gap, int size, int repo
                     << "\n";
                 stDevReportInterval.reset();
 
+                quint64 cpuTime = usecsOfCPUTime();
+                std::cout << "Cost Per Packet Last report interval:\n"
+                    << "system calls: " << (float)systemCallsSinceReport / qMax(packetsSinceReport, (quint64)1) << ", "
+                    << "cpu: " << (float)(cpuTime - cpuTimeAtLastReport) / qMax(packetsSinceReport, (quint64)1)
+                    << " usecs\n";
+                packetsSinceReport = 0;
+                systemCallsSinceReport = 0;
+                cpuTimeAtLastReport = cpuTime;
+
                 if (stDev30s.getSamples() > SAMPLES_FOR_30_SECONDS) {
                     stDev30s.reset();
                 }
@@ -368,7 +486,9 @@ void runReceive(const char* addressOption, int port, int gap, int size, int repo
             hasStatsCalculationTime = true;
         }
     }
-    delete[] inputBuffer;
+    for (int i = 0; i < MAX_PACKETS_PER_BATCH; i++) {
+        delete[] inputBuffers[i];
+    }
 
 #ifdef _WIN32
     WSACleanup();
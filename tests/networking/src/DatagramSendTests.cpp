@@ -0,0 +1,173 @@
+//
+//  DatagramSendTests.cpp
+//  tests/networking/src
+//
+//  Created on 4/15/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstdlib>
+#include <cstring>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtNetwork/QUdpSocket>
+
+#include <LimitedNodeList.h>
+#include <PacketHeaders.h>
+#include <UUID.h>
+
+#include "DatagramSendTests.h"
+
+// Qt containers allocate with malloc rather than new, so to count allocations per packet we count calls to the
+// malloc family. That needs the glibc entry points underneath them, elsewhere the benchmark only reports timing.
+static QBasicAtomicInt allocationCount = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+#ifdef __GLIBC__
+#define HAS_ALLOCATION_COUNT
+
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+
+    void* malloc(size_t size) {
+        allocationCount.fetchAndAddRelaxed(1);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) {
+        allocationCount.fetchAndAddRelaxed(1);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size) {
+        allocationCount.fetchAndAddRelaxed(1);
+        return __libc_realloc(pointer, size);
+    }
+}
+#endif
+
+// a mixed audio packet is what the audio mixer sends most of
+const int TEST_PAYLOAD_BYTES = 2 * 512 + sizeof(quint16);
+
+static QByteArray randomPacket(PacketType type, const QUuid& sessionUUID, int payloadBytes) {
+    QByteArray packet = byteArrayWithPopulatedHeader(type, sessionUUID);
+    for (int i = 0; i < payloadBytes; i++) {
+        packet.append((char)(rand() % 256));
+    }
+    // these tests compare against the MD5 the send path always used, so send as if to a peer that only knows MD5
+    setVersionForPeerHashMode(packet.data(), PacketHashModeMD5);
+    return packet;
+}
+
+// the send path before it stamped hashes in place, as used for a const char* datagram
+static void replaceHashTheOldWay(QByteArray& datagram, const QUuid& connectionSecret) {
+    datagram.replace(numBytesForPacketHeader(datagram) - NUM_BYTES_MD5_HASH, NUM_BYTES_MD5_HASH,
+                     QCryptographicHash::hash(datagram.mid(numBytesForPacketHeader(datagram))
+                                              + connectionSecret.toRfc4122(), QCryptographicHash::Md5));
+}
+
+void DatagramSendTests::runAllTests() {
+    uuidToRfc4122Test();
+    inPlaceHashTest();
+}
+
+void DatagramSendTests::uuidToRfc4122Test() {
+    const int NUM_UUIDS = 1000;
+    for (int i = 0; i < NUM_UUIDS; i++) {
+        QUuid uuid = QUuid::createUuid();
+        char rfcUUID[NUM_BYTES_RFC4122_UUID];
+        uuidToRfc4122(uuid, rfcUUID);
+
+        if (QByteArray(rfcUUID, NUM_BYTES_RFC4122_UUID) != uuid.toRfc4122()) {
+            qDebug() << "uuidToRfc4122Test() FAILED for" << uuid;
+            return;
+        }
+    }
+    qDebug() << "uuidToRfc4122Test() passed";
+}
+
+void DatagramSendTests::inPlaceHashTest() {
+    QUuid sessionUUID = QUuid::createUuid();
+
+    const int NUM_PACKETS = 1000;
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        QUuid connectionSecret = QUuid::createUuid();
+        QByteArray expected = randomPacket(PacketTypeMixedAudio, sessionUUID, rand() % TEST_PAYLOAD_BYTES);
+        QByteArray actual = expected;
+        actual.detach();
+
+        replaceHashTheOldWay(expected, connectionSecret);
+        replaceHashInPacketGivenConnectionUUID(actual.data(), actual.size(), connectionSecret);
+
+        if (actual != expected) {
+            qDebug() << "inPlaceHashTest() FAILED for a packet of" << expected.size() << "bytes";
+            return;
+        }
+
+        if (hashFromPacketHeader(actual) != hashForPacketAndConnectionUUID(actual, connectionSecret)) {
+            qDebug() << "inPlaceHashTest() FAILED to verify a packet of" << expected.size() << "bytes";
+            return;
+        }
+    }
+    qDebug() << "inPlaceHashTest() passed";
+}
+
+void DatagramSendTests::runBenchmarks() {
+    // nothing reads from this socket, once its receive buffer is full the kernel just drops what we send it
+    QUdpSocket receivingSocket;
+    receivingSocket.bind(QHostAddress::LocalHost, 0);
+    QHostAddress destinationAddress = QHostAddress::LocalHost;
+    quint16 destinationPort = receivingSocket.localPort();
+
+    QUdpSocket sendingSocket;
+    sendingSocket.bind(QHostAddress::LocalHost, 0);
+
+    QUuid connectionSecret = QUuid::createUuid();
+    QByteArray packet = randomPacket(PacketTypeMixedAudio, QUuid::createUuid(), TEST_PAYLOAD_BYTES);
+    char buffer[MAX_PACKET_SIZE];
+    memcpy(buffer, packet.constData(), packet.size());
+
+    const int NUM_PACKETS = 100000;
+    QElapsedTimer timer;
+
+    int allocationsBefore = allocationCount.load();
+    timer.start();
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        // the mixer handed us a const char*, which was wrapped and then copied before the hash went in
+        QByteArray datagram(buffer, packet.size());
+        QByteArray datagramCopy = datagram;
+        replaceHashTheOldWay(datagramCopy, connectionSecret);
+        sendingSocket.writeDatagram(datagramCopy, destinationAddress, destinationPort);
+    }
+    qint64 copyingElapsed = timer.nsecsElapsed();
+    float copyingAllocations = (float)(allocationCount.load() - allocationsBefore) / NUM_PACKETS;
+
+    allocationsBefore = allocationCount.load();
+    timer.restart();
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        replaceHashInPacketGivenConnectionUUID(buffer, packet.size(), connectionSecret);
+        sendingSocket.writeDatagram(buffer, packet.size(), destinationAddress, destinationPort);
+    }
+    qint64 inPlaceElapsed = timer.nsecsElapsed();
+    float inPlaceAllocations = (float)(allocationCount.load() - allocationsBefore) / NUM_PACKETS;
+
+    const double NSECS_PER_SECOND = 1e9;
+#ifdef HAS_ALLOCATION_COUNT
+    qDebug("copying send path:  %10.0f packets/sec, %5.2f allocations/packet",
+           NUM_PACKETS * NSECS_PER_SECOND / copyingElapsed, copyingAllocations);
+    qDebug("in place send path: %10.0f packets/sec, %5.2f allocations/packet",
+           NUM_PACKETS * NSECS_PER_SECOND / inPlaceElapsed, inPlaceAllocations);
+#else
+    Q_UNUSED(copyingAllocations);
+    Q_UNUSED(inPlaceAllocations);
+    qDebug("copying send path:  %10.0f packets/sec", NUM_PACKETS * NSECS_PER_SECOND / copyingElapsed);
+    qDebug("in place send path: %10.0f packets/sec", NUM_PACKETS * NSECS_PER_SECOND / inPlaceElapsed);
+#endif
+}
@@ -0,0 +1,27 @@
+//
+//  DatagramSendTests.h
+//  tests/networking/src
+//
+//  Created on 4/15/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_DatagramSendTests_h
+#define hifi_DatagramSendTests_h
+
+namespace DatagramSendTests {
+
+    void runAllTests();
+
+    // checks that stamping the hash in place gives the same packet as the QByteArray path
+    void inPlaceHashTest();
+    void uuidToRfc4122Test();
+
+    // packets per second and allocations per packet for the old copying send path and the in place one
+    void runBenchmarks();
+};
+
+#endif // hifi_DatagramSendTests_h
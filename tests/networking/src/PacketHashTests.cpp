@@ -0,0 +1,208 @@
+//
+//  PacketHashTests.cpp
+//  tests/networking/src
+//
+//  Created on 4/16/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstdlib>
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+
+#include <PacketHeaders.h>
+#include <SipHash.h>
+
+#include "PacketHashTests.h"
+
+// a mixed audio packet is what the audio mixer sends most of
+const int TEST_PAYLOAD_BYTES = 2 * 512 + sizeof(quint16);
+
+static QByteArray randomPacket(PacketType type, const QUuid& sessionUUID, int payloadBytes) {
+    QByteArray packet = byteArrayWithPopulatedHeader(type, sessionUUID);
+    for (int i = 0; i < payloadBytes; i++) {
+        packet.append((char)(rand() % 256));
+    }
+    return packet;
+}
+
+// the receive path before SipHash, as packetVersionAndHashMatch did it
+static bool md5HashMatchesTheOldWay(const QByteArray& packet, const QUuid& connectionSecret) {
+    return packet.mid(numBytesForPacketHeader(packet) - NUM_BYTES_MD5_HASH, NUM_BYTES_MD5_HASH)
+        == QCryptographicHash::hash(packet.mid(numBytesForPacketHeader(packet)) + connectionSecret.toRfc4122(),
+                                    QCryptographicHash::Md5);
+}
+
+void PacketHashTests::runAllTests() {
+    sipHashReferenceTest();
+    hashModeTest();
+    compactHeaderTest();
+}
+
+void PacketHashTests::sipHashReferenceTest() {
+    // the key is 00 01 .. 0f and the message of each length is 00 01 02 ..
+    struct ReferenceVector {
+        int length;
+        quint64 hash;
+    };
+    const ReferenceVector REFERENCE_VECTORS[] = {
+        { 0, 0x726fdb47dd0e0e31ULL },
+        { 1, 0x74f839c593dc67fdULL },
+        { 2, 0x0d6c8009d9a94f5aULL },
+        { 3, 0x85676696d7fb7e2dULL },
+        { 8, 0x93f5f5799a932462ULL },
+        { 15, 0xa129ca6149be45e5ULL },
+        { 63, 0x958a324ceb064572ULL }
+    };
+
+    char key[NUM_BYTES_SIP_HASH_KEY];
+    for (int i = 0; i < NUM_BYTES_SIP_HASH_KEY; i++) {
+        key[i] = i;
+    }
+    char message[64];
+    for (int i = 0; i < (int)sizeof(message); i++) {
+        message[i] = i;
+    }
+
+    for (unsigned int i = 0; i < sizeof(REFERENCE_VECTORS) / sizeof(ReferenceVector); i++) {
+        if (sipHash24(key, message, REFERENCE_VECTORS[i].length) != REFERENCE_VECTORS[i].hash) {
+            qDebug() << "sipHashReferenceTest() FAILED for a message of" << REFERENCE_VECTORS[i].length << "bytes";
+            return;
+        }
+    }
+    qDebug() << "sipHashReferenceTest() passed";
+}
+
+void PacketHashTests::hashModeTest() {
+    QUuid sessionUUID = QUuid::createUuid();
+
+    const int NUM_PACKETS = 1000;
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        QUuid connectionSecret = QUuid::createUuid();
+        QByteArray packet = randomPacket(PacketTypeMixedAudio, sessionUUID, rand() % TEST_PAYLOAD_BYTES);
+
+        // a peer that can verify SipHash gets the SipHash version
+        setVersionForPeerHashMode(packet.data(), PacketHashModeSipHash);
+        replaceHashInPacketGivenConnectionUUID(packet, connectionSecret);
+        if (hashModeForPacket(packet.constData()) != PacketHashModeSipHash
+            || packet[numBytesArithmeticCodingFromBuffer(packet.constData())]
+                != sipHashVersionForPacketType(PacketTypeMixedAudio)
+            || !isAcceptedVersionForPacketType(PacketTypeMixedAudio,
+                                               packet[numBytesArithmeticCodingFromBuffer(packet.constData())])
+            || !packetHashMatchesConnectionUUID(packet.constData(), packet.size(), connectionSecret)) {
+            qDebug() << "hashModeTest() FAILED to verify a SipHash packet of" << packet.size() << "bytes";
+            return;
+        }
+
+        // and the hash is really keyed with the secret
+        if (packetHashMatchesConnectionUUID(packet.constData(), packet.size(), QUuid::createUuid())) {
+            qDebug() << "hashModeTest() FAILED, a SipHash packet verified with the wrong secret";
+            return;
+        }
+
+        // an old peer gets the version before SipHash, hashed exactly as it always was
+        setVersionForPeerHashMode(packet.data(), PacketHashModeMD5);
+        replaceHashInPacketGivenConnectionUUID(packet, connectionSecret);
+        if (hashModeForPacket(packet.constData()) != PacketHashModeMD5
+            || !isAcceptedVersionForPacketType(PacketTypeMixedAudio,
+                                               packet[numBytesArithmeticCodingFromBuffer(packet.constData())])
+            || !md5HashMatchesTheOldWay(packet, connectionSecret)
+            || !packetHashMatchesConnectionUUID(packet.constData(), packet.size(), connectionSecret)) {
+            qDebug() << "hashModeTest() FAILED to verify an MD5 packet of" << packet.size() << "bytes";
+            return;
+        }
+    }
+
+    // types that haven't moved to SipHash are left alone
+    QByteArray entityPacket = randomPacket(PacketTypeEntityData, sessionUUID, TEST_PAYLOAD_BYTES);
+    setVersionForPeerHashMode(entityPacket.data(), PacketHashModeSipHash);
+    if (hashModeForPacket(entityPacket.constData()) != PacketHashModeMD5
+        || entityPacket[numBytesArithmeticCodingFromBuffer(entityPacket.constData())]
+            != versionForPacketType(PacketTypeEntityData)) {
+        qDebug() << "hashModeTest() FAILED, an entity data packet changed hash mode";
+        return;
+    }
+    qDebug() << "hashModeTest() passed";
+}
+
+void PacketHashTests::compactHeaderTest() {
+    QUuid sessionUUID = QUuid::createUuid();
+
+    const int NUM_PACKETS = 1000;
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        QUuid connectionSecret = QUuid::createUuid();
+        LocalNodeID localID = 1 + rand() % 0xfffe;
+        QByteArray packet = randomPacket(PacketTypeMixedAudio, sessionUUID, rand() % TEST_PAYLOAD_BYTES);
+        QByteArray payload = packet.mid(numBytesForPacketHeader(packet));
+
+        setVersionForPeerHashMode(packet.data(), PacketHashModeCompactSipHash);
+        int offset = compactPacketHeader(packet.data(), localID);
+        QByteArray compactPacket = packet.mid(offset);
+        replaceHashInPacketGivenConnectionUUID(compactPacket, connectionSecret);
+
+        if (offset != NUM_STATIC_HEADER_BYTES + NUM_BYTES_MD5_HASH - NUM_COMPACT_HEADER_BYTES_AFTER_TYPE
+            || !hasCompactHeader(compactPacket.constData())
+            || packetTypeForPacket(compactPacket) != PacketTypeMixedAudio
+            || !isAcceptedVersionForPacketType(PacketTypeMixedAudio,
+                                               compactPacket[numBytesArithmeticCodingFromBuffer(compactPacket.constData())])
+            || localIDFromPacketHeader(compactPacket.constData()) != localID
+            || compactPacket.mid(numBytesForPacketHeader(compactPacket)) != payload) {
+            qDebug() << "compactHeaderTest() FAILED to compact the header of a packet of" << packet.size() << "bytes";
+            return;
+        }
+
+        if (!packetHashMatchesConnectionUUID(compactPacket.constData(), compactPacket.size(), connectionSecret)
+            || packetHashMatchesConnectionUUID(compactPacket.constData(), compactPacket.size(), QUuid::createUuid())) {
+            qDebug() << "compactHeaderTest() FAILED to verify a compact packet of" << compactPacket.size() << "bytes";
+            return;
+        }
+    }
+    qDebug() << "compactHeaderTest() passed";
+}
+
+void PacketHashTests::runBenchmarks() {
+    QUuid connectionSecret = QUuid::createUuid();
+
+    QByteArray md5Packet = randomPacket(PacketTypeMixedAudio, QUuid::createUuid(), TEST_PAYLOAD_BYTES);
+    setVersionForPeerHashMode(md5Packet.data(), PacketHashModeMD5);
+    replaceHashInPacketGivenConnectionUUID(md5Packet, connectionSecret);
+
+    QByteArray sipHashPacket = md5Packet;
+    setVersionForPeerHashMode(sipHashPacket.data(), PacketHashModeSipHash);
+    replaceHashInPacketGivenConnectionUUID(sipHashPacket, connectionSecret);
+
+    const int NUM_PACKETS = 100000;
+    int numMatches = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        numMatches += md5HashMatchesTheOldWay(md5Packet, connectionSecret);
+    }
+    qint64 oldMD5Elapsed = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        numMatches += packetHashMatchesConnectionUUID(md5Packet.constData(), md5Packet.size(), connectionSecret);
+    }
+    qint64 md5Elapsed = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        numMatches += packetHashMatchesConnectionUUID(sipHashPacket.constData(), sipHashPacket.size(), connectionSecret);
+    }
+    qint64 sipHashElapsed = timer.nsecsElapsed();
+
+    if (numMatches != 3 * NUM_PACKETS) {
+        qDebug() << "PacketHashTests::runBenchmarks() FAILED, not every packet matched";
+    }
+
+    qDebug("MD5 hash match, old way: %8.3f usecs/packet", oldMD5Elapsed / 1000.0 / NUM_PACKETS);
+    qDebug("MD5 hash match:          %8.3f usecs/packet", md5Elapsed / 1000.0 / NUM_PACKETS);
+    qDebug("SipHash hash match:      %8.3f usecs/packet", sipHashElapsed / 1000.0 / NUM_PACKETS);
+}
@@ -0,0 +1,32 @@
+//
+//  PacketHashTests.h
+//  tests/networking/src
+//
+//  Created on 4/16/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_PacketHashTests_h
+#define hifi_PacketHashTests_h
+
+namespace PacketHashTests {
+
+    void runAllTests();
+
+    // checks our SipHash-2-4 against the vectors from the reference implementation
+    void sipHashReferenceTest();
+
+    // checks that packets verify in the mode their version gives, and that old peers still get MD5
+    void hashModeTest();
+
+    // checks that a compacted header names the sender by local ID, leaves the payload alone and verifies
+    void compactHeaderTest();
+
+    // time per packet to match the hash of a received packet, MD5 as it was done before against SipHash
+    void runBenchmarks();
+};
+
+#endif // hifi_PacketHashTests_h
@@ -0,0 +1,137 @@
+//
+//  PacketRingTests.cpp
+//  tests/networking/src
+//
+//  Created on 4/17/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QtCore/QDebug>
+#include <QtCore/QThread>
+
+#include <PacketRing.h>
+
+#include "PacketRingTests.h"
+
+static void writePacket(PacketRing::Slot* slot, int sequence) {
+    // vary the size so that slots are resized both ways
+    slot->packet.resize(sizeof(int) + sequence % 512);
+    memcpy(slot->packet.data(), &sequence, sizeof(int));
+    slot->senderSockAddr.setPort(sequence % 65536);
+}
+
+static int sequenceOfPacket(const PacketRing::Slot* slot) {
+    int sequence;
+    memcpy(&sequence, slot->packet.constData(), sizeof(int));
+    if (slot->packet.size() != (int)sizeof(int) + sequence % 512 || slot->senderSockAddr.getPort() != sequence % 65536) {
+        return -1;
+    }
+    return sequence;
+}
+
+class PacketRingProducer : public QThread {
+public:
+    PacketRingProducer(PacketRing& ring, int numPackets) : _ring(ring), _numPackets(numPackets) { }
+
+protected:
+    virtual void run() {
+        for (int i = 0; i < _numPackets; i++) {
+            PacketRing::Slot* slot = _ring.beginWrite();
+            if (slot) {
+                writePacket(slot, i);
+                _ring.endWrite();
+            } else {
+                _ring.recordDrop();
+            }
+        }
+    }
+
+private:
+    PacketRing& _ring;
+    int _numPackets;
+};
+
+void PacketRingTests::runAllTests() {
+    singleThreadTest();
+    producerConsumerTest();
+}
+
+void PacketRingTests::singleThreadTest() {
+    const int NUM_SLOTS = 16;
+    PacketRing ring(NUM_SLOTS);
+
+    for (int round = 0; round < 3; round++) {
+        // one more than fits, the last is dropped
+        for (int i = 0; i <= NUM_SLOTS; i++) {
+            PacketRing::Slot* slot = ring.beginWrite();
+            if (!slot) {
+                ring.recordDrop();
+                continue;
+            }
+            writePacket(slot, i);
+            ring.endWrite();
+        }
+
+        if (ring.getDepth() != NUM_SLOTS || ring.getNumDropped() != round + 1) {
+            qDebug() << "singleThreadTest() FAILED, depth" << ring.getDepth() << "and" << ring.getNumDropped() << "dropped";
+            return;
+        }
+
+        for (int i = 0; i < NUM_SLOTS; i++) {
+            PacketRing::Slot* slot = ring.beginRead();
+            if (!slot || sequenceOfPacket(slot) != i) {
+                qDebug() << "singleThreadTest() FAILED to read packet" << i << "back";
+                return;
+            }
+            ring.endRead();
+        }
+
+        if (ring.beginRead() || ring.getDepth() != 0) {
+            qDebug() << "singleThreadTest() FAILED, ring not empty after reading everything back";
+            return;
+        }
+    }
+    qDebug() << "singleThreadTest() passed";
+}
+
+void PacketRingTests::producerConsumerTest() {
+    const int NUM_SLOTS = 64;
+    const int NUM_PACKETS = 100000;
+    PacketRing ring(NUM_SLOTS);
+
+    PacketRingProducer producer(ring, NUM_PACKETS);
+    producer.start();
+
+    int numReceived = 0;
+    int lastSequence = -1;
+    bool producerDone = false;
+    while (!producerDone) {
+        // check before draining, so nothing written before the producer finished is left behind
+        producerDone = producer.isFinished();
+
+        PacketRing::Slot* slot;
+        while ((slot = ring.beginRead())) {
+            int sequence = sequenceOfPacket(slot);
+            if (sequence <= lastSequence) {
+                qDebug() << "producerConsumerTest() FAILED, packet" << sequence << "after" << lastSequence;
+                producer.wait();
+                return;
+            }
+            lastSequence = sequence;
+            numReceived++;
+            ring.endRead();
+        }
+    }
+
+    if (numReceived + ring.getNumDropped() != NUM_PACKETS) {
+        qDebug() << "producerConsumerTest() FAILED," << numReceived << "received and" << ring.getNumDropped()
+            << "dropped of" << NUM_PACKETS;
+        return;
+    }
+    qDebug() << "producerConsumerTest() passed," << ring.getNumDropped() << "of" << NUM_PACKETS << "dropped";
+}
@@ -0,0 +1,26 @@
+//
+//  PacketRingTests.h
+//  tests/networking/src
+//
+//  Created on 4/17/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_PacketRingTests_h
+#define hifi_PacketRingTests_h
+
+namespace PacketRingTests {
+
+    void runAllTests();
+
+    // fills and drains the ring from one thread, checking order, depth and drops
+    void singleThreadTest();
+
+    // a producer thread and a consumer thread, every packet is either received in order or counted as dropped
+    void producerConsumerTest();
+};
+
+#endif // hifi_PacketRingTests_h
@@ -0,0 +1,176 @@
+//
+//  ReceivedPacketProcessorTests.cpp
+//  tests/networking/src
+//
+//  Created on 4/17/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+#include <PacketHeaders.h>
+#include <ReceivedPacketProcessor.h>
+
+#include "ReceivedPacketProcessorTests.h"
+
+// about the size of a typical entity edit
+const int TEST_PAYLOAD_BYTES = 200;
+
+static SharedNodePointer createTestNode() {
+    return SharedNodePointer(new Node(QUuid::createUuid(), NodeType::Agent, HifiSockAddr(), HifiSockAddr(), true, true));
+}
+
+static QByteArray editPacket(const SharedNodePointer& node, int sequence) {
+    QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeEntityAddOrEdit, node->getUUID());
+    packet.append(reinterpret_cast<const char*>(&sequence), sizeof(int));
+    packet.append(QByteArray(TEST_PAYLOAD_BYTES, 'e'));
+    return packet;
+}
+
+// checks that the packets of each node come out in the order they went in
+class OrderCheckingProcessor : public ReceivedPacketProcessor {
+public:
+    OrderCheckingProcessor(const QVector<SharedNodePointer>& nodes) :
+        _nodes(nodes),
+        _nextSequences(nodes.size(), 0),
+        _numProcessed(0),
+        _numOutOfOrder(0) { }
+
+    bool processQueuedPackets() { return process(); }
+
+    int getNumProcessed() const { return _numProcessed; }
+    int getNumOutOfOrder() const { return _numOutOfOrder; }
+
+protected:
+    virtual void processPacket(const SharedNodePointer& sendingNode, const QByteArray& packet) {
+        int sequence;
+        memcpy(&sequence, packet.constData() + numBytesForPacketHeader(packet), sizeof(int));
+
+        int nodeIndex = _nodes.indexOf(sendingNode);
+        if (nodeIndex < 0 || sequence != _nextSequences[nodeIndex]) {
+            _numOutOfOrder++;
+        } else {
+            _nextSequences[nodeIndex]++;
+        }
+        _numProcessed++;
+    }
+
+    // don't wait long for packets, the test stops calling process() once everything is in
+    virtual unsigned long getMaxWait() const { return 1; }
+
+private:
+    QVector<SharedNodePointer> _nodes;
+    QVector<int> _nextSequences;
+    int _numProcessed;
+    int _numOutOfOrder;
+};
+
+class PacketQueueingThread : public QThread {
+public:
+    PacketQueueingThread(ReceivedPacketProcessor& processor, const SharedNodePointer& node, int numPackets) :
+        _processor(processor), _node(node), _numPackets(numPackets) { }
+
+protected:
+    virtual void run() {
+        for (int i = 0; i < _numPackets; i++) {
+            _processor.queueReceivedPacket(_node, editPacket(_node, i));
+        }
+    }
+
+private:
+    ReceivedPacketProcessor& _processor;
+    SharedNodePointer _node;
+    int _numPackets;
+};
+
+void ReceivedPacketProcessorTests::runAllTests() {
+    concurrentQueueTest();
+}
+
+void ReceivedPacketProcessorTests::concurrentQueueTest() {
+    const int NUM_NODES = 4;
+    const int NUM_PACKETS_PER_NODE = 25000;
+
+    QVector<SharedNodePointer> nodes;
+    for (int i = 0; i < NUM_NODES; i++) {
+        nodes.append(createTestNode());
+    }
+    OrderCheckingProcessor processor(nodes);
+
+    QVector<PacketQueueingThread*> threads;
+    for (int i = 0; i < NUM_NODES; i++) {
+        threads.append(new PacketQueueingThread(processor, nodes[i], NUM_PACKETS_PER_NODE));
+        threads[i]->start();
+    }
+
+    // process on this thread while the others are queueing, until they're done and everything has been processed
+    bool isQueueing = true;
+    while (isQueueing || processor.hasPacketsToProcess()) {
+        isQueueing = false;
+        foreach (PacketQueueingThread* thread, threads) {
+            isQueueing = isQueueing || !thread->isFinished();
+        }
+        processor.processQueuedPackets();
+    }
+
+    foreach (PacketQueueingThread* thread, threads) {
+        thread->wait();
+        delete thread;
+    }
+
+    if (processor.getNumProcessed() != NUM_NODES * NUM_PACKETS_PER_NODE || processor.getNumOutOfOrder() > 0) {
+        qDebug() << "concurrentQueueTest() FAILED, processed" << processor.getNumProcessed() << "packets,"
+            << processor.getNumOutOfOrder() << "out of order";
+        return;
+    }
+
+    foreach (const SharedNodePointer& node, nodes) {
+        if (processor.hasPacketsToProcessFrom(node)) {
+            qDebug() << "concurrentQueueTest() FAILED, a node still has packets to process";
+            return;
+        }
+    }
+    qDebug() << "concurrentQueueTest() passed";
+}
+
+void ReceivedPacketProcessorTests::runBenchmarks() {
+    const int NUM_PACKETS = 100000;
+
+    QVector<SharedNodePointer> nodes;
+    nodes.append(createTestNode());
+    OrderCheckingProcessor processor(nodes);
+
+    // the packets are made up front so that only the queue is timed
+    QVector<QByteArray> packets;
+    packets.reserve(NUM_PACKETS);
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        packets.append(editPacket(nodes[0], i));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        processor.queueReceivedPacket(nodes[0], packets[i]);
+    }
+    qint64 queueElapsed = timer.nsecsElapsed();
+
+    timer.restart();
+    processor.processQueuedPackets();
+    qint64 drainElapsed = timer.nsecsElapsed();
+
+    if (processor.getNumProcessed() != NUM_PACKETS || processor.getNumOutOfOrder() > 0) {
+        qDebug() << "ReceivedPacketProcessorTests::runBenchmarks() FAILED, not every packet was processed in order";
+    }
+
+    const double NSECS_PER_SECOND = 1e9;
+    qDebug("queue %d edit packets: %10.0f packets/sec", NUM_PACKETS, NUM_PACKETS * NSECS_PER_SECOND / queueElapsed);
+    qDebug("drain %d edit packets: %10.0f packets/sec", NUM_PACKETS, NUM_PACKETS * NSECS_PER_SECOND / drainElapsed);
+}
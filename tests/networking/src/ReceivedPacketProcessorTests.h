@@ -0,0 +1,26 @@
+//
+//  ReceivedPacketProcessorTests.h
+//  tests/networking/src
+//
+//  Created on 4/17/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_ReceivedPacketProcessorTests_h
+#define hifi_ReceivedPacketProcessorTests_h
+
+namespace ReceivedPacketProcessorTests {
+
+    void runAllTests();
+
+    // several threads queue edit packets while they're processed, checks every one is processed once and in order
+    void concurrentQueueTest();
+
+    // queues a burst of 100k edit packets and reports how fast they are drained
+    void runBenchmarks();
+};
+
+#endif // hifi_ReceivedPacketProcessorTests_h
@@ -8,11 +8,22 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include "DatagramSendTests.h"
+#include "PacketHashTests.h"
+#include "PacketRingTests.h"
+#include "ReceivedPacketProcessorTests.h"
 #include "SequenceNumberStatsTests.h"
 #include <stdio.h>
 
 int main(int argc, char** argv) {
     SequenceNumberStatsTests::runAllTests();
+    DatagramSendTests::runAllTests();
+    DatagramSendTests::runBenchmarks();
+    PacketHashTests::runAllTests();
+    PacketHashTests::runBenchmarks();
+    PacketRingTests::runAllTests();
+    ReceivedPacketProcessorTests::runAllTests();
+    ReceivedPacketProcessorTests::runBenchmarks();
     printf("tests passed! press enter to exit");
     getchar();
     return 0;
@@ -12,7 +12,11 @@
 //    * need to add expected results and accumulation of test success/failure
 //
 
+#include <QBuffer>
 #include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 
 #include <EntityItem.h>
 #include <EntityTree.h>
@@ -516,3 +520,206 @@ void EntityTests::runAllTests(bool verbose) {
     entityTreeTests(verbose);
 }
 
+// a persist file of randomly placed boxes
+static QByteArray makeBoxesPersistFile(int numEntities, QVector<QUuid>& ids) {
+    QJsonArray entitiesArray;
+    for (int i = 0; i < numEntities; i++) {
+        QUuid id = QUuid::createUuid();
+        ids << id;
+
+        QJsonObject position;
+        position["x"] = randFloatInRange(1.0f, (float)TREE_SCALE - 1.0f);
+        position["y"] = randFloatInRange(1.0f, (float)TREE_SCALE - 1.0f);
+        position["z"] = randFloatInRange(1.0f, (float)TREE_SCALE - 1.0f);
+        QJsonObject dimensions;
+        dimensions["x"] = dimensions["y"] = dimensions["z"] = randFloatInRange(0.1f, 10.0f);
+        QJsonObject color;
+        color["red"] = randIntInRange(0, 255);
+        color["green"] = randIntInRange(0, 255);
+        color["blue"] = randIntInRange(0, 255);
+
+        QJsonObject entity;
+        entity["id"] = id.toString();
+        entity["type"] = QString("Box");
+        entity["position"] = position;
+        entity["dimensions"] = dimensions;
+        entity["color"] = color;
+        entity["name"] = QString("box %1").arg(i);
+        entitiesArray.append(entity);
+    }
+    QJsonObject description;
+    description["Entities"] = entitiesArray;
+    return QJsonDocument(description).toJson();
+}
+
+// loads the same JSON persist file through readFromMap() and through readFromJSON(), and checks they agree
+void EntityTests::entityLoadBenchmark(int numEntities) {
+    qDebug() << "EntityTests::entityLoadBenchmark()" << numEntities << "entities";
+
+    QVector<QUuid> ids;
+    QByteArray persistFile = makeBoxesPersistFile(numEntities, ids);
+
+    EntityTree mapTree;
+    mapTree.setIsServer(true);
+    quint64 startMap = usecTimestampNow();
+    QVariantMap asMap = QJsonDocument::fromJson(persistFile).toVariant().toMap();
+    mapTree.readFromMap(asMap);
+    quint64 endMap = usecTimestampNow();
+
+    EntityTree jsonTree;
+    jsonTree.setIsServer(true);
+    quint64 startJSON = usecTimestampNow();
+    jsonTree.readFromJSON(QJsonDocument::fromJson(persistFile).object());
+    quint64 endJSON = usecTimestampNow();
+
+    int mismatches = 0;
+    foreach (const QUuid& id, ids) {
+        EntityItem* fromMap = mapTree.findEntityByID(id);
+        EntityItem* fromJSON = jsonTree.findEntityByID(id);
+        if (!fromMap || !fromJSON || fromMap->getPosition() != fromJSON->getPosition()
+                || fromMap->getDimensions() != fromJSON->getDimensions()
+                || mapTree.getContainingElement(EntityItemID(id))->getAACube()
+                    != jsonTree.getContainingElement(EntityItemID(id))->getAACube()) {
+            mismatches++;
+        }
+    }
+
+    qDebug() << "   persist file:" << persistFile.size() << "bytes";
+    qDebug() << "   readFromMap():" << (endMap - startMap) / USECS_PER_MSEC << "msecs";
+    qDebug() << "   readFromJSON():" << (endJSON - startJSON) / USECS_PER_MSEC << "msecs";
+    if (mismatches > 0) {
+        qDebug() << "   FAILED" << mismatches << "entities differ between the two loads";
+    } else {
+        qDebug() << "   both loads agree";
+    }
+}
+
+// the entities of the second list that aren't the same as the entity with their id in the first
+static int countMismatchedEntities(const QJsonArray& expected, const QJsonArray& actual) {
+    QHash<QString, QJsonObject> expectedByID;
+    foreach (const QJsonValue& entity, expected) {
+        expectedByID[entity.toObject().value("id").toString()] = entity.toObject();
+    }
+    int mismatches = 0;
+    foreach (const QJsonValue& entity, actual) {
+        QJsonObject entityObject = entity.toObject();
+        if (expectedByID.value(entityObject.value("id").toString()) != entityObject) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// writes the same tree through writeToMap() and through writeToJSON(), and checks both read back to the same entities
+void EntityTests::entityPersistBenchmark(int numEntities) {
+    qDebug() << "EntityTests::entityPersistBenchmark()" << numEntities << "entities";
+
+    QVector<QUuid> ids;
+    QByteArray persistFile = makeBoxesPersistFile(numEntities, ids);
+    EntityTree tree;
+    tree.setIsServer(true);
+    tree.readFromJSON(QJsonDocument::fromJson(persistFile).object());
+
+    quint64 startMap = usecTimestampNow();
+    QVariantMap entityDescription;
+    tree.writeToMap(entityDescription, tree.getRoot(), true);
+    QByteArray mapFile = QJsonDocument::fromVariant(entityDescription).toJson();
+    entityDescription.clear();
+    quint64 endMap = usecTimestampNow();
+
+    quint64 startJSON = usecTimestampNow();
+    QByteArray jsonFile;
+    QBuffer jsonBuffer(&jsonFile);
+    jsonBuffer.open(QIODevice::WriteOnly);
+    bool jsonWritten = tree.writeToJSON(jsonBuffer, tree.getRoot(), true);
+    jsonBuffer.close();
+    quint64 endJSON = usecTimestampNow();
+
+    QJsonArray fromMap = QJsonDocument::fromJson(mapFile).object().value("Entities").toArray();
+    QJsonArray fromJSON = QJsonDocument::fromJson(jsonFile).object().value("Entities").toArray();
+    int mismatches = countMismatchedEntities(fromMap, fromJSON);
+
+    qDebug() << "   writeToMap():" << (endMap - startMap) / USECS_PER_MSEC << "msecs" << mapFile.size() << "bytes";
+    qDebug() << "   writeToJSON():" << (endJSON - startJSON) / USECS_PER_MSEC << "msecs" << jsonFile.size() << "bytes";
+    if (!jsonWritten || fromJSON.size() != numEntities || fromMap.size() != numEntities || mismatches > 0) {
+        qDebug() << "   FAILED" << fromMap.size() << "and" << fromJSON.size() << "entities written,"
+            << mismatches << "differ";
+    } else {
+        qDebug() << "   both writes agree";
+    }
+}
+
+// writes a tree in the binary format and reads it back, against writing and reading it as JSON
+void EntityTests::entityBinaryBenchmark(int numEntities) {
+    qDebug() << "EntityTests::entityBinaryBenchmark()" << numEntities << "entities";
+
+    QVector<QUuid> ids;
+    QByteArray persistFile = makeBoxesPersistFile(numEntities, ids);
+    EntityTree tree;
+    tree.setIsServer(true);
+    tree.readFromJSON(QJsonDocument::fromJson(persistFile).object());
+
+    QByteArray jsonFile;
+    QBuffer jsonBuffer(&jsonFile);
+    jsonBuffer.open(QIODevice::WriteOnly);
+    tree.writeToJSON(jsonBuffer, tree.getRoot(), true);
+    jsonBuffer.close();
+
+    quint64 startWrite = usecTimestampNow();
+    QByteArray binaryFile;
+    QBuffer binaryBuffer(&binaryFile);
+    binaryBuffer.open(QIODevice::WriteOnly);
+    bool binaryWritten = tree.writeToBinary(binaryBuffer, tree.getRoot());
+    binaryBuffer.close();
+    quint64 endWrite = usecTimestampNow();
+
+    EntityTree jsonTree;
+    jsonTree.setIsServer(true);
+    quint64 startJSON = usecTimestampNow();
+    jsonTree.readFromJSON(QJsonDocument::fromJson(jsonFile).object());
+    quint64 endJSON = usecTimestampNow();
+
+    EntityTree binaryTree;
+    binaryTree.setIsServer(true);
+    quint64 startBinary = usecTimestampNow();
+    bool binaryRead = binaryTree.readFromBinary(reinterpret_cast<const uchar*>(binaryFile.constData()),
+                                                binaryFile.size());
+    quint64 endBinary = usecTimestampNow();
+
+    // what the binary file loaded has to write out the same JSON as the tree it was written from
+    QByteArray rewrittenFile;
+    QBuffer rewrittenBuffer(&rewrittenFile);
+    rewrittenBuffer.open(QIODevice::WriteOnly);
+    binaryTree.writeToJSON(rewrittenBuffer, binaryTree.getRoot(), true);
+    rewrittenBuffer.close();
+    QJsonArray original = QJsonDocument::fromJson(jsonFile).object().value("Entities").toArray();
+    QJsonArray rewritten = QJsonDocument::fromJson(rewrittenFile).object().value("Entities").toArray();
+    int mismatches = countMismatchedEntities(original, rewritten);
+    int misplaced = 0;
+    foreach (const QUuid& id, ids) {
+        EntityTreeElement* expected = tree.getContainingElement(EntityItemID(id));
+        EntityTreeElement* actual = binaryTree.getContainingElement(EntityItemID(id));
+        if (!expected || !actual || expected->getAACube() != actual->getAACube()) {
+            misplaced++;
+        }
+    }
+
+    qDebug() << "   JSON file:" << jsonFile.size() << "bytes, binary file:" << binaryFile.size() << "bytes";
+    qDebug() << "   writeToBinary():" << (endWrite - startWrite) / USECS_PER_MSEC << "msecs";
+    qDebug() << "   readFromJSON():" << (endJSON - startJSON) / USECS_PER_MSEC << "msecs";
+    qDebug() << "   readFromBinary():" << (endBinary - startBinary) / USECS_PER_MSEC << "msecs";
+    if (!binaryWritten || !binaryRead || rewritten.size() != numEntities || mismatches > 0 || misplaced > 0) {
+        qDebug() << "   FAILED" << rewritten.size() << "entities read back," << mismatches << "differ,"
+            << misplaced << "in the wrong element";
+    } else {
+        qDebug() << "   binary round trip matches";
+    }
+}
+
+void EntityTests::runBenchmarks() {
+    const int LOAD_BENCHMARK_ENTITIES = 100000;
+    entityLoadBenchmark(LOAD_BENCHMARK_ENTITIES);
+    entityPersistBenchmark(LOAD_BENCHMARK_ENTITIES);
+    entityBinaryBenchmark(LOAD_BENCHMARK_ENTITIES);
+}
+
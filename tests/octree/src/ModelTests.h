@@ -15,6 +15,11 @@
 namespace EntityTests {
     void entityTreeTests(bool verbose = false);
     void runAllTests(bool verbose = false);
+
+    void entityLoadBenchmark(int numEntities);
+    void entityPersistBenchmark(int numEntities);
+    void entityBinaryBenchmark(int numEntities);
+    void runBenchmarks();
 }
 
 #endif // hifi_EntityTests_h
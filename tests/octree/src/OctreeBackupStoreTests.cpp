@@ -0,0 +1,106 @@
+//
+//  OctreeBackupStoreTests.cpp
+//  tests/octree/src
+//
+//  Created on 4/24/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstdlib>
+
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QUuid>
+
+#include <OctreeBackupStore.h>
+
+#include "OctreeBackupStoreTests.h"
+
+// something shaped like a JSON persist file, many similar lines that each differ a little
+static QByteArray makePersistContent(int numLines) {
+    QByteArray content = "{\n    \"Entities\": [\n";
+    for (int i = 0; i < numLines; i++) {
+        content += QString("{\"id\":\"%1\",\"position\":{\"x\":%2,\"y\":%3,\"z\":%4},\"type\":\"Box\"},\n")
+            .arg(QUuid::createUuid().toString()).arg(rand() % 16384).arg(rand() % 16384).arg(rand() % 16384).toUtf8();
+    }
+    content += "    ]\n}\n";
+    return content;
+}
+
+static bool writeFile(const QString& fileName, const QByteArray& content) {
+    QFile file(fileName);
+    return file.open(QIODevice::WriteOnly) && file.write(content) == content.size();
+}
+
+static QByteArray readFile(const QString& fileName) {
+    QFile file(fileName);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void OctreeBackupStoreTests::runAllTests(bool verbose) {
+    backupRestoreTest(verbose);
+}
+
+void OctreeBackupStoreTests::backupRestoreTest(bool verbose) {
+    QDir testDirectory(QDir::temp().filePath("OctreeBackupStoreTests-" + QUuid::createUuid().toString().mid(1, 8)));
+    testDirectory.mkpath(".");
+    QString persistFileName = testDirectory.filePath("models.json");
+    QString restoredFileName = testDirectory.filePath("restored.json");
+    OctreeBackupStore store(persistFileName);
+
+    const int NUM_LINES = 50000;
+    QByteArray firstContent = makePersistContent(NUM_LINES);
+    writeFile(persistFileName, firstContent);
+    bool passed = store.addVersion(persistFileName, "test");
+    int firstChunks = store.getChunksWritten();
+
+    // an entity added in the middle of the file
+    QByteArray secondContent = firstContent;
+    secondContent.insert(secondContent.size() / 2, makePersistContent(1).mid(20));
+    writeFile(persistFileName, secondContent);
+    passed = passed && store.addVersion(persistFileName, "test");
+    int secondChunks = store.getChunksWritten();
+    int reusedChunks = store.getChunksReused();
+
+    const int MAX_CHUNKS_CHANGED_BY_EDIT = 3;
+    if (secondChunks > MAX_CHUNKS_CHANGED_BY_EDIT) {
+        qDebug() << "backupRestoreTest() FAILED, an edit wrote" << secondChunks << "of" << firstChunks << "chunks";
+        passed = false;
+    }
+
+    QList<OctreeBackupStore::Version> versions = store.getVersions("test");
+    if (versions.size() != 2) {
+        qDebug() << "backupRestoreTest() FAILED," << versions.size() << "versions stored";
+        passed = false;
+    } else {
+        if (!store.restoreVersion(versions[0], restoredFileName) || readFile(restoredFileName) != secondContent) {
+            qDebug() << "backupRestoreTest() FAILED to restore the newest version";
+            passed = false;
+        }
+        if (!store.restoreVersion(versions[1], restoredFileName) || readFile(restoredFileName) != firstContent) {
+            qDebug() << "backupRestoreTest() FAILED to restore the oldest version";
+            passed = false;
+        }
+    }
+
+    store.pruneVersions("test", 1);
+    versions = store.getVersions("test");
+    if (versions.size() != 1 || !store.restoreVersion(versions[0], restoredFileName)
+            || readFile(restoredFileName) != secondContent) {
+        qDebug() << "backupRestoreTest() FAILED to restore the newest version after pruning";
+        passed = false;
+    }
+
+    if (verbose) {
+        qDebug() << "first version" << firstChunks << "chunks, second version" << secondChunks << "written and"
+            << reusedChunks << "reused";
+    }
+    testDirectory.removeRecursively();
+    if (passed) {
+        qDebug() << "backupRestoreTest() passed";
+    }
+}
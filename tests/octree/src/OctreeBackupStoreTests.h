@@ -0,0 +1,24 @@
+//
+//  OctreeBackupStoreTests.h
+//  tests/octree/src
+//
+//  Created on 4/24/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeBackupStoreTests_h
+#define hifi_OctreeBackupStoreTests_h
+
+namespace OctreeBackupStoreTests {
+
+    void runAllTests(bool verbose);
+
+    // backs up a file, edits the middle of it and backs it up again, then checks that the second version only wrote
+    // the chunks around the edit, that both versions restore to what was backed up, and that pruning keeps the newest
+    void backupRestoreTest(bool verbose);
+};
+
+#endif // hifi_OctreeBackupStoreTests_h
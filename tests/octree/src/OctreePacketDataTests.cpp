@@ -0,0 +1,151 @@
+//
+//  OctreePacketDataTests.cpp
+//  tests/octree/src
+//
+//  Created on 4/18/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstdlib>
+
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+
+#include <OctreePacketData.h>
+
+#include "OctreePacketDataTests.h"
+
+// something shaped like entity data, a few fixed fields that repeat between items and some that don't compress at all
+static void appendTestItem(OctreePacketData& packetData, int itemNumber) {
+    packetData.appendValue((quint64)itemNumber);
+    packetData.appendValue(glm::vec3(itemNumber % 8, 1.0f, (float)(rand() % 1000) / 100.0f));
+    packetData.appendColor(itemNumber % 256, 128, 64);
+    packetData.appendValue((uint32_t)rand());
+    packetData.appendValue((uint8_t)(itemNumber % 3));
+}
+
+static bool uncompressesToContent(OctreePacketData& packetData) {
+    QByteArray uncompressed = qUncompress(packetData.getFinalizedData(), packetData.getFinalizedSize());
+    return uncompressed == QByteArray((const char*)packetData.getUncompressedData(), packetData.getUncompressedSize());
+}
+
+void OctreePacketDataTests::runAllTests(bool verbose) {
+    compressionRoundTripTest(verbose);
+}
+
+void OctreePacketDataTests::compressionRoundTripTest(bool verbose) {
+    OctreePacketData packetData(true);
+
+    const int NUM_PACKETS = 2000;
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        packetData.setCompressionLevel(1 + i % 9);
+        packetData.reset();
+
+        int item = 0;
+        bool fits = true;
+        while (fits) {
+            LevelDetails level = packetData.startLevel();
+            int bitmaskOffset = packetData.getUncompressedByteOffset();
+            fits = packetData.appendBitMask(0);
+            appendTestItem(packetData, item++);
+
+            switch (rand() % 4) {
+                case 0:
+                    packetData.discardLevel(level);
+                    break;
+                case 1:
+                    packetData.updatePriorBitMask(bitmaskOffset, (unsigned char)item);
+                    packetData.endLevel(level);
+                    break;
+                default:
+                    packetData.endLevel(level);
+                    break;
+            }
+
+            if (rand() % 3 == 0 && !uncompressesToContent(packetData)) {
+                qDebug() << "compressionRoundTripTest() FAILED after" << item << "items of packet" << i;
+                return;
+            }
+        }
+
+        if (!uncompressesToContent(packetData)) {
+            qDebug() << "compressionRoundTripTest() FAILED for packet" << i;
+            return;
+        }
+
+        OctreePacketData loadedData(true);
+        loadedData.loadFinalizedContent(packetData.getFinalizedData(), packetData.getFinalizedSize());
+        if (loadedData.getUncompressedSize() != packetData.getUncompressedSize()) {
+            qDebug() << "compressionRoundTripTest() FAILED to load packet" << i;
+            return;
+        }
+    }
+
+    if (verbose) {
+        qDebug() << "compressed" << NUM_PACKETS << "packets in" << OctreePacketData::getCompressContentCalls() << "calls";
+    }
+    qDebug() << "compressionRoundTripTest() passed";
+}
+
+void OctreePacketDataTests::runBenchmarks() {
+    OctreePacketData packetData(true);
+    int item = 0;
+    while (packetData.getUncompressedSize() < (int)MAX_OCTREE_PACKET_DATA_SIZE - 100) {
+        appendTestItem(packetData, item++);
+    }
+    QByteArray content((const char*)packetData.getUncompressedData(), packetData.getUncompressedSize());
+
+    const int NUM_PACKETS = 10000;
+    const int APPENDS_PER_CHECK = 100;
+    const double NSECS_PER_USEC = 1000.0;
+    QElapsedTimer timer;
+
+    for (int level = 1; level <= 9; level += 4) {
+        int qCompressBytes = 0;
+        timer.start();
+        for (int i = 0; i < NUM_PACKETS; i++) {
+            qCompressBytes = qCompress(content, level).size();
+        }
+        qint64 qCompressElapsed = timer.nsecsElapsed();
+
+        packetData.setCompressionLevel(level);
+        timer.restart();
+        for (int i = 0; i < NUM_PACKETS; i++) {
+            packetData.reset();
+            packetData.appendRawData((const unsigned char*)content.constData(), content.size());
+            packetData.getFinalizedSize();
+        }
+        qint64 finalizedElapsed = timer.nsecsElapsed();
+        int finalizedBytes = packetData.getFinalizedSize();
+
+        // checking the size every few appends, as packing for the size of the compressed packet would
+        timer.restart();
+        for (int i = 0; i < NUM_PACKETS; i++) {
+            for (int size = APPENDS_PER_CHECK; size < content.size(); size += APPENDS_PER_CHECK) {
+                qCompress(content.left(size), level);
+            }
+        }
+        qint64 qCompressCheckingElapsed = timer.nsecsElapsed();
+
+        timer.restart();
+        for (int i = 0; i < NUM_PACKETS; i++) {
+            packetData.reset();
+            for (int offset = 0; offset < content.size(); offset += APPENDS_PER_CHECK) {
+                packetData.appendRawData((const unsigned char*)content.constData() + offset,
+                                         qMin(APPENDS_PER_CHECK, content.size() - offset));
+                packetData.getFinalizedSize();
+            }
+        }
+        qint64 incrementalCheckingElapsed = timer.nsecsElapsed();
+
+        qDebug("level %d, %d bytes: qCompress() %6.1f usecs %d bytes, packet data %6.1f usecs %d bytes", level,
+               content.size(), qCompressElapsed / NSECS_PER_USEC / NUM_PACKETS, qCompressBytes,
+               finalizedElapsed / NSECS_PER_USEC / NUM_PACKETS, finalizedBytes);
+        qDebug("    checked every %d bytes: qCompress() %6.1f usecs, packet data %6.1f usecs", APPENDS_PER_CHECK,
+               qCompressCheckingElapsed / NSECS_PER_USEC / NUM_PACKETS,
+               incrementalCheckingElapsed / NSECS_PER_USEC / NUM_PACKETS);
+    }
+}
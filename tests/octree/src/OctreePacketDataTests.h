@@ -0,0 +1,27 @@
+//
+//  OctreePacketDataTests.h
+//  tests/octree/src
+//
+//  Created on 4/18/15.
+//  Copyright 2015 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreePacketDataTests_h
+#define hifi_OctreePacketDataTests_h
+
+namespace OctreePacketDataTests {
+
+    void runAllTests(bool verbose);
+
+    // checks that the incrementally compressed packets still come out of qUncompress() as what was packed, through
+    // appends, discarded levels and updates to prior bytes
+    void compressionRoundTripTest(bool verbose);
+
+    // time per compressed packet, finalized once and checked after every few appends, against qCompress()
+    void runBenchmarks();
+};
+
+#endif // hifi_OctreePacketDataTests_h
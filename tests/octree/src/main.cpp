@@ -10,6 +10,8 @@
 
 #include "AABoxCubeTests.h"
 #include "ModelTests.h" // needs to be EntityTests.h soon
+#include "OctreeBackupStoreTests.h"
+#include "OctreePacketDataTests.h"
 #include "OctreeTests.h"
 #include "SharedUtil.h"
 
@@ -20,5 +22,9 @@ int main(int argc, const char* argv[]) {
     //OctreeTests::runAllTests(verbose);
     //AABoxCubeTests::runAllTests(verbose);
     EntityTests::runAllTests(verbose);
+    EntityTests::runBenchmarks();
+    OctreePacketDataTests::runAllTests(verbose);
+    OctreePacketDataTests::runBenchmarks();
+    OctreeBackupStoreTests::runAllTests(verbose);
     return 0;
 }